@@ -0,0 +1,138 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares a sum, average and maximum per group computed natively by the aggregate option with the
+// same reduction in JavaScript over row objects and over columnar results, for a 100k instance class.
+// Runs against the stand-in provider where available, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/aggregationBenchmark.js [iterations] [rows]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 10;
+const kRowCount = Number(process.argv[3]) || 100000;
+
+let query;
+let key;
+let summed;
+let averaged;
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount });
+    query = 'SELECT * FROM StandIn_Typed';
+    key = 'Enabled';
+    summed = 'Count';
+    averaged = 'Ratio';
+} else {
+    query = 'SELECT * FROM Win32_Process';
+    key = 'SessionId';
+    summed = 'WorkingSetSize';
+    averaged = 'ThreadCount';
+}
+const properties = [key, summed, averaged];
+
+// 64-bit properties are summed as Numbers in JavaScript, ask for the same from the native sums
+const kOptions = { typed: true, int64: 'number' };
+
+function reduceRows(rows) {
+    let groups = new Map();
+    for (let row of rows) {
+        let group = groups.get(row[key]);
+        if (!group) {
+            group = { sum: 0, total: 0, count: 0, max: -Infinity };
+            groups.set(row[key], group);
+        }
+        group.sum += row[summed];
+        group.total += row[averaged];
+        group.max = Math.max(group.max, row[averaged]);
+        ++group.count;
+    }
+    return groups.size;
+}
+
+function reduceColumns(result) {
+    let keys = result.data[key];
+    let sums = result.data[summed];
+    let averages = result.data[averaged];
+    let groups = new Map();
+    for (let i = 0; i < result.rows; ++i) {
+        let group = groups.get(keys[i]);
+        if (!group) {
+            group = { sum: 0, total: 0, count: 0, max: -Infinity };
+            groups.set(keys[i], group);
+        }
+        group.sum += sums[i];
+        group.total += averages[i];
+        group.max = Math.max(group.max, averages[i]);
+        ++group.count;
+    }
+    return groups.size;
+}
+
+function measure(name, run) {
+    // One warm up round so every variant starts with a pooled connection
+    run();
+
+    let start = process.hrtime.bigint();
+    let groups = 0;
+    for (let i = 0; i < kIterations; ++i) {
+        groups += run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(2)}ms per query, ${(groups / kIterations).toFixed(0)} groups`);
+}
+
+measure('rows + reduce', () => reduceRows(Object.values(wmi.query('root/cimv2', query, properties, kOptions))));
+
+measure('columnar + reduce', () => reduceColumns(wmi.query('root/cimv2', query, properties, { ...kOptions, format: 'columnar' })));
+
+measure('aggregate', () => {
+    let groups = wmi.query('root/cimv2', query, undefined, {
+        ...kOptions,
+        aggregate: {
+            groupBy: key,
+            values: {
+                sum: { op: 'sum', property: summed },
+                average: { op: 'avg', property: averaged },
+                max: { op: 'max', property: averaged },
+                count: { op: 'count' }
+            }
+        }
+    });
+    return groups.length;
+});
+
+measure('aggregate, filtered', () => {
+    let groups = wmi.query('root/cimv2', query, undefined, {
+        ...kOptions,
+        aggregate: {
+            where: [{ property: averaged, op: '>', value: 10 }],
+            groupBy: key,
+            values: { sum: { op: 'sum', property: summed } }
+        }
+    });
+    return groups.length;
+});
\ No newline at end of file
@@ -0,0 +1,91 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Reports of the benchmark and soak scripts, written as JSON in the format Google Benchmark uses for
+// --benchmark_out so the same tools can compare them. See compareBenchmarks.js.
+
+const fs = require('fs');
+const os = require('os');
+
+function createReport(script) {
+    let cpus = os.cpus();
+    return {
+        context: {
+            date: new Date().toISOString(),
+            host_name: os.hostname(),
+            executable: `node ${script}`,
+            num_cpus: cpus.length,
+            mhz_per_cpu: cpus.length > 0 ? cpus[0].speed : 0,
+            cpu_model: cpus.length > 0 ? cpus[0].model : '',
+            platform: `${process.platform}-${process.arch}`,
+            node_version: process.version,
+            library_build_type: 'release'
+        },
+        benchmarks: []
+    };
+}
+
+/**
+ * Adds a run measured over iterations
+ *
+ * @param entry name, iterations, realTimeNs and cpuTimeNs per iteration, optional items and bytes per
+ *              iteration, and counters added as they are, like the user counters of Google Benchmark
+ */
+function addBenchmark(report, entry) {
+    let seconds = entry.realTimeNs / 1e9;
+    let benchmark = {
+        name: entry.name,
+        run_name: entry.name,
+        run_type: 'iteration',
+        repetitions: 1,
+        repetition_index: 0,
+        threads: 1,
+        iterations: entry.iterations,
+        real_time: entry.realTimeNs,
+        cpu_time: entry.cpuTimeNs,
+        time_unit: 'ns'
+    };
+    if (entry.items && seconds > 0) {
+        benchmark.items_per_second = entry.items / seconds;
+    }
+    if (entry.bytes && seconds > 0) {
+        benchmark.bytes_per_second = entry.bytes / seconds;
+    }
+    report.benchmarks.push(Object.assign(benchmark, entry.counters));
+    return benchmark;
+}
+
+// Writes the report to path, or to stdout when path is '-'
+function writeReport(report, path) {
+    let json = JSON.stringify(report, null, 2);
+    if (path === '-') {
+        process.stdout.write(json + '\n');
+    } else {
+        fs.writeFileSync(path, json + '\n');
+    }
+}
+
+module.exports = { createReport, addBenchmark, writeReport };
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares the row and columnar result formats for a 10k instance by 20 property result set,
+// including the pivot into per-property arrays that row results need before charting.
+// Runs against the stand-in provider where available, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/columnarBenchmark.js [iterations]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = 10000;
+
+let properties;
+let query;
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount });
+    const numeric = ['Level', 'Offset', 'Port', 'Count', 'Delta', 'Ratio', 'Load', 'Total', 'Balance', 'Enabled'];
+    const text = Array.from({ length: 10 }, (_, i) => `Text${i}`);
+    properties = numeric.concat(text);
+    query = `SELECT ${properties.join(',')} FROM StandIn_Typed`;
+} else {
+    properties = ['ProcessId', 'ParentProcessId', 'ThreadCount', 'HandleCount', 'Priority', 'SessionId', 'PageFaults',
+        'PeakVirtualSize', 'PeakWorkingSetSize', 'PrivatePageCount', 'ReadOperationCount', 'WriteOperationCount',
+        'KernelModeTime', 'UserModeTime', 'VirtualSize', 'WorkingSetSize', 'Name', 'Caption', 'ExecutablePath', 'CommandLine'];
+    query = `SELECT ${properties.join(',')} FROM Win32_Process`;
+}
+
+function pivot(rows) {
+    let data = {};
+    for (let property of properties) {
+        data[property] = rows.map(row => row[property]);
+    }
+    return data;
+}
+
+function measure(name, run) {
+    // One warm up round so every format starts with a pooled connection
+    run();
+
+    let start = process.hrtime.bigint();
+    let rows = 0;
+    for (let i = 0; i < kIterations; ++i) {
+        rows += run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(2)}ms per query, ${(rows / kIterations).toFixed(0)} rows`);
+}
+
+measure('rows', () => {
+    let result = wmi.query('root/cimv2', query, properties, { typed: true });
+    return Object.keys(result).length;
+});
+
+measure('rows + pivot', () => {
+    let data = pivot(Object.values(wmi.query('root/cimv2', query, properties, { typed: true })));
+    return data[properties[0]].length;
+});
+
+measure('columnar', () => {
+    let result = wmi.query('root/cimv2', query, properties, { typed: true, format: 'columnar' });
+    return result.rows;
+});
+
+measure('columnar, 64 bit as Number', () => {
+    let result = wmi.query('root/cimv2', query, properties, { typed: true, int64: 'number', format: 'columnar' });
+    return result.rows;
+});
\ No newline at end of file
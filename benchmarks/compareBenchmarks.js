@@ -0,0 +1,83 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares two reports of pipelineBenchmark.js, or of any Google Benchmark run written with
+// --benchmark_out, and fails when a benchmark got slower. A benchmark regressed when its real time
+// per iteration grew by more than thresholdPercent (default 10). Benchmarks only present in one of
+// the reports are listed but don't fail the comparison.
+//
+// Usage: node benchmarks/compareBenchmarks.js baseline.json current.json [thresholdPercent]
+
+const fs = require('fs');
+
+const kBaselinePath = process.argv[2];
+const kCurrentPath = process.argv[3];
+const kThresholdPercent = process.argv[4] !== undefined ? Number(process.argv[4]) : 10;
+
+function readBenchmarks(path) {
+    let report = JSON.parse(fs.readFileSync(path, 'utf8'));
+    let benchmarks = new Map();
+    for (let benchmark of report.benchmarks || []) {
+        // Only plain runs, not the aggregates of repeated runs
+        if (benchmark.run_type === undefined || benchmark.run_type === 'iteration') {
+            benchmarks.set(benchmark.name, benchmark);
+        }
+    }
+    return benchmarks;
+}
+
+function compare() {
+    if (!kBaselinePath || !kCurrentPath || !(kThresholdPercent >= 0)) {
+        console.error('Usage: node benchmarks/compareBenchmarks.js baseline.json current.json [thresholdPercent]');
+        return 2;
+    }
+
+    let baseline = readBenchmarks(kBaselinePath);
+    let current = readBenchmarks(kCurrentPath);
+    let regressions = 0;
+    for (let [name, benchmark] of current) {
+        let before = baseline.get(name);
+        if (!before) {
+            console.log(`${name.padEnd(48)} new`);
+            continue;
+        }
+        let change = (benchmark.real_time / before.real_time - 1) * 100;
+        let regressed = change > kThresholdPercent;
+        regressions += regressed ? 1 : 0;
+        console.log(`${name.padEnd(48)} ${before.real_time.toFixed(0).padStart(12)} -> ${benchmark.real_time.toFixed(0).padStart(12)}` +
+            `${benchmark.time_unit || 'ns'} ${change >= 0 ? '+' : ''}${change.toFixed(1)}%${regressed ? ' REGRESSION' : ''}`);
+    }
+    for (let name of baseline.keys()) {
+        if (!current.has(name)) {
+            console.log(`${name.padEnd(48)} missing`);
+        }
+    }
+
+    console.log(`${regressions} of ${current.size} benchmarks more than ${kThresholdPercent}% slower`);
+    return regressions > 0 ? 1 : 0;
+}
+
+process.exitCode = compare();
\ No newline at end of file
@@ -0,0 +1,51 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Wall time and number of Next calls of queries of different sizes, where every Next call costs a
+// round trip to the provider. The batch size adapts to how fast the provider returns instances.
+// Runs against the stand-in provider where available, with nextLatencyMs per call, otherwise
+// against Win32_Process, reporting the time spent waiting in Next.
+//
+// Usage: node benchmarks/enumerationBenchmark.js [nextLatencyMs]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kNextLatencyMs = Number(process.argv[2]) || 1;
+
+if (standIn) {
+    for (let rows of [10, 100, 1000, 10000]) {
+        standIn.enable({ rowCount: rows, nextLatencyMs: kNextLatencyMs });
+        let started = process.hrtime.bigint();
+        wmi.query('root/cimv2', 'SELECT Caption FROM StandIn_Enumerated', ['Caption']);
+        let elapsedMs = Number(process.hrtime.bigint() - started) / 1e6;
+        let calls = standIn.lastExecQuery().nextCounts.length;
+        console.log(`${rows} rows: ${calls} Next calls (${Math.ceil(rows / 10) + 1} at 10 per call), ${elapsedMs.toFixed(1)}ms`);
+    }
+} else {
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', ['Name'], { timings: true });
+    console.log(`Win32_Process: ${result.timings.rows} rows, ${result.timings.nextMs.toFixed(1)}ms in Next, ${result.timings.totalMs.toFixed(1)}ms total`);
+}
\ No newline at end of file
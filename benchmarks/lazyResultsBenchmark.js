@@ -0,0 +1,90 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares eager and lazy results of a SELECT * query over a wide class when a few properties of each
+// instance are read, and when all of them are. Runs against the stand-in provider where available,
+// with 200 properties per instance, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/lazyResultsBenchmark.js [iterations] [rows] [properties]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = Number(process.argv[3]) || 5000;
+const kPropertyCount = Number(process.argv[4]) || 200;
+
+let query;
+let read;
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount, propertyCount: kPropertyCount });
+    query = 'SELECT * FROM StandIn_Wide';
+    read = ['Property0', 'Property1', 'Property2'];
+} else {
+    query = 'SELECT * FROM Win32_Process';
+    read = ['Name', 'ProcessId', 'WorkingSetSize'];
+}
+
+function readSome(results) {
+    let length = 0;
+    for (let row of Object.values(results)) {
+        for (let property of read) {
+            length += String(row[property]).length;
+        }
+    }
+    return length;
+}
+
+function readAll(results) {
+    let length = 0;
+    for (let row of Object.values(results)) {
+        for (let property in row) {
+            length += String(row[property]).length;
+        }
+    }
+    return length;
+}
+
+function measure(name, run) {
+    // One warm up round so every variant starts with a pooled connection
+    run();
+
+    let start = process.hrtime.bigint();
+    for (let i = 0; i < kIterations; ++i) {
+        run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    let heapMb = process.memoryUsage().heapUsed / (1024 * 1024);
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(2)}ms per query, heap ${heapMb.toFixed(1)}MB`);
+}
+
+measure(`eager, ${read.length} properties read`, () => readSome(wmi.query('root/cimv2', query)));
+
+measure(`lazy, ${read.length} properties read`, () => readSome(wmi.query('root/cimv2', query, undefined, { lazy: true })));
+
+measure('eager, every property read', () => readAll(wmi.query('root/cimv2', query)));
+
+measure('lazy, every property read', () => readAll(wmi.query('root/cimv2', query, undefined, { lazy: true })));
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Time spent turning native results into JavaScript objects, from the marshal stage of the query
+// timings, for rows of ASCII strings and rows of wide strings with non-ASCII property names.
+// Wide values include a character outside the Basic Multilingual Plane.
+// Runs against the stand-in provider where available, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/marshallingBenchmark.js [iterations] [rows]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = Number(process.argv[3]) || 20000;
+
+function measure(name, query, properties, options) {
+    // One warm up round, then keep the fastest so garbage collection doesn't decide the outcome
+    wmi.query('root/cimv2', query, properties, options);
+
+    let best = Infinity;
+    let rows = 0;
+    for (let i = 0; i < kIterations; ++i) {
+        let result = wmi.query('root/cimv2', query, properties, Object.assign({ timings: true }, options));
+        best = Math.min(best, result.timings.marshalMs);
+        rows = result.timings.rows;
+    }
+    console.log(`${name}: ${best.toFixed(2)}ms to marshal ${rows} rows, ${(best * 1e6 / Math.max(rows, 1)).toFixed(0)}ns per row`);
+}
+
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount });
+    const ascii = Array.from({ length: 10 }, (_, i) => `Text${i}`);
+    const wide = ['Label'].concat(Array.from({ length: 9 }, (_, i) => `Größe${i}`));
+    measure('ascii strings', `SELECT ${ascii.join(',')} FROM StandIn_Text`, ascii, { typed: true });
+    measure('wide strings ', `SELECT ${wide.join(',')} FROM StandIn_Wide`, wide, { typed: true });
+} else {
+    const properties = ['Name', 'Caption', 'Description', 'ExecutablePath', 'CommandLine'];
+    measure('Win32_Process', `SELECT ${properties.join(',')} FROM Win32_Process`, properties, { typed: true });
+}
\ No newline at end of file
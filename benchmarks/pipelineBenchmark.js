@@ -0,0 +1,174 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Reproducible benchmarks of the query pipeline, reported as Google Benchmark JSON for regression
+// gating with compareBenchmarks.js. On Linux the stages of the pipeline are first measured natively
+// with standIn.benchmark: building the query parameters, converting property values, reading
+// instances into results and converting results to JavaScript objects. Then whole queries through
+// every API run against the stand-in provider, whose instances are the same on every run, and
+// against WMI on Windows. Each benchmark runs for at least minTimeMs.
+//
+// Usage: node benchmarks/pipelineBenchmark.js [minTimeMs] [jsonPath]
+// jsonPath '-' writes the report to stdout and the summary to stderr.
+
+const wmi = require('../build/Release/wmi_native_module');
+const { createReport, addBenchmark, writeReport } = require('./benchmarkReport');
+
+const standIn = wmi.standIn;
+const kMinTimeMs = Number(process.argv[2]) || 500;
+const kJsonPath = process.argv[3];
+const log = kJsonPath === '-' ? console.error : console.log;
+
+const kStages = [
+    ['params', { properties: 5 }],
+    ['params', { properties: 50 }],
+    ['format', { properties: 20, typed: false }],
+    ['format', { properties: 20, typed: true }],
+    ['build', { rows: 1000, properties: 20, typed: false }],
+    ['build', { rows: 1000, properties: 20, typed: true }],
+    ['marshal', { rows: 1000, properties: 20, typed: false }],
+    ['marshal', { rows: 1000, properties: 20, typed: true }],
+    ['marshal', { rows: 10, properties: 5, typed: true }]
+];
+
+const kRowCount = 1000;
+const kPropertyCount = 20;
+
+// The stand-in produces kRowCount instances of any class, WMI answers with what the machine has
+function getQuery() {
+    if (standIn) {
+        let properties = Array.from({ length: kPropertyCount }, (_, i) => `Property${i}`);
+        return ['root/cimv2', `SELECT ${properties.join(', ')} FROM StandIn_Pipeline`, properties];
+    }
+    let properties = ['Name', 'ProcessId', 'ParentProcessId', 'ThreadCount', 'HandleCount', 'WorkingSetSize', 'CreationDate'];
+    return ['root/cimv2', `SELECT ${properties.join(', ')} FROM Win32_Process`, properties];
+}
+
+function countRows(result) {
+    return Array.isArray(result.columns) ? result.rows : Object.keys(result).length;
+}
+
+function percentile(sorted, fraction) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * fraction))];
+}
+
+// Runs one call after the other until kMinTimeMs passed, after one warmup call
+async function measureEndToEnd(report, name, run) {
+    await run();
+
+    let latencies = [];
+    let rows = 0;
+    let cpuStart = process.cpuUsage();
+    let start = process.hrtime.bigint();
+    let end = start + BigInt(kMinTimeMs) * 1000000n;
+    let now = start;
+    while (now < end || latencies.length < 3) {
+        rows += await run();
+        let finished = process.hrtime.bigint();
+        latencies.push(Number(finished - now));
+        now = finished;
+    }
+    let cpu = process.cpuUsage(cpuStart);
+
+    let iterations = latencies.length;
+    let realTimeNs = Number(now - start) / iterations;
+    latencies.sort((a, b) => a - b);
+    let benchmark = addBenchmark(report, {
+        name: name,
+        iterations: iterations,
+        realTimeNs: realTimeNs,
+        cpuTimeNs: (cpu.user + cpu.system) * 1000 / iterations,
+        items: rows / iterations,
+        counters: { p50_ns: percentile(latencies, 0.5), p99_ns: percentile(latencies, 0.99), max_ns: latencies[iterations - 1] }
+    });
+    log(`${name.padEnd(44)} ${(realTimeNs / 1e3).toFixed(1).padStart(10)}us mean, ` +
+        `${(benchmark.p50_ns / 1e3).toFixed(1)}us p50, ${(benchmark.p99_ns / 1e3).toFixed(1)}us p99, ` +
+        `${(benchmark.items_per_second || 0).toFixed(0)} rows/s`);
+}
+
+function runStages(report) {
+    for (let [stage, options] of kStages) {
+        let result = standIn.benchmark(stage, Object.assign({ minTimeMs: kMinTimeMs }, options));
+        addBenchmark(report, {
+            name: result.name,
+            iterations: result.iterations,
+            realTimeNs: result.realTimeNs,
+            cpuTimeNs: result.cpuTimeNs,
+            items: result.itemsPerSecond * result.realTimeNs / 1e9,
+            bytes: result.bytesPerSecond * result.realTimeNs / 1e9
+        });
+        log(`${result.name.padEnd(44)} ${(result.realTimeNs / 1e3).toFixed(1).padStart(10)}us, ` +
+            `${result.itemsPerSecond.toFixed(0)} items/s, ${(result.bytesPerSecond / 1048576).toFixed(1)}MiB/s`);
+    }
+}
+
+async function runEndToEnd(report) {
+    let [namespace, query, properties] = getQuery();
+    let suffix = standIn ? `rows:${kRowCount}/properties:${kPropertyCount}` : 'Win32_Process';
+
+    await measureEndToEnd(report, `e2e/query/${suffix}`, () => countRows(wmi.query(namespace, query, properties)));
+    await measureEndToEnd(report, `e2e/queryAsync/${suffix}`,
+        async () => countRows(await wmi.queryAsync(namespace, query, properties)));
+    await measureEndToEnd(report, `e2e/queryAsync/${suffix}/typed`,
+        async () => countRows(await wmi.queryAsync(namespace, query, properties, { typed: true })));
+    await measureEndToEnd(report, `e2e/queryAsync/${suffix}/columnar`,
+        async () => countRows(await wmi.queryAsync(namespace, query, properties, { typed: true, format: 'columnar' })));
+    await measureEndToEnd(report, `e2e/queryStream/${suffix}`, async () => {
+        let rows = 0;
+        for await (let batch of wmi.queryStream(namespace, query, properties, { batchSize: 100 })) {
+            rows += batch.length;
+        }
+        return rows;
+    });
+
+    let prepared = wmi.prepare(namespace, query, properties);
+    await measureEndToEnd(report, `e2e/prepared/${suffix}`, async () => countRows(await prepared.runAsync()));
+    prepared.close();
+
+    await measureEndToEnd(report, `e2e/queryTyped/Win32_Processor`,
+        async () => countRows(await wmi.queryTyped('Win32_Processor')));
+}
+
+async function runBenchmarks() {
+    let report = createReport('benchmarks/pipelineBenchmark.js');
+    report.context.provider = standIn ? 'stand-in' : 'wmi';
+    report.context.min_time_ms = kMinTimeMs;
+
+    if (standIn) {
+        standIn.enable({ rowCount: kRowCount });
+        runStages(report);
+    }
+    await runEndToEnd(report);
+
+    if (kJsonPath) {
+        writeReport(report, kJsonPath);
+    }
+}
+
+runBenchmarks().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,74 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Per-call cost of a small query that runs over and over, such as a polling loop reading a few
+// properties of one instance, through query and through a query prepared once with prepare.
+// The second round serves every call from the result cache, where the parsing is all that's left.
+// Runs against the stand-in provider where available, otherwise against Win32_OperatingSystem.
+//
+// Usage: node benchmarks/preparedQueryBenchmark.js [calls]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kCalls = Number(process.argv[2]) || 20000;
+
+function measure(name, run) {
+    // Warm up, then keep the fastest of three rounds so garbage collection doesn't decide the outcome
+    run();
+    let best = Infinity;
+    for (let round = 0; round < 3; ++round) {
+        let start = process.hrtime.bigint();
+        for (let i = 0; i < kCalls; ++i) {
+            run();
+        }
+        best = Math.min(best, Number(process.hrtime.bigint() - start) / 1e3 / kCalls);
+    }
+    console.log(`${name}: ${best.toFixed(2)}us per call`);
+    return best;
+}
+
+function compare(label, query, properties, options) {
+    let adHoc = measure(`${label} query   `, () => wmi.query('root/cimv2', query, properties, options));
+    let prepared = wmi.prepare('root/cimv2', query, properties, options);
+    let reused = measure(`${label} prepared`, () => prepared.run());
+    prepared.close();
+    console.log(`${label} speedup: ${(adHoc / reused).toFixed(2)}x`);
+}
+
+let query;
+let properties;
+if (standIn) {
+    standIn.enable({ rowCount: 1 });
+    properties = ['Caption', 'Level', 'Total', 'Ratio'];
+    query = `SELECT ${properties.join(', ')} FROM StandIn_Polled WHERE Caption = 'StandIn_Polled.Caption.0'`;
+} else {
+    properties = ['FreePhysicalMemory', 'FreeVirtualMemory', 'NumberOfProcesses'];
+    query = `SELECT ${properties.join(', ')} FROM Win32_OperatingSystem`;
+}
+
+compare('uncached', query, properties, { typed: true, cacheTtlMs: 0 });
+compare('cached  ', query, properties, { typed: true, cacheTtlMs: 60000 });
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Measures the per-row cost of reading numeric properties of a 10k instance result set through
+// cached property handles and, on the stand-in provider, compares it with reading them by name.
+// Runs against the stand-in provider where available, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/propertyHandleBenchmark.js [iterations]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = 10000;
+
+let properties;
+let query;
+if (standIn) {
+    properties = ['Count', 'Delta', 'Total', 'Balance', 'Ratio', 'Load', 'Capacity', 'Enabled'];
+    query = `SELECT ${properties.join(',')} FROM StandIn_Typed`;
+} else {
+    properties = ['ProcessId', 'ParentProcessId', 'ThreadCount', 'HandleCount', 'PageFaults', 'PeakVirtualSize',
+        'PrivatePageCount', 'ReadOperationCount', 'WriteOperationCount', 'VirtualSize'];
+    query = `SELECT ${properties.join(',')} FROM Win32_Process`;
+}
+
+function measure(name, options) {
+    // One warm up round so every run starts with a pooled connection and resolved handles
+    wmi.query('root/cimv2', query, properties, options);
+
+    let start = process.hrtime.bigint();
+    let rows = 0;
+    for (let i = 0; i < kIterations; ++i) {
+        rows += Object.keys(wmi.query('root/cimv2', query, properties, options)).length;
+    }
+    let elapsedNs = Number(process.hrtime.bigint() - start);
+    console.log(`${name}: ${(elapsedNs / 1e6 / kIterations).toFixed(2)}ms per query, ` +
+        `${(elapsedNs / Math.max(rows, 1)).toFixed(0)}ns per row, ${(rows / kIterations).toFixed(0)} rows`);
+}
+
+function measureStandIn(name, options) {
+    standIn.enable({ rowCount: kRowCount, propertyHandles: true });
+    let before = standIn.propertyHandleStats();
+    measure(`${name}, handles`, options);
+    let after = standIn.propertyHandleStats();
+    let lookups = (after.hits - before.hits) + (after.misses - before.misses);
+    let reads = (after.handleReads - before.handleReads) + (after.namedReads - before.namedReads);
+    console.log(`  hit rate ${((after.hits - before.hits) / lookups * 100).toFixed(1)}%, ` +
+        `${((after.handleReads - before.handleReads) / reads * 100).toFixed(1)}% of values read through handles`);
+
+    standIn.enable({ rowCount: kRowCount, propertyHandles: false });
+    measure(`${name}, by name`, options);
+}
+
+if (standIn) {
+    measureStandIn('strings', {});
+    measureStandIn('typed', { typed: true });
+    standIn.enable();
+} else {
+    measure('strings', {});
+    measure('typed', { typed: true });
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Measures the wall time of a 25 query inventory snapshot spread over three namespaces, run one
+// query at a time and through queryMany with a growing number of workers.
+// Runs against the stand-in provider where available, which injects latencyMs into every query,
+// otherwise against WMI.
+//
+// Usage: node benchmarks/queryManyBenchmark.js [iterations] [latencyMs]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 5;
+const kLatencyMs = Number(process.argv[3]) || 20;
+const kWorkerCounts = [1, 2, 4, 8, 16];
+
+let requests;
+if (standIn) {
+    standIn.enable({ latencyMs: kLatencyMs });
+    const namespaces = ['root/cimv2', 'root/wmi', 'root/microsoft/windows/storage'];
+    requests = Array.from({ length: 25 }, (_, i) => ({
+        namespace: namespaces[i % namespaces.length],
+        query: `SELECT * FROM Inventory${i}`,
+    }));
+} else {
+    const classes = {
+        'root/cimv2': ['Win32_Processor', 'Win32_BIOS', 'Win32_ComputerSystem', 'Win32_OperatingSystem', 'Win32_BaseBoard',
+            'Win32_PhysicalMemory', 'Win32_DiskDrive', 'Win32_LogicalDisk', 'Win32_NetworkAdapter', 'Win32_VideoController',
+            'Win32_SoundDevice', 'Win32_USBController', 'Win32_Battery', 'Win32_TimeZone', 'Win32_Keyboard',
+            'Win32_PointingDevice', 'Win32_DesktopMonitor', 'Win32_Printer', 'Win32_CacheMemory'],
+        'root/wmi': ['WmiMonitorID', 'MSStorageDriver_FailurePredictStatus', 'MSAcpi_ThermalZoneTemperature'],
+        'root/microsoft/windows/storage': ['MSFT_PhysicalDisk', 'MSFT_Disk', 'MSFT_Volume'],
+    };
+    requests = [];
+    for (let namespace of Object.keys(classes)) {
+        for (let className of classes[namespace]) {
+            requests.push({ namespace: namespace, query: `SELECT * FROM ${className}` });
+        }
+    }
+}
+
+async function measure(name, run) {
+    // One warm up round so every run starts with pooled connections
+    await run();
+
+    let start = process.hrtime.bigint();
+    for (let i = 0; i < kIterations; ++i) {
+        await run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(1)}ms per snapshot`);
+}
+
+async function runBenchmarks() {
+    console.log(`${requests.length} queries${standIn ? `, ${kLatencyMs}ms latency each` : ''}`);
+
+    await measure('query, one after another', async () => {
+        for (let request of requests) {
+            wmi.query(request.namespace, request.query);
+        }
+    });
+
+    for (let workers of kWorkerCounts) {
+        // Queries run on the worker threads, give them as many as queryMany keeps queries in flight
+        wmi.configureWorkers({ threads: workers });
+        await measure(`queryMany, ${workers} worker${workers > 1 ? 's' : ''}`, () => wmi.queryMany(requests, { concurrency: workers }));
+    }
+}
+
+runBenchmarks().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Measures what collecting query statistics costs: the same synchronous queries are timed with
+// statistics turned off and on, alternating so both see the same machine state. The overhead
+// should stay below 1%. Prints the per-stage latency summary collected along the way.
+// Runs against the stand-in provider where available, otherwise against WMI.
+//
+// Usage: node benchmarks/queryStatsBenchmark.js [iterations] [rounds]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 200;
+const kRounds = Number(process.argv[3]) || 10;
+const kQuery = standIn ? 'SELECT * FROM StandIn_Stats' : 'SELECT * FROM Win32_Process';
+
+function measure(enabled) {
+    wmi.configureStats({ enabled });
+    let start = process.hrtime.bigint();
+    for (let i = 0; i < kIterations; i++) {
+        wmi.query('root/cimv2', kQuery);
+    }
+    return Number(process.hrtime.bigint() - start) / 1e6;
+}
+
+function runBenchmarks() {
+    if (standIn) {
+        standIn.enable({ rowCount: 200, propertyCount: 10 });
+    }
+
+    // Warm up, then keep the fastest round of each so noise doesn't decide the outcome
+    measure(false);
+    measure(true);
+    wmi.resetStats();
+    let offMs = Infinity;
+    let onMs = Infinity;
+    for (let round = 0; round < kRounds; round++) {
+        if (round % 2 === 0) {
+            offMs = Math.min(offMs, measure(false));
+            onMs = Math.min(onMs, measure(true));
+        } else {
+            onMs = Math.min(onMs, measure(true));
+            offMs = Math.min(offMs, measure(false));
+        }
+    }
+
+    console.log(`${kIterations} queries, best of ${kRounds} rounds`);
+    console.log(`  statistics off: ${(offMs * 1000 / kIterations).toFixed(1)}us per query`);
+    console.log(`  statistics on:  ${(onMs * 1000 / kIterations).toFixed(1)}us per query, ${((onMs - offMs) * 100 / offMs).toFixed(2)}% overhead`);
+
+    for (let entry of wmi.getStats()) {
+        console.log(`${entry.namespace} ${entry.className}: ${entry.queries} queries, ${entry.rows} rows, ${entry.bytes} bytes`);
+        for (let [stage, summary] of Object.entries(entry.stages)) {
+            console.log(`  ${stage.padEnd(8)} p50 ${summary.p50Ms.toFixed(3)}ms, p90 ${summary.p90Ms.toFixed(3)}ms, ` +
+                `p99 ${summary.p99Ms.toFixed(3)}ms, max ${summary.maxMs.toFixed(3)}ms`);
+        }
+    }
+    wmi.resetStats();
+}
+
+runBenchmarks();
\ No newline at end of file
@@ -0,0 +1,93 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares live queries with queries replayed from a recording, and measures how long a replay of a
+// recording with many queries takes to start. Records a snapshot of classes from the stand-in provider
+// where available, with 10ms of latency per query, otherwise from WMI. Replays without latency.
+//
+// Usage: node benchmarks/replayBenchmark.js [iterations] [rows] [classes]
+
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = Number(process.argv[3]) || 2000;
+const kClassCount = Number(process.argv[4]) || 200;
+const kRecordingPath = path.join(os.tmpdir(), `wmi-replay-benchmark-${process.pid}.bin`);
+
+let queries;
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount, propertyCount: 20, latencyMs: 10 });
+    queries = [];
+    for (let i = 0; i < kClassCount; ++i) {
+        queries.push(`SELECT * FROM StandIn_Class${i}`);
+    }
+} else {
+    queries = ['SELECT * FROM Win32_Process', 'SELECT * FROM Win32_Service', 'SELECT * FROM Win32_LogicalDisk'];
+}
+
+function measure(name, run) {
+    run();
+
+    let start = process.hrtime.bigint();
+    for (let i = 0; i < kIterations; ++i) {
+        run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(2)}ms per query`);
+}
+
+let start = process.hrtime.bigint();
+wmi.startRecording();
+for (let query of queries) {
+    wmi.query('root/cimv2', query);
+}
+let stats = wmi.stopRecording(kRecordingPath);
+let recordMs = Number(process.hrtime.bigint() - start) / 1e6;
+console.log(`recorded ${stats.entries} queries, ${(stats.bytes / (1024 * 1024)).toFixed(1)}MB in ${recordMs.toFixed(0)}ms`);
+
+measure('live', () => wmi.query('root/cimv2', queries[0]));
+
+// Starting a replay reads the index only, however many result sets the recording holds
+start = process.hrtime.bigint();
+wmi.startReplay(kRecordingPath);
+let startMs = Number(process.hrtime.bigint() - start) / 1e6;
+console.log(`replay of ${stats.entries} queries started in ${startMs.toFixed(2)}ms`);
+
+measure('replayed', () => wmi.query('root/cimv2', queries[0]));
+
+start = process.hrtime.bigint();
+for (let query of queries) {
+    wmi.query('root/cimv2', query);
+}
+console.log(`every recorded query replayed in ${(Number(process.hrtime.bigint() - start) / 1e6).toFixed(0)}ms`);
+
+wmi.stopReplay();
+fs.unlinkSync(kRecordingPath);
\ No newline at end of file
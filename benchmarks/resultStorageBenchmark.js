@@ -0,0 +1,98 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Native memory used by large results: native bytes held by the result set, allocated before
+// marshalling, and the growth of the process's peak RSS for a 100k instance by 10 property query.
+// With the stand-in provider, the same instances are also only read into their native results,
+// once into a ResultSet and once into the legacy layout of one WmiQueryResult per instance, which
+// also reports the heap blocks each layout holds.
+// Every format runs in its own child process so one peak doesn't hide the next.
+// Runs against the stand-in provider where available, otherwise against Win32_Process.
+//
+// Usage: node benchmarks/resultStorageBenchmark.js [rows]
+
+const childProcess = require('child_process');
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kRowCount = Number(process.argv[2]) || 100000;
+const kFormats = {
+    strings: {},
+    typed: { typed: true },
+    columnar: { typed: true, format: 'columnar' },
+};
+const kLayouts = {
+    'arena/strings': {},
+    'arena/typed': { typed: true },
+    'legacy/strings': { legacyLayout: true },
+    'legacy/typed': { legacyLayout: true, typed: true },
+};
+
+function runFormat(format) {
+    let query = 'SELECT * FROM Win32_Process';
+    if (standIn) {
+        standIn.enable({ rowCount: kRowCount, propertyCount: 10 });
+        query = 'SELECT * FROM StandIn_Storage';
+    }
+
+    global.gc && global.gc();
+    let peakBefore = process.resourceUsage().maxRSS;
+    let start = process.hrtime.bigint();
+    let result = wmi.query('root/cimv2', query, undefined, Object.assign({ timings: true }, kFormats[format]));
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    let peakGrowth = process.resourceUsage().maxRSS - peakBefore;
+
+    let rows = result.timings.rows;
+    console.log(`${format.padEnd(8)} ${rows} rows in ${elapsedMs.toFixed(0)}ms, ` +
+        `native results ${(result.timings.bytes / 1048576).toFixed(1)}MiB (${(result.timings.bytes / Math.max(rows, 1)).toFixed(0)} bytes per row), ` +
+        `peak RSS +${(peakGrowth / 1024).toFixed(1)}MiB`);
+}
+
+function runLayout(layout) {
+    global.gc && global.gc();
+    let peakBefore = process.resourceUsage().maxRSS;
+    // A single iteration, like a single query
+    let run = standIn.benchmark('build', Object.assign({ rows: kRowCount, properties: 10, minTimeMs: 0 }, kLayouts[layout]));
+    let peakGrowth = process.resourceUsage().maxRSS - peakBefore;
+
+    let bytes = run.bytesPerSecond * run.realTimeNs / 1e9;
+    console.log(`${layout.padEnd(14)} ${kRowCount} rows built in ${(run.realTimeNs / 1e6).toFixed(0)}ms, ` +
+        `native results ${(bytes / 1048576).toFixed(1)}MiB in ${run.heapBlocks} heap blocks, ` +
+        `peak RSS +${(peakGrowth / 1024).toFixed(1)}MiB`);
+}
+
+if (process.argv[3]) {
+    if (kLayouts[process.argv[3]]) {
+        runLayout(process.argv[3]);
+    } else {
+        runFormat(process.argv[3]);
+    }
+} else {
+    let runs = Object.keys(kFormats).concat(standIn ? Object.keys(kLayouts) : []);
+    for (let run of runs) {
+        childProcess.execFileSync(process.execPath, ['--expose-gc', __filename, String(kRowCount), run], { stdio: 'inherit' });
+    }
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Samples a performance counter class at a fixed interval for a few seconds, once by polling
+// query() from a JavaScript timer and once with createSampler, and reports the achieved rate,
+// the jitter between samples and the time spent on the JavaScript thread.
+// Runs against the stand-in provider where available, otherwise against WMI.
+//
+// Usage: node benchmarks/samplerBenchmark.js [intervalMs] [durationMs]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIntervalMs = Number(process.argv[2]) || 5;
+const kDurationMs = Number(process.argv[3]) || 3000;
+const kReadIntervalMs = 100;
+
+const kClass = standIn ? 'StandIn_Counter' : 'Win32_PerfFormattedData_PerfOS_Processor';
+const kProperties = ['PercentProcessorTime', 'PercentIdleTime', 'InterruptsPersec'];
+
+if (standIn) {
+    standIn.enable({ rowCount: 16 });
+}
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+function report(name, timestamps, jsMs) {
+    let gaps = [];
+    for (let i = 1; i < timestamps.length; i++) {
+        gaps.push(Math.abs(timestamps[i] - timestamps[i - 1] - kIntervalMs));
+    }
+    gaps.sort((a, b) => a - b);
+    let mean = gaps.reduce((sum, gap) => sum + gap, 0) / gaps.length;
+    let p99 = gaps[Math.floor(gaps.length * 0.99)];
+    console.log(`${name}: ${(timestamps.length * 1000 / kDurationMs).toFixed(1)} samples/s, ` +
+        `jitter mean ${mean.toFixed(2)}ms p99 ${p99.toFixed(2)}ms max ${gaps[gaps.length - 1].toFixed(2)}ms, ` +
+        `${jsMs.toFixed(1)}ms on the JavaScript thread`);
+}
+
+async function measurePolling() {
+    let query = `SELECT ${kProperties.join(', ')} FROM ${kClass}`;
+    let timestamps = [];
+    let jsMs = 0;
+    let timer = setInterval(() => {
+        let start = process.hrtime.bigint();
+        timestamps.push(Date.now());
+        wmi.query('root/cimv2', query);
+        jsMs += Number(process.hrtime.bigint() - start) / 1e6;
+    }, kIntervalMs);
+    await sleep(kDurationMs);
+    clearInterval(timer);
+    report('query() polling', timestamps, jsMs);
+}
+
+async function measureSampler() {
+    let sampler = wmi.createSampler('root/cimv2', kClass, kProperties, kIntervalMs);
+    let timestamps = [];
+    let jsMs = 0;
+    let cursor = 0;
+    let end = Date.now() + kDurationMs;
+    while (Date.now() < end) {
+        await sleep(kReadIntervalMs);
+        let start = process.hrtime.bigint();
+        let window = sampler.read(cursor);
+        for (let i = 0; i < window.rows; i++) {
+            // Every instance refreshed together shares the timestamp
+            if (i === 0 || window.timestamps[i] !== window.timestamps[i - 1]) {
+                timestamps.push(window.timestamps[i]);
+            }
+        }
+        cursor = window.cursor;
+        jsMs += Number(process.hrtime.bigint() - start) / 1e6;
+    }
+    let stats = sampler.stats();
+    sampler.close();
+    report('createSampler', timestamps, jsMs);
+    console.log(`  ${stats.missedTicks} missed ticks, lateness mean ${stats.meanLatenessMs.toFixed(3)}ms max ${stats.maxLatenessMs.toFixed(3)}ms`);
+}
+
+async function runBenchmarks() {
+    console.log(`${kClass}, ${kProperties.length} properties every ${kIntervalMs}ms for ${kDurationMs}ms`);
+    await measurePolling();
+    await measureSampler();
+}
+
+runBenchmarks().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Time per poll of a large class of which only a few instances change between polls: diffed
+// natively by watchSnapshot, which only converts the changes, and by query plus a diff in
+// JavaScript keyed by __PATH, which converts and compares every instance. Every poll changes
+// changedPercent of the instances. Runs against the stand-in provider where available, otherwise
+// against Win32_Process.
+//
+// Usage: node benchmarks/snapshotDiffBenchmark.js [rows] [changedPercent]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kRows = Number(process.argv[2]) || 50000;
+const kChangedPercent = Number(process.argv[3]) || 1;
+const kPolls = 10;
+
+const kQuery = standIn ? 'SELECT * FROM StandIn_Inventory' : 'SELECT * FROM Win32_Process';
+const kProperties = standIn ? ['Caption', 'Name', 'DeviceID', 'Version', 'Count', 'Total'] : ['Name', 'ProcessId', 'WorkingSetSize', 'ThreadCount'];
+const kOptions = { typed: true };
+
+let revision = 0;
+function nextRevision() {
+    // Every poll changes a different revision of the same instances
+    if (standIn) {
+        standIn.enable({ rowCount: kRows, revision: ++revision, revisionInterval: Math.max(1, Math.round(100 / kChangedPercent)) });
+    }
+}
+
+function sameInstance(first, second) {
+    for (let property of kProperties) {
+        if (first[property] !== second[property]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+async function measure(name, poll) {
+    nextRevision();
+    await poll();
+    let total = 0;
+    let changed = 0;
+    for (let i = 0; i < kPolls; ++i) {
+        nextRevision();
+        let start = process.hrtime.bigint();
+        changed = await poll();
+        total += Number(process.hrtime.bigint() - start) / 1e6;
+    }
+    console.log(`${name}: ${(total / kPolls).toFixed(1)}ms per poll, ${changed} changed`);
+    return total / kPolls;
+}
+
+async function main() {
+    if (standIn) {
+        standIn.enable({ rowCount: kRows });
+    }
+
+    let watch = wmi.watchSnapshot('root/cimv2', kQuery, undefined, Object.assign({ properties: kProperties }, kOptions));
+    let native = await measure('watchSnapshot      ', async () => {
+        let changes = await watch.poll();
+        return changes.changed.length;
+    });
+    watch.close();
+
+    let previous = new Map();
+    let javascript = await measure('queryAsync + JS diff', async () => {
+        let results = await wmi.queryAsync('root/cimv2', kQuery, kProperties.concat('__PATH'), kOptions);
+        let current = new Map();
+        let changed = 0;
+        for (let key in results) {
+            let instance = results[key];
+            let before = previous.get(instance.__PATH);
+            if (before !== undefined && !sameInstance(before, instance)) {
+                ++changed;
+            }
+            current.set(instance.__PATH, instance);
+        }
+        previous = current;
+        return changed;
+    });
+    console.log(`speedup: ${(javascript / native).toFixed(2)}x`);
+}
+
+main().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
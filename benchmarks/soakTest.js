@@ -0,0 +1,287 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Soak test of the query pipeline. Runs a mixed workload of every API for minutes or hours: queries
+// in every format, streams that are left early, prepared queries, queryMany, aborted queries, cached
+// results, snapshot watches, subscriptions and samplers that are opened and closed again, and on the
+// stand-in provider connections that break every few rounds. Every sampleSeconds it records the
+// resident set size, JavaScript and external memory, the open file descriptors and threads of the
+// process and the open connections. Samples taken after the first tenth of the run are compared
+// with the last ones: the run fails when the resident set grew by more than maxRssGrowthMb or the
+// descriptors or threads by more than maxHandleGrowth. Run with --expose-gc so each sample sees
+// the memory that is still in use rather than garbage.
+//
+// Usage: node --expose-gc benchmarks/soakTest.js [minutes] [sampleSeconds] [jsonPath] [maxRssGrowthMb] [maxHandleGrowth]
+// jsonPath '-' writes the report to stdout and the progress to stderr.
+
+const fs = require('fs');
+
+const wmi = require('../build/Release/wmi_native_module');
+const { createReport, writeReport } = require('./benchmarkReport');
+
+const standIn = wmi.standIn;
+const kMinutes = Number(process.argv[2]) || 60;
+const kSampleSeconds = Number(process.argv[3]) || 30;
+const kJsonPath = process.argv[4];
+const kMaxRssGrowthMb = Number(process.argv[5]) || 64;
+const kMaxHandleGrowth = Number(process.argv[6]) || 16;
+const log = kJsonPath === '-' ? console.error : console.log;
+
+const kNamespace = 'root/cimv2';
+const kProperties = standIn ? ['Name', 'Caption', 'Count', 'Total', 'InstallDate', 'Ratio'] : ['Name', 'ProcessId', 'WorkingSetSize', 'CreationDate'];
+const kQuery = `SELECT ${kProperties.join(', ')} FROM ${standIn ? 'StandIn_Soak' : 'Win32_Process'}`;
+const kEventQuery = standIn ? 'SELECT * FROM StandIn_Event' : "SELECT * FROM __InstanceCreationEvent WITHIN 1 WHERE TargetInstance ISA 'Win32_Process'";
+const kSamplerClass = standIn ? 'StandIn_Counter' : 'Win32_PerfFormattedData_PerfOS_Processor';
+const kSamplerProperties = standIn ? ['A', 'B'] : ['PercentProcessorTime'];
+
+function delay(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+// Lines of /proc/self/status such as Threads, Linux only
+function readProcStatus(field) {
+    try {
+        let match = fs.readFileSync('/proc/self/status', 'utf8').match(new RegExp(`^${field}:\\s+(\\d+)`, 'm'));
+        return match ? Number(match[1]) : null;
+    } catch (error) {
+        return null;
+    }
+}
+
+function countFileDescriptors() {
+    try {
+        return fs.readdirSync('/proc/self/fd').length;
+    } catch (error) {
+        return null;
+    }
+}
+
+const kWorkload = [
+    ['query', () => wmi.query(kNamespace, kQuery, kProperties)],
+    ['typed', () => wmi.queryAsync(kNamespace, kQuery, kProperties, { typed: true })],
+    ['columnar', () => wmi.queryAsync(kNamespace, kQuery, kProperties, { typed: true, format: 'columnar' })],
+    ['lazy', async () => {
+        let result = await wmi.queryAsync(kNamespace, kQuery, undefined, { lazy: true });
+        return result[0] && result[0].Name;
+    }],
+    ['cached', () => wmi.queryAsync(kNamespace, kQuery, kProperties, { cacheTtlMs: 1000 })],
+    ['stream', async () => {
+        // Leaving after the first batch cancels the rest of the query
+        for await (let batch of wmi.queryStream(kNamespace, kQuery, kProperties, { batchSize: 10 })) {
+            return batch;
+        }
+    }],
+    ['prepared', async () => {
+        let prepared = wmi.prepare(kNamespace, kQuery, kProperties);
+        await prepared.runAsync();
+        prepared.run({ typed: true });
+        prepared.close();
+    }],
+    ['queryMany', () => wmi.queryMany([
+        { namespace: kNamespace, query: kQuery, properties: kProperties },
+        { namespace: kNamespace, query: kQuery, options: { typed: true } }
+    ], { concurrency: 2 })],
+    ['typedClass', () => wmi.queryTyped('Win32_Processor')],
+    ['abort', async () => {
+        let controller = new AbortController();
+        let promise = wmi.queryAsync(kNamespace, kQuery, kProperties, { signal: controller.signal });
+        controller.abort();
+        await promise.catch(error => {
+            if (error.name !== 'AbortError') {
+                throw error;
+            }
+        });
+    }],
+    ['snapshot', async () => {
+        let watch = wmi.watchSnapshot(kNamespace, kQuery, undefined, { properties: kProperties });
+        await watch.poll();
+        await watch.poll();
+        watch.close();
+    }],
+    ['subscribe', async () => {
+        let subscription = wmi.subscribe(kNamespace, kEventQuery, () => { });
+        await delay(20);
+        subscription.unsubscribe();
+    }],
+    ['sampler', async () => {
+        let sampler = wmi.createSampler(kNamespace, kSamplerClass, kSamplerProperties, 5);
+        await delay(20);
+        sampler.read();
+        sampler.close();
+    }]
+];
+
+function takeSample(start, counts) {
+    global.gc && global.gc();
+    let memory = process.memoryUsage();
+    let sample = {
+        elapsed_s: (Date.now() - start) / 1000,
+        rss_mb: memory.rss / 1048576,
+        heap_used_mb: memory.heapUsed / 1048576,
+        external_mb: memory.external / 1048576,
+        array_buffers_mb: memory.arrayBuffers / 1048576,
+        file_descriptors: countFileDescriptors(),
+        threads: readProcStatus('Threads'),
+        active_resources: process.getActiveResourcesInfo ? process.getActiveResourcesInfo().length : null,
+        operations: counts.operations,
+        errors: counts.errors,
+        cache_entries: wmi.cacheStats().entries
+    };
+    if (standIn) {
+        sample.open_connections = standIn.connectionStats().openConnections;
+    }
+    return sample;
+}
+
+function median(values) {
+    let sorted = values.slice().sort((a, b) => a - b);
+    return sorted[Math.floor(sorted.length / 2)];
+}
+
+// Growth of a sample field between the start and the end of the measured samples, medians of three
+// so a single collection or burst doesn't decide the outcome
+function growth(samples, field) {
+    if (samples.length < 2 || samples[0][field] === null || samples[0][field] === undefined) {
+        return null;
+    }
+    let window = Math.min(3, Math.floor(samples.length / 2));
+    let first = median(samples.slice(0, window).map(sample => sample[field]));
+    let last = median(samples.slice(-window).map(sample => sample[field]));
+    return last - first;
+}
+
+// Least squares slope of the resident set size, in MiB per hour
+function rssSlope(samples) {
+    if (samples.length < 2) {
+        return null;
+    }
+    let meanTime = samples.reduce((sum, sample) => sum + sample.elapsed_s, 0) / samples.length;
+    let meanRss = samples.reduce((sum, sample) => sum + sample.rss_mb, 0) / samples.length;
+    let covariance = 0;
+    let variance = 0;
+    for (let sample of samples) {
+        covariance += (sample.elapsed_s - meanTime) * (sample.rss_mb - meanRss);
+        variance += (sample.elapsed_s - meanTime) ** 2;
+    }
+    return variance > 0 ? covariance / variance * 3600 : 0;
+}
+
+async function runSoak() {
+    if (standIn) {
+        standIn.enable({ rowCount: 200, eventIntervalMs: 1 });
+    }
+
+    let counts = { operations: 0, errors: 0 };
+    let perOperation = {};
+    let samples = [];
+    let start = Date.now();
+    let end = start + kMinutes * 60000;
+    let nextSample = start;
+    let round = 0;
+
+    while (Date.now() < end) {
+        for (let [name, run] of kWorkload) {
+            try {
+                await run();
+            } catch (error) {
+                counts.errors++;
+                if (counts.errors <= 10) {
+                    log(`${name} failed: ${error.message}`);
+                }
+            }
+            counts.operations++;
+            perOperation[name] = (perOperation[name] || 0) + 1;
+        }
+
+        // Broken connections are replaced by the next query, cached results dropped
+        if (++round % 10 === 0) {
+            wmi.invalidateCache();
+            if (standIn) {
+                standIn.breakConnections();
+            }
+        }
+
+        if (Date.now() >= nextSample) {
+            let sample = takeSample(start, counts);
+            samples.push(sample);
+            log(`${sample.elapsed_s.toFixed(0).padStart(6)}s ${counts.operations} operations, RSS ${sample.rss_mb.toFixed(1)}MiB, ` +
+                `heap ${sample.heap_used_mb.toFixed(1)}MiB, external ${sample.external_mb.toFixed(1)}MiB, ` +
+                `${sample.file_descriptors} fds, ${sample.threads} threads`);
+            nextSample = Date.now() + kSampleSeconds * 1000;
+        }
+    }
+    samples.push(takeSample(start, counts));
+
+    // The first tenth warms up caches, pools and the heap
+    let warmup = samples.findIndex(sample => sample.elapsed_s >= kMinutes * 6);
+    let measured = samples.slice(warmup > 0 && samples.length - warmup >= 2 ? warmup : 0);
+    let summary = {
+        duration_s: (Date.now() - start) / 1000,
+        operations: counts.operations,
+        errors: counts.errors,
+        operations_per_type: perOperation,
+        rss_growth_mb: growth(measured, 'rss_mb'),
+        rss_slope_mb_per_hour: rssSlope(measured),
+        heap_growth_mb: growth(measured, 'heap_used_mb'),
+        external_growth_mb: growth(measured, 'external_mb'),
+        file_descriptor_growth: growth(measured, 'file_descriptors'),
+        thread_growth: growth(measured, 'threads'),
+        max_rss_growth_mb: kMaxRssGrowthMb,
+        max_handle_growth: kMaxHandleGrowth
+    };
+
+    let failures = [];
+    if (summary.rss_growth_mb !== null && summary.rss_growth_mb > kMaxRssGrowthMb) {
+        failures.push(`RSS grew by ${summary.rss_growth_mb.toFixed(1)}MiB`);
+    }
+    for (let field of ['file_descriptor_growth', 'thread_growth']) {
+        if (summary[field] !== null && summary[field] > kMaxHandleGrowth) {
+            failures.push(`${field} was ${summary[field]}`);
+        }
+    }
+    summary.passed = failures.length === 0;
+    summary.failures = failures;
+
+    log(`${summary.operations} operations (${summary.errors} errors) in ${summary.duration_s.toFixed(0)}s, ` +
+        `RSS ${summary.rss_growth_mb === null ? '-' : summary.rss_growth_mb.toFixed(1)}MiB ` +
+        `(${summary.rss_slope_mb_per_hour === null ? '-' : summary.rss_slope_mb_per_hour.toFixed(1)}MiB/h), ` +
+        `${summary.file_descriptor_growth} fds, ${summary.thread_growth} threads: ${summary.passed ? 'passed' : failures.join(', ')}`);
+
+    if (kJsonPath) {
+        let report = createReport('benchmarks/soakTest.js');
+        report.context.provider = standIn ? 'stand-in' : 'wmi';
+        report.soak = { summary: summary, samples: samples };
+        writeReport(report, kJsonPath);
+    }
+    if (!summary.passed) {
+        process.exitCode = 1;
+    }
+}
+
+runSoak().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
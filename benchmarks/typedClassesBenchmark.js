@@ -0,0 +1,74 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares queries of the typed classes read by their compile-time extractors through queryTyped with
+// the same queries read by the general typed conversion of queryAsync. Runs against the stand-in
+// provider where available, with rows instances per query, otherwise against WMI.
+//
+// Usage: node benchmarks/typedClassesBenchmark.js [iterations] [rows]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = Number(process.argv[3]) || 20000;
+
+const kClasses = {
+    Win32_Processor: ['root/cimv2', ['DeviceID', 'Name', 'Manufacturer', 'ProcessorId', 'Architecture', 'NumberOfCores',
+        'NumberOfLogicalProcessors', 'MaxClockSpeed', 'CurrentClockSpeed', 'LoadPercentage', 'L2CacheSize', 'L3CacheSize']],
+    Win32_LogicalDisk: ['root/cimv2', ['DeviceID', 'DriveType', 'FileSystem', 'FreeSpace', 'Size', 'VolumeName', 'VolumeSerialNumber']],
+    Win32_OperatingSystem: ['root/cimv2', ['Caption', 'Version', 'BuildNumber', 'OSArchitecture', 'SystemDrive', 'NumberOfProcesses',
+        'FreePhysicalMemory', 'TotalVisibleMemorySize', 'FreeVirtualMemory', 'InstallDate', 'LastBootUpTime']]
+};
+
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount });
+}
+
+async function measure(run) {
+    await run();
+
+    let start = process.hrtime.bigint();
+    for (let i = 0; i < kIterations; ++i) {
+        await run();
+    }
+    return Number(process.hrtime.bigint() - start) / 1e6 / kIterations;
+}
+
+async function runBenchmarks() {
+    for (let [className, [namespace, properties]] of Object.entries(kClasses)) {
+        const query = `SELECT ${properties.join(', ')} FROM ${className}`;
+        let general = await measure(() => wmi.queryAsync(namespace, query, properties, { typed: true }));
+        let typed = await measure(() => wmi.queryTyped(className));
+        console.log(`${className}: queryAsync ${general.toFixed(2)}ms, queryTyped ${typed.toFixed(2)}ms per query ` +
+            `(${(general / typed).toFixed(2)}x)`);
+    }
+}
+
+runBenchmarks().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
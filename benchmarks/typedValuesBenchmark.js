@@ -0,0 +1,97 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Compares reading numeric properties as typed values with the string path followed by the
+// parsing callers had to do on every poll. Runs against the stand-in provider where available,
+// otherwise against Win32_Process.
+//
+// Usage: node benchmarks/typedValuesBenchmark.js [iterations]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kIterations = Number(process.argv[2]) || 20;
+const kRowCount = 10000;
+
+let properties;
+let query;
+let parseStrings;
+if (standIn) {
+    standIn.enable({ rowCount: kRowCount });
+    properties = ['Enabled', 'Level', 'Port', 'Count', 'Delta', 'Total', 'Ratio', 'Load', 'InstallDate', 'Samples'];
+    query = `SELECT ${properties.join(',')} FROM StandIn_Typed`;
+    parseStrings = row => ({
+        Enabled: row.Enabled === '1',
+        Level: parseInt(row.Level),
+        Port: parseInt(row.Port),
+        Count: parseInt(row.Count) >>> 0,
+        Delta: parseInt(row.Delta),
+        Total: BigInt(row.Total),
+        Ratio: parseFloat(row.Ratio),
+        Load: parseFloat(row.Load),
+        InstallDate: row.InstallDate,
+        Samples: row.Samples.split('; ').map(value => parseInt(value) >>> 0),
+    });
+} else {
+    properties = ['ProcessId', 'ThreadCount', 'HandleCount', 'WorkingSetSize', 'KernelModeTime', 'CreationDate'];
+    query = `SELECT ${properties.join(',')} FROM Win32_Process`;
+    parseStrings = row => ({
+        ProcessId: parseInt(row.ProcessId),
+        ThreadCount: parseInt(row.ThreadCount),
+        HandleCount: parseInt(row.HandleCount),
+        WorkingSetSize: BigInt(row.WorkingSetSize),
+        KernelModeTime: BigInt(row.KernelModeTime),
+        CreationDate: row.CreationDate,
+    });
+}
+
+function measure(name, run) {
+    // One warm up round so both paths start with a pooled connection
+    run();
+
+    let start = process.hrtime.bigint();
+    let rows = 0;
+    for (let i = 0; i < kIterations; ++i) {
+        rows += run();
+    }
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    console.log(`${name}: ${(elapsedMs / kIterations).toFixed(2)}ms per query, ${(rows / kIterations).toFixed(0)} rows`);
+}
+
+measure('strings + parsing', () => {
+    let result = wmi.query('root/cimv2', query, properties);
+    return Object.values(result).map(parseStrings).length;
+});
+
+measure('typed', () => {
+    let result = wmi.query('root/cimv2', query, properties, { typed: true });
+    return Object.keys(result).length;
+});
+
+measure('typed, 64 bit as Number', () => {
+    let result = wmi.query('root/cimv2', query, properties, { typed: true, int64: 'number', datetime: 'number' });
+    return Object.keys(result).length;
+});
\ No newline at end of file
@@ -0,0 +1,84 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+// Measures how query throughput and the time queries wait for a worker thread scale with the
+// number of worker threads, for queries that mostly wait (latency bound) and queries that mostly
+// convert values (CPU bound). 64 queries are kept in flight through queryMany.
+// Runs against the stand-in provider where available, otherwise against WMI.
+//
+// Usage: node benchmarks/workerPoolBenchmark.js [queries] [latencyMs]
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+const kQueries = Number(process.argv[2]) || 512;
+const kLatencyMs = Number(process.argv[3]) || 5;
+const kThreadCounts = [1, 2, 4, 8, 16, 32];
+const kConcurrency = 64;
+
+const workloads = standIn ? [
+    { name: 'latency bound', options: { rowCount: 1, latencyMs: kLatencyMs }, className: 'StandIn_Wait' },
+    { name: 'CPU bound', options: { rowCount: 2000, propertyCount: 8 }, className: 'StandIn_Convert' },
+] : [
+    { name: 'Win32_Processor', className: 'Win32_Processor' },
+    { name: 'Win32_Process', className: 'Win32_Process' },
+];
+
+async function measure(workload, threads) {
+    wmi.configureWorkers({ threads });
+    let requests = Array.from({ length: kQueries }, () => ({ namespace: 'root/cimv2', query: `SELECT * FROM ${workload.className}` }));
+
+    // One warm up round so every thread is started and the connection is open
+    await wmi.queryMany(requests.slice(0, threads), { concurrency: kConcurrency });
+
+    let before = wmi.workerStats();
+    let start = process.hrtime.bigint();
+    await wmi.queryMany(requests, { concurrency: kConcurrency });
+    let elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+    let after = wmi.workerStats();
+
+    let jobs = after.startedJobs - before.startedJobs;
+    let meanQueueMs = (after.totalQueueMs - before.totalQueueMs) / jobs;
+    console.log(`  ${threads} thread${threads > 1 ? 's' : ''}: ${(kQueries * 1000 / elapsedMs).toFixed(0)} queries/s, ` +
+        `${meanQueueMs.toFixed(2)}ms mean queue time`);
+}
+
+async function runBenchmarks() {
+    for (let workload of workloads) {
+        if (standIn) {
+            standIn.enable(workload.options);
+        }
+        console.log(`${workload.name}, ${kQueries} queries`);
+        for (let threads of kThreadCounts) {
+            await measure(workload, threads);
+        }
+    }
+}
+
+runBenchmarks().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -2,13 +2,13 @@
   'targets': [
     {
       'target_name': 'wmi_native_module',
-      'sources': [ 'src/main.cpp'],
+      'sources': [ 'src/main.cpp', 'src/abort_signal.cpp', 'src/aggregation.cpp', 'src/batch_channel.cpp', 'src/cache_bindings.cpp', 'src/columnar_results.cpp', 'src/connection_pool.cpp', 'src/enumeration.cpp', 'src/event_queue.cpp', 'src/lazy_results.cpp', 'src/marshalling.cpp', 'src/pool_worker.cpp', 'src/prepared_bindings.cpp', 'src/prepared_query.cpp', 'src/property_access.cpp', 'src/query_batch.cpp', 'src/query_bindings.cpp', 'src/query_recording.cpp', 'src/query_stats.cpp', 'src/query_stream.cpp', 'src/recording_bindings.cpp', 'src/result_cache.cpp', 'src/result_set.cpp', 'src/sample_buffer.cpp', 'src/sampler.cpp', 'src/shared_engine.cpp', 'src/snapshot_bindings.cpp', 'src/snapshot_diff.cpp', 'src/stats_bindings.cpp', 'src/subscription.cpp', 'src/variant_conversion.cpp', 'src/worker_bindings.cpp', 'src/worker_pool.cpp', 'src/wql.cpp' ],
       'include_dirs': ["<!(node -p \"require('node-addon-api').include_dir\")"],
       'dependencies': ["<!(node -p \"require('node-addon-api').gyp\")"],
       'cflags': [ '-fno-exceptions' ],
       'cflags_cc': [ '-fno-exceptions' ],
       'conditions': [
-        ["OS=='linux'", {"sources": [ 'src/unsupported_wmi_wrapper.cpp' ], "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ]}],
+        ["OS=='linux'", {"sources": [ 'src/unsupported_wmi_wrapper.cpp', 'src/stage_benchmarks.cpp', 'src/stand_in_provider.cpp', 'src/fake_variant.cpp' ], "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ]}],
         ["OS=='win'", {'sources': [ 'src/wmi_wrapper.cpp' ],  "defines": [ "_HAS_EXCEPTIONS=1" ],
           "msvs_settings": { 
             "VCCLCompilerTool": { 
@@ -30,7 +30,7 @@
       "copies": [
         {
                'destination': '<(module_root_dir)/build/<(CONFIGURATION_NAME)/',
-               'files': ['<(module_root_dir)/wmi_native_module.d.ts', '<(module_root_dir)/package.json']
+               'files': ['<(module_root_dir)/wmi_native_module.d.ts', '<(module_root_dir)/typed_classes.d.ts', '<(module_root_dir)/package.json']
         }
       ]
     }
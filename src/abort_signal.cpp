@@ -0,0 +1,187 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "abort_signal.h"
+
+#include <utility>
+
+namespace wmi_wrapper
+{
+
+    const char kAbortedMessage[] = "This operation was aborted";
+
+    /**
+     * Reads options.signal
+     *
+     * @param signal Receives the signal, left empty when none was passed
+     * @return true when the signal is valid or not set, otherwise a JavaScript exception is pending
+     */
+    bool ReadSignal(
+        Napi::Object options,
+        Napi::Object *signal)
+    {
+        Napi::Value value = options.Get("signal");
+        if (value.IsUndefined())
+        {
+            return true;
+        }
+
+        if (!value.IsObject() ||
+            !value.As<Napi::Object>().Get("addEventListener").IsFunction() ||
+            !value.As<Napi::Object>().Get("removeEventListener").IsFunction())
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *signal = value.As<Napi::Object>();
+        return true;
+    }
+
+    Napi::Value GetAbortReason(
+        Napi::Env env,
+        Napi::Object signal)
+    {
+        if (!signal.IsEmpty())
+        {
+            Napi::Value reason = signal.Get("reason");
+            if (!reason.IsUndefined())
+            {
+                return reason;
+            }
+        }
+
+        // Shaped like the AbortError of Node.js, for signals that carry no reason
+        Napi::Error error = Napi::Error::New(env, kAbortedMessage);
+        error.Set("name", Napi::String::New(env, "AbortError"));
+        error.Set("code", Napi::String::New(env, "ABORT_ERR"));
+        return error.Value();
+    }
+
+    bool AbortListener::Listen(
+        Napi::Object options,
+        QueryOptions *query_options,
+        std::function<void()> on_abort)
+    {
+        Napi::Env env = options.Env();
+        Napi::Object signal;
+        if (!ReadSignal(options, &signal))
+        {
+            return false;
+        }
+        if (signal.IsEmpty())
+        {
+            return true;
+        }
+
+        token_ = std::make_shared<CancellationToken>(query_options->cancellation);
+        query_options->cancellation = token_;
+        signal_ = Napi::Persistent(signal);
+
+        if (signal.Get("aborted").ToBoolean())
+        {
+            token_->Cancel();
+            if (on_abort)
+            {
+                on_abort();
+            }
+            return true;
+        }
+
+        std::shared_ptr<CancellationToken> token = token_;
+        Napi::Function listener = Napi::Function::New(
+            env,
+            [token, on_abort](const Napi::CallbackInfo &)
+            {
+                token->Cancel();
+                if (on_abort)
+                {
+                    on_abort();
+                }
+            },
+            "onAbort");
+
+        Napi::Object listener_options = Napi::Object::New(env);
+        listener_options.Set("once", Napi::Boolean::New(env, true));
+        signal.Get("addEventListener").As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), listener, listener_options});
+        if (env.IsExceptionPending())
+        {
+            return false;
+        }
+        listener_ = Napi::Persistent(listener);
+        return true;
+    }
+
+    bool AbortListener::IsAborted() const
+    {
+        return token_ && token_->IsCancelled();
+    }
+
+    Napi::Value AbortListener::GetReason(
+        Napi::Env env) const
+    {
+        return GetAbortReason(env, signal_.IsEmpty() ? Napi::Object() : signal_.Value());
+    }
+
+    void AbortListener::Stop()
+    {
+        if (listener_.IsEmpty())
+        {
+            return;
+        }
+
+        Napi::Env env = listener_.Env();
+        Napi::Object signal = signal_.Value();
+        signal.Get("removeEventListener").As<Napi::Function>().Call(signal, {Napi::String::New(env, "abort"), listener_.Value()});
+        listener_.Reset();
+
+        // The call already settled, a signal that fails to let go of the listener is not its problem
+        if (env.IsExceptionPending())
+        {
+            env.GetAndClearPendingException();
+        }
+    }
+
+    void AbortListener::Release()
+    {
+        listener_.Reset();
+        signal_.Reset();
+    }
+
+    bool CheckNotAborted(
+        Napi::Object options)
+    {
+        Napi::Object signal;
+        if (!ReadSignal(options, &signal))
+        {
+            return false;
+        }
+        if (!signal.IsEmpty() && signal.Get("aborted").ToBoolean())
+        {
+            Napi::Error(options.Env(), GetAbortReason(options.Env(), signal)).ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+}
\ No newline at end of file
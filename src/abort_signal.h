@@ -0,0 +1,87 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <functional>
+#include <memory>
+
+#include "cancellation.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Cancels the query of a call when the AbortSignal passed as its signal option fires.
+     *
+     * Any object with aborted, reason, addEventListener and removeEventListener works as the signal.
+     * The listener only holds the CancellationToken, so it stays harmless when the signal outlives
+     * the call; Stop removes it once the call settled so long-lived signals don't collect listeners.
+     * Used on the JavaScript thread only.
+     */
+    class AbortListener
+    {
+    public:
+        /**
+         * Reads options.signal and gives query_options a token that is cancelled when it fires,
+         * right away when it already did. A token query_options already has becomes its parent.
+         *
+         * @param on_abort Optional: called on the JavaScript thread once the token was cancelled
+         * @return true when the signal is valid or not set, otherwise a JavaScript exception is pending
+         */
+        bool Listen(Napi::Object options, QueryOptions *query_options, std::function<void()> on_abort = nullptr);
+
+        // true once the token was cancelled, by this signal or by a parent's
+        bool IsAborted() const;
+
+        /**
+         * The value to reject an aborted call with: the reason of the signal, or an AbortError when
+         * it has none
+         */
+        Napi::Value GetReason(Napi::Env env) const;
+
+        // Removes the listener from the signal
+        void Stop();
+
+        // Drops the references to the signal without calling into JavaScript, for an environment that exits
+        void Release();
+
+    private:
+        Napi::ObjectReference signal_;
+        Napi::FunctionReference listener_;
+        std::shared_ptr<CancellationToken> token_;
+    };
+
+    /**
+     * Throws the reason of options.signal when it already fired, for calls that run to completion
+     * before a signal could fire
+     *
+     * @return true when the call may go ahead, otherwise a JavaScript exception is pending
+     */
+    bool CheckNotAborted(Napi::Object options);
+
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include "shared_engine.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * JavaScript state owned by each environment (main thread or worker) that loads the module
+     */
+    struct AddonData
+    {
+        Napi::FunctionReference query_stream_constructor;
+        Napi::FunctionReference subscription_constructor;
+        Napi::FunctionReference sampler_constructor;
+        Napi::FunctionReference prepared_query_constructor;
+        Napi::FunctionReference snapshot_watch_constructor;
+        EngineShare *engine_share = NULL; // Owned by the cleanup hook of the environment, see RegisterWorkerBindings
+    };
+
+    inline AddonData *GetAddonData(Napi::Env env)
+    {
+        return env.GetInstanceData<AddonData>();
+    }
+
+};
\ No newline at end of file
@@ -0,0 +1,716 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "aggregation.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <limits>
+#include <unordered_map>
+
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    // Position of a property that an instance of a schema doesn't have
+    const size_t kMissingColumn = std::numeric_limits<size_t>::max();
+
+    std::vector<std::wstring> AggregateSpec::GetProperties() const
+    {
+        std::vector<std::wstring> properties;
+        auto add = [&](const std::wstring &property)
+        {
+            if (!property.empty() && !ContainsIgnoreCase(properties, property))
+            {
+                properties.push_back(property);
+            }
+        };
+        for (const AggregateCondition &condition : where)
+        {
+            add(condition.property);
+        }
+        for (const std::wstring &property : group_by)
+        {
+            add(property);
+        }
+        for (const AggregateOutput &output : outputs)
+        {
+            add(output.property);
+        }
+        return properties;
+    }
+
+    /**
+     * Finds the position of a property in every schema of the results
+     *
+     * @return kAggregatePropertyMissing when the results have instances but none of them has the property
+     */
+    HRESULT FindColumns(
+        const ResultSet &results,
+        const std::wstring &property,
+        std::vector<size_t> *columns)
+    {
+        columns->assign(results.GetSchemaCount(), kMissingColumn);
+        bool found = results.GetSchemaCount() == 0;
+        for (size_t schema = 0; schema < results.GetSchemaCount(); ++schema)
+        {
+            const ResultSet::Schema &names = results.GetSchema(schema);
+            for (size_t column = 0; column < names.size(); ++column)
+            {
+                if (EqualsIgnoreCase(names[column], property))
+                {
+                    (*columns)[schema] = column;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        return found ? S_OK : kAggregatePropertyMissing;
+    }
+
+    // The value of the property found by FindColumns, NULL when the instance doesn't have it
+    inline const ResultSet::Value *GetColumnValue(
+        const ResultSet &results,
+        const std::vector<size_t> &columns,
+        size_t row)
+    {
+        size_t column = columns[results.GetSchemaIndex(row)];
+        return column == kMissingColumn ? NULL : &results.GetValues(row)[column];
+    }
+
+    inline bool IsNull(
+        const ResultSet::Value *value)
+    {
+        return value == NULL || value->type == WmiValue::kNull;
+    }
+
+    inline bool IsNumber(
+        WmiValue::Type type)
+    {
+        return type == WmiValue::kSigned || type == WmiValue::kUnsigned || type == WmiValue::kReal || type == WmiValue::kDateTime;
+    }
+
+    inline double GetNumber(
+        WmiValue::Type type,
+        int64_t signed_value,
+        uint64_t unsigned_value,
+        double real_value)
+    {
+        return type == WmiValue::kSigned     ? static_cast<double>(signed_value)
+               : type == WmiValue::kUnsigned ? static_cast<double>(unsigned_value)
+                                             : real_value;
+    }
+
+    // Orders two integers of any signedness without converting them to doubles
+    int CompareIntegers(
+        bool first_signed,
+        uint64_t first_bits,
+        bool second_signed,
+        uint64_t second_bits)
+    {
+        bool first_negative = first_signed && static_cast<int64_t>(first_bits) < 0;
+        bool second_negative = second_signed && static_cast<int64_t>(second_bits) < 0;
+        if (first_negative != second_negative)
+        {
+            return first_negative ? -1 : 1;
+        }
+        // Same sign, so the bits order the same way either way
+        if (first_negative)
+        {
+            int64_t first = static_cast<int64_t>(first_bits);
+            int64_t second = static_cast<int64_t>(second_bits);
+            return first < second ? -1 : first > second ? 1 : 0;
+        }
+        return first_bits < second_bits ? -1 : first_bits > second_bits ? 1 : 0;
+    }
+
+    // Orders strings case-insensitively, the way WQL compares them
+    int CompareStrings(
+        const wchar_t *first,
+        size_t first_length,
+        const wchar_t *second,
+        size_t second_length)
+    {
+        size_t length = std::min(first_length, second_length);
+        for (size_t i = 0; i < length; ++i)
+        {
+            wint_t first_char = std::towlower(static_cast<wint_t>(first[i]));
+            wint_t second_char = std::towlower(static_cast<wint_t>(second[i]));
+            if (first_char != second_char)
+            {
+                return first_char < second_char ? -1 : 1;
+            }
+        }
+        return first_length < second_length ? -1 : first_length > second_length ? 1 : 0;
+    }
+
+    /**
+     * Orders a value of the results against the value of a condition
+     *
+     * @return false when they can't be compared
+     */
+    bool CompareToCondition(
+        const ResultSet &results,
+        const ResultSet::Value &value,
+        const WmiValue &condition_value,
+        int *order)
+    {
+        if (IsNumber(value.type) && IsNumber(condition_value.type))
+        {
+            bool integers = (value.type == WmiValue::kSigned || value.type == WmiValue::kUnsigned) &&
+                            (condition_value.type == WmiValue::kSigned || condition_value.type == WmiValue::kUnsigned);
+            if (integers)
+            {
+                *order = CompareIntegers(
+                    value.type == WmiValue::kSigned,
+                    value.unsigned_value,
+                    condition_value.type == WmiValue::kSigned,
+                    condition_value.unsigned_value);
+                return true;
+            }
+
+            double first = GetNumber(value.type, value.signed_value, value.unsigned_value, value.real_value);
+            double second = GetNumber(condition_value.type, condition_value.signed_value, condition_value.unsigned_value, condition_value.real_value);
+            if (first != first || second != second)
+            {
+                return false;
+            }
+            *order = first < second ? -1 : first > second ? 1 : 0;
+            return true;
+        }
+
+        if (value.type == WmiValue::kBoolean && condition_value.type == WmiValue::kBoolean)
+        {
+            *order = static_cast<int>(value.boolean_value) - static_cast<int>(condition_value.boolean_value);
+            return true;
+        }
+
+        if (value.type == WmiValue::kString && condition_value.type == WmiValue::kString)
+        {
+            *order = CompareStrings(results.GetString(value), value.length, condition_value.string_value.data(), condition_value.string_value.size());
+            return true;
+        }
+        return false;
+    }
+
+    bool MeetsCondition(
+        const ResultSet &results,
+        const ResultSet::Value *value,
+        const AggregateCondition &condition)
+    {
+        // Null is only ever equal or not equal to null
+        if (condition.value.type == WmiValue::kNull)
+        {
+            return condition.op == AggregateCondition::kEqual     ? IsNull(value)
+                   : condition.op == AggregateCondition::kNotEqual ? !IsNull(value)
+                                                                   : false;
+        }
+        int order = 0;
+        if (IsNull(value) || !CompareToCondition(results, *value, condition.value, &order))
+        {
+            return false;
+        }
+
+        switch (condition.op)
+        {
+        case AggregateCondition::kEqual:
+            return order == 0;
+        case AggregateCondition::kNotEqual:
+            return order != 0;
+        case AggregateCondition::kLess:
+            return order < 0;
+        case AggregateCondition::kLessOrEqual:
+            return order <= 0;
+        case AggregateCondition::kGreater:
+            return order > 0;
+        default:
+            return order >= 0;
+        }
+    }
+
+    // Sums with independent partial sums, which the compiler can keep in vector registers
+    template <typename T>
+    T SumColumn(
+        const T *values,
+        size_t count)
+    {
+        T sums[4] = {0, 0, 0, 0};
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            sums[0] += values[i];
+            sums[1] += values[i + 1];
+            sums[2] += values[i + 2];
+            sums[3] += values[i + 3];
+        }
+        for (; i < count; ++i)
+        {
+            sums[0] += values[i];
+        }
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+    // Smallest (or largest when max is set) of count > 0 values, four lanes at a time like SumColumn
+    template <typename T>
+    T ExtremeOfColumn(
+        const T *values,
+        size_t count,
+        bool max)
+    {
+        T lanes[4] = {values[0], values[0], values[0], values[0]};
+        size_t i = 0;
+        if (max)
+        {
+            for (; i + 4 <= count; i += 4)
+            {
+                lanes[0] = std::max(lanes[0], values[i]);
+                lanes[1] = std::max(lanes[1], values[i + 1]);
+                lanes[2] = std::max(lanes[2], values[i + 2]);
+                lanes[3] = std::max(lanes[3], values[i + 3]);
+            }
+            for (; i < count; ++i)
+            {
+                lanes[0] = std::max(lanes[0], values[i]);
+            }
+            return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+        }
+
+        for (; i + 4 <= count; i += 4)
+        {
+            lanes[0] = std::min(lanes[0], values[i]);
+            lanes[1] = std::min(lanes[1], values[i + 1]);
+            lanes[2] = std::min(lanes[2], values[i + 2]);
+            lanes[3] = std::min(lanes[3], values[i + 3]);
+        }
+        for (; i < count; ++i)
+        {
+            lanes[0] = std::min(lanes[0], values[i]);
+        }
+        return std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+    }
+
+    /**
+     * The non-null values of a property, gathered group after group into one contiguous column
+     */
+    struct GatheredColumn
+    {
+        WmiValue::Type type = WmiValue::kNull; // kSigned, kUnsigned, kReal or kDateTime for numbers, kString for strings
+        uint8_t size = 0;                      // Widest integer or real
+        std::vector<int64_t> signed_values;
+        std::vector<uint64_t> unsigned_values;
+        std::vector<double> real_values; // Reals, or datetimes in milliseconds
+        std::vector<const ResultSet::Value *> strings;
+        std::vector<size_t> offsets; // Start of each group's values, plus the end
+    };
+
+    /**
+     * Picks the type the values of a property are reduced as and gathers them
+     *
+     * @param rows Instances in group order, group g being rows[group_offsets[g]] to rows[group_offsets[g + 1]]
+     * @return kAggregateTypeMismatch when the values can't be reduced together
+     */
+    HRESULT GatherColumn(
+        const ResultSet &results,
+        const std::vector<size_t> &columns,
+        const std::vector<uint32_t> &rows,
+        const std::vector<size_t> &group_offsets,
+        GatheredColumn *column)
+    {
+        bool has_real = false;
+        bool has_signed = false;
+        bool has_unsigned = false;
+        bool has_datetime = false;
+        bool has_string = false;
+        for (uint32_t row : rows)
+        {
+            const ResultSet::Value *value = GetColumnValue(results, columns, row);
+            if (IsNull(value))
+            {
+                continue;
+            }
+            switch (value->type)
+            {
+            case WmiValue::kSigned:
+                has_signed = true;
+                break;
+            case WmiValue::kUnsigned:
+                has_unsigned = true;
+                break;
+            case WmiValue::kReal:
+                has_real = true;
+                break;
+            case WmiValue::kDateTime:
+                has_datetime = true;
+                break;
+            case WmiValue::kString:
+                has_string = true;
+                break;
+            default:
+                // Booleans and arrays have no order or sum
+                return kAggregateTypeMismatch;
+            }
+            column->size = std::max(column->size, value->size);
+        }
+
+        bool has_number = has_real || has_signed || has_unsigned;
+        if (static_cast<int>(has_number) + static_cast<int>(has_datetime) + static_cast<int>(has_string) > 1)
+        {
+            return kAggregateTypeMismatch;
+        }
+        column->type = has_string     ? WmiValue::kString
+                       : has_datetime ? WmiValue::kDateTime
+                       : has_real     ? WmiValue::kReal
+                       : has_signed   ? WmiValue::kSigned
+                       : has_unsigned ? WmiValue::kUnsigned
+                                      : WmiValue::kNull;
+
+        switch (column->type)
+        {
+        case WmiValue::kString:
+            column->strings.reserve(rows.size());
+            break;
+        case WmiValue::kSigned:
+            column->signed_values.reserve(rows.size());
+            break;
+        case WmiValue::kUnsigned:
+            column->unsigned_values.reserve(rows.size());
+            break;
+        default:
+            column->real_values.reserve(rows.size());
+            break;
+        }
+
+        size_t group_count = group_offsets.size() - 1;
+        column->offsets.resize(group_count + 1);
+        size_t gathered = 0;
+        for (size_t group = 0; group < group_count; ++group)
+        {
+            column->offsets[group] = gathered;
+            for (size_t i = group_offsets[group]; i < group_offsets[group + 1]; ++i)
+            {
+                const ResultSet::Value *value = GetColumnValue(results, columns, rows[i]);
+                if (IsNull(value))
+                {
+                    continue;
+                }
+                ++gathered;
+                switch (column->type)
+                {
+                case WmiValue::kString:
+                    column->strings.push_back(value);
+                    break;
+                case WmiValue::kSigned:
+                    column->signed_values.push_back(value->signed_value);
+                    break;
+                case WmiValue::kUnsigned:
+                    column->unsigned_values.push_back(value->unsigned_value);
+                    break;
+                default:
+                    column->real_values.push_back(GetNumber(value->type, value->signed_value, value->unsigned_value, value->real_value));
+                    break;
+                }
+            }
+        }
+        column->offsets[group_count] = gathered;
+        return S_OK;
+    }
+
+    WmiValue MakeNumber(
+        WmiValue::Type type,
+        uint8_t size)
+    {
+        WmiValue value;
+        value.type = type;
+        value.size = size;
+        return value;
+    }
+
+    /**
+     * Sums, averages or picks the smallest or largest of the values a group has in a gathered column
+     *
+     * @return kAggregateTypeMismatch when the function doesn't apply to the type of the column
+     */
+    HRESULT ReduceGroup(
+        const ResultSet &results,
+        const GatheredColumn &column,
+        size_t group,
+        AggregateOutput::Function function,
+        WmiValue *output)
+    {
+        size_t first = column.offsets[group];
+        size_t count = column.offsets[group + 1] - first;
+        bool numeric = column.type == WmiValue::kSigned || column.type == WmiValue::kUnsigned || column.type == WmiValue::kReal;
+
+        if (function == AggregateOutput::kSum || function == AggregateOutput::kAvg)
+        {
+            if (!numeric && column.type != WmiValue::kNull)
+            {
+                return kAggregateTypeMismatch;
+            }
+
+            // Integers are summed exactly, wrapping around like the 64 bit integers they are read as
+            uint64_t integer_sum = 0;
+            double real_sum = 0;
+            if (column.type == WmiValue::kSigned && count > 0)
+            {
+                const int64_t *values = column.signed_values.data() + first;
+                integer_sum = SumColumn(reinterpret_cast<const uint64_t *>(values), count);
+                real_sum = static_cast<double>(static_cast<int64_t>(integer_sum));
+            }
+            else if (column.type == WmiValue::kUnsigned && count > 0)
+            {
+                integer_sum = SumColumn(column.unsigned_values.data() + first, count);
+                real_sum = static_cast<double>(integer_sum);
+            }
+            else if (column.type == WmiValue::kReal && count > 0)
+            {
+                real_sum = SumColumn(column.real_values.data() + first, count);
+            }
+
+            if (function == AggregateOutput::kAvg)
+            {
+                if (count > 0)
+                {
+                    *output = MakeNumber(WmiValue::kReal, 8);
+                    output->real_value = real_sum / static_cast<double>(count);
+                }
+                return S_OK;
+            }
+
+            if (column.type == WmiValue::kReal)
+            {
+                *output = MakeNumber(WmiValue::kReal, 8);
+                output->real_value = real_sum;
+            }
+            else
+            {
+                // A sum of nothing is a plain 0
+                *output = MakeNumber(column.type == WmiValue::kSigned ? WmiValue::kSigned : WmiValue::kUnsigned, std::max<uint8_t>(column.size, 4));
+                output->unsigned_value = integer_sum;
+            }
+            return S_OK;
+        }
+
+        // The smallest or largest value, null when the group has none
+        bool max = function == AggregateOutput::kMax;
+        if (count == 0)
+        {
+            return S_OK;
+        }
+        switch (column.type)
+        {
+        case WmiValue::kString:
+        {
+            const ResultSet::Value *extreme = column.strings[first];
+            for (size_t i = first + 1; i < first + count; ++i)
+            {
+                const ResultSet::Value *value = column.strings[i];
+                int order = CompareStrings(results.GetString(*value), value->length, results.GetString(*extreme), extreme->length);
+                if (max ? order > 0 : order < 0)
+                {
+                    extreme = value;
+                }
+            }
+            *output = results.GetWmiValue(*extreme);
+            break;
+        }
+        case WmiValue::kSigned:
+            *output = MakeNumber(WmiValue::kSigned, column.size);
+            output->signed_value = ExtremeOfColumn(column.signed_values.data() + first, count, max);
+            break;
+        case WmiValue::kUnsigned:
+            *output = MakeNumber(WmiValue::kUnsigned, column.size);
+            output->unsigned_value = ExtremeOfColumn(column.unsigned_values.data() + first, count, max);
+            break;
+        default:
+            *output = MakeNumber(column.type, column.size);
+            output->real_value = ExtremeOfColumn(column.real_values.data() + first, count, max);
+            break;
+        }
+        return S_OK;
+    }
+
+    HRESULT AggregateResults(
+        const ResultSet &results,
+        const AggregateSpec &spec,
+        AggregatedResults *aggregated)
+    {
+        HRESULT hres = S_OK;
+
+        // Keep the instances that meet every condition
+        std::vector<uint32_t> selected;
+        selected.reserve(results.size());
+        std::vector<std::vector<size_t>> condition_columns(spec.where.size());
+        for (size_t c = 0; c < spec.where.size() && SUCCEEDED(hres); ++c)
+        {
+            hres = FindColumns(results, spec.where[c].property, &condition_columns[c]);
+        }
+        for (uint32_t row = 0; row < results.size() && SUCCEEDED(hres); ++row)
+        {
+            bool meets = true;
+            for (size_t c = 0; c < spec.where.size() && meets; ++c)
+            {
+                meets = MeetsCondition(results, GetColumnValue(results, condition_columns[c], row), spec.where[c]);
+            }
+            if (meets)
+            {
+                selected.push_back(row);
+            }
+        }
+
+        // Number the groups in the order their first instance comes in
+        std::vector<std::vector<size_t>> key_columns(spec.group_by.size());
+        for (size_t k = 0; k < spec.group_by.size() && SUCCEEDED(hres); ++k)
+        {
+            hres = FindColumns(results, spec.group_by[k], &key_columns[k]);
+        }
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        ResultSet::Value null_value;
+        auto key_value = [&](size_t k, uint32_t row) -> const ResultSet::Value &
+        {
+            const ResultSet::Value *value = GetColumnValue(results, key_columns[k], row);
+            return value != NULL ? *value : null_value;
+        };
+
+        std::vector<uint32_t> group_of(selected.size(), 0);
+        std::vector<uint32_t> group_first_rows;
+        if (spec.group_by.empty())
+        {
+            group_first_rows.push_back(0);
+        }
+        else
+        {
+            std::unordered_multimap<uint64_t, uint32_t> groups;
+            for (size_t i = 0; i < selected.size(); ++i)
+            {
+                uint64_t hash = kHashOffset;
+                for (size_t k = 0; k < spec.group_by.size(); ++k)
+                {
+                    hash = HashValue(results, key_value(k, selected[i]), hash);
+                }
+
+                uint32_t group = static_cast<uint32_t>(group_first_rows.size());
+                auto candidates = groups.equal_range(hash);
+                for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+                {
+                    bool same_key = true;
+                    for (size_t k = 0; k < spec.group_by.size() && same_key; ++k)
+                    {
+                        same_key = ValuesEqual(results, key_value(k, selected[i]), results, key_value(k, group_first_rows[candidate->second]));
+                    }
+                    if (same_key)
+                    {
+                        group = candidate->second;
+                        break;
+                    }
+                }
+                if (group == group_first_rows.size())
+                {
+                    group_first_rows.push_back(selected[i]);
+                    groups.emplace(hash, group);
+                }
+                group_of[i] = group;
+            }
+        }
+
+        // Lay the instances out group after group, so each group's values end up next to each other
+        size_t group_count = group_first_rows.size();
+        std::vector<size_t> group_offsets(group_count + 1, 0);
+        for (uint32_t group : group_of)
+        {
+            ++group_offsets[group + 1];
+        }
+        for (size_t group = 0; group < group_count; ++group)
+        {
+            group_offsets[group + 1] += group_offsets[group];
+        }
+        std::vector<uint32_t> rows(selected.size());
+        std::vector<size_t> next(group_offsets.begin(), group_offsets.end() - 1);
+        for (size_t i = 0; i < selected.size(); ++i)
+        {
+            rows[next[group_of[i]]++] = selected[i];
+        }
+
+        aggregated->groups.assign(group_count, AggregateGroup());
+        for (size_t group = 0; group < group_count; ++group)
+        {
+            AggregateGroup &output = aggregated->groups[group];
+            output.outputs.resize(spec.outputs.size());
+            for (size_t k = 0; k < spec.group_by.size(); ++k)
+            {
+                output.keys.push_back(results.GetWmiValue(key_value(k, group_first_rows[group])));
+            }
+        }
+
+        for (size_t o = 0; o < spec.outputs.size(); ++o)
+        {
+            const AggregateOutput &output = spec.outputs[o];
+            std::vector<size_t> columns;
+            if (!output.property.empty())
+            {
+                hres = FindColumns(results, output.property, &columns);
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+            }
+
+            // Counts need no particular type, only the instances or their values that aren't null
+            if (output.function == AggregateOutput::kCount)
+            {
+                for (size_t group = 0; group < group_count; ++group)
+                {
+                    WmiValue &count = aggregated->groups[group].outputs[o];
+                    count = MakeNumber(WmiValue::kUnsigned, 4);
+                    for (size_t i = group_offsets[group]; i < group_offsets[group + 1]; ++i)
+                    {
+                        count.unsigned_value += output.property.empty() || !IsNull(GetColumnValue(results, columns, rows[i])) ? 1 : 0;
+                    }
+                }
+                continue;
+            }
+
+            GatheredColumn column;
+            if (SUCCEEDED(hres))
+            {
+                hres = GatherColumn(results, columns, rows, group_offsets, &column);
+            }
+            for (size_t group = 0; group < group_count && SUCCEEDED(hres); ++group)
+            {
+                hres = ReduceGroup(results, column, group, output.function, &aggregated->groups[group].outputs[o]);
+            }
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+        }
+        return S_OK;
+    }
+
+}
\ No newline at end of file
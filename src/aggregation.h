@@ -0,0 +1,119 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    // Returned when a value can't be aggregated, such as the sum of a string property
+    const HRESULT kAggregateTypeMismatch = static_cast<HRESULT>(0x80020005L); // Same as DISP_E_TYPEMISMATCH
+
+    // Returned when none of the instances has a property the aggregation uses
+    const HRESULT kAggregatePropertyMissing = static_cast<HRESULT>(0x80020006L); // Same as DISP_E_UNKNOWNNAME
+
+    /**
+     * A condition instances have to meet to be aggregated. Numbers compare by value whatever their
+     * CIM type, strings compare case-insensitively like WQL does, null only equals null and values
+     * that can't be compared, such as a string and a number, never meet the condition.
+     */
+    struct AggregateCondition
+    {
+        enum Operator : uint8_t
+        {
+            kEqual,
+            kNotEqual,
+            kLess,
+            kLessOrEqual,
+            kGreater,
+            kGreaterOrEqual
+        };
+
+        std::wstring property;
+        Operator op = kEqual;
+        WmiValue value;
+    };
+
+    /**
+     * A value computed per group. Null values are skipped, count without a property counts instances.
+     */
+    struct AggregateOutput
+    {
+        enum Function : uint8_t
+        {
+            kCount,
+            kSum, // Numbers, exact for integers, which keep their type widened to the largest width summed
+            kMin, // Numbers, datetimes or strings, the value keeps its type
+            kMax,
+            kAvg  // Numbers, always a real
+        };
+
+        std::string name; // Name of the value in the results
+        Function function = kCount;
+        std::wstring property;
+    };
+
+    /**
+     * The aggregation a query asked for with its aggregate option
+     */
+    struct AggregateSpec
+    {
+        std::vector<AggregateCondition> where; // All of them have to be met
+        std::vector<std::wstring> group_by;    // No groups when empty, every instance goes into one
+        std::vector<AggregateOutput> outputs;
+
+        // The properties that have to be read, each once
+        std::vector<std::wstring> GetProperties() const;
+    };
+
+    struct AggregateGroup
+    {
+        std::vector<WmiValue> keys;    // One per AggregateSpec::group_by
+        std::vector<WmiValue> outputs; // One per AggregateSpec::outputs
+    };
+
+    struct AggregatedResults
+    {
+        std::vector<AggregateGroup> groups; // In the order their first instance came in, one when not grouped
+    };
+
+    /**
+     * Filters, groups and reduces query results without converting them. Numeric values are gathered
+     * into a contiguous column per group and reduced several at a time. Does not touch any Napi
+     * values, so it can run on a worker thread.
+     *
+     * @return kAggregateTypeMismatch when a value can't be aggregated by its function,
+     *         kAggregatePropertyMissing when no instance has one of the properties
+     */
+    HRESULT AggregateResults(const ResultSet &results, const AggregateSpec &spec, AggregatedResults *aggregated);
+
+};
\ No newline at end of file
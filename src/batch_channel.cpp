@@ -0,0 +1,113 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "batch_channel.h"
+
+namespace wmi_wrapper
+{
+
+    BatchChannel::BatchChannel(size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1),
+          consumer_waiting_(false),
+          completed_(false),
+          cancelled_(false),
+          status_(S_OK)
+    {
+    }
+
+    bool BatchChannel::Push(
+        ResultSet &&batch,
+        bool *wake_consumer)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(
+            lock,
+            [this]()
+            { return cancelled_ || batches_.size() < capacity_; });
+
+        *wake_consumer = false;
+        if (cancelled_)
+        {
+            return false;
+        }
+
+        batches_.push_back(std::move(batch));
+        *wake_consumer = consumer_waiting_;
+        consumer_waiting_ = false;
+        return true;
+    }
+
+    bool BatchChannel::Complete(HRESULT status)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed_ = true;
+        status_ = status;
+
+        bool wake_consumer = consumer_waiting_;
+        consumer_waiting_ = false;
+        return wake_consumer;
+    }
+
+    BatchChannel::PopResult BatchChannel::Pop(
+        ResultSet *batch,
+        HRESULT *status)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!batches_.empty())
+        {
+            *batch = std::move(batches_.front());
+            batches_.pop_front();
+            not_full_.notify_one();
+            return kBatch;
+        }
+
+        if (completed_ || cancelled_)
+        {
+            *status = status_;
+            return kDone;
+        }
+
+        consumer_waiting_ = true;
+        return kPending;
+    }
+
+    void BatchChannel::Cancel()
+    {
+        std::deque<ResultSet> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // A waiting consumer stays marked, the Complete of the stopped query wakes it
+            cancelled_ = true;
+            dropped.swap(batches_);
+        }
+        not_full_.notify_all();
+    }
+
+    size_t BatchChannel::GetBufferedCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batches_.size();
+    }
+
+}
\ No newline at end of file
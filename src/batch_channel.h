@@ -0,0 +1,93 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Bounded hand-off of result batches from the thread running a query to the JavaScript thread.
+     *
+     * The producer blocks once the channel holds capacity batches, which pauses the enumeration
+     * until the consumer catches up. The consumer never blocks: when there is nothing to take it is
+     * marked as waiting, and the next Push or Complete reports that it needs to be woken up.
+     */
+    class BatchChannel
+    {
+    public:
+        enum PopResult
+        {
+            kBatch,   // A batch was taken
+            kPending, // Nothing available yet, the consumer is now waiting
+            kDone     // The query completed (or was cancelled) and every batch was taken
+        };
+
+        explicit BatchChannel(size_t capacity);
+
+        /**
+         * Adds a batch, blocking while the channel is full
+         *
+         * @param wake_consumer Set to true when the consumer is waiting for this batch
+         * @return false if the channel was cancelled and the query should stop
+         */
+        bool Push(ResultSet &&batch, bool *wake_consumer);
+
+        /**
+         * Marks the end of the query
+         *
+         * @return true when the consumer is waiting and needs to be woken up
+         */
+        bool Complete(HRESULT status);
+
+        PopResult Pop(ResultSet *batch, HRESULT *status);
+
+        /**
+         * Drops buffered batches and makes the producer stop at its next Push. A consumer that is
+         * waiting is woken by the Complete that follows.
+         */
+        void Cancel();
+
+        size_t GetBufferedCount();
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable not_full_;
+        std::deque<ResultSet> batches_;
+        size_t capacity_;
+
+        bool consumer_waiting_;
+        bool completed_;
+        bool cancelled_;
+        HRESULT status_;
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,260 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Appends little-endian integers and UTF-16 strings to a buffer, whatever the byte order and
+     * wchar_t width of the platform, so files written on Windows read the same everywhere
+     */
+    class BinaryWriter
+    {
+    public:
+        explicit BinaryWriter(std::vector<uint8_t> *buffer) : buffer_(buffer) {}
+
+        size_t GetSize() const
+        {
+            return buffer_->size();
+        }
+
+        void Write8(uint8_t value)
+        {
+            buffer_->push_back(value);
+        }
+
+        void Write16(uint16_t value)
+        {
+            buffer_->push_back(static_cast<uint8_t>(value));
+            buffer_->push_back(static_cast<uint8_t>(value >> 8));
+        }
+
+        void Write32(uint32_t value)
+        {
+            Write16(static_cast<uint16_t>(value));
+            Write16(static_cast<uint16_t>(value >> 16));
+        }
+
+        void Write64(uint64_t value)
+        {
+            Write32(static_cast<uint32_t>(value));
+            Write32(static_cast<uint32_t>(value >> 32));
+        }
+
+        void WriteBytes(const uint8_t *data, size_t size)
+        {
+            buffer_->insert(buffer_->end(), data, data + size);
+        }
+
+        // Overwrite values written before, such as sizes only known once what follows them is written
+        void Patch32(size_t position, uint32_t value)
+        {
+            for (size_t i = 0; i < 4; ++i)
+            {
+                (*buffer_)[position + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        void Patch64(size_t position, uint64_t value)
+        {
+            Patch32(position, static_cast<uint32_t>(value));
+            Patch32(position + 4, static_cast<uint32_t>(value >> 32));
+        }
+
+        void Align(size_t alignment)
+        {
+            buffer_->resize((buffer_->size() + alignment - 1) / alignment * alignment, 0);
+        }
+
+        /**
+         * Writes characters as UTF-16 code units, code points above U+FFFF as surrogate pairs where
+         * wchar_t holds UTF-32
+         *
+         * @return Number of code units written
+         */
+        uint32_t WriteUtf16(const wchar_t *text, size_t length)
+        {
+            uint32_t units = 0;
+            for (size_t i = 0; i < length; ++i)
+            {
+                uint32_t code_point = static_cast<uint32_t>(text[i]);
+                if (sizeof(wchar_t) > 2 && code_point >= 0x10000 && code_point <= 0x10FFFF)
+                {
+                    code_point -= 0x10000;
+                    Write16(static_cast<uint16_t>(0xD800 | (code_point >> 10)));
+                    Write16(static_cast<uint16_t>(0xDC00 | (code_point & 0x3FF)));
+                    units += 2;
+                }
+                else
+                {
+                    Write16(static_cast<uint16_t>(code_point));
+                    ++units;
+                }
+            }
+            return units;
+        }
+
+        // Writes the number of code units followed by the UTF-16 string
+        void WriteString(const std::wstring &text)
+        {
+            size_t position = buffer_->size();
+            Write32(0);
+            Patch32(position, WriteUtf16(text.data(), text.size()));
+        }
+
+    private:
+        std::vector<uint8_t> *buffer_;
+    };
+
+    /**
+     * Reads what BinaryWriter wrote. Reads fail instead of going past the end of the data, which
+     * may come from a file that was cut short or changed.
+     */
+    class BinaryReader
+    {
+    public:
+        BinaryReader(const uint8_t *data, size_t size) : data_(data), size_(size), position_(0) {}
+
+        size_t GetPosition() const
+        {
+            return position_;
+        }
+
+        size_t GetRemaining() const
+        {
+            return size_ - position_;
+        }
+
+        bool Read8(uint8_t *value)
+        {
+            if (GetRemaining() < 1)
+            {
+                return false;
+            }
+            *value = data_[position_++];
+            return true;
+        }
+
+        bool Read16(uint16_t *value)
+        {
+            if (GetRemaining() < 2)
+            {
+                return false;
+            }
+            *value = static_cast<uint16_t>(data_[position_] | (data_[position_ + 1] << 8));
+            position_ += 2;
+            return true;
+        }
+
+        bool Read32(uint32_t *value)
+        {
+            uint16_t low;
+            uint16_t high;
+            if (!Read16(&low) || !Read16(&high))
+            {
+                return false;
+            }
+            *value = low | (static_cast<uint32_t>(high) << 16);
+            return true;
+        }
+
+        bool Read64(uint64_t *value)
+        {
+            uint32_t low;
+            uint32_t high;
+            if (!Read32(&low) || !Read32(&high))
+            {
+                return false;
+            }
+            *value = low | (static_cast<uint64_t>(high) << 32);
+            return true;
+        }
+
+        // Returns the next size bytes without copying them, NULL when there aren't that many left
+        const uint8_t *ReadBytes(size_t size)
+        {
+            if (GetRemaining() < size)
+            {
+                return NULL;
+            }
+            const uint8_t *bytes = data_ + position_;
+            position_ += size;
+            return bytes;
+        }
+
+        // Reads a string written by BinaryWriter::WriteString
+        bool ReadString(std::wstring *text)
+        {
+            uint32_t units;
+            if (!Read32(&units) || GetRemaining() / 2 < units)
+            {
+                return false;
+            }
+            text->clear();
+            AppendUtf16(data_ + position_, units, text);
+            position_ += static_cast<size_t>(units) * 2;
+            return true;
+        }
+
+        /**
+         * Appends little-endian UTF-16 code units as wchar_t, joining surrogate pairs where wchar_t
+         * holds UTF-32 and replacing unpaired surrogates there
+         */
+        template <typename Output>
+        static void AppendUtf16(const uint8_t *units, size_t count, Output *text)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                uint32_t unit = units[2 * i] | (units[2 * i + 1] << 8);
+                if (sizeof(wchar_t) > 2 && unit >= 0xD800 && unit <= 0xDFFF)
+                {
+                    uint32_t next = i + 1 < count ? (units[2 * i + 2] | (units[2 * i + 3] << 8)) : 0;
+                    if (unit <= 0xDBFF && next >= 0xDC00 && next <= 0xDFFF)
+                    {
+                        unit = 0x10000 + ((unit - 0xD800) << 10) + (next - 0xDC00);
+                        ++i;
+                    }
+                    else
+                    {
+                        unit = 0xFFFD;
+                    }
+                }
+                text->push_back(static_cast<wchar_t>(unit));
+            }
+        }
+
+    private:
+        const uint8_t *data_;
+        size_t size_;
+        size_t position_;
+    };
+
+};
\ No newline at end of file
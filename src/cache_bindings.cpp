@@ -0,0 +1,181 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "cache_bindings.h"
+
+#include <limits>
+#include <string>
+
+#include "marshalling.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "result_cache.h"
+
+namespace wmi_wrapper
+{
+
+    bool ReadMilliseconds(
+        Napi::Value value,
+        uint32_t *milliseconds)
+    {
+        double number = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+        if (!(number >= 0 && number <= std::numeric_limits<uint32_t>::max()))
+        {
+            Napi::Error::New(value.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *milliseconds = static_cast<uint32_t>(number);
+        return true;
+    }
+
+    Napi::Value WmiConfigureCache(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        ResultCache *cache = GetResultCache();
+        if (cache == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        if (info.Length() != 1 || !info[0].IsObject())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object options = info[0].As<Napi::Object>();
+        Napi::Value max_bytes = options.Get("maxBytes");
+        Napi::Value class_ttls = options.Get("classTtlMs");
+        if ((!max_bytes.IsUndefined() && !(max_bytes.IsNumber() && max_bytes.As<Napi::Number>().DoubleValue() >= 0)) ||
+            (!class_ttls.IsUndefined() && !class_ttls.IsObject()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        if (!class_ttls.IsUndefined())
+        {
+            // Validate everything before applying anything
+            Napi::Object ttls = class_ttls.As<Napi::Object>();
+            Napi::Array class_names = ttls.GetPropertyNames();
+            std::vector<std::pair<std::wstring, uint32_t>> class_ttl_values;
+            for (uint32_t i = 0; i < class_names.Length(); ++i)
+            {
+                Napi::Value class_name = class_names.Get(i);
+                uint32_t ttl_ms;
+                if (!ReadMilliseconds(ttls.Get(class_name), &ttl_ms))
+                {
+                    return env.Undefined();
+                }
+                class_ttl_values.push_back(std::make_pair(
+                    ConvertStringToWstring(class_name.ToString().Utf8Value()),
+                    ttl_ms));
+            }
+
+            for (const auto &class_ttl : class_ttl_values)
+            {
+                cache->SetClassTtl(class_ttl.first, class_ttl.second);
+            }
+        }
+
+        if (!max_bytes.IsUndefined())
+        {
+            cache->SetMaxBytes(static_cast<size_t>(max_bytes.As<Napi::Number>().Int64Value()));
+        }
+
+        return env.Undefined();
+    }
+
+    Napi::Value WmiInvalidateCache(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        ResultCache *cache = GetResultCache();
+        if (cache == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        std::string wmi_namespace;
+        std::wstring class_name;
+        if (info.Length() > 2 ||
+            (info.Length() > 0 && !info[0].IsUndefined() && !info[0].IsString()) ||
+            (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsString()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (info.Length() > 0 && info[0].IsString())
+        {
+            wmi_namespace = info[0].As<Napi::String>().Utf8Value();
+        }
+        if (info.Length() > 1 && info[1].IsString())
+        {
+            class_name = ConvertStringToWstring(info[1].As<Napi::String>().Utf8Value());
+        }
+
+        cache->Invalidate(wmi_namespace, class_name);
+        return env.Undefined();
+    }
+
+    Napi::Value WmiCacheStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        ResultCache *cache = GetResultCache();
+        if (cache == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        ResultCacheStats stats = cache->GetStats();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+        result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+        result.Set("coalesced", Napi::Number::New(env, static_cast<double>(stats.coalesced)));
+        result.Set("expirations", Napi::Number::New(env, static_cast<double>(stats.expirations)));
+        result.Set("evictions", Napi::Number::New(env, static_cast<double>(stats.evictions)));
+        result.Set("invalidations", Napi::Number::New(env, static_cast<double>(stats.invalidations)));
+        result.Set("entries", Napi::Number::New(env, static_cast<double>(stats.entries)));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+        return result;
+    }
+
+    void RegisterCacheBindings(
+        Napi::Env env,
+        Napi::Object exports)
+    {
+        exports.Set("configureCache", Napi::Function::New(env, wmi_wrapper::WmiConfigureCache));
+        exports.Set("invalidateCache", Napi::Function::New(env, wmi_wrapper::WmiInvalidateCache));
+        exports.Set("cacheStats", Napi::Function::New(env, wmi_wrapper::WmiCacheStats));
+    }
+
+}
\ No newline at end of file
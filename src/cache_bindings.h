@@ -0,0 +1,57 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Sets the result cache limits
+     *
+     * @param info[0] Object with maxBytes (size limit of the cached results) and classTtlMs, an object
+     *                mapping class names to the milliseconds their results are cached for when a query
+     *                passes no cacheTtlMs, 0 stops caching a class
+     */
+    Napi::Value WmiConfigureCache(const Napi::CallbackInfo &info);
+
+    /**
+     * Drops cached results
+     *
+     * @param info[0] Optional: Only drop results of this namespace
+     * @param info[1] Optional: Only drop results of this class
+     */
+    Napi::Value WmiInvalidateCache(const Napi::CallbackInfo &info);
+
+    /**
+     * Returns the result cache counters: hits, misses, coalesced, expirations, evictions,
+     * invalidations, entries and bytes
+     */
+    Napi::Value WmiCacheStats(const Napi::CallbackInfo &info);
+
+    void RegisterCacheBindings(Napi::Env env, Napi::Object exports);
+
+};
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <utility>
+
+namespace wmi_wrapper
+{
+
+    // How long a query that can be cancelled waits on WMI before it checks its CancellationToken again
+    const std::chrono::milliseconds kCancellationPollInterval(50);
+
+    /**
+     * Tells a running query to stop, set from the JavaScript thread when the AbortSignal of the
+     * query fires and checked by the query between calls into WMI. A token with a parent is also
+     * cancelled with it, which is how a queryMany signal reaches every query of the batch.
+     */
+    class CancellationToken
+    {
+    public:
+        explicit CancellationToken(std::shared_ptr<const CancellationToken> parent)
+            : cancelled_(false),
+              parent_(std::move(parent))
+        {
+        }
+
+        void Cancel()
+        {
+            cancelled_ = true;
+        }
+
+        bool IsCancelled() const
+        {
+            return cancelled_ || (parent_ && parent_->IsCancelled());
+        }
+
+    private:
+        std::atomic<bool> cancelled_;
+        std::shared_ptr<const CancellationToken> parent_;
+    };
+
+};
\ No newline at end of file
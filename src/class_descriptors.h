@@ -0,0 +1,627 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "property_access.h"
+#include "query_types.h"
+#include "result_set.h"
+#include "variant_conversion.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * A property of a typed class, its name and CIM type are fixed at compile time
+     */
+    struct TypedProperty
+    {
+        const wchar_t *name;
+        CIMTYPE cim_type;
+    };
+
+    // Same as WBEM_E_TYPE_MISMATCH, returned when an instance has a property of a typed class with another CIM type
+    const HRESULT kTypedClassMismatch = static_cast<HRESULT>(0x80041005L);
+
+    /**
+     * Descriptors of the classes queryTyped knows, every property is read with the conversion of its
+     * declared CIM type. The property lists are the select lists of the typed queries.
+     */
+    struct Win32ProcessorClass
+    {
+        static constexpr const char *kNamespace = "root/cimv2";
+        static constexpr const wchar_t *kClassName = L"Win32_Processor";
+        static constexpr TypedProperty kProperties[] = {
+            {L"DeviceID", CIM_STRING},
+            {L"Name", CIM_STRING},
+            {L"Manufacturer", CIM_STRING},
+            {L"ProcessorId", CIM_STRING},
+            {L"Architecture", CIM_UINT16},
+            {L"NumberOfCores", CIM_UINT32},
+            {L"NumberOfLogicalProcessors", CIM_UINT32},
+            {L"MaxClockSpeed", CIM_UINT32},
+            {L"CurrentClockSpeed", CIM_UINT32},
+            {L"LoadPercentage", CIM_UINT16},
+            {L"L2CacheSize", CIM_UINT32},
+            {L"L3CacheSize", CIM_UINT32}};
+    };
+
+    struct Win32LogicalDiskClass
+    {
+        static constexpr const char *kNamespace = "root/cimv2";
+        static constexpr const wchar_t *kClassName = L"Win32_LogicalDisk";
+        static constexpr TypedProperty kProperties[] = {
+            {L"DeviceID", CIM_STRING},
+            {L"DriveType", CIM_UINT32},
+            {L"FileSystem", CIM_STRING},
+            {L"FreeSpace", CIM_UINT64},
+            {L"Size", CIM_UINT64},
+            {L"VolumeName", CIM_STRING},
+            {L"VolumeSerialNumber", CIM_STRING}};
+    };
+
+    struct Win32OperatingSystemClass
+    {
+        static constexpr const char *kNamespace = "root/cimv2";
+        static constexpr const wchar_t *kClassName = L"Win32_OperatingSystem";
+        static constexpr TypedProperty kProperties[] = {
+            {L"Caption", CIM_STRING},
+            {L"Version", CIM_STRING},
+            {L"BuildNumber", CIM_STRING},
+            {L"OSArchitecture", CIM_STRING},
+            {L"SystemDrive", CIM_STRING},
+            {L"NumberOfProcesses", CIM_UINT32},
+            {L"FreePhysicalMemory", CIM_UINT64},
+            {L"TotalVisibleMemorySize", CIM_UINT64},
+            {L"FreeVirtualMemory", CIM_UINT64},
+            {L"InstallDate", CIM_DATETIME},
+            {L"LastBootUpTime", CIM_DATETIME}};
+    };
+
+    struct MsftPhysicalDiskClass
+    {
+        static constexpr const char *kNamespace = "root/microsoft/windows/storage";
+        static constexpr const wchar_t *kClassName = L"MSFT_PhysicalDisk";
+        static constexpr TypedProperty kProperties[] = {
+            {L"DeviceId", CIM_STRING},
+            {L"FriendlyName", CIM_STRING},
+            {L"SerialNumber", CIM_STRING},
+            {L"MediaType", CIM_UINT16},
+            {L"BusType", CIM_UINT16},
+            {L"HealthStatus", CIM_UINT16},
+            {L"OperationalStatus", CIM_UINT16 | CIM_FLAG_ARRAY},
+            {L"SpindleSpeed", CIM_UINT32},
+            {L"Size", CIM_UINT64}};
+    };
+
+    struct WmiMonitorIdClass
+    {
+        static constexpr const char *kNamespace = "root/wmi";
+        static constexpr const wchar_t *kClassName = L"WmiMonitorID";
+        static constexpr TypedProperty kProperties[] = {
+            {L"InstanceName", CIM_STRING},
+            {L"Active", CIM_BOOLEAN},
+            {L"ManufacturerName", CIM_UINT16 | CIM_FLAG_ARRAY},
+            {L"ProductCodeID", CIM_UINT16 | CIM_FLAG_ARRAY},
+            {L"SerialNumberID", CIM_UINT16 | CIM_FLAG_ARRAY},
+            {L"UserFriendlyName", CIM_UINT16 | CIM_FLAG_ARRAY},
+            {L"WeekOfManufacture", CIM_UINT8},
+            {L"YearOfManufacture", CIM_UINT16}};
+    };
+
+    /**
+     * Reads the value of a property whose CIM type is known at compile time. Types with a fixed size
+     * representation are read through a property handle, the others are read by name and converted
+     * for their type directly. The general conversion is kept for VARIANTs of another shape, such as
+     * nulls, and for arrays.
+     */
+    template <CIMTYPE kCimType>
+    struct TypedValueReader
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            ConvertVariant(variant, kCimType, value);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_UINT32>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kDword;
+
+        static void Convert(uint64_t number, WmiValue *value)
+        {
+            value->type = WmiValue::kUnsigned;
+            value->size = 4;
+            value->unsigned_value = static_cast<uint32_t>(number);
+        }
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            ConvertVariant(variant, CIM_UINT32, value);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_SINT32>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kDword;
+
+        static void Convert(uint64_t number, WmiValue *value)
+        {
+            value->type = WmiValue::kSigned;
+            value->size = 4;
+            value->signed_value = static_cast<int32_t>(static_cast<uint32_t>(number));
+        }
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            ConvertVariant(variant, CIM_SINT32, value);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_UINT64>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kQword;
+
+        static void Convert(uint64_t number, WmiValue *value)
+        {
+            value->type = WmiValue::kUnsigned;
+            value->size = 8;
+            value->unsigned_value = number;
+        }
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            ConvertVariant(variant, CIM_UINT64, value);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_SINT64>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kQword;
+
+        static void Convert(uint64_t number, WmiValue *value)
+        {
+            value->type = WmiValue::kSigned;
+            value->size = 8;
+            value->signed_value = static_cast<int64_t>(number);
+        }
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            ConvertVariant(variant, CIM_SINT64, value);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_STRING>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            if (variant.vt != VT_BSTR)
+            {
+                ConvertVariant(variant, CIM_STRING, value);
+                return;
+            }
+            value->type = WmiValue::kString;
+            if (variant.bstrVal != NULL)
+            {
+                value->string_value.assign(variant.bstrVal, SysStringLen(variant.bstrVal));
+            }
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_BOOLEAN>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            if (variant.vt != VT_BOOL)
+            {
+                ConvertVariant(variant, CIM_BOOLEAN, value);
+                return;
+            }
+            value->type = WmiValue::kBoolean;
+            value->boolean_value = variant.boolVal != VARIANT_FALSE;
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_UINT8>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            if (variant.vt != VT_UI1)
+            {
+                ConvertVariant(variant, CIM_UINT8, value);
+                return;
+            }
+            value->type = WmiValue::kUnsigned;
+            value->size = 1;
+            value->unsigned_value = variant.bVal;
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_UINT16>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            // WMI passes uint16 in VT_I4
+            if (variant.vt != VT_I4)
+            {
+                ConvertVariant(variant, CIM_UINT16, value);
+                return;
+            }
+            value->type = WmiValue::kUnsigned;
+            value->size = 2;
+            value->unsigned_value = static_cast<uint16_t>(variant.lVal);
+        }
+    };
+
+    template <>
+    struct TypedValueReader<CIM_DATETIME>
+    {
+        static const PropertyHandle::Read kRead = PropertyHandle::kByName;
+
+        static void Convert(const VARIANT &variant, WmiValue *value)
+        {
+            double epoch_ms;
+            if (variant.vt != VT_BSTR || variant.bstrVal == NULL ||
+                !ParseCimDateTime(variant.bstrVal, SysStringLen(variant.bstrVal), &epoch_ms))
+            {
+                // Intervals stay strings
+                ConvertVariant(variant, CIM_DATETIME, value);
+                return;
+            }
+            value->type = WmiValue::kDateTime;
+            value->real_value = epoch_ms;
+        }
+    };
+
+    /**
+     * Reads the properties of a typed class from the instances of one query
+     */
+    class TypedClassReader
+    {
+    public:
+        virtual ~TypedClassReader() {}
+
+        // Adds the instance to results, like InstanceReader::Read
+        virtual HRESULT Read(InstanceAccess *instance, ResultSet *results) = 0;
+
+        uint64_t GetHandleReads() const
+        {
+            return handle_reads_;
+        }
+
+        uint64_t GetNamedReads() const
+        {
+            return named_reads_;
+        }
+
+    protected:
+        uint64_t handle_reads_ = 0;
+        uint64_t named_reads_ = 0;
+    };
+
+    /**
+     * Reader specialized for the properties of Class. The reads are unrolled at compile time, so every
+     * property goes straight to the read and conversion of its CIM type without looking its name or type
+     * up per instance. Handles are resolved from the first instance and again whenever the class of the
+     * instances changes.
+     */
+    template <typename Class>
+    class TypedClassExtractor : public TypedClassReader
+    {
+    public:
+        static constexpr size_t kPropertyCount = sizeof(Class::kProperties) / sizeof(Class::kProperties[0]);
+
+        /**
+         * @param names The property names of Class, shared by every row
+         * @param use_handles false reads every property by name
+         */
+        TypedClassExtractor(
+            std::shared_ptr<const ResultSet::Schema> names,
+            bool use_handles)
+            : names_(std::move(names)),
+              use_handles_(use_handles),
+              resolved_(false)
+        {
+        }
+
+        HRESULT Read(InstanceAccess *instance, ResultSet *results) override
+        {
+            HRESULT hres = instance->GetClassName(&instance_class_);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            if (!resolved_ || instance_class_ != class_name_)
+            {
+                hres = ResolveHandles(instance, Indexes());
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+                class_name_ = instance_class_;
+                resolved_ = true;
+            }
+
+            results->AddRow(names_);
+            return ReadValues(instance, results, Indexes());
+        }
+
+    private:
+        typedef std::make_index_sequence<kPropertyCount> Indexes;
+
+        template <size_t... I>
+        HRESULT ResolveHandles(InstanceAccess *instance, std::index_sequence<I...>)
+        {
+            HRESULT hres = S_OK;
+            // Stops at the first property that fails
+            (void)(SUCCEEDED(hres = ResolveHandle<I>(instance)) && ...);
+            return hres;
+        }
+
+        template <size_t I>
+        HRESULT ResolveHandle(InstanceAccess *instance)
+        {
+            constexpr TypedProperty kProperty = Class::kProperties[I];
+            if (TypedValueReader<kProperty.cim_type>::kRead == PropertyHandle::kByName || !use_handles_)
+            {
+                return S_OK;
+            }
+
+            CIMTYPE cim_type = CIM_EMPTY;
+            HRESULT hres = instance->GetPropertyHandle((*names_)[I], &cim_type, &handles_[I]);
+            if (SUCCEEDED(hres) && cim_type != kProperty.cim_type)
+            {
+                return kTypedClassMismatch;
+            }
+            return hres;
+        }
+
+        template <size_t... I>
+        HRESULT ReadValues(InstanceAccess *instance, ResultSet *results, std::index_sequence<I...>)
+        {
+            // Every value is added even after a mismatch, so the row stays complete
+            bool matched = true;
+            ((matched = ReadValue<I>(instance, results) && matched), ...);
+            return matched ? S_OK : kTypedClassMismatch;
+        }
+
+        template <size_t I>
+        bool ReadValue(InstanceAccess *instance, ResultSet *results)
+        {
+            // Properties that can't be read are reported as empty strings, like InstanceReader does
+            value_.type = WmiValue::kString;
+            value_.size = 0;
+            value_.unsigned_value = 0;
+            value_.string_value.clear();
+            value_.elements.clear();
+
+            HRESULT hres = ReadHandleValue<I>(instance);
+            if (hres != S_OK)
+            {
+                // Read* report null properties with a success code other than S_OK, those are read by name
+                named_reads_++;
+                hres = ReadNamedValue<I>(instance);
+            }
+            else
+            {
+                handle_reads_++;
+            }
+
+            results->AddValue(value_);
+            return hres != kTypedClassMismatch;
+        }
+
+        template <size_t I>
+        HRESULT ReadHandleValue(InstanceAccess *instance)
+        {
+            typedef TypedValueReader<Class::kProperties[I].cim_type> Reader;
+            if constexpr (Reader::kRead == PropertyHandle::kDword)
+            {
+                uint32_t dword = 0;
+                HRESULT hres = use_handles_ ? instance->ReadDWORD(handles_[I], &dword) : S_FALSE;
+                if (hres == S_OK)
+                {
+                    Reader::Convert(dword, &value_);
+                }
+                return hres;
+            }
+            else if constexpr (Reader::kRead == PropertyHandle::kQword)
+            {
+                uint64_t qword = 0;
+                HRESULT hres = use_handles_ ? instance->ReadQWORD(handles_[I], &qword) : S_FALSE;
+                if (hres == S_OK)
+                {
+                    Reader::Convert(qword, &value_);
+                }
+                return hres;
+            }
+            else
+            {
+                return S_FALSE;
+            }
+        }
+
+        template <size_t I>
+        HRESULT ReadNamedValue(InstanceAccess *instance)
+        {
+            constexpr CIMTYPE kCimType = Class::kProperties[I].cim_type;
+            VARIANT variant;
+            VariantInit(&variant);
+            CIMTYPE cim_type = kCimType;
+            HRESULT hres = instance->Get((*names_)[I], &variant, &cim_type);
+            if (SUCCEEDED(hres) && cim_type != kCimType)
+            {
+                hres = kTypedClassMismatch;
+            }
+            else if (SUCCEEDED(hres))
+            {
+                TypedValueReader<kCimType>::Convert(variant, &value_);
+            }
+            VariantClear(&variant);
+            return hres;
+        }
+
+        std::shared_ptr<const ResultSet::Schema> names_;
+        bool use_handles_;
+        bool resolved_;
+        std::wstring class_name_;     // Class the handles were resolved for
+        std::wstring instance_class_; // Class of the instance being read, kept to reuse its buffer
+        long handles_[kPropertyCount] = {};
+        WmiValue value_; // Reused for every value
+    };
+
+    /**
+     * What the registry of typed classes knows about one of them at run time
+     */
+    class TypedClass
+    {
+    public:
+        virtual ~TypedClass() {}
+
+        virtual const char *GetNamespace() const = 0;
+        virtual const wchar_t *GetClassName() const = 0;
+        virtual size_t GetPropertyCount() const = 0;
+        virtual const TypedProperty &GetProperty(size_t index) const = 0;
+
+        // The property names in descriptor order, the select list of typed queries
+        virtual const std::vector<std::wstring> &GetPropertyNames() const = 0;
+
+        /**
+         * @param use_handles false reads every property by name
+         */
+        virtual std::unique_ptr<TypedClassReader> CreateReader(bool use_handles) const = 0;
+
+        // The index of a property, or GetPropertyCount() when the class doesn't have it
+        size_t FindProperty(const std::wstring &name) const
+        {
+            const std::vector<std::wstring> &names = GetPropertyNames();
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                if (EqualsIgnoreCase(names[i], name))
+                {
+                    return i;
+                }
+            }
+            return names.size();
+        }
+    };
+
+    template <typename Class>
+    class TypedClassDescriptor : public TypedClass
+    {
+    public:
+        TypedClassDescriptor()
+            : names_(std::make_shared<ResultSet::Schema>())
+        {
+            for (const TypedProperty &property : Class::kProperties)
+            {
+                names_->push_back(property.name);
+            }
+        }
+
+        const char *GetNamespace() const override
+        {
+            return Class::kNamespace;
+        }
+
+        const wchar_t *GetClassName() const override
+        {
+            return Class::kClassName;
+        }
+
+        size_t GetPropertyCount() const override
+        {
+            return TypedClassExtractor<Class>::kPropertyCount;
+        }
+
+        const TypedProperty &GetProperty(size_t index) const override
+        {
+            return Class::kProperties[index];
+        }
+
+        const std::vector<std::wstring> &GetPropertyNames() const override
+        {
+            return *names_;
+        }
+
+        std::unique_ptr<TypedClassReader> CreateReader(bool use_handles) const override
+        {
+            return std::unique_ptr<TypedClassReader>(new TypedClassExtractor<Class>(names_, use_handles));
+        }
+
+    private:
+        std::shared_ptr<ResultSet::Schema> names_;
+    };
+
+    /**
+     * Returns the typed class with the given name (case-insensitive), or NULL when there is none
+     */
+    inline const TypedClass *FindTypedClass(const std::wstring &class_name)
+    {
+        // Built once and never changed, so every thread and environment can share them
+        static const TypedClassDescriptor<Win32ProcessorClass> processor;
+        static const TypedClassDescriptor<Win32LogicalDiskClass> logical_disk;
+        static const TypedClassDescriptor<Win32OperatingSystemClass> operating_system;
+        static const TypedClassDescriptor<MsftPhysicalDiskClass> physical_disk;
+        static const TypedClassDescriptor<WmiMonitorIdClass> monitor_id;
+        static const TypedClass *const kClasses[] = {&processor, &logical_disk, &operating_system, &physical_disk, &monitor_id};
+
+        for (const TypedClass *typed_class : kClasses)
+        {
+            if (EqualsIgnoreCase(typed_class->GetClassName(), class_name))
+            {
+                return typed_class;
+            }
+        }
+        return NULL;
+    }
+
+};
\ No newline at end of file
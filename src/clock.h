@@ -0,0 +1,76 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace wmi_wrapper
+{
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    /**
+     * Source of monotonic time for anything that expires, so tests can control time explicitly.
+     */
+    class Clock
+    {
+    public:
+        virtual ~Clock() {}
+        virtual TimePoint Now() = 0;
+    };
+
+    class SteadyClock : public Clock
+    {
+    public:
+        TimePoint Now() override
+        {
+            return std::chrono::steady_clock::now();
+        }
+    };
+
+    /**
+     * Clock that only moves when advanced, used by the stand-in provider.
+     */
+    class ManualClock : public Clock
+    {
+    public:
+        ManualClock() : offset_ms_(0) {}
+
+        TimePoint Now() override
+        {
+            return TimePoint() + std::chrono::milliseconds(offset_ms_.load());
+        }
+
+        void Advance(std::chrono::milliseconds duration)
+        {
+            offset_ms_ += duration.count();
+        }
+
+    private:
+        std::atomic<long long> offset_ms_;
+    };
+
+};
\ No newline at end of file
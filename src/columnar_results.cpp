@@ -0,0 +1,232 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "columnar_results.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
+
+namespace wmi_wrapper
+{
+
+    void FreeColumnBuffer(
+        void *data)
+    {
+        std::free(data);
+    }
+
+    /**
+     * What the values of a column have in common, collected before the column kind is chosen
+     */
+    struct ColumnSummary
+    {
+        bool all_numbers = true;   // Only numbers or null, fits a Float64Array
+        bool all_signed64 = true;  // Only 64 bit signed integers, fits a BigInt64Array
+        bool all_unsigned64 = true; // Only 64 bit unsigned integers, fits a BigUint64Array
+        bool has_wide_integers = false;
+        bool has_values = false;
+        size_t count = 0; // Instances that have the property
+    };
+
+    void AddToSummary(
+        const ResultSet::Value &value,
+        const QueryOptions &options,
+        ColumnSummary *summary)
+    {
+        bool wide_integer = (value.type == WmiValue::kSigned || value.type == WmiValue::kUnsigned) && value.size == 8;
+        summary->all_signed64 = summary->all_signed64 && value.type == WmiValue::kSigned && wide_integer;
+        summary->all_unsigned64 = summary->all_unsigned64 && value.type == WmiValue::kUnsigned && wide_integer;
+        summary->has_wide_integers = summary->has_wide_integers || wide_integer;
+        ++summary->count;
+
+        switch (value.type)
+        {
+        case WmiValue::kNull:
+            break;
+        case WmiValue::kSigned:
+        case WmiValue::kUnsigned:
+        case WmiValue::kReal:
+            summary->has_values = true;
+            break;
+        case WmiValue::kDateTime:
+            summary->has_values = true;
+            summary->all_numbers = summary->all_numbers && !options.datetime_as_date;
+            break;
+        default:
+            summary->has_values = true;
+            summary->all_numbers = false;
+            break;
+        }
+    }
+
+    ResultColumn::Kind GetColumnKind(
+        const ColumnSummary &summary,
+        size_t row_count,
+        const QueryOptions &options)
+    {
+        if (!summary.has_values)
+        {
+            return ResultColumn::kValues;
+        }
+        if (options.int64_as_bigint && summary.has_wide_integers)
+        {
+            // BigInt arrays have no room for null, columns with gaps stay plain arrays
+            if (summary.all_signed64 && summary.count == row_count)
+            {
+                return ResultColumn::kBigInt64;
+            }
+            if (summary.all_unsigned64 && summary.count == row_count)
+            {
+                return ResultColumn::kBigUint64;
+            }
+            return ResultColumn::kValues;
+        }
+        return summary.all_numbers ? ResultColumn::kFloat64 : ResultColumn::kValues;
+    }
+
+    double GetNumber(
+        const ResultSet::Value &value)
+    {
+        switch (value.type)
+        {
+        case WmiValue::kSigned:
+            return static_cast<double>(value.signed_value);
+        case WmiValue::kUnsigned:
+            return static_cast<double>(value.unsigned_value);
+        case WmiValue::kReal:
+        case WmiValue::kDateTime:
+            return value.real_value;
+        default:
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+
+    HRESULT BuildColumnarResults(
+        ResultSet results,
+        const QueryOptions &options,
+        ColumnarResults *columnar)
+    {
+        columnar->row_count = results.size();
+        columnar->columns.clear();
+
+        // Columns follow the order in which properties first appear, each schema is mapped to them once
+        std::unordered_map<std::wstring, size_t> column_indexes;
+        std::vector<std::vector<size_t>> schema_columns(results.GetSchemaCount());
+        for (size_t schema = 0; schema < results.GetSchemaCount(); ++schema)
+        {
+            for (const std::wstring &name : results.GetSchema(schema))
+            {
+                auto found = column_indexes.find(name);
+                if (found == column_indexes.end())
+                {
+                    found = column_indexes.emplace(name, columnar->columns.size()).first;
+                    columnar->columns.emplace_back();
+                    columnar->columns.back().name = name;
+                }
+                schema_columns[schema].push_back(found->second);
+            }
+        }
+
+        std::vector<ColumnSummary> summaries(columnar->columns.size());
+        for (size_t row = 0; row < results.size(); ++row)
+        {
+            const std::vector<size_t> &columns = schema_columns[results.GetSchemaIndex(row)];
+            const ResultSet::Value *values = results.GetValues(row);
+            for (size_t i = 0; i < columns.size(); ++i)
+            {
+                AddToSummary(values[i], options, &summaries[columns[i]]);
+            }
+        }
+
+        size_t numeric_columns = 0;
+        for (size_t column = 0; column < columnar->columns.size(); ++column)
+        {
+            ResultColumn &result_column = columnar->columns[column];
+            result_column.kind = GetColumnKind(summaries[column], results.size(), options);
+            if (result_column.kind == ResultColumn::kValues)
+            {
+                result_column.values.assign(results.size(), NULL);
+            }
+            else
+            {
+                result_column.offset = numeric_columns * results.size() * sizeof(double);
+                ++numeric_columns;
+            }
+        }
+
+        columnar->numeric_size = numeric_columns * results.size() * sizeof(double);
+        columnar->numeric_data.reset();
+        if (columnar->numeric_size > 0)
+        {
+            columnar->numeric_data.reset(static_cast<uint8_t *>(std::malloc(columnar->numeric_size)));
+            if (!columnar->numeric_data)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            // BigInt columns have a value in every row, Float64 columns start out null
+            for (const ResultColumn &result_column : columnar->columns)
+            {
+                if (result_column.kind == ResultColumn::kFloat64)
+                {
+                    double *data = reinterpret_cast<double *>(columnar->numeric_data.get() + result_column.offset);
+                    std::fill(data, data + results.size(), std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+        }
+
+        uint8_t *numeric_data = columnar->numeric_data.get();
+        for (size_t row = 0; row < results.size(); ++row)
+        {
+            const std::vector<size_t> &columns = schema_columns[results.GetSchemaIndex(row)];
+            const ResultSet::Value *values = results.GetValues(row);
+            for (size_t i = 0; i < columns.size(); ++i)
+            {
+                ResultColumn &result_column = columnar->columns[columns[i]];
+                const ResultSet::Value &value = values[i];
+                switch (result_column.kind)
+                {
+                case ResultColumn::kFloat64:
+                    reinterpret_cast<double *>(numeric_data + result_column.offset)[row] = GetNumber(value);
+                    break;
+                case ResultColumn::kBigInt64:
+                    reinterpret_cast<int64_t *>(numeric_data + result_column.offset)[row] = value.signed_value;
+                    break;
+                case ResultColumn::kBigUint64:
+                    reinterpret_cast<uint64_t *>(numeric_data + result_column.offset)[row] = value.unsigned_value;
+                    break;
+                default:
+                    result_column.values[row] = &value;
+                    break;
+                }
+            }
+        }
+
+        columnar->results = std::move(results);
+        return S_OK;
+    }
+
+}
\ No newline at end of file
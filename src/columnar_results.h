@@ -0,0 +1,95 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Frees a numeric column buffer, also used as the finalizer once the buffer belongs to an ArrayBuffer
+     */
+    void FreeColumnBuffer(void *data);
+
+    struct ColumnBufferDeleter
+    {
+        void operator()(uint8_t *data) const
+        {
+            FreeColumnBuffer(data);
+        }
+    };
+
+    typedef std::unique_ptr<uint8_t, ColumnBufferDeleter> ColumnBuffer;
+
+    struct ResultColumn
+    {
+        enum Kind
+        {
+            kValues,    // values, converted one by one
+            kFloat64,   // row_count doubles at offset in the numeric buffer, null values are NaN
+            kBigInt64,  // row_count int64_t at offset in the numeric buffer
+            kBigUint64, // row_count uint64_t at offset in the numeric buffer
+        };
+
+        std::wstring name;
+        Kind kind = kValues;
+        size_t offset = 0;
+        std::vector<const ResultSet::Value *> values; // Values in ColumnarResults::results, NULL when an instance doesn't have the property
+    };
+
+    /**
+     * Query results laid out as one column per property. All numeric columns share a single
+     * buffer so they can be handed to JavaScript as views on one ArrayBuffer without copying.
+     */
+    struct ColumnarResults
+    {
+        size_t row_count = 0;
+        std::vector<ResultColumn> columns;
+        ColumnBuffer numeric_data;
+        size_t numeric_size = 0;
+        ResultSet results; // Holds the values of the kValues columns, moving it keeps them in place
+    };
+
+    /**
+     * Pivots query results into columns. Properties missing from an instance are null.
+     * Does not touch any Napi values, so it can run on a worker thread.
+     *
+     * @param results The results to pivot, the columns keep them
+     * @param options Decides which columns are numeric: 64 bit integers become BigInt columns when
+     *                int64_as_bigint is set, datetimes become numeric columns unless datetime_as_date is set
+     * @param columnar Receives the columns
+     * @return S_OK on success, E_OUTOFMEMORY if the numeric buffer could not be allocated
+     */
+    HRESULT BuildColumnarResults(ResultSet results, const QueryOptions &options, ColumnarResults *columnar);
+
+};
\ No newline at end of file
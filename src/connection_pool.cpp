@@ -0,0 +1,226 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "connection_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+#ifdef _WIN32
+#include <Wbemidl.h>
+#endif
+
+namespace wmi_wrapper
+{
+
+    const HRESULT kRpcDisconnected = (HRESULT)0x80010108L;       // RPC_E_DISCONNECTED
+    const HRESULT kRpcServerUnavailable = (HRESULT)0x800706BAL;  // HRESULT_FROM_WIN32(RPC_S_SERVER_UNAVAILABLE)
+    const HRESULT kRpcCallFailed = (HRESULT)0x800706BEL;         // HRESULT_FROM_WIN32(RPC_S_CALL_FAILED)
+    const HRESULT kWbemTransportFailure = (HRESULT)0x80041015L;  // WBEM_E_TRANSPORT_FAILURE
+    const HRESULT kWbemShuttingDown = (HRESULT)0x80041033L;      // WBEM_E_SHUTTING_DOWN
+
+    bool IsBrokenConnectionError(HRESULT hres)
+    {
+        return hres == kRpcDisconnected ||
+               hres == kRpcServerUnavailable ||
+               hres == kRpcCallFailed ||
+               hres == kWbemTransportFailure ||
+               hres == kWbemShuttingDown;
+    }
+
+    std::string GetPoolKey(const std::string &wmi_namespace)
+    {
+        std::string key = wmi_namespace;
+        std::transform(
+            key.begin(),
+            key.end(),
+            key.begin(),
+            [](unsigned char c)
+            { return std::tolower(c); });
+        return key;
+    }
+
+    ConnectionPool::ConnectionPool(
+        ServiceConnector *connector,
+        Clock *clock,
+        ConnectionPoolOptions options)
+        : connector_(connector),
+          clock_(clock),
+          options_(options)
+    {
+    }
+
+    HRESULT ConnectionPool::Acquire(
+        const std::string &wmi_namespace,
+        std::shared_ptr<ServiceConnection> *connection)
+    {
+        std::string key = GetPoolKey(wmi_namespace);
+        std::vector<std::shared_ptr<ServiceConnection>> evicted;
+        std::shared_ptr<ServiceConnection> pooled;
+        bool needs_health_check = false;
+        bool reconnecting = false;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            TimePoint now = clock_->Now();
+            EvictIdleLocked(now, &evicted);
+
+            auto entry = connections_.find(key);
+            if (entry != connections_.end())
+            {
+                if (entry->second.connection)
+                {
+                    pooled = entry->second.connection;
+                    needs_health_check = now - entry->second.last_used >= options_.health_check_interval;
+                    entry->second.last_used = now;
+                }
+                else
+                {
+                    reconnecting = entry->second.invalidated;
+                }
+            }
+        }
+
+        // Health checks make a round trip, so they run without holding the lock
+        if (pooled && needs_health_check && !pooled->IsHealthy())
+        {
+            Invalidate(wmi_namespace, pooled);
+            pooled.reset();
+            reconnecting = true;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.failed_health_checks;
+        }
+
+        if (pooled)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.hits;
+            *connection = std::move(pooled);
+            return S_OK;
+        }
+
+        // Connecting can take a long time, don't block queries to other namespaces meanwhile
+        std::shared_ptr<ServiceConnection> created;
+        HRESULT hres = connector_->Connect(wmi_namespace, &created);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        PooledConnection &entry = connections_[key];
+        entry.last_used = clock_->Now();
+        if (entry.connection)
+        {
+            // Another caller connected to the same namespace first, share its connection
+            ++stats_.hits;
+            *connection = entry.connection;
+            return S_OK;
+        }
+
+        entry.connection = created;
+        entry.invalidated = false;
+        if (reconnecting)
+        {
+            ++stats_.reconnects;
+        }
+        else
+        {
+            ++stats_.misses;
+        }
+
+        *connection = std::move(created);
+        return S_OK;
+    }
+
+    void ConnectionPool::Invalidate(
+        const std::string &wmi_namespace,
+        const std::shared_ptr<ServiceConnection> &connection)
+    {
+        std::shared_ptr<ServiceConnection> released;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto entry = connections_.find(GetPoolKey(wmi_namespace));
+        if (entry != connections_.end() && entry->second.connection == connection)
+        {
+            released = std::move(entry->second.connection);
+            entry->second.invalidated = true;
+        }
+    }
+
+    void ConnectionPool::EvictIdle()
+    {
+        std::vector<std::shared_ptr<ServiceConnection>> evicted;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        EvictIdleLocked(clock_->Now(), &evicted);
+    }
+
+    void ConnectionPool::EvictIdleLocked(
+        TimePoint now,
+        std::vector<std::shared_ptr<ServiceConnection>> *evicted)
+    {
+        for (auto entry = connections_.begin(); entry != connections_.end();)
+        {
+            if (now - entry->second.last_used < options_.idle_timeout)
+            {
+                ++entry;
+                continue;
+            }
+
+            if (entry->second.connection)
+            {
+                evicted->push_back(std::move(entry->second.connection));
+                ++stats_.evictions;
+            }
+            entry = connections_.erase(entry);
+        }
+    }
+
+    void ConnectionPool::Close()
+    {
+        std::map<std::string, PooledConnection> closed;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed.swap(connections_);
+    }
+
+    ConnectionPoolStats ConnectionPool::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ConnectionPoolStats stats = stats_;
+        stats.open_connections = 0;
+        for (const auto &entry : connections_)
+        {
+            if (entry.second.connection)
+            {
+                ++stats.open_connections;
+            }
+        }
+        return stats;
+    }
+
+}
\ No newline at end of file
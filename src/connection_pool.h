@@ -0,0 +1,185 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * A ready to use connection to a namespace (an IWbemServices proxy on Windows).
+     */
+    class ServiceConnection
+    {
+    public:
+        virtual ~ServiceConnection() {}
+
+        /**
+         * Makes a cheap round trip to verify the connection still works
+         */
+        virtual bool IsHealthy() = 0;
+    };
+
+    /**
+     * Opens new connections for the pool.
+     */
+    class ServiceConnector
+    {
+    public:
+        virtual ~ServiceConnector() {}
+        virtual HRESULT Connect(const std::string &wmi_namespace, std::shared_ptr<ServiceConnection> *connection) = 0;
+    };
+
+    struct ConnectionPoolOptions
+    {
+        // Connections unused for this long are released
+        std::chrono::milliseconds idle_timeout = std::chrono::minutes(5);
+
+        // Connections unused for this long are health checked before being handed out again
+        std::chrono::milliseconds health_check_interval = std::chrono::seconds(30);
+    };
+
+    struct ConnectionPoolStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t reconnects = 0;
+        uint64_t evictions = 0;
+        uint64_t failed_health_checks = 0;
+        uint64_t open_connections = 0;
+    };
+
+    /**
+     * Returns true for errors that mean the connection itself is no longer usable,
+     * for example after the WMI service was restarted.
+     */
+    bool IsBrokenConnectionError(HRESULT hres);
+
+    /**
+     * Namespaces are case insensitive, caches keyed by namespace use the lowercase name
+     */
+    std::string GetPoolKey(const std::string &wmi_namespace);
+
+    /**
+     * Process-wide cache of open connections keyed by lowercase namespace.
+     *
+     * Connections are shared by every caller, stay open between queries and are
+     * replaced when they break. All methods are thread safe.
+     */
+    class ConnectionPool
+    {
+    public:
+        ConnectionPool(ServiceConnector *connector, Clock *clock, ConnectionPoolOptions options = ConnectionPoolOptions());
+
+        /**
+         * Returns the pooled connection for the namespace, connecting if there is none
+         */
+        HRESULT Acquire(const std::string &wmi_namespace, std::shared_ptr<ServiceConnection> *connection);
+
+        /**
+         * Drops a connection that failed with a broken connection error so the next Acquire reconnects
+         */
+        void Invalidate(const std::string &wmi_namespace, const std::shared_ptr<ServiceConnection> &connection);
+
+        /**
+         * Runs operation with the pooled connection, reconnecting and retrying once if the connection broke.
+         * The operation is called as HRESULT operation(ServiceConnection *connection, bool *retryable).
+         * Operations that already handed out part of their output clear retryable so they aren't repeated.
+         */
+        template <typename Operation>
+        HRESULT Execute(const std::string &wmi_namespace, Operation operation)
+        {
+            std::shared_ptr<ServiceConnection> connection;
+            HRESULT hres = Acquire(wmi_namespace, &connection);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            bool retryable = true;
+            hres = operation(connection.get(), &retryable);
+            if (IsBrokenConnectionError(hres))
+            {
+                Invalidate(wmi_namespace, connection);
+                connection.reset();
+
+                if (!retryable)
+                {
+                    return hres;
+                }
+
+                hres = Acquire(wmi_namespace, &connection);
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+                hres = operation(connection.get(), &retryable);
+            }
+            return hres;
+        }
+
+        /**
+         * Releases connections that have been idle for longer than the idle timeout
+         */
+        void EvictIdle();
+
+        /**
+         * Releases every pooled connection. The pool stays usable and reconnects on demand.
+         */
+        void Close();
+
+        ConnectionPoolStats GetStats();
+
+    private:
+        struct PooledConnection
+        {
+            std::shared_ptr<ServiceConnection> connection;
+            TimePoint last_used;
+            bool invalidated = false;
+        };
+
+        // Evicted connections are handed back so they are released after the lock is dropped
+        void EvictIdleLocked(TimePoint now, std::vector<std::shared_ptr<ServiceConnection>> *evicted);
+
+        ServiceConnector *connector_;
+        Clock *clock_;
+        ConnectionPoolOptions options_;
+
+        std::mutex mutex_;
+        std::map<std::string, PooledConnection> connections_;
+        ConnectionPoolStats stats_;
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,188 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "enumeration.h"
+
+#include <algorithm>
+
+#include "class_descriptors.h"
+#include "connection_pool.h"
+
+namespace wmi_wrapper
+{
+
+    // Next calls slower than this get fewer instances, see AdaptiveBatchSize
+    const std::chrono::milliseconds kTargetLatency(50);
+
+    void AdaptiveBatchSize::Update(
+        uint32_t requested,
+        uint32_t returned,
+        std::chrono::steady_clock::duration latency)
+    {
+        if (latency > kTargetLatency)
+        {
+            size_ = std::max<uint32_t>(size_ / 2, 1);
+        }
+        else if (requested == size_ && returned == requested && latency < kTargetLatency / 2)
+        {
+            // Calls asking for less because of max_rows say nothing about a larger size
+            size_ = std::min<uint32_t>(size_ * 2, kMaxNextCount);
+        }
+    }
+
+    HRESULT EnumerateInstances(
+        InstanceEnumerator *enumerator,
+        InstanceReader *reader,
+        const QueryOptions &options,
+        size_t batch_size,
+        StageTimer *timer,
+        const QueryBatchCallback &on_batch)
+    {
+        typedef std::chrono::steady_clock Clock;
+        const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(options.timeout_ms);
+
+        AdaptiveBatchSize next_size;
+        ResultSet batch;
+        uint64_t rows = 0;
+        uint64_t handed_out_bytes = 0;
+        HRESULT hres = S_OK;
+        bool keep_going = true;
+
+        while (keep_going && hres == S_OK)
+        {
+            if (options.IsCancelled())
+            {
+                hres = kQueryCancelled;
+                break;
+            }
+
+            Clock::time_point started = Clock::now();
+            uint32_t timeout_ms = kInfiniteTimeout;
+            if (options.timeout_ms > 0)
+            {
+                if (started >= deadline)
+                {
+                    hres = kQueryTimedOut;
+                    break;
+                }
+                // Rounded up, a call returning just before the deadline would only be followed by another one
+                timeout_ms = static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - started + std::chrono::microseconds(999)).count());
+            }
+
+            // A query that can be cancelled doesn't leave a slow or hung provider waiting for long
+            bool polling = false;
+            const uint32_t poll_ms = static_cast<uint32_t>(kCancellationPollInterval.count());
+            if (options.cancellation && timeout_ms > poll_ms)
+            {
+                timeout_ms = poll_ms;
+                polling = true;
+            }
+
+            uint32_t count = next_size.Get();
+            if (options.max_rows > 0)
+            {
+                count = static_cast<uint32_t>(std::min<uint64_t>(count, options.max_rows - rows));
+            }
+
+            uint32_t returned = 0;
+            hres = enumerator->Next(timeout_ms, count, &returned);
+            if (hres != kQueryTimedOut)
+            {
+                // The time a call waited for its timeout says nothing about how many instances to ask for
+                next_size.Update(count, returned, Clock::now() - started);
+            }
+            timer->Lap(kNextStage);
+            bool ended = hres == S_FALSE;
+
+            for (uint32_t i = 0; i < returned && keep_going; ++i)
+            {
+                if (FAILED(enumerator->Read(i, reader, &batch)))
+                {
+                    continue;
+                }
+                ++rows;
+
+                uint64_t bytes = handed_out_bytes + batch.GetBytes();
+                if (batch.size() >= batch_size)
+                {
+                    timer->Lap(kReadStage);
+                    keep_going = on_batch(batch);
+                    batch.Clear();
+                    handed_out_bytes = bytes;
+                    timer->Skip();
+                }
+
+                // Reaching a limit with the last instance there is doesn't cut anything off
+                bool last = ended && i + 1 == returned;
+                if (!last && options.max_rows > 0 && rows >= options.max_rows)
+                {
+                    hres = kQueryMaxRows;
+                    break;
+                }
+                if (!last && options.max_bytes > 0 && bytes >= options.max_bytes)
+                {
+                    hres = kQueryMaxBytes;
+                    break;
+                }
+            }
+            timer->Lap(kReadStage);
+
+            // A call that timed out before the deadline only means the instances are slow to come
+            if (hres == kQueryTimedOut && (polling || (options.timeout_ms > 0 && Clock::now() < deadline)))
+            {
+                hres = S_OK;
+            }
+        }
+
+        if (keep_going && !batch.empty())
+        {
+            on_batch(batch);
+        }
+
+        return hres == S_FALSE ? S_OK : hres;
+    }
+
+    HRESULT GetConnectedQueryResult(
+        HRESULT hres,
+        QueryTimings *timings,
+        HRESULT *rejected)
+    {
+        if (!FAILED(hres) || IsBrokenConnectionError(hres) || hres == kQueryCancelled || hres == kTypedClassMismatch)
+        {
+            return hres;
+        }
+
+        if (timings != NULL)
+        {
+            timings->rejected = hres;
+        }
+        if (rejected != NULL)
+        {
+            *rejected = hres;
+        }
+        return S_OK;
+    }
+
+}
\ No newline at end of file
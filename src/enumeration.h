@@ -0,0 +1,140 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "property_access.h"
+#include "query_provider.h"
+#include "query_stats.h"
+
+namespace wmi_wrapper
+{
+
+    // Timeout of a Next call that waits until instances arrive, same as WBEM_INFINITE
+    const uint32_t kInfiniteTimeout = 0xFFFFFFFF;
+
+    /**
+     * Source of the instances of a query, shaped after IEnumWbemClassObject so the enumeration
+     * loop can run against WMI and against the stand-in.
+     */
+    class InstanceEnumerator
+    {
+    public:
+        virtual ~InstanceEnumerator() {}
+
+        /**
+         * Waits up to timeout_ms for the next count instances, which stay available until the next call
+         *
+         * @return S_OK when count instances arrived, S_FALSE when the enumeration ended, or
+         *         kQueryTimedOut when the timeout passed first. *returned holds the number of
+         *         instances that arrived in every case.
+         */
+        virtual HRESULT Next(uint32_t timeout_ms, uint32_t count, uint32_t *returned) = 0;
+
+        // Reads instance index of the last Next call into results
+        virtual HRESULT Read(uint32_t index, InstanceReader *reader, ResultSet *results) = 0;
+    };
+
+    // Instances asked for by the first Next call of a query, and at most by any
+    const uint32_t kInitialNextCount = 10;
+    const uint32_t kMaxNextCount = 256;
+
+    /**
+     * Number of instances asked for per Next call. Starts at kInitialNextCount, doubles while calls
+     * return every instance asked for well within 50 ms, so fast classes take fewer round trips,
+     * and halves when a call takes longer, so the limits of a query are checked often even when
+     * its provider is slow.
+     */
+    class AdaptiveBatchSize
+    {
+    public:
+        AdaptiveBatchSize()
+            : size_(kInitialNextCount)
+        {
+        }
+
+        uint32_t Get() const
+        {
+            return size_;
+        }
+
+        void Update(
+            uint32_t requested,
+            uint32_t returned,
+            std::chrono::steady_clock::duration latency);
+
+    private:
+        uint32_t size_;
+    };
+
+    /**
+     * Reads the instances of enumerator in batches of batch_size, within the timeout and the row
+     * and byte limits of options. Instances whose properties can't be resolved are skipped.
+     * The cancellation token of options is checked before every Next call, which then waits at
+     * most kCancellationPollInterval.
+     *
+     * @return S_OK once every instance was read or on_batch stopped the query, kQueryTimedOut,
+     *         kQueryMaxRows or kQueryMaxBytes when a limit stopped it, kQueryCancelled when it was
+     *         cancelled, or the error of Next.
+     *         The limits are applied to the instances read, so the results of a query stopped at
+     *         max_bytes are larger by up to one instance.
+     */
+    HRESULT EnumerateInstances(
+        InstanceEnumerator *enumerator,
+        InstanceReader *reader,
+        const QueryOptions &options,
+        size_t batch_size,
+        StageTimer *timer,
+        const QueryBatchCallback &on_batch);
+
+    // Same as WBEM_E_INVALID_QUERY and WBEM_E_INVALID_PROPERTY
+    const HRESULT kInvalidQuery = static_cast<HRESULT>(0x80041017L);
+    const HRESULT kInvalidProperty = static_cast<HRESULT>(0x80041031L);
+
+    /**
+     * Returns true for the errors ExecQuery reports when the select list names a property the class
+     * doesn't have, such as a mistyped one or one of a subclass. A query whose projection was rewritten
+     * is then sent again as it was written, which reads such a property as an empty string.
+     */
+    inline bool IsRejectedProjection(HRESULT hres)
+    {
+        return hres == kInvalidQuery || hres == kInvalidProperty;
+    }
+
+    /**
+     * What a query that got a connection reports. Queries WMI rejects return no results instead of
+     * failing, their error is kept in rejected (when set), see ResultSet::GetRejected, and in timings
+     * (when set) so the statistics still count them. Broken connections, cancelled queries, instances
+     * that don't match their typed class, and the success codes of queries stopped at a limit are
+     * passed on.
+     */
+    HRESULT GetConnectedQueryResult(
+        HRESULT hres,
+        QueryTimings *timings,
+        HRESULT *rejected);
+
+};
\ No newline at end of file
@@ -0,0 +1,302 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "event_queue.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace wmi_wrapper
+{
+
+    void CombineHash(
+        size_t value,
+        size_t *hash)
+    {
+        *hash ^= value + 0x9e3779b9 + (*hash << 6) + (*hash >> 2);
+    }
+
+    size_t HashValue(
+        const WmiValue &value)
+    {
+        size_t hash = std::hash<int>()(value.type);
+        switch (value.type)
+        {
+        case WmiValue::kString:
+            CombineHash(std::hash<std::wstring>()(value.string_value), &hash);
+            break;
+        case WmiValue::kBoolean:
+            CombineHash(std::hash<bool>()(value.boolean_value), &hash);
+            break;
+        case WmiValue::kSigned:
+        case WmiValue::kUnsigned:
+            CombineHash(std::hash<uint64_t>()(value.unsigned_value), &hash);
+            break;
+        case WmiValue::kReal:
+        case WmiValue::kDateTime:
+            CombineHash(std::hash<double>()(value.real_value), &hash);
+            break;
+        case WmiValue::kArray:
+            for (const WmiValue &element : value.elements)
+            {
+                CombineHash(HashValue(element), &hash);
+            }
+            break;
+        default:
+            break;
+        }
+        return hash;
+    }
+
+    size_t HashEvent(
+        const WmiQueryResult &event)
+    {
+        size_t hash = 0;
+        for (const std::pair<std::wstring, WmiValue> &property : event)
+        {
+            CombineHash(std::hash<std::wstring>()(property.first), &hash);
+            CombineHash(HashValue(property.second), &hash);
+        }
+        return hash;
+    }
+
+    bool ValuesEqual(
+        const WmiValue &left,
+        const WmiValue &right)
+    {
+        if (left.type != right.type || left.size != right.size)
+        {
+            return false;
+        }
+
+        switch (left.type)
+        {
+        case WmiValue::kString:
+            return left.string_value == right.string_value;
+        case WmiValue::kBoolean:
+            return left.boolean_value == right.boolean_value;
+        case WmiValue::kSigned:
+        case WmiValue::kUnsigned:
+            return left.unsigned_value == right.unsigned_value;
+        case WmiValue::kReal:
+        case WmiValue::kDateTime:
+            return left.real_value == right.real_value;
+        case WmiValue::kArray:
+            return left.elements.size() == right.elements.size() &&
+                   std::equal(left.elements.begin(), left.elements.end(), right.elements.begin(), ValuesEqual);
+        default:
+            return true;
+        }
+    }
+
+    bool EventsEqual(
+        const WmiQueryResult &left,
+        const WmiQueryResult &right)
+    {
+        if (left.size() != right.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); ++i)
+        {
+            if (left[i].first != right[i].first || !ValuesEqual(left[i].second, right[i].second))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    EventQueue::EventQueue(
+        size_t capacity,
+        OverflowPolicy policy)
+        : capacity_(capacity > 0 ? capacity : 1),
+          policy_(policy),
+          first_position_(0),
+          dropped_(0),
+          coalesced_(0),
+          consumer_waiting_(true),
+          completed_(false),
+          delivered_completion_(false),
+          cancelled_(false),
+          status_(S_OK)
+    {
+    }
+
+    bool EventQueue::Push(
+        std::vector<WmiQueryResult> &&events)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_ || completed_)
+        {
+            return false;
+        }
+
+        for (WmiQueryResult &event : events)
+        {
+            size_t hash = 0;
+            if (policy_ == kCoalesce)
+            {
+                hash = HashEvent(event);
+                if (CoalesceLocked(hash, event))
+                {
+                    continue;
+                }
+            }
+
+            if (events_.size() >= capacity_)
+            {
+                DropOldestLocked();
+            }
+
+            if (policy_ == kCoalesce)
+            {
+                positions_.emplace(hash, first_position_ + events_.size());
+            }
+            events_.push_back({hash, std::move(event)});
+        }
+
+        return WakeConsumerLocked();
+    }
+
+    bool EventQueue::Complete(
+        HRESULT status)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_ || completed_)
+        {
+            return false;
+        }
+
+        completed_ = true;
+        status_ = status;
+        return WakeConsumerLocked();
+    }
+
+    bool EventQueue::Take(
+        size_t max_events,
+        EventBatch *batch)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cancelled_ || delivered_completion_)
+        {
+            return false;
+        }
+
+        size_t count = std::min(max_events, events_.size());
+        batch->events.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            batch->events.push_back(std::move(events_.front().event));
+            PopFrontLocked();
+        }
+
+        batch->dropped = dropped_;
+        batch->coalesced = coalesced_;
+        dropped_ = 0;
+        coalesced_ = 0;
+
+        if (events_.empty() && completed_)
+        {
+            batch->complete = true;
+            batch->status = status_;
+            delivered_completion_ = true;
+            return true;
+        }
+
+        if (batch->events.empty() && batch->dropped == 0 && batch->coalesced == 0)
+        {
+            consumer_waiting_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    void EventQueue::Cancel()
+    {
+        std::deque<QueuedEvent> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+            consumer_waiting_ = false;
+            dropped.swap(events_);
+            positions_.clear();
+        }
+    }
+
+    size_t EventQueue::GetQueuedCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_.size();
+    }
+
+    void EventQueue::DropOldestLocked()
+    {
+        PopFrontLocked();
+        ++dropped_;
+    }
+
+    void EventQueue::PopFrontLocked()
+    {
+        if (policy_ == kCoalesce)
+        {
+            auto range = positions_.equal_range(events_.front().hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second == first_position_)
+                {
+                    positions_.erase(it);
+                    break;
+                }
+            }
+        }
+        events_.pop_front();
+        ++first_position_;
+    }
+
+    bool EventQueue::CoalesceLocked(
+        size_t hash,
+        const WmiQueryResult &event)
+    {
+        auto range = positions_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (EventsEqual(events_[it->second - first_position_].event, event))
+            {
+                ++coalesced_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool EventQueue::WakeConsumerLocked()
+    {
+        bool wake_consumer = consumer_waiting_;
+        consumer_waiting_ = false;
+        return wake_consumer;
+    }
+
+}
\ No newline at end of file
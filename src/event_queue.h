@@ -0,0 +1,128 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Events taken from an EventQueue in one delivery
+     */
+    struct EventBatch
+    {
+        std::vector<WmiQueryResult> events;
+        uint64_t dropped = 0;   // Events discarded since the previous batch because the queue was full
+        uint64_t coalesced = 0; // Events merged into an identical queued event since the previous batch
+        bool complete = false;  // The subscription ended, no batch follows
+        HRESULT status = S_OK;  // Why the subscription ended
+    };
+
+    /**
+     * Bounded hand-off of events from the thread receiving them to the JavaScript thread.
+     *
+     * Unlike BatchChannel the producer never blocks, since WMI keeps delivering events regardless of
+     * how fast they are consumed. Once capacity events are queued the oldest one is dropped, and with
+     * kCoalesce an event identical to one still queued is merged into it instead of being queued again.
+     * The consumer is marked as waiting whenever it finds the queue empty, and the next Push or
+     * Complete reports that it needs to be woken up.
+     */
+    class EventQueue
+    {
+    public:
+        enum OverflowPolicy
+        {
+            kDropOldest,
+            kCoalesce
+        };
+
+        EventQueue(size_t capacity, OverflowPolicy policy);
+
+        /**
+         * Adds events, dropping the oldest queued events once the queue is full
+         *
+         * @return true when the consumer is waiting and needs to be woken up
+         */
+        bool Push(std::vector<WmiQueryResult> &&events);
+
+        /**
+         * Marks the end of the subscription, events already queued are still delivered
+         *
+         * @return true when the consumer is waiting and needs to be woken up
+         */
+        bool Complete(HRESULT status);
+
+        /**
+         * Takes up to max_events queued events
+         *
+         * @return false when there is nothing to deliver, the consumer is then waiting
+         */
+        bool Take(size_t max_events, EventBatch *batch);
+
+        /**
+         * Drops queued events and ignores everything pushed afterwards
+         */
+        void Cancel();
+
+        size_t GetQueuedCount();
+
+    private:
+        struct QueuedEvent
+        {
+            size_t hash;
+            WmiQueryResult event;
+        };
+
+        void DropOldestLocked();
+        void PopFrontLocked();
+        bool CoalesceLocked(size_t hash, const WmiQueryResult &event);
+        bool WakeConsumerLocked();
+
+        std::mutex mutex_;
+        std::deque<QueuedEvent> events_;
+        size_t capacity_;
+        OverflowPolicy policy_;
+
+        // Queue positions of the events with a given hash, only maintained when coalescing
+        std::unordered_multimap<size_t, uint64_t> positions_;
+        uint64_t first_position_;
+
+        uint64_t dropped_;
+        uint64_t coalesced_;
+        bool consumer_waiting_;
+        bool completed_;
+        bool delivered_completion_;
+        bool cancelled_;
+        HRESULT status_;
+    };
+
+};
\ No newline at end of file
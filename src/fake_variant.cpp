@@ -0,0 +1,344 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "fake_variant.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+
+namespace
+{
+
+    // BSTRs carry their length in front of the characters like the real ones, so
+    // embedded nulls survive and SysStringLen doesn't have to scan
+    struct BstrHeader
+    {
+        uint32_t length;
+    };
+
+    size_t GetElementSize(
+        VARTYPE vt)
+    {
+        switch (vt)
+        {
+        case VT_I1:
+        case VT_UI1:
+            return 1;
+        case VT_I2:
+        case VT_UI2:
+        case VT_BOOL:
+            return 2;
+        case VT_I4:
+        case VT_UI4:
+        case VT_R4:
+        case VT_INT:
+        case VT_UINT:
+            return 4;
+        case VT_I8:
+        case VT_UI8:
+        case VT_R8:
+        case VT_DATE:
+            return 8;
+        case VT_BSTR:
+        case VT_UNKNOWN:
+        case VT_DISPATCH:
+            return sizeof(void *);
+        default:
+            return 0;
+        }
+    }
+
+    HRESULT FormatElement(
+        VARTYPE vt,
+        const void *data,
+        std::wstring *result)
+    {
+        switch (vt)
+        {
+        case VT_EMPTY:
+        case VT_NULL:
+            result->clear();
+            return S_OK;
+        case VT_BSTR:
+        {
+            BSTR value = *static_cast<const BSTR *>(data);
+            result->assign(value != NULL ? value : L"", value != NULL ? SysStringLen(value) : 0);
+            return S_OK;
+        }
+        case VT_BOOL:
+            *result = *static_cast<const VARIANT_BOOL *>(data) != VARIANT_FALSE ? L"1" : L"0";
+            return S_OK;
+        case VT_I1:
+            *result = std::to_wstring(*static_cast<const int8_t *>(data));
+            return S_OK;
+        case VT_UI1:
+            *result = std::to_wstring(*static_cast<const uint8_t *>(data));
+            return S_OK;
+        case VT_I2:
+            *result = std::to_wstring(*static_cast<const int16_t *>(data));
+            return S_OK;
+        case VT_UI2:
+            *result = std::to_wstring(*static_cast<const uint16_t *>(data));
+            return S_OK;
+        case VT_I4:
+        case VT_INT:
+            *result = std::to_wstring(*static_cast<const int32_t *>(data));
+            return S_OK;
+        case VT_UI4:
+        case VT_UINT:
+            *result = std::to_wstring(*static_cast<const uint32_t *>(data));
+            return S_OK;
+        case VT_I8:
+            *result = std::to_wstring(*static_cast<const int64_t *>(data));
+            return S_OK;
+        case VT_UI8:
+            *result = std::to_wstring(*static_cast<const uint64_t *>(data));
+            return S_OK;
+        case VT_R4:
+        case VT_R8:
+        {
+            double value = vt == VT_R4 ? *static_cast<const float *>(data) : *static_cast<const double *>(data);
+            wchar_t buffer[32];
+            swprintf(buffer, sizeof(buffer) / sizeof(buffer[0]), vt == VT_R4 ? L"%.7g" : L"%.15g", value);
+            *result = buffer;
+            return S_OK;
+        }
+        default:
+            return DISP_E_TYPEMISMATCH;
+        }
+    }
+
+}
+
+void VariantInit(
+    VARIANT *variant)
+{
+    std::memset(variant, 0, sizeof(*variant));
+    variant->vt = VT_EMPTY;
+}
+
+HRESULT VariantClear(
+    VARIANT *variant)
+{
+    if (variant->vt & VT_ARRAY)
+    {
+        SafeArrayDestroy(variant->parray);
+    }
+    else if (variant->vt == VT_BSTR)
+    {
+        SysFreeString(variant->bstrVal);
+    }
+    VariantInit(variant);
+    return S_OK;
+}
+
+HRESULT VariantToStringAlloc(
+    REFVARIANT variant,
+    PWSTR *result)
+{
+    std::wstring value;
+    if (variant.vt & VT_ARRAY)
+    {
+        // Like propsys, array elements are joined with "; "
+        SAFEARRAY *safe_array = variant.parray;
+        const char *data = static_cast<const char *>(safe_array->pvData);
+        for (ULONG i = 0; i < safe_array->rgsabound[0].cElements; ++i)
+        {
+            std::wstring element;
+            HRESULT hres = FormatElement(safe_array->vt, data + i * safe_array->cbElements, &element);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            if (i > 0)
+            {
+                value += L"; ";
+            }
+            value += element;
+        }
+    }
+    else
+    {
+        HRESULT hres = FormatElement(variant.vt, &variant.llVal, &value);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+    }
+
+    *result = static_cast<PWSTR>(std::malloc((value.size() + 1) * sizeof(wchar_t)));
+    if (*result == NULL)
+    {
+        return E_OUTOFMEMORY;
+    }
+    std::wmemcpy(*result, value.c_str(), value.size() + 1);
+    return S_OK;
+}
+
+BSTR SysAllocString(
+    const OLECHAR *value)
+{
+    return value != NULL ? SysAllocStringLen(value, static_cast<unsigned int>(std::wcslen(value))) : NULL;
+}
+
+BSTR SysAllocStringLen(
+    const OLECHAR *value,
+    unsigned int length)
+{
+    void *memory = std::malloc(sizeof(BstrHeader) + (length + 1) * sizeof(OLECHAR));
+    if (memory == NULL)
+    {
+        return NULL;
+    }
+    static_cast<BstrHeader *>(memory)->length = length;
+
+    BSTR bstr = reinterpret_cast<BSTR>(static_cast<char *>(memory) + sizeof(BstrHeader));
+    if (value != NULL)
+    {
+        std::wmemcpy(bstr, value, length);
+    }
+    bstr[length] = L'\0';
+    return bstr;
+}
+
+unsigned int SysStringLen(
+    BSTR value)
+{
+    if (value == NULL)
+    {
+        return 0;
+    }
+    return reinterpret_cast<BstrHeader *>(reinterpret_cast<char *>(value) - sizeof(BstrHeader))->length;
+}
+
+void SysFreeString(
+    BSTR value)
+{
+    if (value != NULL)
+    {
+        std::free(reinterpret_cast<char *>(value) - sizeof(BstrHeader));
+    }
+}
+
+SAFEARRAY *SafeArrayCreateVector(
+    VARTYPE vt,
+    LONG lower_bound,
+    ULONG element_count)
+{
+    size_t element_size = GetElementSize(vt);
+    if (element_size == 0)
+    {
+        return NULL;
+    }
+
+    SAFEARRAY *safe_array = static_cast<SAFEARRAY *>(std::calloc(1, sizeof(SAFEARRAY)));
+    if (safe_array == NULL)
+    {
+        return NULL;
+    }
+    safe_array->pvData = std::calloc(element_count > 0 ? element_count : 1, element_size);
+    if (safe_array->pvData == NULL)
+    {
+        std::free(safe_array);
+        return NULL;
+    }
+
+    safe_array->cDims = 1;
+    safe_array->cbElements = static_cast<ULONG>(element_size);
+    safe_array->rgsabound[0].cElements = element_count;
+    safe_array->rgsabound[0].lLbound = lower_bound;
+    safe_array->vt = vt;
+    return safe_array;
+}
+
+HRESULT SafeArrayDestroy(
+    SAFEARRAY *safe_array)
+{
+    if (safe_array == NULL)
+    {
+        return S_OK;
+    }
+
+    if (safe_array->vt == VT_BSTR)
+    {
+        BSTR *strings = static_cast<BSTR *>(safe_array->pvData);
+        for (ULONG i = 0; i < safe_array->rgsabound[0].cElements; ++i)
+        {
+            SysFreeString(strings[i]);
+        }
+    }
+    std::free(safe_array->pvData);
+    std::free(safe_array);
+    return S_OK;
+}
+
+HRESULT SafeArrayAccessData(
+    SAFEARRAY *safe_array,
+    void **data)
+{
+    ++safe_array->cLocks;
+    *data = safe_array->pvData;
+    return S_OK;
+}
+
+HRESULT SafeArrayUnaccessData(
+    SAFEARRAY *safe_array)
+{
+    --safe_array->cLocks;
+    return S_OK;
+}
+
+HRESULT SafeArrayGetLBound(
+    SAFEARRAY *safe_array,
+    unsigned int dimension,
+    LONG *lower_bound)
+{
+    if (dimension != 1)
+    {
+        return DISP_E_BADINDEX;
+    }
+    *lower_bound = safe_array->rgsabound[0].lLbound;
+    return S_OK;
+}
+
+HRESULT SafeArrayGetUBound(
+    SAFEARRAY *safe_array,
+    unsigned int dimension,
+    LONG *upper_bound)
+{
+    if (dimension != 1)
+    {
+        return DISP_E_BADINDEX;
+    }
+    *upper_bound = safe_array->rgsabound[0].lLbound + static_cast<LONG>(safe_array->rgsabound[0].cElements) - 1;
+    return S_OK;
+}
+
+void CoTaskMemFree(
+    void *memory)
+{
+    std::free(memory);
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+// VARIANT-shaped stand-ins for the handful of OLE Automation and WMI declarations the value
+// conversions use, so the same conversion code can be compiled and exercised outside of Windows.
+// Layout and semantics follow the Windows SDK closely enough for the conversions, nothing more.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "query_types.h"
+
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint16_t VARTYPE;
+typedef int16_t VARIANT_BOOL;
+typedef wchar_t OLECHAR;
+typedef OLECHAR *BSTR;
+typedef wchar_t *PWSTR;
+typedef double DATE;
+typedef LONG CIMTYPE;
+
+#define VARIANT_TRUE ((VARIANT_BOOL)-1)
+#define VARIANT_FALSE ((VARIANT_BOOL)0)
+
+#define DISP_E_TYPEMISMATCH ((HRESULT)0x80020005L)
+#define DISP_E_BADINDEX ((HRESULT)0x8002000BL)
+
+enum VARENUM
+{
+    VT_EMPTY = 0,
+    VT_NULL = 1,
+    VT_I2 = 2,
+    VT_I4 = 3,
+    VT_R4 = 4,
+    VT_R8 = 5,
+    VT_DATE = 7,
+    VT_BSTR = 8,
+    VT_DISPATCH = 9,
+    VT_BOOL = 11,
+    VT_UNKNOWN = 13,
+    VT_I1 = 16,
+    VT_UI1 = 17,
+    VT_UI2 = 18,
+    VT_UI4 = 19,
+    VT_I8 = 20,
+    VT_UI8 = 21,
+    VT_INT = 22,
+    VT_UINT = 23,
+    VT_ARRAY = 0x2000,
+    VT_TYPEMASK = 0xfff
+};
+
+enum CIMTYPE_ENUMERATION
+{
+    CIM_ILLEGAL = 0xfff,
+    CIM_EMPTY = 0,
+    CIM_SINT8 = 16,
+    CIM_UINT8 = 17,
+    CIM_SINT16 = 2,
+    CIM_UINT16 = 18,
+    CIM_SINT32 = 3,
+    CIM_UINT32 = 19,
+    CIM_SINT64 = 20,
+    CIM_UINT64 = 21,
+    CIM_REAL32 = 4,
+    CIM_REAL64 = 5,
+    CIM_BOOLEAN = 11,
+    CIM_STRING = 8,
+    CIM_DATETIME = 101,
+    CIM_REFERENCE = 102,
+    CIM_CHAR16 = 103,
+    CIM_OBJECT = 13,
+    CIM_FLAG_ARRAY = 0x2000
+};
+
+struct SAFEARRAYBOUND
+{
+    ULONG cElements;
+    LONG lLbound;
+};
+
+// Only one dimensional arrays are supported, which is all WMI properties use
+struct SAFEARRAY
+{
+    uint16_t cDims;
+    uint16_t fFeatures;
+    ULONG cbElements;
+    ULONG cLocks;
+    void *pvData;
+    SAFEARRAYBOUND rgsabound[1];
+    VARTYPE vt; // Element type, kept next to the array instead of in front of it
+};
+
+struct VARIANT
+{
+    VARTYPE vt;
+    uint16_t wReserved1;
+    uint16_t wReserved2;
+    uint16_t wReserved3;
+    union
+    {
+        int64_t llVal;
+        uint64_t ullVal;
+        LONG lVal;
+        ULONG ulVal;
+        int16_t iVal;
+        uint16_t uiVal;
+        char cVal;
+        uint8_t bVal;
+        float fltVal;
+        double dblVal;
+        VARIANT_BOOL boolVal;
+        DATE date;
+        BSTR bstrVal;
+        SAFEARRAY *parray;
+        void *punkVal;
+    };
+};
+
+typedef const VARIANT &REFVARIANT;
+
+void VariantInit(VARIANT *variant);
+HRESULT VariantClear(VARIANT *variant);
+HRESULT VariantToStringAlloc(REFVARIANT variant, PWSTR *result);
+
+BSTR SysAllocString(const OLECHAR *value);
+BSTR SysAllocStringLen(const OLECHAR *value, unsigned int length);
+unsigned int SysStringLen(BSTR value);
+void SysFreeString(BSTR value);
+
+SAFEARRAY *SafeArrayCreateVector(VARTYPE vt, LONG lower_bound, ULONG element_count);
+HRESULT SafeArrayDestroy(SAFEARRAY *safe_array);
+HRESULT SafeArrayAccessData(SAFEARRAY *safe_array, void **data);
+HRESULT SafeArrayUnaccessData(SAFEARRAY *safe_array);
+HRESULT SafeArrayGetLBound(SAFEARRAY *safe_array, unsigned int dimension, LONG *lower_bound);
+HRESULT SafeArrayGetUBound(SAFEARRAY *safe_array, unsigned int dimension, LONG *upper_bound);
+
+void CoTaskMemFree(void *memory);
\ No newline at end of file
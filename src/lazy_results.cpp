@@ -0,0 +1,197 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "lazy_results.h"
+
+#include <utility>
+
+#include "marshalling.h"
+
+namespace wmi_wrapper
+{
+
+    const char kDisposedMessage[] = "Instance was disposed";
+
+    // A property of a schema class, handed to its getter and setter
+    struct LazyProperty
+    {
+        std::wstring name;
+        std::string utf8_name;
+        size_t column;
+    };
+
+    Napi::Function LazyInstance::DefineSchemaClass(
+        Napi::Env env,
+        const ResultSet::Schema &names)
+    {
+        std::vector<LazyProperty> *properties = new std::vector<LazyProperty>(names.size());
+        for (size_t column = 0; column < names.size(); ++column)
+        {
+            (*properties)[column].name = names[column];
+            (*properties)[column].utf8_name = ConvertWstringToString(names[column]);
+            (*properties)[column].column = column;
+        }
+
+        // Properties come after the methods, so a property named like one of them still reads its value
+        std::vector<PropertyDescriptor> descriptors;
+        descriptors.push_back(InstanceMethod("toJSON", &LazyInstance::ToJSON));
+        descriptors.push_back(InstanceMethod("dispose", &LazyInstance::Dispose));
+        for (LazyProperty &property : *properties)
+        {
+            descriptors.push_back(InstanceAccessor(
+                property.utf8_name.c_str(),
+                &LazyInstance::GetProperty,
+                &LazyInstance::SetProperty,
+                static_cast<napi_property_attributes>(napi_enumerable | napi_configurable),
+                &property));
+        }
+
+        // Instances keep their prototype and with it the class alive, so the names outlive every getter call
+        Napi::Function schema_class = DefineClass(env, "WmiInstance", descriptors);
+        schema_class.AddFinalizer(
+            [](Napi::Env, std::vector<LazyProperty> *properties)
+            { delete properties; },
+            properties);
+        return schema_class;
+    }
+
+    LazyInstance::LazyInstance(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<LazyInstance>(info)
+    {
+    }
+
+    void LazyInstance::Init(
+        std::shared_ptr<LazyResults> results,
+        uint32_t row)
+    {
+        results_ = std::move(results);
+        row_ = row;
+    }
+
+    Napi::Value LazyInstance::GetProperty(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        const LazyProperty *property = static_cast<const LazyProperty *>(info.Data());
+        if (!results_ || !results_->results)
+        {
+            Napi::Error::New(env, kDisposedMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        const ResultSet &results = *results_->results;
+        Napi::Value value = ConvertValue(results, results.GetValues(row_)[property->column], results_->options, env);
+
+        // The value on the instance hides this getter from now on
+        info.This().As<Napi::Object>().DefineProperty(Napi::PropertyDescriptor::Value(
+            ConvertWstringToJsString(property->name, env),
+            value,
+            static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable)));
+        return value;
+    }
+
+    void LazyInstance::SetProperty(
+        const Napi::CallbackInfo &info,
+        const Napi::Value &value)
+    {
+        // Assigning replaces the value, the same as for the objects of eager results
+        const LazyProperty *property = static_cast<const LazyProperty *>(info.Data());
+        info.This().As<Napi::Object>().DefineProperty(Napi::PropertyDescriptor::Value(
+            ConvertWstringToJsString(property->name, info.Env()),
+            value,
+            static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable)));
+    }
+
+    Napi::Value LazyInstance::ToJSON(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!results_ || !results_->results)
+        {
+            Napi::Error::New(env, kDisposedMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // Reading every property through the instance converts the ones that weren't read yet
+        Napi::Object self = info.This().As<Napi::Object>();
+        Napi::Object plain = Napi::Object::New(env);
+        for (const std::wstring &name : results_->results->GetNames(row_))
+        {
+            Napi::String js_name = ConvertWstringToJsString(name, env);
+            plain.Set(js_name, self.Get(js_name));
+        }
+        return plain;
+    }
+
+    Napi::Value LazyInstance::Dispose(
+        const Napi::CallbackInfo &info)
+    {
+        // Values already read stay on the instance
+        results_.reset();
+        return info.Env().Undefined();
+    }
+
+    Napi::Object ConvertLazyResults(
+        ResultSet results,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        std::shared_ptr<LazyResults> lazy = std::make_shared<LazyResults>();
+        lazy->results.reset(new ResultSet(std::move(results)));
+        lazy->options = options;
+        // Both belong to the query, which is done by the time the values are read
+        lazy->options.timings = NULL;
+        lazy->options.prepared = NULL;
+
+        const ResultSet &lazy_results = *lazy->results;
+        std::vector<Napi::Function> classes(lazy_results.GetSchemaCount());
+        Napi::Object return_values = Napi::Object::New(env);
+        for (size_t i = 0; i < lazy_results.size(); ++i)
+        {
+            size_t schema = lazy_results.GetSchemaIndex(i);
+            if (classes[schema].IsEmpty())
+            {
+                classes[schema] = LazyInstance::DefineSchemaClass(env, lazy_results.GetSchema(schema));
+            }
+            Napi::Object instance = classes[schema].New({});
+            LazyInstance::Unwrap(instance)->Init(lazy, static_cast<uint32_t>(i));
+            return_values.Set(static_cast<uint32_t>(i), instance);
+        }
+
+        return_values.DefineProperty(Napi::PropertyDescriptor::Value(
+            "dispose",
+            Napi::Function::New(
+                env,
+                [lazy](const Napi::CallbackInfo &info)
+                {
+                    lazy->results.reset();
+                    return info.Env().Undefined();
+                },
+                "dispose"),
+            napi_default));
+        return return_values;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Results of a lazy query, shared by the instances converted from them. The set is released once
+     * every instance was disposed or collected, or right away by dispose() on the results object.
+     */
+    struct LazyResults
+    {
+        std::unique_ptr<ResultSet> results; // NULL once the results were disposed
+        QueryOptions options;
+    };
+
+    /**
+     * An instance of lazy results. Its class has a getter per property of the schema, which converts
+     * the value the first time it is read and defines it on the instance, so later reads are plain
+     * property reads that don't come back to native code.
+     */
+    class LazyInstance : public Napi::ObjectWrap<LazyInstance>
+    {
+    public:
+        /**
+         * Defines the class of the instances of one schema. The class owns the property names its
+         * getters refer to.
+         */
+        static Napi::Function DefineSchemaClass(Napi::Env env, const ResultSet::Schema &names);
+
+        explicit LazyInstance(const Napi::CallbackInfo &info);
+
+        void Init(std::shared_ptr<LazyResults> results, uint32_t row);
+
+    private:
+        Napi::Value GetProperty(const Napi::CallbackInfo &info);
+        void SetProperty(const Napi::CallbackInfo &info, const Napi::Value &value);
+        Napi::Value ToJSON(const Napi::CallbackInfo &info);
+        Napi::Value Dispose(const Napi::CallbackInfo &info);
+
+        std::shared_ptr<LazyResults> results_; // NULL once disposed
+        uint32_t row_ = 0;
+    };
+
+    /**
+     * Converts results into an object holding one LazyInstance per instance, under the same keys as
+     * ConvertResultsObject. Only the property values that are read get converted. The object has a
+     * non-enumerable dispose() that releases the results before the instances are collected.
+     */
+    Napi::Object ConvertLazyResults(ResultSet results, const QueryOptions &options, Napi::Env env);
+
+};
\ No newline at end of file
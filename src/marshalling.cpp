@@ -0,0 +1,673 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "marshalling.h"
+
+#include <napi.h>
+
+#include <cstring>
+#include <vector>
+
+namespace wmi_wrapper
+{
+
+#ifdef _WIN32
+    std::string ConvertWstringToString(const wchar_t *wstring, size_t length)
+    {
+        if (length == 0)
+            return std::string();
+
+        int size_needed = WideCharToMultiByte(CP_UTF8, 0, wstring, (int)length, NULL, 0, NULL, NULL);
+        std::string str(size_needed, 0);
+        WideCharToMultiByte(CP_UTF8, 0, wstring, (int)length, &str[0], size_needed, NULL, NULL);
+        return str;
+    }
+
+    std::wstring ConvertStringToWstring(const std::string &string)
+    {
+        if (string.empty())
+        {
+            return std::wstring();
+        }
+
+        int size_needed = MultiByteToWideChar(CP_UTF8, 0, &string[0], (int)string.size(), NULL, 0);
+        std::wstring wstr(size_needed, 0);
+        MultiByteToWideChar(CP_UTF8, 0, &string[0], (int)string.size(), &wstr[0], size_needed);
+        return wstr;
+    }
+
+    Napi::String ConvertWstringToJsString(
+        const wchar_t *wstring,
+        size_t length,
+        Napi::Env env)
+    {
+        // wchar_t already holds UTF-16
+        return Napi::String::New(env, reinterpret_cast<const char16_t *>(wstring), length);
+    }
+#else
+    // Outside of Windows wchar_t holds UTF-32 code points, so the conversions are done by hand.
+    const uint32_t kReplacementCharacter = 0xFFFD;
+
+    std::string ConvertWstringToString(const wchar_t *wstring, size_t length)
+    {
+        std::string str;
+        str.reserve(length);
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t code_point = static_cast<uint32_t>(wstring[i]);
+            if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+            {
+                code_point = kReplacementCharacter;
+            }
+
+            if (code_point < 0x80)
+            {
+                str.push_back(static_cast<char>(code_point));
+            }
+            else if (code_point < 0x800)
+            {
+                str.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+                str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else if (code_point < 0x10000)
+            {
+                str.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+                str.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+            else
+            {
+                str.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+                str.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+                str.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+            }
+        }
+        return str;
+    }
+
+    std::wstring ConvertStringToWstring(const std::string &string)
+    {
+        std::wstring wstr;
+        wstr.reserve(string.size());
+
+        size_t i = 0;
+        while (i < string.size())
+        {
+            unsigned char lead = static_cast<unsigned char>(string[i]);
+            size_t length;
+            uint32_t code_point;
+            if (lead < 0x80)
+            {
+                length = 1;
+                code_point = lead;
+            }
+            else if ((lead & 0xE0) == 0xC0)
+            {
+                length = 2;
+                code_point = lead & 0x1F;
+            }
+            else if ((lead & 0xF0) == 0xE0)
+            {
+                length = 3;
+                code_point = lead & 0x0F;
+            }
+            else if ((lead & 0xF8) == 0xF0)
+            {
+                length = 4;
+                code_point = lead & 0x07;
+            }
+            else
+            {
+                wstr.push_back(static_cast<wchar_t>(kReplacementCharacter));
+                ++i;
+                continue;
+            }
+
+            bool valid = i + length <= string.size();
+            for (size_t j = 1; valid && j < length; ++j)
+            {
+                unsigned char continuation = static_cast<unsigned char>(string[i + j]);
+                valid = (continuation & 0xC0) == 0x80;
+                code_point = (code_point << 6) | (continuation & 0x3F);
+            }
+
+            if (!valid)
+            {
+                wstr.push_back(static_cast<wchar_t>(kReplacementCharacter));
+                ++i;
+                continue;
+            }
+
+            wstr.push_back(static_cast<wchar_t>(code_point));
+            i += length;
+        }
+        return wstr;
+    }
+
+    Napi::String ConvertWstringToJsString(
+        const wchar_t *wstring,
+        size_t length,
+        Napi::Env env)
+    {
+        // Encoded into a buffer kept by the thread, strings only need surrogate pairs above U+FFFF
+        thread_local std::u16string utf16;
+        utf16.clear();
+        utf16.reserve(length);
+
+        for (size_t i = 0; i < length; ++i)
+        {
+            uint32_t code_point = static_cast<uint32_t>(wstring[i]);
+            if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+            {
+                code_point = kReplacementCharacter;
+            }
+
+            if (code_point < 0x10000)
+            {
+                utf16.push_back(static_cast<char16_t>(code_point));
+            }
+            else
+            {
+                code_point -= 0x10000;
+                utf16.push_back(static_cast<char16_t>(0xD800 | (code_point >> 10)));
+                utf16.push_back(static_cast<char16_t>(0xDC00 | (code_point & 0x3FF)));
+            }
+        }
+        return Napi::String::New(env, utf16.data(), utf16.size());
+    }
+#endif
+
+    std::string ConvertWstringToString(const std::wstring &wstring)
+    {
+        return ConvertWstringToString(wstring.data(), wstring.size());
+    }
+
+    Napi::String ConvertWstringToJsString(
+        const std::wstring &wstring,
+        Napi::Env env)
+    {
+        return ConvertWstringToJsString(wstring.data(), wstring.size(), env);
+    }
+
+    WmiQueryParams GetWstrParams(
+        Napi::String query,
+        Napi::Array properties,
+        Napi::Env env)
+    {
+        WmiQueryParams wstr_params;
+        std::wstring wstr_query = ConvertStringToWstring(query);
+
+        std::vector<std::wstring> wstr_properties;
+
+        for (uint32_t i = 0; i < properties.Length(); ++i)
+        {
+            Napi::Value param_value = properties[i];
+            if (param_value.IsString())
+            {
+                std::string value = param_value.ToString().Utf8Value();
+                std::wstring wstr_value = ConvertStringToWstring(value);
+                wstr_properties.push_back(std::move(wstr_value));
+            }
+            else
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return wstr_params;
+            }
+        }
+
+        wstr_params = make_pair(wstr_query, wstr_properties);
+        return wstr_params;
+    }
+
+    // Elements are either WmiValues or values stored in a ResultSet, they have the same members
+    template <typename T, typename Element>
+    Napi::Value ConvertNumericArray(
+        const Element *elements,
+        size_t count,
+        napi_typedarray_type array_type,
+        Napi::Env env)
+    {
+        Napi::TypedArrayOf<T> array = Napi::TypedArrayOf<T>::New(env, count, array_type);
+        T *data = array.Data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Element &element = elements[i];
+            switch (element.type)
+            {
+            case WmiValue::kSigned:
+                data[i] = static_cast<T>(element.signed_value);
+                break;
+            case WmiValue::kUnsigned:
+                data[i] = static_cast<T>(element.unsigned_value);
+                break;
+            default:
+                data[i] = static_cast<T>(element.real_value);
+                break;
+            }
+        }
+        return array;
+    }
+
+    template <typename Element, typename ConvertElement>
+    Napi::Value ConvertArrayValue(
+        const Element *elements,
+        size_t count,
+        const QueryOptions &options,
+        Napi::Env env,
+        ConvertElement convert_element)
+    {
+        // Numbers of a single width go into the matching TypedArray
+        bool uniform = count > 0;
+        for (size_t i = 1; uniform && i < count; ++i)
+        {
+            uniform = elements[i].type == elements[0].type && elements[i].size == elements[0].size;
+        }
+
+        if (uniform)
+        {
+            WmiValue::Type type = elements[0].type;
+            uint8_t size = elements[0].size;
+            if (type == WmiValue::kSigned)
+            {
+                switch (size)
+                {
+                case 1:
+                    return ConvertNumericArray<int8_t>(elements, count, napi_int8_array, env);
+                case 2:
+                    return ConvertNumericArray<int16_t>(elements, count, napi_int16_array, env);
+                case 4:
+                    return ConvertNumericArray<int32_t>(elements, count, napi_int32_array, env);
+                default:
+                    return options.int64_as_bigint
+                               ? ConvertNumericArray<int64_t>(elements, count, napi_bigint64_array, env)
+                               : ConvertNumericArray<double>(elements, count, napi_float64_array, env);
+                }
+            }
+            if (type == WmiValue::kUnsigned)
+            {
+                switch (size)
+                {
+                case 1:
+                    return ConvertNumericArray<uint8_t>(elements, count, napi_uint8_array, env);
+                case 2:
+                    return ConvertNumericArray<uint16_t>(elements, count, napi_uint16_array, env);
+                case 4:
+                    return ConvertNumericArray<uint32_t>(elements, count, napi_uint32_array, env);
+                default:
+                    return options.int64_as_bigint
+                               ? ConvertNumericArray<uint64_t>(elements, count, napi_biguint64_array, env)
+                               : ConvertNumericArray<double>(elements, count, napi_float64_array, env);
+                }
+            }
+            if (type == WmiValue::kReal)
+            {
+                return size == 4
+                           ? ConvertNumericArray<float>(elements, count, napi_float32_array, env)
+                           : ConvertNumericArray<double>(elements, count, napi_float64_array, env);
+            }
+        }
+
+        Napi::Array array = Napi::Array::New(env, count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            array.Set(static_cast<uint32_t>(i), convert_element(elements[i]));
+        }
+        return array;
+    }
+
+    Napi::Value ConvertValue(
+        const WmiValue &value,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        switch (value.type)
+        {
+        case WmiValue::kString:
+            return ConvertWstringToJsString(value.string_value, env);
+        case WmiValue::kBoolean:
+            return Napi::Boolean::New(env, value.boolean_value);
+        case WmiValue::kSigned:
+            if (value.size == 8 && options.int64_as_bigint)
+            {
+                return Napi::BigInt::New(env, value.signed_value);
+            }
+            return Napi::Number::New(env, static_cast<double>(value.signed_value));
+        case WmiValue::kUnsigned:
+            if (value.size == 8 && options.int64_as_bigint)
+            {
+                return Napi::BigInt::New(env, value.unsigned_value);
+            }
+            return Napi::Number::New(env, static_cast<double>(value.unsigned_value));
+        case WmiValue::kReal:
+            return Napi::Number::New(env, value.real_value);
+        case WmiValue::kDateTime:
+            if (options.datetime_as_date)
+            {
+                return Napi::Date::New(env, value.real_value);
+            }
+            return Napi::Number::New(env, value.real_value);
+        case WmiValue::kArray:
+            return ConvertArrayValue(value.elements.data(), value.elements.size(), options, env, [&](const WmiValue &element)
+                                     { return ConvertValue(element, options, env); });
+        default:
+            return env.Null();
+        }
+    }
+
+    Napi::Value ConvertValue(
+        const ResultSet &results,
+        const ResultSet::Value &value,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        switch (value.type)
+        {
+        case WmiValue::kString:
+            return ConvertWstringToJsString(results.GetString(value), value.length, env);
+        case WmiValue::kArray:
+            return ConvertArrayValue(results.GetElements(value), value.length, options, env, [&](const ResultSet::Value &element)
+                                     { return ConvertValue(results, element, options, env); });
+        case WmiValue::kBoolean:
+            return Napi::Boolean::New(env, value.boolean_value);
+        case WmiValue::kSigned:
+            if (value.size == 8 && options.int64_as_bigint)
+            {
+                return Napi::BigInt::New(env, value.signed_value);
+            }
+            return Napi::Number::New(env, static_cast<double>(value.signed_value));
+        case WmiValue::kUnsigned:
+            if (value.size == 8 && options.int64_as_bigint)
+            {
+                return Napi::BigInt::New(env, value.unsigned_value);
+            }
+            return Napi::Number::New(env, static_cast<double>(value.unsigned_value));
+        case WmiValue::kReal:
+            return Napi::Number::New(env, value.real_value);
+        case WmiValue::kDateTime:
+            if (options.datetime_as_date)
+            {
+                return Napi::Date::New(env, value.real_value);
+            }
+            return Napi::Number::New(env, value.real_value);
+        default:
+            return env.Null();
+        }
+    }
+
+    Napi::Object ConvertResultObject(
+        const WmiQueryResult &result,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Object return_obj = Napi::Object::New(env);
+        for (size_t j = 0; j < result.size(); ++j)
+        {
+            return_obj.Set(ConvertWstringToJsString(result[j].first, env), ConvertValue(result[j].second, options, env));
+        }
+        return return_obj;
+    }
+
+    /**
+     * Converts the instances of a result set one at a time. Each schema gets its property descriptors,
+     * with the name strings, the first time one of its instances is converted. Its other instances
+     * only fill in the values and define all properties in one call.
+     */
+    class ResultObjectConverter
+    {
+    public:
+        ResultObjectConverter(
+            const ResultSet &results,
+            const QueryOptions &options,
+            Napi::Env env)
+            : results_(results),
+              options_(options),
+              env_(env),
+              descriptors_(results.GetSchemaCount())
+        {
+        }
+
+        Napi::Object Convert(size_t row)
+        {
+            std::vector<napi_property_descriptor> &descriptors = descriptors_[results_.GetSchemaIndex(row)];
+            const ResultSet::Schema &names = results_.GetNames(row);
+            if (descriptors.size() != names.size())
+            {
+                descriptors.resize(names.size());
+                for (size_t j = 0; j < names.size(); ++j)
+                {
+                    descriptors[j] = napi_property_descriptor();
+                    descriptors[j].name = ConvertWstringToJsString(names[j], env_);
+                    descriptors[j].attributes = static_cast<napi_property_attributes>(napi_writable | napi_enumerable | napi_configurable);
+                }
+            }
+
+            const ResultSet::Value *values = results_.GetValues(row);
+            for (size_t j = 0; j < descriptors.size(); ++j)
+            {
+                descriptors[j].value = ConvertValue(results_, values[j], options_, env_);
+            }
+
+            // Defining properties only fails with an exception pending, which the caller surfaces
+            Napi::Object return_obj = Napi::Object::New(env_);
+            napi_define_properties(env_, return_obj, descriptors.size(), descriptors.data());
+            return return_obj;
+        }
+
+    private:
+        const ResultSet &results_;
+        const QueryOptions &options_;
+        Napi::Env env_;
+        std::vector<std::vector<napi_property_descriptor>> descriptors_;
+    };
+
+    Napi::Object ConvertResultsObject(
+        const ResultSet &results,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Object return_values = Napi::Object::New(env);
+        ResultObjectConverter converter(results, options, env);
+
+        size_t results_length = results.size();
+        for (size_t i = 0; i < results_length; ++i)
+        {
+            return_values.Set(i, converter.Convert(i));
+        }
+        return return_values;
+    }
+
+    Napi::Array ConvertResultsArray(
+        std::vector<WmiQueryResult> results,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Array return_values = Napi::Array::New(env, results.size());
+
+        size_t results_length = results.size();
+        for (size_t i = 0; i < results_length; ++i)
+        {
+            return_values.Set(i, ConvertResultObject(results[i], options, env));
+        }
+        return return_values;
+    }
+
+    Napi::Array ConvertResultsArray(
+        const ResultSet &results,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Array return_values = Napi::Array::New(env, results.size());
+        ResultObjectConverter converter(results, options, env);
+
+        size_t results_length = results.size();
+        for (size_t i = 0; i < results_length; ++i)
+        {
+            return_values.Set(i, converter.Convert(i));
+        }
+        return return_values;
+    }
+
+    Napi::Array ConvertResultRows(
+        const ResultSet &results,
+        const std::vector<uint32_t> &rows,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Array return_values = Napi::Array::New(env, rows.size());
+        ResultObjectConverter converter(results, options, env);
+
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            return_values.Set(i, converter.Convert(rows[i]));
+        }
+        return return_values;
+    }
+
+    Napi::ArrayBuffer CreateColumnArrayBuffer(
+        ColumnBuffer *buffer,
+        size_t size,
+        Napi::Env env)
+    {
+        // The buffer is handed to V8 as is and freed by its finalizer
+        napi_value array_buffer;
+        napi_status status = napi_create_external_arraybuffer(
+            env,
+            buffer->get(),
+            size,
+            [](napi_env, void *data, void *)
+            { FreeColumnBuffer(data); },
+            NULL,
+            &array_buffer);
+        if (status == napi_ok)
+        {
+            buffer->release();
+            return Napi::ArrayBuffer(env, array_buffer);
+        }
+
+        // Runtimes that don't allow external buffers get a copy
+        Napi::ArrayBuffer copy = Napi::ArrayBuffer::New(env, size);
+        std::memcpy(copy.Data(), buffer->get(), size);
+        return copy;
+    }
+
+    Napi::Object ConvertColumnarResults(
+        ColumnarResults columnar,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        Napi::Object return_value = Napi::Object::New(env);
+        Napi::Array columns = Napi::Array::New(env, columnar.columns.size());
+        Napi::Object data = Napi::Object::New(env);
+
+        Napi::ArrayBuffer array_buffer;
+        if (columnar.numeric_size > 0)
+        {
+            array_buffer = CreateColumnArrayBuffer(&columnar.numeric_data, columnar.numeric_size, env);
+        }
+
+        size_t row_count = columnar.row_count;
+        for (size_t i = 0; i < columnar.columns.size(); ++i)
+        {
+            const ResultColumn &column = columnar.columns[i];
+            Napi::String name = ConvertWstringToJsString(column.name, env);
+            columns.Set(static_cast<uint32_t>(i), name);
+
+            switch (column.kind)
+            {
+            case ResultColumn::kFloat64:
+                data.Set(name, Napi::Float64Array::New(env, row_count, array_buffer, column.offset, napi_float64_array));
+                break;
+            case ResultColumn::kBigInt64:
+                data.Set(name, Napi::BigInt64Array::New(env, row_count, array_buffer, column.offset, napi_bigint64_array));
+                break;
+            case ResultColumn::kBigUint64:
+                data.Set(name, Napi::BigUint64Array::New(env, row_count, array_buffer, column.offset, napi_biguint64_array));
+                break;
+            default:
+            {
+                Napi::Array values = Napi::Array::New(env, row_count);
+                for (size_t row = 0; row < row_count; ++row)
+                {
+                    const ResultSet::Value *value = column.values[row];
+                    values.Set(static_cast<uint32_t>(row), value ? ConvertValue(columnar.results, *value, options, env) : env.Null());
+                }
+                data.Set(name, values);
+                break;
+            }
+            }
+        }
+
+        return_value.Set("columns", columns);
+        return_value.Set("rows", Napi::Number::New(env, static_cast<double>(row_count)));
+        return_value.Set("data", data);
+        return return_value;
+    }
+
+    Napi::Value ConvertAggregatedResults(
+        const AggregatedResults &aggregated,
+        const AggregateSpec &spec,
+        const QueryOptions &options,
+        Napi::Env env)
+    {
+        // Names are created once and shared by every group
+        std::vector<Napi::String> key_names;
+        for (const std::wstring &property : spec.group_by)
+        {
+            key_names.push_back(ConvertWstringToJsString(property, env));
+        }
+        std::vector<Napi::String> output_names;
+        for (const AggregateOutput &output : spec.outputs)
+        {
+            output_names.push_back(Napi::String::New(env, output.name));
+        }
+
+        auto convert_group = [&](const AggregateGroup &group)
+        {
+            Napi::Object converted = Napi::Object::New(env);
+            for (size_t k = 0; k < group.keys.size(); ++k)
+            {
+                converted.Set(key_names[k], ConvertValue(group.keys[k], options, env));
+            }
+            for (size_t o = 0; o < group.outputs.size(); ++o)
+            {
+                converted.Set(output_names[o], ConvertValue(group.outputs[o], options, env));
+            }
+            return converted;
+        };
+
+        if (spec.group_by.empty())
+        {
+            return aggregated.groups.empty() ? Napi::Object::New(env) : convert_group(aggregated.groups[0]);
+        }
+        Napi::Array groups = Napi::Array::New(env, aggregated.groups.size());
+        for (size_t i = 0; i < aggregated.groups.size(); ++i)
+        {
+            groups.Set(static_cast<uint32_t>(i), convert_group(aggregated.groups[i]));
+        }
+        return groups;
+    }
+
+}
\ No newline at end of file
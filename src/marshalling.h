@@ -0,0 +1,91 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "aggregation.h"
+#include "columnar_results.h"
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    std::string ConvertWstringToString(const std::wstring &wstring);
+    std::string ConvertWstringToString(const wchar_t *wstring, size_t length);
+    std::wstring ConvertStringToWstring(const std::string &string);
+
+    /**
+     * Creates a JavaScript string straight from UTF-16, without a round trip through UTF-8
+     */
+    Napi::String ConvertWstringToJsString(const wchar_t *wstring, size_t length, Napi::Env env);
+    Napi::String ConvertWstringToJsString(const std::wstring &wstring, Napi::Env env);
+
+    WmiQueryParams GetWstrParams(Napi::String query, Napi::Array keys, Napi::Env env);
+
+    /**
+     * Converts a property value to JavaScript. Typed values become numbers, BigInts, booleans,
+     * Dates, null or arrays, with arrays of numbers of a single width becoming TypedArrays.
+     */
+    Napi::Value ConvertValue(const WmiValue &value, const QueryOptions &options, Napi::Env env);
+    Napi::Value ConvertValue(const ResultSet &results, const ResultSet::Value &value, const QueryOptions &options, Napi::Env env);
+    Napi::Object ConvertResultObject(const WmiQueryResult &result, const QueryOptions &options, Napi::Env env);
+
+    /**
+     * Converts every instance of a result set to an object. Property name strings are created once
+     * per schema and all instances of a schema define them in the same order, so they share one
+     * hidden class.
+     */
+    Napi::Object ConvertResultsObject(const ResultSet &results, const QueryOptions &options, Napi::Env env);
+    Napi::Array ConvertResultsArray(std::vector<WmiQueryResult> results, const QueryOptions &options, Napi::Env env);
+    Napi::Array ConvertResultsArray(const ResultSet &results, const QueryOptions &options, Napi::Env env);
+
+    // Converts the given rows of a result set, in that order
+    Napi::Array ConvertResultRows(const ResultSet &results, const std::vector<uint32_t> &rows, const QueryOptions &options, Napi::Env env);
+
+    /**
+     * Wraps a native buffer in an ArrayBuffer. The ArrayBuffer takes over the buffer, or gets a copy
+     * on runtimes that don't allow external buffers.
+     */
+    Napi::ArrayBuffer CreateColumnArrayBuffer(ColumnBuffer *buffer, size_t size, Napi::Env env);
+
+    /**
+     * Converts columns built by BuildColumnarResults into { columns, rows, data }. Numeric columns
+     * become TypedArray views on one ArrayBuffer that takes over the native buffer without a copy.
+     */
+    Napi::Object ConvertColumnarResults(ColumnarResults columnar, const QueryOptions &options, Napi::Env env);
+
+    /**
+     * Converts the outcome of an aggregation: one object with the values when it has no groupBy,
+     * otherwise an array with an object per group holding its key properties followed by its values
+     */
+    Napi::Value ConvertAggregatedResults(const AggregatedResults &aggregated, const AggregateSpec &spec, const QueryOptions &options, Napi::Env env);
+
+};
\ No newline at end of file
@@ -24,14 +24,19 @@
 
 #pragma once
 
-#include <vector>
+#include <napi.h>
+
+#include <algorithm>
+#include <cctype>
 #include <string>
+#include <unordered_set>
 
 namespace namespaces
 {
-    std::vector<std::string> GetWhitelist()
+    inline const std::unordered_set<std::string> &GetWhitelist()
     {
-        std::vector<std::string> whitelist_lowercase{
+        // Built once, checking a namespace is a single lookup of its lowercase name
+        static const std::unordered_set<std::string> whitelist_lowercase{
             "root/cimv2",
             "root/cimv2/power",
             "root/wmi",
@@ -40,7 +45,7 @@ namespace namespaces
         return whitelist_lowercase;
     }
 
-    bool IsSupportedNamespace(Napi::String wmi_namespace)
+    inline bool IsSupportedNamespace(const std::string &wmi_namespace)
     {
         std::string wmi_namespace_lowercase = wmi_namespace;
         std::transform(
@@ -48,16 +53,13 @@ namespace namespaces
             wmi_namespace_lowercase.end(),
             wmi_namespace_lowercase.begin(),
             [](unsigned char c)
-            { return std::tolower(c); });
+            { return static_cast<char>(std::tolower(c)); });
 
-        std::vector<std::string> whitelist = namespaces::GetWhitelist();
+        return GetWhitelist().count(wmi_namespace_lowercase) != 0;
+    }
 
-        return std::any_of(
-            whitelist.begin(),
-            whitelist.end(),
-            [wmi_namespace_lowercase](const std::string &str)
-            {
-                return str == wmi_namespace_lowercase;
-            });
+    inline bool IsSupportedNamespace(Napi::String wmi_namespace)
+    {
+        return IsSupportedNamespace(wmi_namespace.Utf8Value());
     }
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "pool_worker.h"
+
+#include <thread>
+
+namespace wmi_wrapper
+{
+
+    PoolWorker::PoolWorker(
+        Napi::Env env,
+        const char *resource_name)
+        : env_(env),
+          resource_name_(resource_name),
+          failed_(false),
+          env_exited_(false),
+          owners_(2)
+    {
+    }
+
+    void PoolWorker::Queue(
+        WorkerPool *pool,
+        JobPriority priority)
+    {
+        settle_ = Napi::ThreadSafeFunction::New(
+            env_,
+            Napi::Function::New(env_, [](const Napi::CallbackInfo &) {}),
+            resource_name_,
+            0,
+            1,
+            [this](Napi::Env env)
+            {
+                napi_remove_env_cleanup_hook(env, CleanupOnEnvExit, this);
+                ReleaseOwner();
+            });
+
+        // Added after the thread-safe function's own hook, so it runs first
+        napi_add_env_cleanup_hook(env_, CleanupOnEnvExit, this);
+
+        if (pool == NULL)
+        {
+            std::thread([this]()
+                        { Run(S_OK); })
+                .detach();
+            return;
+        }
+        pool->Post(
+            priority,
+            [this](HRESULT thread_status)
+            {
+                Run(thread_status);
+            });
+    }
+
+    void PoolWorker::SetError(
+        const std::string &message)
+    {
+        failed_ = true;
+        error_ = message;
+    }
+
+    void PoolWorker::CleanupOnEnvExit(
+        void *data)
+    {
+        PoolWorker *worker = static_cast<PoolWorker *>(data);
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex_);
+            worker->env_exited_ = true;
+        }
+        worker->OnEnvCleanup();
+    }
+
+    void PoolWorker::Run(
+        HRESULT thread_status)
+    {
+        Execute(thread_status);
+        {
+            // The thread-safe function is gone once the environment exited
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!env_exited_)
+            {
+                settle_.NonBlockingCall(
+                    [this](Napi::Env, Napi::Function)
+                    {
+                        Settle();
+                    });
+                settle_.Release();
+            }
+        }
+        ReleaseOwner();
+    }
+
+    void PoolWorker::Settle()
+    {
+        Napi::HandleScope scope(env_);
+        if (failed_)
+        {
+            OnError(Napi::Error::New(env_, error_));
+        }
+        else
+        {
+            OnOK();
+        }
+    }
+
+    void PoolWorker::ReleaseOwner()
+    {
+        if (--owners_ == 0)
+        {
+            delete this;
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include "query_types.h"
+#include "worker_pool.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Async work that waits for a thread of a WorkerPool instead of a thread of the libuv pool, so
+     * as many calls can be queued as the pool takes and they start in the order of their priority.
+     *
+     * Like Napi::AsyncWorker, Execute runs on a worker thread and OnOK or OnError on the JavaScript
+     * thread afterwards, reached through a thread-safe function that keeps the event loop alive in
+     * the meantime. The worker deletes itself once it settled. When the environment goes away first
+     * it isn't settled: OnEnvCleanup lets go of its JavaScript references and the worker is deleted
+     * by whichever of the environment and the worker thread is done with it last.
+     */
+    class PoolWorker
+    {
+    public:
+        virtual ~PoolWorker() {}
+
+        /**
+         * Posts the worker to pool, or runs it on a thread of its own when there is no pool
+         */
+        void Queue(WorkerPool *pool, JobPriority priority);
+
+    protected:
+        PoolWorker(Napi::Env env, const char *resource_name);
+
+        /**
+         * Runs on a worker thread, which must not be used for WMI calls when thread_status failed
+         */
+        virtual void Execute(HRESULT thread_status) = 0;
+
+        virtual void OnOK() = 0;
+        virtual void OnError(const Napi::Error &error) = 0;
+
+        // Called on the JavaScript thread while the environment exits, Execute may still be running
+        virtual void OnEnvCleanup() {}
+
+        // Makes OnError run instead of OnOK, called from Execute
+        void SetError(const std::string &message);
+
+        Napi::Env Env() const
+        {
+            return env_;
+        }
+
+    private:
+        static void CleanupOnEnvExit(void *data);
+
+        void Run(HRESULT thread_status);
+        void Settle();
+        void ReleaseOwner();
+
+        Napi::Env env_;
+        const char *resource_name_;
+        Napi::ThreadSafeFunction settle_;
+        bool failed_;
+        std::string error_;
+
+        std::mutex mutex_;
+        bool env_exited_;        // Guarded by mutex_, settle_ is not to be used anymore once set
+        std::atomic<int> owners_; // The environment and the worker thread
+    };
+
+};
\ No newline at end of file
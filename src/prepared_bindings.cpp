@@ -0,0 +1,252 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "prepared_bindings.h"
+
+#include <utility>
+
+#include <napi.h>
+
+#include "marshalling.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+
+namespace wmi_wrapper
+{
+
+    const char kClosedMessage[] = "Prepared query is closed";
+
+    Napi::Function PreparedQueryHandle::GetClass(
+        Napi::Env env)
+    {
+        return DefineClass(
+            env,
+            "PreparedQuery",
+            {InstanceMethod("run", &PreparedQueryHandle::Run),
+             InstanceMethod("runAsync", &PreparedQueryHandle::RunAsync),
+             InstanceMethod("close", &PreparedQueryHandle::Close),
+             InstanceAccessor("namespace", &PreparedQueryHandle::GetNamespace, nullptr),
+             InstanceAccessor("query", &PreparedQueryHandle::GetQuery, nullptr),
+             InstanceAccessor("className", &PreparedQueryHandle::GetClassName, nullptr),
+             InstanceAccessor("properties", &PreparedQueryHandle::GetProperties, nullptr),
+             InstanceAccessor("closed", &PreparedQueryHandle::GetClosed, nullptr)});
+    }
+
+    PreparedQueryHandle::PreparedQueryHandle(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<PreparedQueryHandle>(info)
+    {
+    }
+
+    void PreparedQueryHandle::Init(
+        std::shared_ptr<const PreparedQuery> prepared,
+        const QueryOptions &options)
+    {
+        prepared_ = std::move(prepared);
+        options_ = options;
+        options_.prepared = prepared_.get();
+    }
+
+    bool PreparedQueryHandle::GetRunOptions(
+        const Napi::CallbackInfo &info,
+        QueryOptions *options,
+        AbortListener *abort)
+    {
+        Napi::Env env = info.Env();
+        if (!prepared_)
+        {
+            Napi::Error::New(env, kClosedMessage).ThrowAsJavaScriptException();
+            return false;
+        }
+        if (info.Length() > 1 || (info.Length() == 1 && !info[0].IsUndefined() && !info[0].IsObject()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        // Options left out of the run keep the value given to prepare
+        *options = options_;
+        if (info.Length() == 0 || info[0].IsUndefined())
+        {
+            return true;
+        }
+
+        Napi::Object run_options = info[0].As<Napi::Object>();
+        return ParseQueryOptions(run_options, options) &&
+               (abort != NULL ? abort->Listen(run_options, options) : CheckNotAborted(run_options));
+    }
+
+    Napi::Value PreparedQueryHandle::Run(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        QueryOptions options;
+        if (provider == NULL || !GetRunOptions(info, &options, NULL))
+        {
+            if (!env.IsExceptionPending())
+            {
+                Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            }
+            return env.Null();
+        }
+
+        return RunQuery(env, provider, prepared_->GetNamespace(), prepared_->GetParams(), options);
+    }
+
+    Napi::Value PreparedQueryHandle::RunAsync(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        QueryOptions options;
+        AbortListener abort;
+        if (provider == NULL || !GetRunOptions(info, &options, &abort))
+        {
+            // Reported through the Promise like any other failure
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(env.IsExceptionPending()
+                                ? env.GetAndClearPendingException().Value()
+                                : Napi::Error::New(env, kUnsupportedOsMessage).Value());
+            return deferred.Promise();
+        }
+
+        return QueueQuery(env, provider, prepared_, options, std::move(abort));
+    }
+
+    Napi::Value PreparedQueryHandle::Close(
+        const Napi::CallbackInfo &info)
+    {
+        // Runs that are still in progress keep the query until they are done
+        prepared_.reset();
+        options_.prepared = NULL;
+        return info.Env().Undefined();
+    }
+
+    Napi::Value PreparedQueryHandle::GetNamespace(
+        const Napi::CallbackInfo &info)
+    {
+        if (!prepared_)
+        {
+            return info.Env().Null();
+        }
+        return Napi::String::New(info.Env(), prepared_->GetNamespace());
+    }
+
+    Napi::Value PreparedQueryHandle::GetQuery(
+        const Napi::CallbackInfo &info)
+    {
+        if (!prepared_)
+        {
+            return info.Env().Null();
+        }
+        return ConvertWstringToJsString(prepared_->GetParams().first, info.Env());
+    }
+
+    Napi::Value PreparedQueryHandle::GetClassName(
+        const Napi::CallbackInfo &info)
+    {
+        if (!prepared_)
+        {
+            return info.Env().Null();
+        }
+        return ConvertWstringToJsString(prepared_->GetClassName(), info.Env());
+    }
+
+    Napi::Value PreparedQueryHandle::GetProperties(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!prepared_)
+        {
+            return env.Null();
+        }
+
+        const std::vector<std::wstring> &properties = prepared_->GetParams().second;
+        Napi::Array property_list = Napi::Array::New(env, properties.size());
+        for (size_t i = 0; i < properties.size(); ++i)
+        {
+            property_list.Set(static_cast<uint32_t>(i), ConvertWstringToJsString(properties[i], env));
+        }
+        return property_list;
+    }
+
+    Napi::Value PreparedQueryHandle::GetClosed(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Boolean::New(info.Env(), !prepared_);
+    }
+
+    Napi::Value WmiPrepare(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string wmi_namespace;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        if (!ParseQueryArguments(info, &wmi_namespace, &wstr_params, &options) ||
+            !ParseQueryOptions(options, &query_options))
+        {
+            return env.Null();
+        }
+        UseAggregateProperties(query_options, &wstr_params.second);
+
+        std::shared_ptr<const PreparedQuery> prepared;
+        HRESULT hres = PreparedQuery::Create(
+            std::move(wmi_namespace),
+            std::move(wstr_params.first),
+            std::move(wstr_params.second),
+            &prepared);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, hres == E_INVALIDARG ? "Invalid Query" : GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object handle = GetAddonData(env)->prepared_query_constructor.New({});
+        PreparedQueryHandle::Unwrap(handle)->Init(std::move(prepared), query_options);
+        return handle;
+    }
+
+    void RegisterPreparedQueries(
+        Napi::Env env,
+        Napi::Object exports,
+        AddonData *addon_data)
+    {
+        addon_data->prepared_query_constructor = Napi::Persistent(PreparedQueryHandle::GetClass(env));
+        exports.Set("prepare", Napi::Function::New(env, wmi_wrapper::WmiPrepare));
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+
+#include "abort_signal.h"
+#include "addon_data.h"
+#include "prepared_query.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Handle returned by prepare. It holds the parsed query and its default options, so running it
+     * skips converting and validating the arguments.
+     */
+    class PreparedQueryHandle : public Napi::ObjectWrap<PreparedQueryHandle>
+    {
+    public:
+        static Napi::Function GetClass(Napi::Env env);
+
+        explicit PreparedQueryHandle(const Napi::CallbackInfo &info);
+
+        void Init(std::shared_ptr<const PreparedQuery> prepared, const QueryOptions &options);
+
+    private:
+        Napi::Value Run(const Napi::CallbackInfo &info);
+        Napi::Value RunAsync(const Napi::CallbackInfo &info);
+        Napi::Value Close(const Napi::CallbackInfo &info);
+        Napi::Value GetNamespace(const Napi::CallbackInfo &info);
+        Napi::Value GetQuery(const Napi::CallbackInfo &info);
+        Napi::Value GetClassName(const Napi::CallbackInfo &info);
+        Napi::Value GetProperties(const Napi::CallbackInfo &info);
+        Napi::Value GetClosed(const Napi::CallbackInfo &info);
+
+        /**
+         * Reads the options passed to run or runAsync on top of the defaults given to prepare
+         *
+         * @param abort Listens to the signal of a runAsync, NULL for run, which only checks that the
+         *              signal didn't fire yet
+         * @return true when the options are valid, otherwise a JavaScript exception is pending
+         */
+        bool GetRunOptions(const Napi::CallbackInfo &info, QueryOptions *options, AbortListener *abort);
+
+        std::shared_ptr<const PreparedQuery> prepared_; // NULL once closed
+        QueryOptions options_;
+    };
+
+    /**
+     * Parses and validates a SELECT query once so it can be run any number of times
+     *
+     * @param info[0] String containing the Namespace
+     * @param info[1] String containing a WQL SELECT query (example: "SELECT Name, ProcessId FROM Win32_Process")
+     * @param info[2] Optional: Array of strings containing the properties to read, taken from the select list when
+     *                left out. SELECT * without properties returns all properties.
+     * @param info[3] Optional: Object with the default options of every run, see ParseQueryOptions
+     * @return An object with run(options?), runAsync(options?), close(), namespace, query, className,
+     *         properties and closed
+     */
+    Napi::Value WmiPrepare(const Napi::CallbackInfo &info);
+
+    void RegisterPreparedQueries(Napi::Env env, Napi::Object exports, AddonData *addon_data);
+
+};
\ No newline at end of file
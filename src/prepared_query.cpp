@@ -0,0 +1,75 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "prepared_query.h"
+
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    PreparedQuery::PreparedQuery()
+        : query_text_(NULL)
+    {
+    }
+
+    PreparedQuery::~PreparedQuery()
+    {
+        SysFreeString(query_text_);
+    }
+
+    HRESULT PreparedQuery::Create(
+        std::string wmi_namespace,
+        std::wstring query,
+        std::vector<std::wstring> properties,
+        std::shared_ptr<const PreparedQuery> *prepared)
+    {
+        SelectQuery select;
+        if (!ParseSelectQuery(query, &select))
+        {
+            return E_INVALIDARG;
+        }
+
+        std::shared_ptr<PreparedQuery> created(new PreparedQuery());
+        created->params_.second = properties.empty() ? std::move(select.properties) : std::move(properties);
+
+        // ExecQuery gets the query narrowed to the properties that are read
+        std::wstring projected;
+        const std::wstring &query_text = RewriteProjection(query, created->params_.second, &projected) ? projected : query;
+        created->query_text_ = SysAllocStringLen(query_text.data(), static_cast<unsigned int>(query_text.size()));
+        if (created->query_text_ == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        created->wmi_namespace_ = std::move(wmi_namespace);
+        created->class_name_ = std::move(select.class_name);
+        created->selection_ = GetQuerySelection(query);
+        created->normalized_query_ = NormalizeQuery(query);
+        created->params_.first = std::move(query);
+        *prepared = std::move(created);
+        return S_OK;
+    }
+
+}
\ No newline at end of file
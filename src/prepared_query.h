@@ -0,0 +1,112 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include "fake_variant.h"
+#endif
+
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * A query parsed and validated once by prepare(). Everything derived from the query text is kept
+     * with it, so running it again only executes the query and converts the results. Providers and
+     * the result cache take what they need from QueryOptions::prepared when it is set.
+     */
+    class PreparedQuery
+    {
+    public:
+        /**
+         * @param wmi_namespace Already checked against the supported namespaces
+         * @param properties Properties to read, empty to take them from the select list
+         * @param prepared Receives the prepared query
+         * @return E_INVALIDARG when the query isn't a SELECT query with a FROM clause
+         */
+        static HRESULT Create(
+            std::string wmi_namespace,
+            std::wstring query,
+            std::vector<std::wstring> properties,
+            std::shared_ptr<const PreparedQuery> *prepared);
+
+        ~PreparedQuery();
+
+        PreparedQuery(const PreparedQuery &) = delete;
+        PreparedQuery &operator=(const PreparedQuery &) = delete;
+
+        const std::string &GetNamespace() const
+        {
+            return wmi_namespace_;
+        }
+
+        // The query text and the properties read from every instance
+        const WmiQueryParams &GetParams() const
+        {
+            return params_;
+        }
+
+        const std::wstring &GetClassName() const
+        {
+            return class_name_;
+        }
+
+        // See GetQuerySelection
+        const std::wstring &GetSelection() const
+        {
+            return selection_;
+        }
+
+        // See NormalizeQuery
+        const std::wstring &GetNormalizedQuery() const
+        {
+            return normalized_query_;
+        }
+
+        // The query text allocated once for ExecQuery, with its projection rewritten, see RewriteProjection
+        BSTR GetQueryText() const
+        {
+            return query_text_;
+        }
+
+    private:
+        PreparedQuery();
+
+        std::string wmi_namespace_;
+        WmiQueryParams params_;
+        std::wstring class_name_;
+        std::wstring selection_;
+        std::wstring normalized_query_;
+        BSTR query_text_;
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,412 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "property_access.h"
+
+#include <cstring>
+#include <utility>
+
+#include "class_descriptors.h"
+#include "connection_pool.h"
+#include "prepared_query.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    PropertyHandle::Read GetHandleRead(CIMTYPE cim_type)
+    {
+        switch (cim_type)
+        {
+        case CIM_SINT32:
+        case CIM_UINT32:
+        case CIM_REAL32:
+            return PropertyHandle::kDword;
+        case CIM_SINT64:
+        case CIM_UINT64:
+        case CIM_REAL64:
+            return PropertyHandle::kQword;
+        default:
+            // Strings, datetimes, arrays, objects and types narrower than 32 bits are read by name
+            return PropertyHandle::kByName;
+        }
+    }
+
+    std::wstring GetSchemaKey(
+        const std::wstring &class_name,
+        const std::wstring &selection,
+        const std::vector<std::wstring> &properties)
+    {
+        std::wstring key = class_name + L'|' + selection;
+        for (const std::wstring &property : properties)
+        {
+            key += L'|';
+            key += property;
+        }
+        return key;
+    }
+
+    HRESULT ResolveSchema(
+        const std::vector<std::wstring> &properties,
+        InstanceAccess *instance,
+        ClassSchema *schema)
+    {
+        std::vector<std::wstring> names;
+        const std::vector<std::wstring> *resolved = &properties;
+        if (properties.empty())
+        {
+            HRESULT hres = instance->GetNames(&names);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            resolved = &names;
+        }
+
+        schema->properties.reserve(resolved->size());
+        for (const std::wstring &name : *resolved)
+        {
+            PropertyHandle property;
+            property.name = name;
+
+            CIMTYPE cim_type = CIM_EMPTY;
+            long handle = 0;
+            if (SUCCEEDED(instance->GetPropertyHandle(name, &cim_type, &handle)))
+            {
+                property.cim_type = cim_type;
+                property.handle = handle;
+                property.read = GetHandleRead(cim_type);
+            }
+
+            schema->properties.push_back(std::move(property));
+        }
+
+        return S_OK;
+    }
+
+    PropertyHandleCache::PropertyHandleCache(size_t max_schemas)
+        : max_schemas_(max_schemas),
+          schema_count_(0)
+    {
+    }
+
+    std::shared_ptr<const ClassSchema> PropertyHandleCache::GetSchema(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name,
+        const std::wstring &selection,
+        const std::vector<std::wstring> &properties,
+        InstanceAccess *instance)
+    {
+        std::string namespace_key = GetPoolKey(wmi_namespace);
+        std::wstring schema_key = GetSchemaKey(class_name, selection, properties);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto classes = schemas_.find(namespace_key);
+            if (classes != schemas_.end())
+            {
+                auto schema = classes->second.find(schema_key);
+                if (schema != classes->second.end())
+                {
+                    stats_.hits++;
+                    return schema->second;
+                }
+            }
+        }
+
+        // Resolve outside the lock, the handles only depend on the class so racing resolutions agree
+        std::shared_ptr<ClassSchema> schema = std::make_shared<ClassSchema>();
+        if (FAILED(ResolveSchema(properties, instance, schema.get())))
+        {
+            return nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.misses++;
+        if (schema_count_ >= max_schemas_)
+        {
+            // Queries rarely touch more than a handful of classes, starting over is cheaper than tracking use
+            schemas_.clear();
+            schema_count_ = 0;
+        }
+
+        auto inserted = schemas_[namespace_key].emplace(schema_key, schema);
+        if (inserted.second)
+        {
+            schema_count_++;
+        }
+        return inserted.first->second;
+    }
+
+    void PropertyHandleCache::Invalidate(const std::string &wmi_namespace)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto classes = schemas_.find(GetPoolKey(wmi_namespace));
+        if (classes != schemas_.end())
+        {
+            schema_count_ -= classes->second.size();
+            schemas_.erase(classes);
+            stats_.invalidations++;
+        }
+    }
+
+    void PropertyHandleCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        schemas_.clear();
+        schema_count_ = 0;
+    }
+
+    void PropertyHandleCache::AddReads(uint64_t handle_reads, uint64_t named_reads)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.handle_reads += handle_reads;
+        stats_.named_reads += named_reads;
+    }
+
+    PropertyHandleCacheStats PropertyHandleCache::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PropertyHandleCacheStats stats = stats_;
+        stats.cached_schemas = schema_count_;
+        return stats;
+    }
+
+    ClassSchema GetNamedSchema(const std::vector<std::wstring> &properties)
+    {
+        ClassSchema schema;
+        schema.properties.reserve(properties.size());
+        for (const std::wstring &name : properties)
+        {
+            PropertyHandle property;
+            property.name = name;
+            schema.properties.push_back(std::move(property));
+        }
+        return schema;
+    }
+
+    InstanceReader::InstanceReader(
+        PropertyHandleCache *cache,
+        const std::string &wmi_namespace,
+        const std::wstring &query,
+        const std::vector<std::wstring> &properties,
+        const QueryOptions &options)
+        : cache_(cache),
+          wmi_namespace_(wmi_namespace),
+          selection_(cache == NULL                ? std::wstring()
+                     : options.prepared != NULL ? options.prepared->GetSelection()
+                                                : GetQuerySelection(query)),
+          properties_(properties),
+          options_(options),
+          handle_reads_(0),
+          named_reads_(0)
+    {
+        if (options.typed_class != NULL)
+        {
+            // Without a cache every property is read by name, the extractor does the same
+            typed_reader_ = options.typed_class->CreateReader(cache_ != NULL);
+        }
+        else if (cache_ == NULL && !properties_.empty())
+        {
+            schema_ = std::make_shared<ClassSchema>(GetNamedSchema(properties_));
+        }
+    }
+
+    InstanceReader::~InstanceReader()
+    {
+        if (cache_ != NULL && typed_reader_)
+        {
+            cache_->AddReads(typed_reader_->GetHandleReads(), typed_reader_->GetNamedReads());
+        }
+        else if (cache_ != NULL)
+        {
+            cache_->AddReads(handle_reads_, named_reads_);
+        }
+    }
+
+    HRESULT InstanceReader::ResolveSchema(InstanceAccess *instance)
+    {
+        if (cache_ == NULL && properties_.empty())
+        {
+            std::vector<std::wstring> names;
+            HRESULT hres = instance->GetNames(&names);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            if (names_ && *names_ == names)
+            {
+                return S_OK;
+            }
+            schema_ = std::make_shared<ClassSchema>(GetNamedSchema(names));
+        }
+        else if (cache_ != NULL)
+        {
+            std::wstring class_name;
+            HRESULT hres = instance->GetClassName(&class_name);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            if (!schema_ || class_name != class_name_)
+            {
+                schema_ = cache_->GetSchema(wmi_namespace_, class_name, selection_, properties_, instance);
+                if (!schema_)
+                {
+                    return E_FAIL;
+                }
+                class_name_ = std::move(class_name);
+            }
+        }
+
+        if (named_schema_ != schema_)
+        {
+            std::shared_ptr<ResultSet::Schema> names = std::make_shared<ResultSet::Schema>();
+            names->reserve(schema_->properties.size());
+            for (const PropertyHandle &property : schema_->properties)
+            {
+                names->push_back(property.name);
+            }
+            names_ = std::move(names);
+            named_schema_ = schema_;
+        }
+        return S_OK;
+    }
+
+    HRESULT InstanceReader::Read(InstanceAccess *instance, ResultSet *results)
+    {
+        if (typed_reader_)
+        {
+            return typed_reader_->Read(instance, results);
+        }
+
+        HRESULT hres = ResolveSchema(instance);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        results->AddRow(names_);
+        for (const PropertyHandle &property : schema_->properties)
+        {
+            // Properties that can't be read are reported as empty strings
+            value_.type = WmiValue::kString;
+            value_.size = 0;
+            value_.unsigned_value = 0;
+            value_.string_value.clear();
+            value_.elements.clear();
+            ReadProperty(instance, property, &value_);
+            results->AddValue(value_);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT InstanceReader::Read(InstanceAccess *instance, WmiQueryResult *result)
+    {
+        HRESULT hres = ResolveSchema(instance);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        result->reserve(result->size() + schema_->properties.size());
+        for (const PropertyHandle &property : schema_->properties)
+        {
+            // Properties that can't be read are reported as empty strings
+            WmiValue value(L"");
+            ReadProperty(instance, property, &value);
+            result->emplace_back(property.name, std::move(value));
+        }
+
+        return S_OK;
+    }
+
+    HRESULT InstanceReader::ReadProperty(
+        InstanceAccess *instance,
+        const PropertyHandle &property,
+        WmiValue *value)
+    {
+        VARIANT variant;
+        VariantInit(&variant);
+        CIMTYPE cim_type = property.cim_type;
+        HRESULT hres = S_FALSE;
+
+        // Read* report null properties with a success code other than S_OK, those fall back to Get
+        if (property.read == PropertyHandle::kDword)
+        {
+            uint32_t dword = 0;
+            hres = instance->ReadDWORD(property.handle, &dword);
+            if (hres == S_OK && cim_type == CIM_REAL32)
+            {
+                variant.vt = VT_R4;
+                std::memcpy(&variant.fltVal, &dword, sizeof(dword));
+            }
+            else if (hres == S_OK)
+            {
+                variant.vt = VT_I4;
+                variant.lVal = static_cast<LONG>(dword);
+            }
+        }
+        else if (property.read == PropertyHandle::kQword)
+        {
+            uint64_t qword = 0;
+            hres = instance->ReadQWORD(property.handle, &qword);
+            if (hres == S_OK && cim_type == CIM_REAL64)
+            {
+                variant.vt = VT_R8;
+                std::memcpy(&variant.dblVal, &qword, sizeof(qword));
+            }
+            else if (hres == S_OK && cim_type == CIM_SINT64)
+            {
+                variant.vt = VT_I8;
+                variant.llVal = static_cast<int64_t>(qword);
+            }
+            else if (hres == S_OK)
+            {
+                variant.vt = VT_UI8;
+                variant.ullVal = qword;
+            }
+        }
+
+        if (hres == S_OK)
+        {
+            handle_reads_++;
+        }
+        else
+        {
+            named_reads_++;
+            hres = instance->Get(property.name, &variant, &cim_type);
+        }
+
+        if (SUCCEEDED(hres))
+        {
+            hres = ConvertPropertyValue(variant, cim_type, options_, value);
+        }
+        VariantClear(&variant);
+        return hres;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+#include "variant_conversion.h"
+
+namespace wmi_wrapper
+{
+
+    class TypedClassReader;
+
+    /**
+     * Read access to the properties of one instance, shaped after IWbemClassObject and
+     * IWbemObjectAccess so property handles can be resolved once and reused for every
+     * instance of the same class.
+     */
+    class InstanceAccess
+    {
+    public:
+        virtual ~InstanceAccess() {}
+
+        virtual HRESULT GetClassName(std::wstring *class_name) = 0;
+
+        // Names of every property of the instance, used when no property list is given
+        virtual HRESULT GetNames(std::vector<std::wstring> *names) = 0;
+
+        virtual HRESULT GetPropertyHandle(const std::wstring &property, CIMTYPE *cim_type, long *handle) = 0;
+        virtual HRESULT ReadDWORD(long handle, uint32_t *value) = 0;
+        virtual HRESULT ReadQWORD(long handle, uint64_t *value) = 0;
+
+        // Reads a property by name, the caller clears the VARIANT
+        virtual HRESULT Get(const std::wstring &property, VARIANT *variant, CIMTYPE *cim_type) = 0;
+    };
+
+    /**
+     * How one property of a class is read
+     */
+    struct PropertyHandle
+    {
+        enum Read
+        {
+            kByName, // IWbemClassObject::Get, for types without a fixed size representation
+            kDword,  // ReadDWORD, 32 bit integers and real32
+            kQword   // ReadQWORD, 64 bit integers and real64
+        };
+
+        std::wstring name;
+        CIMTYPE cim_type = CIM_EMPTY;
+        long handle = 0;
+        Read read = kByName;
+    };
+
+    struct ClassSchema
+    {
+        std::vector<PropertyHandle> properties;
+    };
+
+    struct PropertyHandleCacheStats
+    {
+        uint64_t hits = 0;          // Schemas found in the cache
+        uint64_t misses = 0;        // Schemas resolved through GetPropertyHandle
+        uint64_t invalidations = 0; // Namespaces dropped because their connection was replaced
+        uint64_t handle_reads = 0;  // Property values read through a handle
+        uint64_t named_reads = 0;   // Property values read by name
+        uint64_t cached_schemas = 0;
+    };
+
+    /**
+     * Process-wide cache of resolved property handles keyed by namespace, class and property list.
+     *
+     * Handles stay valid as long as the class definition doesn't change, so the schemas of a
+     * namespace are dropped whenever its connection is replaced. All methods are thread safe.
+     */
+    class PropertyHandleCache
+    {
+    public:
+        explicit PropertyHandleCache(size_t max_schemas = 256);
+
+        /**
+         * Returns the schema for reading properties from instances of class_name, resolving the
+         * handles through instance on a miss
+         *
+         * @param selection Select list of the query, instances of a projection are laid out
+         *                  differently from full instances so their handles are kept apart
+         * @param properties Properties to read, an empty list reads every property of the instance
+         */
+        std::shared_ptr<const ClassSchema> GetSchema(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::wstring &selection,
+            const std::vector<std::wstring> &properties,
+            InstanceAccess *instance);
+
+        /**
+         * Drops the schemas of a namespace, called when a new connection to it is opened
+         */
+        void Invalidate(const std::string &wmi_namespace);
+
+        void Clear();
+
+        void AddReads(uint64_t handle_reads, uint64_t named_reads);
+
+        PropertyHandleCacheStats GetStats();
+
+    private:
+        std::mutex mutex_;
+        size_t max_schemas_;
+        size_t schema_count_;
+        std::map<std::string, std::map<std::wstring, std::shared_ptr<const ClassSchema>>> schemas_;
+        PropertyHandleCacheStats stats_;
+    };
+
+    /**
+     * Resolves the schema of a property list without any handles, every property is read by name
+     */
+    ClassSchema GetNamedSchema(const std::vector<std::wstring> &properties);
+
+    /**
+     * Reads the properties of the instances returned by one query. The schema of the last seen
+     * class is kept, so the cache is only consulted when the class of the instances changes.
+     * Queries of a typed class (QueryOptions::typed_class) are read by the extractor of the class.
+     */
+    class InstanceReader
+    {
+    public:
+        /**
+         * @param cache Cache to take property handles from, NULL reads every property by name
+         */
+        InstanceReader(
+            PropertyHandleCache *cache,
+            const std::string &wmi_namespace,
+            const std::wstring &query,
+            const std::vector<std::wstring> &properties,
+            const QueryOptions &options);
+
+        ~InstanceReader();
+
+        // Adds the instance to results, property names are shared with the other instances of its class
+        HRESULT Read(InstanceAccess *instance, ResultSet *results);
+        HRESULT Read(InstanceAccess *instance, WmiQueryResult *result);
+
+    private:
+        HRESULT ResolveSchema(InstanceAccess *instance);
+        HRESULT ReadProperty(InstanceAccess *instance, const PropertyHandle &property, WmiValue *value);
+
+        PropertyHandleCache *cache_;
+        std::string wmi_namespace_;
+        std::wstring selection_;
+        const std::vector<std::wstring> &properties_;
+        const QueryOptions &options_;
+
+        std::wstring class_name_;
+        std::shared_ptr<const ClassSchema> schema_;
+        std::shared_ptr<const ClassSchema> named_schema_; // The schema names_ was taken from
+        std::shared_ptr<const ResultSet::Schema> names_;  // Property names shared by the instances of the schema
+        WmiValue value_;                                  // Reused for every value read into a ResultSet
+
+        uint64_t handle_reads_;
+        uint64_t named_reads_;
+
+        std::unique_ptr<TypedClassReader> typed_reader_; // Set for queries of a typed class
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "query_batch.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "connection_pool.h"
+
+namespace wmi_wrapper
+{
+
+    void RunBatchQuery(
+        QueryProvider *provider,
+        BatchQuery *query)
+    {
+        query->hres = provider->Query(query->wmi_namespace, query->params, query->options, &query->results);
+        CountQueryResults(query->results, query->options);
+        if (SUCCEEDED(query->hres) && query->options.aggregate)
+        {
+            StageTimer timer(query->options.timings);
+            ResultSet results = std::move(query->results);
+            HRESULT aggregate_hres = AggregateResults(results, *query->options.aggregate, &query->aggregated);
+            timer.Lap(kMarshalStage);
+            if (FAILED(aggregate_hres))
+            {
+                query->hres = aggregate_hres;
+            }
+        }
+        else if (SUCCEEDED(query->hres) && query->options.columnar)
+        {
+            StageTimer timer(query->options.timings);
+            HRESULT columnar_hres = BuildColumnarResults(std::move(query->results), query->options, &query->columnar);
+            timer.Lap(kMarshalStage);
+            // Keeps the code of a query stopped at a limit
+            if (FAILED(columnar_hres))
+            {
+                query->hres = columnar_hres;
+            }
+        }
+    }
+
+    void RunQueryBatch(
+        QueryProvider *provider,
+        std::vector<BatchQuery> *queries,
+        size_t concurrency)
+    {
+        if (queries->empty())
+        {
+            return;
+        }
+
+        std::map<std::string, std::vector<size_t>> groups;
+        for (size_t i = 0; i < queries->size(); ++i)
+        {
+            groups[GetPoolKey((*queries)[i].wmi_namespace)].push_back(i);
+        }
+
+        // The first query of every group is ready, it releases the rest of its group when done
+        std::deque<size_t> ready;
+        std::vector<const std::vector<size_t> *> released_by(queries->size(), NULL);
+        for (const auto &group : groups)
+        {
+            ready.push_back(group.second.front());
+            released_by[group.second.front()] = &group.second;
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t remaining = queries->size();
+
+        auto run_queries = [&]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                changed.wait(lock, [&]()
+                             { return !ready.empty() || remaining == 0; });
+                if (ready.empty())
+                {
+                    return;
+                }
+
+                size_t index = ready.front();
+                ready.pop_front();
+                lock.unlock();
+
+                RunBatchQuery(provider, &(*queries)[index]);
+
+                lock.lock();
+                --remaining;
+                const std::vector<size_t> *group = released_by[index];
+                if (group != NULL)
+                {
+                    ready.insert(ready.end(), group->begin() + 1, group->end());
+                }
+                if (remaining == 0 || (group != NULL && group->size() > 1))
+                {
+                    changed.notify_all();
+                }
+            }
+        };
+
+        size_t thread_count = std::min(std::max<size_t>(concurrency, 1), queries->size());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            threads.emplace_back(run_queries);
+        }
+        run_queries();
+
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+}
\ No newline at end of file
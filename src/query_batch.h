@@ -0,0 +1,67 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "aggregation.h"
+#include "columnar_results.h"
+#include "query_provider.h"
+#include "query_stats.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * One query of a queryMany batch and, once the batch ran, its outcome
+     */
+    struct BatchQuery
+    {
+        std::string wmi_namespace;
+        WmiQueryParams params;
+        QueryOptions options;
+        QueryTimings timings; // options.timings points here while the query is timed
+
+        HRESULT hres = S_OK;
+        ResultSet results; // Moved into columnar when options.columnar is set, released when options.aggregate is
+        ColumnarResults columnar; // Only when options.columnar is set
+        AggregatedResults aggregated; // Only when options.aggregate is set
+    };
+
+    /**
+     * Runs a batch of independent queries on up to concurrency threads, including the calling thread.
+     *
+     * Queries are grouped by namespace. The first query of a namespace runs before the rest of its
+     * group, so it is the only one that opens the namespace's pooled connection and the others
+     * share it. Queries of different namespaces run concurrently right away.
+     */
+    void RunQueryBatch(
+        QueryProvider *provider,
+        std::vector<BatchQuery> *queries,
+        size_t concurrency);
+
+};
\ No newline at end of file
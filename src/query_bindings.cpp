@@ -0,0 +1,1288 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "query_bindings.h"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <napi.h>
+
+#include "abort_signal.h"
+#include "addon_data.h"
+#include "aggregation.h"
+#include "cache_bindings.h"
+#include "class_descriptors.h"
+#include "columnar_results.h"
+#include "lazy_results.h"
+#include "marshalling.h"
+#include "namespaces.h"
+#include "pool_worker.h"
+#include "prepared_bindings.h"
+#include "prepared_query.h"
+#include "query_batch.h"
+#include "query_provider.h"
+#include "query_recording.h"
+#include "query_stream.h"
+#include "recording_bindings.h"
+#include "sampler.h"
+#include "snapshot_bindings.h"
+#include "stats_bindings.h"
+#include "subscription.h"
+#include "worker_bindings.h"
+
+namespace wmi_wrapper
+{
+
+    const char kUnsupportedOsMessage[] = "This OS is not supported.";
+
+    // Largest integer a JavaScript number holds exactly
+    const double kMaxSafeInteger = 9007199254740991.0;
+
+    std::string GetQueryErrorMessage(
+        HRESULT hres)
+    {
+        if (hres == kAggregateTypeMismatch)
+        {
+            return "Aggregate function does not apply to the values of its property";
+        }
+        if (hres == kAggregatePropertyMissing)
+        {
+            return "Aggregated property is not in the results";
+        }
+        if (hres == kQueryNotRecorded)
+        {
+            return "Query is not in the replayed recording";
+        }
+        if (hres == kTypedClassMismatch)
+        {
+            return "Property does not have the CIM type of its typed class";
+        }
+        std::string hresStr = std::to_string(hres);
+        return "Query failed with error code: " + hresStr;
+    }
+
+    /**
+     * Runs queryAsync, queryTyped and the runAsync of a prepared query. Waits for a worker thread in
+     * the order of its priority, without holding a thread of the libuv pool meanwhile.
+     */
+    class QueryWorker : public PoolWorker
+    {
+    public:
+        QueryWorker(
+            Napi::Env env,
+            QueryProvider *provider,
+            std::string wmi_namespace,
+            WmiQueryParams params,
+            const QueryOptions &options,
+            AbortListener abort)
+            : PoolWorker(env, "wmi_native_module:queryAsync"),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              provider_(provider),
+              wmi_namespace_(std::move(wmi_namespace)),
+              params_(std::move(params)),
+              options_(options),
+              abort_(std::move(abort))
+        {
+            StartQueryTimings(&options_, &timings_);
+            queued_ = StageTimer(options_.timings);
+        }
+
+        // Runs a prepared query, which the worker keeps alive instead of copying its namespace and query
+        QueryWorker(
+            Napi::Env env,
+            QueryProvider *provider,
+            std::shared_ptr<const PreparedQuery> prepared,
+            const QueryOptions &options,
+            AbortListener abort)
+            : PoolWorker(env, "wmi_native_module:runAsync"),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              provider_(provider),
+              prepared_(std::move(prepared)),
+              options_(options),
+              abort_(std::move(abort))
+        {
+            options_.prepared = prepared_.get();
+            StartQueryTimings(&options_, &timings_);
+            queued_ = StageTimer(options_.timings);
+        }
+
+        Napi::Promise GetPromise() const
+        {
+            return deferred_.Promise();
+        }
+
+        void Queue()
+        {
+            PoolWorker::Queue(provider_->GetWorkerPool(), options_.priority);
+        }
+
+    protected:
+        void Execute(HRESULT thread_status) override
+        {
+            // The query runs on this thread, the provider doesn't queue it again
+            queued_.Lap(kQueueStage);
+            hres_ = SUCCEEDED(thread_status) ? provider_->Query(GetNamespace(), GetParams(), options_, &results_) : thread_status;
+            CountQueryResults(results_, options_);
+            if (SUCCEEDED(hres_) && options_.aggregate)
+            {
+                // Only the aggregate is kept, the results are released right away
+                StageTimer timer(options_.timings);
+                ResultSet results = std::move(results_);
+                HRESULT aggregate_hres = AggregateResults(results, *options_.aggregate, &aggregated_);
+                timer.Lap(kMarshalStage);
+                if (FAILED(aggregate_hres))
+                {
+                    hres_ = aggregate_hres;
+                }
+            }
+            else if (SUCCEEDED(hres_) && options_.columnar)
+            {
+                // Pivoting doesn't need the JavaScript thread, only wrapping the columns does
+                StageTimer timer(options_.timings);
+                HRESULT columnar_hres = BuildColumnarResults(std::move(results_), options_, &columnar_);
+                timer.Lap(kMarshalStage);
+                // Keeps the code of a query stopped at a limit
+                if (FAILED(columnar_hres))
+                {
+                    hres_ = columnar_hres;
+                }
+            }
+            if (FAILED(hres_))
+            {
+                SetError(GetQueryErrorMessage(hres_));
+            }
+        }
+
+        void OnOK() override
+        {
+            StageTimer timer(options_.timings);
+            Napi::Value results = options_.aggregate      ? ConvertAggregatedResults(aggregated_, *options_.aggregate, options_, Env())
+                                  : options_.columnar     ? ConvertColumnarResults(std::move(columnar_), options_, Env())
+                                  : options_.lazy_objects ? ConvertLazyResults(std::move(results_), options_, Env())
+                                                          : ConvertResultsObject(results_, options_, Env());
+            timer.Lap(kMarshalStage);
+            FinishQueryTimings(GetNamespace(), GetParams(), hres_, options_, results);
+            MarkLimitedResults(hres_, results);
+            abort_.Stop();
+            deferred_.Resolve(results);
+        }
+
+        void OnError(const Napi::Error &error) override
+        {
+            FinishQueryTimings(GetNamespace(), GetParams(), hres_, options_, Env().Undefined());
+            abort_.Stop();
+            deferred_.Reject(hres_ == kQueryCancelled ? abort_.GetReason(Env()) : error.Value());
+        }
+
+        void OnEnvCleanup() override
+        {
+            abort_.Release();
+        }
+
+    private:
+        const std::string &GetNamespace() const
+        {
+            return prepared_ ? prepared_->GetNamespace() : wmi_namespace_;
+        }
+
+        const WmiQueryParams &GetParams() const
+        {
+            return prepared_ ? prepared_->GetParams() : params_;
+        }
+
+        Napi::Promise::Deferred deferred_;
+        QueryProvider *provider_;
+        std::shared_ptr<const PreparedQuery> prepared_; // NULL for queries that aren't prepared
+        std::string wmi_namespace_;
+        WmiQueryParams params_;
+        QueryOptions options_;
+        QueryTimings timings_;
+        StageTimer queued_ = StageTimer(NULL); // Time waiting for a worker thread
+        AbortListener abort_;
+        HRESULT hres_ = S_OK;
+        ResultSet results_;
+        ColumnarResults columnar_;
+        AggregatedResults aggregated_;
+    };
+
+    bool CheckNamespace(
+        Napi::String wmi_namespace)
+    {
+        if (!namespaces::IsSupportedNamespace(wmi_namespace))
+        {
+            Napi::Error::New(wmi_namespace.Env(), "Unsupported Namespace").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+    bool ParseQueryArguments(
+        const Napi::CallbackInfo &info,
+        std::string *wmi_namespace,
+        WmiQueryParams *params,
+        Napi::Object *options)
+    {
+        const size_t kNamespaceParam = 0;
+        const size_t kQueryParam = 1;
+        const size_t kPropertiesParam = 2; // optional
+        const size_t kOptionsParam = 3;    // optional, only where options are accepted
+
+        const size_t kMinRequiredParamCount = 2;
+        const size_t kMaxAllowedParams = options != NULL ? 4 : 3;
+
+        Napi::Env env = info.Env();
+        if (info.Length() < kMinRequiredParamCount || info.Length() > kMaxAllowedParams)
+        {
+            // Too few or too many parameters passed
+            Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (!info[kNamespaceParam].IsString() || !info[kQueryParam].IsString())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::String namespace_value = info[kNamespaceParam].As<Napi::String>();
+        if (!CheckNamespace(namespace_value))
+        {
+            return false;
+        }
+
+        Napi::String query = info[kQueryParam].As<Napi::String>();
+
+        Napi::Array properties = Napi::Array::New(env);
+
+        // Properties param is optional, it may be left undefined when options follow
+        bool has_options = options != NULL && info.Length() > kOptionsParam;
+        if (info.Length() > kPropertiesParam && !(has_options && info[kPropertiesParam].IsUndefined()))
+        {
+            // If specific properties are requested, they must be passed as an array
+            if (info[kPropertiesParam].IsArray())
+            {
+                properties = info[kPropertiesParam].As<Napi::Array>();
+            }
+            else
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        if (options != NULL)
+        {
+            *options = Napi::Object::New(env);
+            if (has_options && !info[kOptionsParam].IsUndefined())
+            {
+                if (!info[kOptionsParam].IsObject())
+                {
+                    Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                    return false;
+                }
+                *options = info[kOptionsParam].As<Napi::Object>();
+            }
+        }
+
+        *params = GetWstrParams(query, properties, env);
+        if (env.IsExceptionPending())
+        {
+            return false;
+        }
+
+        *wmi_namespace = namespace_value.Utf8Value();
+        return true;
+    }
+
+    bool ReadStringOption(
+        Napi::Object options,
+        const char *name,
+        const char *first_choice,
+        const char *second_choice,
+        bool *is_first_choice)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+
+        std::string choice = option.IsString() ? option.As<Napi::String>().Utf8Value() : std::string();
+        if (choice != first_choice && choice != second_choice)
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *is_first_choice = choice == first_choice;
+        return true;
+    }
+
+    bool ReadLimitOption(
+        Napi::Object options,
+        const char *name,
+        double max_value,
+        uint64_t *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+
+        double limit = option.IsNumber() ? option.As<Napi::Number>().DoubleValue() : -1;
+        if (!(limit >= 0 && limit <= max_value))
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *value = static_cast<uint64_t>(limit);
+        return true;
+    }
+
+    bool ReadAggregateProperty(
+        Napi::Value value,
+        std::wstring *property)
+    {
+        if (!value.IsString() || value.As<Napi::String>().Utf8Value().empty())
+        {
+            return false;
+        }
+        *property = ConvertStringToWstring(value.As<Napi::String>().Utf8Value());
+        return true;
+    }
+
+    bool ReadConditionOperator(
+        Napi::Value value,
+        AggregateCondition::Operator *op)
+    {
+        static const std::pair<const char *, AggregateCondition::Operator> kOperators[] = {
+            {"=", AggregateCondition::kEqual},
+            {"!=", AggregateCondition::kNotEqual},
+            {"<>", AggregateCondition::kNotEqual},
+            {"<", AggregateCondition::kLess},
+            {"<=", AggregateCondition::kLessOrEqual},
+            {">", AggregateCondition::kGreater},
+            {">=", AggregateCondition::kGreaterOrEqual}};
+
+        std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        for (const auto &entry : kOperators)
+        {
+            if (name == entry.first)
+            {
+                *op = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Converts the value of a condition, given as a number, BigInt, string, boolean, Date or null
+    bool ReadConditionValue(
+        Napi::Value value,
+        WmiValue *condition_value)
+    {
+        if (value.IsNull())
+        {
+            return true;
+        }
+        if (value.IsNumber())
+        {
+            condition_value->type = WmiValue::kReal;
+            condition_value->size = 8;
+            condition_value->real_value = value.As<Napi::Number>().DoubleValue();
+            return true;
+        }
+        if (value.IsBigInt())
+        {
+            bool lossless = false;
+            int64_t signed_value = value.As<Napi::BigInt>().Int64Value(&lossless);
+            condition_value->size = 8;
+            if (lossless && signed_value < 0)
+            {
+                condition_value->type = WmiValue::kSigned;
+                condition_value->signed_value = signed_value;
+                return true;
+            }
+            condition_value->type = WmiValue::kUnsigned;
+            condition_value->unsigned_value = value.As<Napi::BigInt>().Uint64Value(&lossless);
+            return lossless;
+        }
+        if (value.IsString())
+        {
+            *condition_value = WmiValue(ConvertStringToWstring(value.As<Napi::String>().Utf8Value()));
+            return true;
+        }
+        if (value.IsBoolean())
+        {
+            condition_value->type = WmiValue::kBoolean;
+            condition_value->boolean_value = value.As<Napi::Boolean>().Value();
+            return true;
+        }
+        if (value.IsDate())
+        {
+            condition_value->type = WmiValue::kDateTime;
+            condition_value->real_value = value.As<Napi::Date>().ValueOf();
+            return true;
+        }
+        return false;
+    }
+
+    bool ReadAggregateFunction(
+        Napi::Value value,
+        AggregateOutput::Function *function)
+    {
+        static const std::pair<const char *, AggregateOutput::Function> kFunctions[] = {
+            {"count", AggregateOutput::kCount},
+            {"sum", AggregateOutput::kSum},
+            {"min", AggregateOutput::kMin},
+            {"max", AggregateOutput::kMax},
+            {"avg", AggregateOutput::kAvg}};
+
+        std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : std::string();
+        for (const auto &entry : kFunctions)
+        {
+            if (name == entry.first)
+            {
+                *function = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Reads the aggregate option: { where?: [{ property, op, value }], groupBy?: string | string[],
+     * values: { [name]: { op, property? } } }
+     *
+     * @return true when the option is valid or not set, otherwise a JavaScript exception is pending
+     */
+    bool ParseAggregateOption(
+        Napi::Object options,
+        QueryOptions *query_options)
+    {
+        Napi::Value option = options.Get("aggregate");
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+
+        Napi::Env env = options.Env();
+        std::shared_ptr<AggregateSpec> spec = std::make_shared<AggregateSpec>();
+        bool valid = option.IsObject() && !option.IsArray();
+
+        Napi::Value where = valid ? option.As<Napi::Object>().Get("where") : env.Undefined();
+        if (valid && !where.IsUndefined())
+        {
+            valid = where.IsArray();
+            Napi::Array conditions = valid ? where.As<Napi::Array>() : Napi::Array::New(env);
+            for (uint32_t i = 0; valid && i < conditions.Length(); ++i)
+            {
+                Napi::Value entry = conditions[i];
+                AggregateCondition condition;
+                valid = entry.IsObject() &&
+                        ReadAggregateProperty(entry.As<Napi::Object>().Get("property"), &condition.property) &&
+                        ReadConditionOperator(entry.As<Napi::Object>().Get("op"), &condition.op) &&
+                        ReadConditionValue(entry.As<Napi::Object>().Get("value"), &condition.value);
+                spec->where.push_back(std::move(condition));
+            }
+        }
+
+        Napi::Value group_by = valid ? option.As<Napi::Object>().Get("groupBy") : env.Undefined();
+        if (valid && group_by.IsString())
+        {
+            spec->group_by.emplace_back();
+            valid = ReadAggregateProperty(group_by, &spec->group_by.back());
+        }
+        else if (valid && !group_by.IsUndefined())
+        {
+            valid = group_by.IsArray();
+            Napi::Array properties = valid ? group_by.As<Napi::Array>() : Napi::Array::New(env);
+            for (uint32_t i = 0; valid && i < properties.Length(); ++i)
+            {
+                spec->group_by.emplace_back();
+                valid = ReadAggregateProperty(properties[i], &spec->group_by.back());
+            }
+        }
+
+        // Every aggregation computes at least one value, count is the only one that needs no property
+        Napi::Value values = valid ? option.As<Napi::Object>().Get("values") : env.Undefined();
+        valid = valid && values.IsObject() && !values.IsArray();
+        Napi::Array names = valid ? values.As<Napi::Object>().GetPropertyNames() : Napi::Array::New(env);
+        valid = valid && names.Length() > 0;
+        for (uint32_t i = 0; valid && i < names.Length(); ++i)
+        {
+            Napi::Value name = names[i];
+            Napi::Value entry = values.As<Napi::Object>().Get(name);
+            AggregateOutput output;
+            output.name = name.ToString().Utf8Value();
+            valid = entry.IsObject() && ReadAggregateFunction(entry.As<Napi::Object>().Get("op"), &output.function);
+            if (valid)
+            {
+                Napi::Value property = entry.As<Napi::Object>().Get("property");
+                valid = (property.IsUndefined() && output.function == AggregateOutput::kCount) ||
+                        ReadAggregateProperty(property, &output.property);
+            }
+            spec->outputs.push_back(std::move(output));
+        }
+
+        if (!valid)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        query_options->aggregate = std::move(spec);
+        return true;
+    }
+
+    void UseAggregateProperties(
+        const QueryOptions &options,
+        std::vector<std::wstring> *properties)
+    {
+        if (!options.aggregate)
+        {
+            return;
+        }
+        std::vector<std::wstring> aggregated = options.aggregate->GetProperties();
+        if (!aggregated.empty())
+        {
+            *properties = std::move(aggregated);
+        }
+    }
+
+    bool ParseQueryOptions(
+        Napi::Object options,
+        QueryOptions *query_options)
+    {
+        Napi::Value typed = options.Get("typed");
+        if (!typed.IsUndefined())
+        {
+            if (!typed.IsBoolean())
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            query_options->typed_values = typed.As<Napi::Boolean>().Value();
+        }
+
+        Napi::Value cache_ttl = options.Get("cacheTtlMs");
+        if (!cache_ttl.IsUndefined())
+        {
+            double ttl_ms = cache_ttl.IsNumber() ? cache_ttl.As<Napi::Number>().DoubleValue() : -1;
+            if (!(ttl_ms >= 0 && ttl_ms <= std::numeric_limits<uint32_t>::max()))
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            query_options->cache_ttl_ms = static_cast<int64_t>(ttl_ms);
+        }
+
+        Napi::Value priority = options.Get("priority");
+        if (!priority.IsUndefined())
+        {
+            std::string choice = priority.IsString() ? priority.As<Napi::String>().Utf8Value() : std::string();
+            if (choice == "high")
+            {
+                query_options->priority = kHighPriority;
+            }
+            else if (choice == "normal")
+            {
+                query_options->priority = kNormalPriority;
+            }
+            else if (choice == "low")
+            {
+                query_options->priority = kLowPriority;
+            }
+            else
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+        }
+
+        Napi::Value timings = options.Get("timings");
+        if (!timings.IsUndefined())
+        {
+            if (!timings.IsBoolean())
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            query_options->report_timings = timings.As<Napi::Boolean>().Value();
+        }
+
+        Napi::Value lazy = options.Get("lazy");
+        if (!lazy.IsUndefined())
+        {
+            if (!lazy.IsBoolean())
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            query_options->lazy_objects = lazy.As<Napi::Boolean>().Value();
+        }
+
+        Napi::Value partial_instances = options.Get("partialInstances");
+        if (!partial_instances.IsUndefined())
+        {
+            if (!partial_instances.IsBoolean())
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            query_options->partial_instances = partial_instances.As<Napi::Boolean>().Value();
+        }
+
+        // The timeout stays below WBEM_INFINITE, which Next takes as no timeout
+        uint64_t timeout_ms = query_options->timeout_ms;
+        if (!ReadLimitOption(options, "timeoutMs", std::numeric_limits<uint32_t>::max() - 1, &timeout_ms) ||
+            !ReadLimitOption(options, "maxRows", kMaxSafeInteger, &query_options->max_rows) ||
+            !ReadLimitOption(options, "maxBytes", kMaxSafeInteger, &query_options->max_bytes))
+        {
+            return false;
+        }
+        query_options->timeout_ms = static_cast<uint32_t>(timeout_ms);
+
+        if (!ParseAggregateOption(options, query_options))
+        {
+            return false;
+        }
+        // Sums and comparisons need the values with their CIM types
+        if (query_options->aggregate)
+        {
+            query_options->typed_values = true;
+        }
+
+        if (!ReadStringOption(options, "int64", "bigint", "number", &query_options->int64_as_bigint) ||
+            !ReadStringOption(options, "datetime", "date", "number", &query_options->datetime_as_date) ||
+            !ReadStringOption(options, "format", "columnar", "rows", &query_options->columnar))
+        {
+            return false;
+        }
+
+        // Lazy instances are rows, columns and aggregates convert what they return all at once
+        if (query_options->lazy_objects && (query_options->columnar || query_options->aggregate))
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+    void MarkLimitedResults(
+        HRESULT hres,
+        Napi::Value results)
+    {
+        const char *limit = hres == kQueryTimedOut ? "timeout"
+                            : hres == kQueryMaxRows ? "maxRows"
+                            : hres == kQueryMaxBytes ? "maxBytes"
+                                                      : NULL;
+        // Kept out of enumeration like timings
+        if (limit != NULL && results.IsObject())
+        {
+            results.As<Napi::Object>().DefineProperty(
+                Napi::PropertyDescriptor::Value("truncated", Napi::String::New(results.Env(), limit), napi_default));
+        }
+    }
+
+    Napi::Value RunQuery(
+        Napi::Env env,
+        QueryProvider *provider,
+        const std::string &wmi_namespace,
+        const WmiQueryParams &wstr_params,
+        QueryOptions query_options)
+    {
+        QueryTimings timings;
+        StartQueryTimings(&query_options, &timings);
+
+        // The JavaScript thread waits for the query, it doesn't queue behind asynchronous ones
+        query_options.priority = kSynchronousPriority;
+        ResultSet results;
+        HRESULT hres = provider->Query(wmi_namespace, wstr_params, query_options, &results);
+        CountQueryResults(results, query_options);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+        }
+
+        StageTimer timer(query_options.timings);
+        Napi::Value converted;
+        if (query_options.aggregate)
+        {
+            AggregatedResults aggregated;
+            HRESULT aggregate_hres = AggregateResults(results, *query_options.aggregate, &aggregated);
+            if (FAILED(aggregate_hres))
+            {
+                FinishQueryTimings(wmi_namespace, wstr_params, aggregate_hres, query_options, env.Undefined());
+                Napi::Error::New(env, GetQueryErrorMessage(aggregate_hres)).ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            converted = ConvertAggregatedResults(aggregated, *query_options.aggregate, query_options, env);
+        }
+        else if (query_options.columnar)
+        {
+            ColumnarResults columnar;
+            HRESULT columnar_hres = BuildColumnarResults(std::move(results), query_options, &columnar);
+            if (FAILED(columnar_hres))
+            {
+                FinishQueryTimings(wmi_namespace, wstr_params, columnar_hres, query_options, env.Undefined());
+                Napi::Error::New(env, GetQueryErrorMessage(columnar_hres)).ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            converted = ConvertColumnarResults(std::move(columnar), query_options, env);
+        }
+        else if (query_options.lazy_objects)
+        {
+            converted = ConvertLazyResults(std::move(results), query_options, env);
+        }
+        else
+        {
+            converted = ConvertResultsObject(results, query_options, env);
+        }
+        timer.Lap(kMarshalStage);
+        FinishQueryTimings(wmi_namespace, wstr_params, hres, query_options, converted);
+        MarkLimitedResults(hres, converted);
+        return converted;
+    }
+
+    Napi::Value WmiQuery(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return Napi::Object::New(env);
+        }
+
+        std::string wmi_namespace;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        if (!ParseQueryArguments(info, &wmi_namespace, &wstr_params, &options) ||
+            !ParseQueryOptions(options, &query_options) ||
+            !CheckNotAborted(options))
+        {
+            return env.Null();
+        }
+        UseAggregateProperties(query_options, &wstr_params.second);
+
+        return RunQuery(env, provider, wmi_namespace, wstr_params, query_options);
+    }
+
+    Napi::Value WmiQueryAsync(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(Napi::Error::New(env, kUnsupportedOsMessage).Value());
+            return deferred.Promise();
+        }
+
+        std::string wmi_namespace;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        AbortListener abort;
+        if (!ParseQueryArguments(info, &wmi_namespace, &wstr_params, &options) ||
+            !ParseQueryOptions(options, &query_options) ||
+            !abort.Listen(options, &query_options))
+        {
+            // Argument errors are reported through the Promise like any other failure
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(env.GetAndClearPendingException().Value());
+            return deferred.Promise();
+        }
+
+        // A query aborted before it was queued isn't queued
+        if (abort.IsAborted())
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(abort.GetReason(env));
+            return deferred.Promise();
+        }
+        UseAggregateProperties(query_options, &wstr_params.second);
+
+        // The worker deletes itself once the Promise has been settled
+        QueryWorker *worker = new QueryWorker(env, provider, std::move(wmi_namespace), std::move(wstr_params), query_options, std::move(abort));
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    bool ParseTypedQueryArguments(
+        const Napi::CallbackInfo &info,
+        const TypedClass **typed_class,
+        WmiQueryParams *params,
+        Napi::Object *options)
+    {
+        const size_t kClassParam = 0;
+        const size_t kFilterParam = 1;  // optional
+        const size_t kOptionsParam = 2; // optional
+
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || info.Length() > 3)
+        {
+            Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        if (!info[kClassParam].IsString() ||
+            (info.Length() > kFilterParam && !info[kFilterParam].IsString() && !info[kFilterParam].IsUndefined()) ||
+            (info.Length() > kOptionsParam && !info[kOptionsParam].IsObject() && !info[kOptionsParam].IsUndefined()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        *typed_class = FindTypedClass(ConvertStringToWstring(info[kClassParam].As<Napi::String>().Utf8Value()));
+        if (*typed_class == NULL)
+        {
+            Napi::Error::New(env, "Unsupported Class").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        // The select list is the property list of the descriptor, which the extractor reads in order
+        std::wstring query = L"SELECT ";
+        const std::vector<std::wstring> &properties = (*typed_class)->GetPropertyNames();
+        for (size_t i = 0; i < properties.size(); ++i)
+        {
+            query += i == 0 ? L"" : L", ";
+            query += properties[i];
+        }
+        query += L" FROM ";
+        query += (*typed_class)->GetClassName();
+        if (info.Length() > kFilterParam && info[kFilterParam].IsString())
+        {
+            std::wstring filter = ConvertStringToWstring(info[kFilterParam].As<Napi::String>().Utf8Value());
+            if (!filter.empty())
+            {
+                query += L" WHERE " + filter;
+            }
+        }
+        *params = WmiQueryParams(std::move(query), properties);
+
+        *options = info.Length() > kOptionsParam && info[kOptionsParam].IsObject() ? info[kOptionsParam].As<Napi::Object>()
+                                                                                  : Napi::Object::New(env);
+        return true;
+    }
+
+    Napi::Value WmiQueryTyped(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(Napi::Error::New(env, kUnsupportedOsMessage).Value());
+            return deferred.Promise();
+        }
+
+        const TypedClass *typed_class = NULL;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        AbortListener abort;
+        bool parsed = ParseTypedQueryArguments(info, &typed_class, &wstr_params, &options) &&
+                      ParseQueryOptions(options, &query_options) &&
+                      abort.Listen(options, &query_options);
+        // Typed queries return rows of the declared shape
+        if (parsed && (query_options.columnar || query_options.aggregate))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            parsed = false;
+        }
+        if (!parsed)
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(env.GetAndClearPendingException().Value());
+            return deferred.Promise();
+        }
+
+        if (abort.IsAborted())
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(abort.GetReason(env));
+            return deferred.Promise();
+        }
+        query_options.typed_values = true;
+        query_options.typed_class = typed_class;
+
+        // The worker deletes itself once the Promise has been settled
+        QueryWorker *worker = new QueryWorker(env, provider, typed_class->GetNamespace(), std::move(wstr_params), query_options, std::move(abort));
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    Napi::Promise QueueQuery(
+        Napi::Env env,
+        QueryProvider *provider,
+        std::shared_ptr<const PreparedQuery> prepared,
+        const QueryOptions &options,
+        AbortListener abort)
+    {
+        if (abort.IsAborted())
+        {
+            Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+            deferred.Reject(abort.GetReason(env));
+            return deferred.Promise();
+        }
+
+        // The worker deletes itself once the Promise has been settled
+        QueryWorker *worker = new QueryWorker(env, provider, std::move(prepared), options, std::move(abort));
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    const uint32_t kDefaultBatchConcurrency = 4;
+    const uint32_t kMaxBatchConcurrency = 64;
+
+    class QueryManyWorker : public Napi::AsyncWorker
+    {
+    public:
+        QueryManyWorker(
+            Napi::Env env,
+            QueryProvider *provider,
+            std::vector<BatchQuery> queries,
+            std::vector<AbortListener> aborts,
+            std::vector<std::string> errors,
+            size_t concurrency,
+            AbortListener batch_abort)
+            : Napi::AsyncWorker(env, "wmi_native_module:queryMany"),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              provider_(provider),
+              queries_(std::move(queries)),
+              aborts_(std::move(aborts)),
+              errors_(std::move(errors)),
+              concurrency_(concurrency),
+              batch_abort_(std::move(batch_abort))
+        {
+        }
+
+        Napi::Promise GetPromise() const
+        {
+            return deferred_.Promise();
+        }
+
+    protected:
+        void Execute() override
+        {
+            for (BatchQuery &query : queries_)
+            {
+                StartQueryTimings(&query.options, &query.timings);
+            }
+            RunQueryBatch(provider_, &queries_, concurrency_);
+        }
+
+        void OnOK() override
+        {
+            Napi::Env env = Env();
+            StopListening();
+
+            // Aborting the batch rejects all of it, whatever its queries had read
+            if (batch_abort_.IsAborted())
+            {
+                deferred_.Reject(batch_abort_.GetReason(env));
+                return;
+            }
+
+            Napi::Array settled = Napi::Array::New(env, errors_.size());
+
+            // Requests that failed validation have an error and no query
+            size_t query_index = 0;
+            for (uint32_t i = 0; i < errors_.size(); ++i)
+            {
+                Napi::Object outcome = Napi::Object::New(env);
+                std::string error = errors_[i];
+                Napi::Value reason;
+                if (error.empty())
+                {
+                    size_t index = query_index++;
+                    BatchQuery &query = queries_[index];
+                    if (query.hres == kQueryCancelled)
+                    {
+                        reason = aborts_[index].GetReason(env);
+                        FinishQueryTimings(query.wmi_namespace, query.params, query.hres, query.options, env.Undefined());
+                    }
+                    else if (FAILED(query.hres))
+                    {
+                        error = GetQueryErrorMessage(query.hres);
+                        FinishQueryTimings(query.wmi_namespace, query.params, query.hres, query.options, env.Undefined());
+                    }
+                    else
+                    {
+                        StageTimer timer(query.options.timings);
+                        Napi::Value value = query.options.aggregate      ? ConvertAggregatedResults(query.aggregated, *query.options.aggregate, query.options, env)
+                                            : query.options.columnar     ? ConvertColumnarResults(std::move(query.columnar), query.options, env)
+                                            : query.options.lazy_objects ? ConvertLazyResults(std::move(query.results), query.options, env)
+                                                                         : ConvertResultsObject(query.results, query.options, env);
+                        timer.Lap(kMarshalStage);
+                        FinishQueryTimings(query.wmi_namespace, query.params, query.hres, query.options, value);
+                        MarkLimitedResults(query.hres, value);
+                        outcome.Set("status", "fulfilled");
+                        outcome.Set("value", value);
+                    }
+                }
+
+                if (!error.empty())
+                {
+                    reason = Napi::Error::New(env, error).Value();
+                }
+                if (!reason.IsEmpty())
+                {
+                    outcome.Set("status", "rejected");
+                    outcome.Set("reason", reason);
+                }
+                settled.Set(i, outcome);
+            }
+
+            deferred_.Resolve(settled);
+        }
+
+        void OnError(const Napi::Error &error) override
+        {
+            StopListening();
+            deferred_.Reject(error.Value());
+        }
+
+    private:
+        void StopListening()
+        {
+            for (AbortListener &abort : aborts_)
+            {
+                abort.Stop();
+            }
+            batch_abort_.Stop();
+        }
+
+        Napi::Promise::Deferred deferred_;
+        QueryProvider *provider_;
+        std::vector<BatchQuery> queries_;
+        std::vector<AbortListener> aborts_; // One per query, listening to the signal of its request
+        std::vector<std::string> errors_;
+        size_t concurrency_;
+        AbortListener batch_abort_;
+    };
+
+    /**
+     * Reads one request of a queryMany batch
+     *
+     * @param supported_namespaces Namespaces already checked against the whitelist, so each is checked once
+     * @param query query->options.cancellation holds the token of the batch, if any
+     * @param abort Listens to the signal of the request
+     * @return An empty string when the request is valid, otherwise the error to reject it with
+     */
+    std::string ParseBatchQuery(
+        Napi::Value request,
+        std::map<std::string, bool> *supported_namespaces,
+        BatchQuery *query,
+        AbortListener *abort)
+    {
+        Napi::Env env = request.Env();
+        if (!request.IsObject())
+        {
+            return "Invalid Parameter";
+        }
+
+        Napi::Object values = request.As<Napi::Object>();
+        Napi::Value wmi_namespace = values.Get("namespace");
+        Napi::Value query_text = values.Get("query");
+        Napi::Value properties = values.Get("properties");
+        Napi::Value options = values.Get("options");
+        if (!wmi_namespace.IsString() ||
+            !query_text.IsString() ||
+            !(properties.IsUndefined() || properties.IsArray()) ||
+            !(options.IsUndefined() || options.IsObject()))
+        {
+            return "Invalid Parameter";
+        }
+
+        query->wmi_namespace = wmi_namespace.As<Napi::String>().Utf8Value();
+        auto supported = supported_namespaces->find(query->wmi_namespace);
+        if (supported == supported_namespaces->end())
+        {
+            supported = supported_namespaces->emplace(
+                                                 query->wmi_namespace,
+                                                 namespaces::IsSupportedNamespace(wmi_namespace.As<Napi::String>()))
+                            .first;
+        }
+        if (!supported->second)
+        {
+            return "Unsupported Namespace";
+        }
+
+        Napi::Array property_list = properties.IsArray() ? properties.As<Napi::Array>() : Napi::Array::New(env);
+        query->params = GetWstrParams(query_text.As<Napi::String>(), property_list, env);
+        if (!env.IsExceptionPending() && options.IsObject() &&
+            ParseQueryOptions(options.As<Napi::Object>(), &query->options))
+        {
+            UseAggregateProperties(query->options, &query->params.second);
+            abort->Listen(options.As<Napi::Object>(), &query->options);
+        }
+        if (env.IsExceptionPending())
+        {
+            // Report it for this request only instead of failing the whole batch
+            return env.GetAndClearPendingException().Message();
+        }
+        return std::string();
+    }
+
+    Napi::Value WmiQueryMany(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            deferred.Reject(Napi::Error::New(env, kUnsupportedOsMessage).Value());
+            return deferred.Promise();
+        }
+
+        if (info.Length() < 1 || info.Length() > 2 || !info[0].IsArray() ||
+            (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsObject()))
+        {
+            deferred.Reject(Napi::Error::New(env, "Invalid Parameters").Value());
+            return deferred.Promise();
+        }
+
+        uint32_t concurrency = kDefaultBatchConcurrency;
+        QueryOptions batch_options;
+        AbortListener batch_abort;
+        if (info.Length() > 1 && info[1].IsObject())
+        {
+            if (!batch_abort.Listen(info[1].As<Napi::Object>(), &batch_options))
+            {
+                deferred.Reject(env.GetAndClearPendingException().Value());
+                return deferred.Promise();
+            }
+            if (batch_abort.IsAborted())
+            {
+                deferred.Reject(batch_abort.GetReason(env));
+                return deferred.Promise();
+            }
+
+            Napi::Value option = info[1].As<Napi::Object>().Get("concurrency");
+            if (!option.IsUndefined())
+            {
+                double value = option.IsNumber() ? option.As<Napi::Number>().DoubleValue() : 0;
+                if (!(value >= 1 && value <= kMaxBatchConcurrency))
+                {
+                    batch_abort.Stop();
+                    deferred.Reject(Napi::Error::New(env, "Invalid Parameter").Value());
+                    return deferred.Promise();
+                }
+                concurrency = static_cast<uint32_t>(value);
+            }
+        }
+
+        Napi::Array requests = info[0].As<Napi::Array>();
+        std::vector<BatchQuery> queries;
+        std::vector<AbortListener> aborts;
+        std::vector<std::string> errors;
+        std::map<std::string, bool> supported_namespaces;
+        queries.reserve(requests.Length());
+        for (uint32_t i = 0; i < requests.Length(); ++i)
+        {
+            BatchQuery query;
+            AbortListener abort;
+            query.options.cancellation = batch_options.cancellation;
+            std::string error = ParseBatchQuery(requests.Get(i), &supported_namespaces, &query, &abort);
+            if (error.empty())
+            {
+                queries.push_back(std::move(query));
+                aborts.push_back(std::move(abort));
+            }
+            errors.push_back(std::move(error));
+        }
+
+        // The worker deletes itself once the Promise has been settled
+        QueryManyWorker *worker = new QueryManyWorker(
+            env,
+            provider,
+            std::move(queries),
+            std::move(aborts),
+            std::move(errors),
+            concurrency,
+            std::move(batch_abort));
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    void CloseProvider()
+    {
+        QueryProvider *provider = GetQueryProvider();
+        if (provider != NULL)
+        {
+            provider->Close();
+        }
+    }
+
+    Napi::Value WmiClose(
+        const Napi::CallbackInfo &info)
+    {
+        // Other environments keep the engine they share until they close or go away as well
+        CloseEnvironment(info.Env());
+        return info.Env().Undefined();
+    }
+
+    void RegisterQueryBindings(
+        Napi::Env env,
+        Napi::Object exports)
+    {
+        exports.Set("query", Napi::Function::New(env, wmi_wrapper::WmiQuery));
+        exports.Set("queryAsync", Napi::Function::New(env, wmi_wrapper::WmiQueryAsync));
+        exports.Set("queryMany", Napi::Function::New(env, wmi_wrapper::WmiQueryMany));
+        exports.Set("queryTyped", Napi::Function::New(env, wmi_wrapper::WmiQueryTyped));
+        exports.Set("close", Napi::Function::New(env, wmi_wrapper::WmiClose));
+
+        AddonData *addon_data = new AddonData();
+        env.SetInstanceData(addon_data);
+        RegisterQueryStream(env, exports, addon_data);
+        RegisterSubscriptions(env, exports, addon_data);
+        RegisterSamplers(env, exports, addon_data);
+        RegisterPreparedQueries(env, exports, addon_data);
+        RegisterSnapshotWatches(env, exports, addon_data);
+        RegisterCacheBindings(env, exports);
+        RegisterStatsBindings(env, exports);
+        RegisterRecordingBindings(env, exports);
+        RegisterWorkerBindings(env, exports);
+    }
+
+}
\ No newline at end of file
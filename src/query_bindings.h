@@ -0,0 +1,166 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "abort_signal.h"
+#include "query_provider.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    extern const char kUnsupportedOsMessage[];
+
+    std::string GetQueryErrorMessage(HRESULT hres);
+
+    // Releases the pooled connections and cached results of the provider, which reacquires them on demand
+    void CloseProvider();
+
+    /**
+     * Checks a namespace passed from JavaScript against the supported namespaces
+     *
+     * @return true when the namespace is supported, otherwise a JavaScript exception is pending
+     */
+    bool CheckNamespace(Napi::String wmi_namespace);
+
+    /**
+     * Reads an option that must be one of two strings, leaving is_first_choice unchanged when it isn't set
+     *
+     * @return true when the option is valid, otherwise a JavaScript exception is pending
+     */
+    bool ReadStringOption(Napi::Object options, const char *name, const char *first_choice, const char *second_choice, bool *is_first_choice);
+
+    /**
+     * Validates the namespace, query and optional properties arguments shared by the query entry points
+     *
+     * @param info Arguments passed from JavaScript, starting with the namespace
+     * @param wmi_namespace Receives the validated namespace
+     * @param params Receives the wide string query and properties
+     * @param options NULL if the entry point takes no options object after the properties,
+     *                otherwise receives the options object (empty when none was passed)
+     * @return true when the arguments are valid, otherwise a JavaScript exception is pending
+     */
+    bool ParseQueryArguments(const Napi::CallbackInfo &info, std::string *wmi_namespace, WmiQueryParams *params, Napi::Object *options);
+
+    /**
+     * Reads the value conversion settings shared by the query entry points from an options object:
+     * typed (boolean), int64 ('bigint' or 'number'), datetime ('date' or 'number'),
+     * format ('columnar' or 'rows') and cacheTtlMs (milliseconds results may be served from the cache),
+     * the limits timeoutMs, maxRows and maxBytes (0 for none), aggregate, which reduces the results
+     * natively and implies typed, and lazy (boolean), which can't be combined with columnar or aggregate
+     *
+     * @return true when the options are valid, otherwise a JavaScript exception is pending
+     */
+    bool ParseQueryOptions(Napi::Object options, QueryOptions *query_options);
+
+    /**
+     * Narrows the properties a query reads to the ones its aggregation uses, when it has one that uses any
+     */
+    void UseAggregateProperties(const QueryOptions &options, std::vector<std::wstring> *properties);
+
+    /**
+     * Adds the non-enumerable truncated property ('timeout', 'maxRows' or 'maxBytes') to the results
+     * of a query that stopped at one of its limits
+     */
+    void MarkLimitedResults(HRESULT hres, Napi::Value results);
+
+    /**
+     * Runs a query on the calling thread and converts its results, shared by query and prepared queries
+     *
+     * @param options options.prepared is set when running a prepared query
+     * @return The results, a JavaScript exception is pending when the query failed
+     */
+    Napi::Value RunQuery(Napi::Env env, QueryProvider *provider, const std::string &wmi_namespace, const WmiQueryParams &params, QueryOptions options);
+
+    /**
+     * Runs a prepared query on a worker thread like WmiQueryAsync, the worker keeps it alive until done
+     *
+     * @param abort Listens to the signal of the run, if any
+     */
+    Napi::Promise QueueQuery(Napi::Env env, QueryProvider *provider, std::shared_ptr<const PreparedQuery> prepared, const QueryOptions &options, AbortListener abort);
+
+    /**
+     * Queries WMI on the local system and returns an object with the requested values
+     *
+     * @param info[0] String containing the Namespace (example: 'root\wmi' or 'root\cimv2')
+     * @param info[1] String containing the WQL query (example: "SELECT * FROM Win32_OperatingSystem")
+     * @param info[2] Optional: Array of strings containing the desired data (example: ['Version','BuildNumber']).
+     *                If no value is passed, all properties will be returned from the object.
+     * @param info[3] Optional: Object with the value conversion settings, see ParseQueryOptions
+     * @return An object containing objects with the requested data as strings (example: {'0': {'Version': '10.0.19044', 'BuildNumber': '19044'}}),
+     *         or as typed values when options.typed is set
+     */
+    Napi::Value WmiQuery(const Napi::CallbackInfo &info);
+
+    /**
+     * Queries WMI on a worker thread so the event loop is not blocked while WMI produces the results.
+     * Only the conversion of the results into JavaScript objects runs on the JavaScript thread.
+     *
+     * @param info Same arguments as WmiQuery. options.signal, an AbortSignal, stops the query at its
+     *             next Next call and rejects the Promise with the reason of the signal.
+     * @return A Promise resolved with the same object WmiQuery returns, or rejected with the query error
+     */
+    Napi::Value WmiQueryAsync(const Napi::CallbackInfo &info);
+
+    /**
+     * Queries one of the classes of class_descriptors.h on a worker thread. The properties of the class
+     * descriptor are selected and read by an extractor specialized for their CIM types, so the values
+     * are always typed.
+     *
+     * @param info[0] Name of the class (example: 'Win32_LogicalDisk'), its namespace is implied
+     * @param info[1] Optional: WQL condition appended as the WHERE clause (example: 'DriveType = 3')
+     * @param info[2] Optional: Object with the settings of ParseQueryOptions, except format 'columnar'
+     *               and aggregate. typed is ignored, options.signal aborts the query like in WmiQueryAsync.
+     * @return A Promise resolved with the same object WmiQueryAsync returns for typed values
+     */
+    Napi::Value WmiQueryTyped(const Napi::CallbackInfo &info);
+
+    /**
+     * Runs many independent queries, possibly across namespaces, concurrently on a bounded set of
+     * native threads. Queries of the same namespace share one connection.
+     *
+     * @param info[0] Array of { namespace, query, properties?, options? } requests, see WmiQuery
+     * @param info[1] Optional: Object with concurrency, the number of queries run at once (1 to 64, default 4),
+     *                and signal, an AbortSignal that aborts every query of the batch
+     * @return A Promise resolved with one { status: 'fulfilled', value } or { status: 'rejected', reason }
+     *         object per request, in request order. A failing request doesn't affect the others.
+     *         Rejected with the reason of the batch signal when it fires before the batch is done.
+     */
+    Napi::Value WmiQueryMany(const Napi::CallbackInfo &info);
+
+    /**
+     * Releases the connections kept open between queries. Later queries reconnect as needed.
+     */
+    Napi::Value WmiClose(const Napi::CallbackInfo &info);
+
+    void RegisterQueryBindings(Napi::Env env, Napi::Object exports);
+
+};
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Receives the instances of a query in batches as they are produced. The callback may move
+     * the batch away. Returning false stops the query.
+     */
+    typedef std::function<bool(ResultSet &batch)> QueryBatchCallback;
+
+    /**
+     * Receives the events of a subscription. Called from whichever thread delivers the events,
+     * so implementations must be thread safe and must not block.
+     */
+    class EventListener
+    {
+    public:
+        virtual ~EventListener() {}
+
+        // The listener may move the events out of the vector
+        virtual void OnEvents(std::vector<WmiQueryResult> &events) = 0;
+
+        /**
+         * Called once when the subscription ends by itself, for example because the connection
+         * broke or the query was rejected. Not called after the subscription was cancelled.
+         */
+        virtual void OnComplete(HRESULT hres) = 0;
+    };
+
+    /**
+     * A running event subscription, destroying it cancels the subscription
+     */
+    class EventSubscription
+    {
+    public:
+        virtual ~EventSubscription() {}
+
+        /**
+         * Stops the subscription. Once Cancel returns the listener is no longer called.
+         */
+        virtual void Cancel() = 0;
+    };
+
+    class SampleSource;
+    class WorkerPool;
+
+    /**
+     * Executes WMI queries on behalf of the JavaScript entry points.
+     *
+     * Implementations are called from both the JavaScript thread and from worker threads,
+     * so they must not touch any Napi values and must be safe to call concurrently.
+     */
+    class QueryProvider
+    {
+    public:
+        virtual ~QueryProvider() {}
+
+        /**
+         * Runs a WQL query against the given namespace
+         *
+         * @param wmi_namespace Namespace of the class to query (example: 'root/cimv2')
+         * @param query The WQL query and the list of properties to read from each instance.
+         *              An empty property list returns every property of the instance.
+         * @param options Per query settings such as typed values
+         * @param results Receives one entry per instance returned by the query
+         * @return S_OK on success, otherwise the failing HRESULT
+         */
+        virtual HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            ResultSet *results) = 0;
+
+        /**
+         * Runs a WQL query and hands the instances to on_batch as they are produced,
+         * instead of collecting the whole result set first
+         *
+         * @param batch_size Maximum number of instances per batch
+         * @param on_batch Called on the calling thread for every batch, returns false to stop the query.
+         *                 Unlike Query this runs on the calling thread, a stream paused by its consumer
+         *                 would otherwise hold on to a worker thread.
+         * @return S_OK on success or when stopped by on_batch, otherwise the failing HRESULT
+         */
+        virtual HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch) = 0;
+
+        /**
+         * Starts delivering the events matched by a WQL event query to listener.
+         * Failures after the subscription was set up, including failing to connect, are
+         * reported through EventListener::OnComplete.
+         *
+         * @param query The event query and the list of properties to read from each event
+         * @param subscription Receives the handle used to cancel the subscription
+         * @return S_OK when the subscription was started, E_NOTIMPL when events are not supported
+         */
+        virtual HRESULT Subscribe(
+            const std::string & /* wmi_namespace */,
+            const WmiQueryParams & /* query */,
+            const QueryOptions & /* options */,
+            std::shared_ptr<EventListener> /* listener */,
+            std::unique_ptr<EventSubscription> * /* subscription */)
+        {
+            return E_NOTIMPL;
+        }
+
+        /**
+         * Creates the source a sampler refreshes the counters of a class through, registering the
+         * class happens later on the sampling thread in SampleSource::Open
+         *
+         * @param class_name Class whose instances are sampled, typically a Win32_PerfFormattedData class
+         * @param properties Numeric properties read from each instance
+         * @return S_OK on success, E_NOTIMPL when sampling is not supported
+         */
+        virtual HRESULT CreateSampleSource(
+            const std::string & /* wmi_namespace */,
+            const std::wstring & /* class_name */,
+            const std::vector<std::wstring> & /* properties */,
+            std::unique_ptr<SampleSource> * /* source */)
+        {
+            return E_NOTIMPL;
+        }
+
+        /**
+         * Returns the worker threads Query runs on, or NULL when queries run on the calling thread
+         */
+        virtual WorkerPool *GetWorkerPool()
+        {
+            return NULL;
+        }
+
+        /**
+         * Releases resources kept between queries, such as pooled connections.
+         * The provider stays usable and reacquires them on demand.
+         */
+        virtual void Close() {}
+    };
+
+    /**
+     * Returns the provider used to run queries on this platform, or NULL when the
+     * current OS is not supported.
+     */
+    QueryProvider *GetQueryProvider();
+
+    class ResultCache;
+
+    /**
+     * Returns the cache in front of the provider returned by GetQueryProvider, or NULL when the
+     * current OS is not supported.
+     */
+    ResultCache *GetResultCache();
+
+    class RecordingQueryProvider;
+
+    /**
+     * Returns the provider that records and replays the queries of GetQueryProvider. Replaying works
+     * on every OS, recordings are the same everywhere.
+     */
+    RecordingQueryProvider *GetRecordingQueryProvider();
+
+};
\ No newline at end of file
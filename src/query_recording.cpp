@@ -0,0 +1,582 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "query_recording.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "binary_io.h"
+#include "connection_pool.h"
+#include "query_stats.h"
+#include "result_cache.h"
+
+namespace wmi_wrapper
+{
+
+    const char kRecordingMagic[] = "WMIRECRD";
+    const size_t kRecordingMagicSize = 8;
+    const size_t kRecordingHeaderSize = kRecordingMagicSize + 4 + 4 + 8;
+    const size_t kRecordingIndexOffset = kRecordingMagicSize + 4 + 4;
+
+    // Replayed latency is slept in slices so a cancelled query doesn't wait all of it
+    const std::chrono::milliseconds kReplayCancelPollInterval(50);
+
+#ifdef _WIN32
+    std::wstring GetWidePath(
+        const std::string &path)
+    {
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), NULL, 0);
+        std::wstring wide_path(length, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), static_cast<int>(path.size()), &wide_path[0], length);
+        return wide_path;
+    }
+#endif
+
+    MappedFile::~MappedFile()
+    {
+        if (view_ == NULL)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(view_);
+#else
+        munmap(const_cast<uint8_t *>(view_), size_);
+#endif
+    }
+
+    bool MappedFile::Open(
+        const std::string &path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(GetWidePath(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+            static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        // The view keeps the mapping and the file open
+        HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (mapping == NULL)
+        {
+            return false;
+        }
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == NULL)
+        {
+            return false;
+        }
+        view_ = static_cast<const uint8_t *>(view);
+        size_ = static_cast<size_t>(file_size.QuadPart);
+#else
+        int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            return false;
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size <= 0)
+        {
+            close(file);
+            return false;
+        }
+
+        // The mapping keeps the file open
+        void *view = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+        view_ = static_cast<const uint8_t *>(view);
+        size_ = static_cast<size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    bool WriteWholeFile(
+        const std::string &path,
+        const std::vector<uint8_t> &data)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(GetWidePath(path).c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+        bool written = true;
+        for (size_t offset = 0; written && offset < data.size();)
+        {
+            DWORD size = static_cast<DWORD>(std::min<size_t>(data.size() - offset, 1 << 30));
+            DWORD chunk = 0;
+            written = WriteFile(file, data.data() + offset, size, &chunk, NULL) && chunk == size;
+            offset += chunk;
+        }
+        return CloseHandle(file) && written;
+#else
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        file.close();
+        return !file.fail();
+#endif
+    }
+
+    HRESULT WriteRecording(
+        const std::string &path,
+        const std::map<std::wstring, RecordedQuery> &queries,
+        RecordingStats *stats)
+    {
+        std::vector<uint8_t> buffer;
+        BinaryWriter writer(&buffer);
+        writer.WriteBytes(reinterpret_cast<const uint8_t *>(kRecordingMagic), kRecordingMagicSize);
+        writer.Write32(kRecordingVersion);
+        writer.Write32(static_cast<uint32_t>(queries.size()));
+        writer.Write64(0);
+
+        // Result sets are aligned so their offsets stay the same whatever is written before them in later versions
+        std::vector<uint64_t> offsets;
+        offsets.reserve(queries.size());
+        for (const auto &query : queries)
+        {
+            writer.Align(8);
+            offsets.push_back(writer.GetSize());
+            writer.WriteBytes(query.second.data.data(), query.second.data.size());
+        }
+
+        writer.Align(8);
+        writer.Patch64(kRecordingIndexOffset, writer.GetSize());
+        size_t next = 0;
+        for (const auto &query : queries)
+        {
+            writer.WriteString(query.first);
+            writer.Write32(static_cast<uint32_t>(query.second.hres));
+            writer.Write64(offsets[next++]);
+            writer.Write64(query.second.data.size());
+        }
+
+        if (!WriteWholeFile(path, buffer))
+        {
+            return kRecordingUnavailable;
+        }
+
+        stats->entries = queries.size();
+        stats->bytes = buffer.size();
+        return S_OK;
+    }
+
+    HRESULT Recording::Open(
+        const std::string &path)
+    {
+        if (!file_.Open(path))
+        {
+            return kRecordingUnavailable;
+        }
+
+        BinaryReader header(file_.GetData(), file_.GetSize());
+        const uint8_t *magic = header.ReadBytes(kRecordingMagicSize);
+        uint32_t version;
+        uint32_t entry_count;
+        uint64_t index_offset;
+        if (magic == NULL || std::memcmp(magic, kRecordingMagic, kRecordingMagicSize) != 0 ||
+            !header.Read32(&version) || version != kRecordingVersion ||
+            !header.Read32(&entry_count) || !header.Read64(&index_offset) ||
+            index_offset < kRecordingHeaderSize || index_offset > file_.GetSize())
+        {
+            return kRecordingInvalid;
+        }
+
+        BinaryReader index(file_.GetData() + index_offset, file_.GetSize() - static_cast<size_t>(index_offset));
+        entries_.reserve(entry_count);
+        for (uint32_t i = 0; i < entry_count; ++i)
+        {
+            std::wstring key;
+            uint32_t hres;
+            Entry entry;
+            if (!index.ReadString(&key) || !index.Read32(&hres) || !index.Read64(&entry.offset) || !index.Read64(&entry.size) ||
+                entry.offset < kRecordingHeaderSize || entry.offset > index_offset || entry.size > index_offset - entry.offset)
+            {
+                entries_.clear();
+                return kRecordingInvalid;
+            }
+            entry.hres = static_cast<HRESULT>(hres);
+            entries_[key] = entry;
+        }
+        return S_OK;
+    }
+
+    HRESULT Recording::Read(
+        const std::wstring &key,
+        ResultSet *results) const
+    {
+        results->Clear();
+        auto found = entries_.find(key);
+        if (found == entries_.end())
+        {
+            return kQueryNotRecorded;
+        }
+
+        const Entry &entry = found->second;
+        if (FAILED(entry.hres))
+        {
+            return entry.hres;
+        }
+        if (!results->Deserialize(file_.GetData() + entry.offset, static_cast<size_t>(entry.size)))
+        {
+            return kRecordingInvalid;
+        }
+        return entry.hres;
+    }
+
+    /**
+     * Waits as long as a replayed query is meant to take, as long as its timeout allows
+     *
+     * @return S_OK, kQueryTimedOut when the latency is longer than the timeout or kQueryCancelled
+     */
+    HRESULT WaitReplayLatency(
+        uint32_t latency_ms,
+        const QueryOptions &options)
+    {
+        bool timed_out = options.timeout_ms > 0 && latency_ms > options.timeout_ms;
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timed_out ? options.timeout_ms : latency_ms);
+        for (;;)
+        {
+            if (options.IsCancelled())
+            {
+                return kQueryCancelled;
+            }
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (now >= deadline)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, kReplayCancelPollInterval));
+        }
+        return timed_out ? kQueryTimedOut : S_OK;
+    }
+
+    RecordingQueryProvider::RecordingQueryProvider(
+        QueryProvider *provider)
+        : provider_(provider),
+          recording_(false)
+    {
+    }
+
+    void RecordingQueryProvider::StartRecording()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        recording_ = true;
+        recorded_.clear();
+    }
+
+    HRESULT RecordingQueryProvider::StopRecording(
+        const std::string &path,
+        RecordingStats *stats)
+    {
+        std::map<std::wstring, RecordedQuery> recorded;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!recording_)
+            {
+                return S_FALSE;
+            }
+            recording_ = false;
+            recorded.swap(recorded_);
+        }
+        return WriteRecording(path, recorded, stats);
+    }
+
+    bool RecordingQueryProvider::IsRecording()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return recording_;
+    }
+
+    HRESULT RecordingQueryProvider::StartReplay(
+        const std::string &path,
+        const ReplayOptions &options,
+        RecordingStats *stats)
+    {
+        std::shared_ptr<Replay> replay = std::make_shared<Replay>();
+        HRESULT hres = replay->recording.Open(path);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+        replay->options = options;
+        stats->entries = replay->recording.GetEntryCount();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        replay_ = std::move(replay);
+        return S_OK;
+    }
+
+    void RecordingQueryProvider::StopReplay()
+    {
+        std::shared_ptr<const Replay> replay;
+        std::lock_guard<std::mutex> lock(mutex_);
+        // The file is unmapped once the last query replaying it is done, outside the lock
+        replay.swap(replay_);
+    }
+
+    bool RecordingQueryProvider::IsReplaying()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return replay_ != NULL;
+    }
+
+    std::shared_ptr<const RecordingQueryProvider::Replay> RecordingQueryProvider::GetReplay()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return replay_;
+    }
+
+    void RecordingQueryProvider::Record(
+        const std::wstring &key,
+        HRESULT hres,
+        const ResultSet &results)
+    {
+        // A query WMI rejected succeeded without results, it is recorded with the error that rejected it
+        if (hres == S_OK && FAILED(results.GetRejected()))
+        {
+            hres = results.GetRejected();
+        }
+
+        // Results cut short by a timeout or a cancellation depend on the run, failures are replayed as they were
+        if (hres != S_OK && (SUCCEEDED(hres) || hres == kQueryCancelled))
+        {
+            return;
+        }
+
+        RecordedQuery recorded;
+        recorded.hres = hres;
+        if (SUCCEEDED(hres))
+        {
+            results.Serialize(&recorded.data);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (recording_)
+        {
+            recorded_[key] = std::move(recorded);
+        }
+    }
+
+    HRESULT RecordingQueryProvider::Query(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        ResultSet *results)
+    {
+        std::shared_ptr<const Replay> replay = GetReplay();
+        bool recording = IsRecording();
+        if (replay == NULL && !recording)
+        {
+            return provider_->Query(wmi_namespace, query, options, results);
+        }
+
+        HRESULT hres = kQueryNotRecorded;
+        std::wstring key = GetResultKey(GetPoolKey(wmi_namespace), query, options);
+        if (replay != NULL)
+        {
+            StageTimer timer(options.timings);
+            hres = WaitReplayLatency(replay->options.latency_ms, options);
+            timer.Lap(kExecStage);
+            if (hres != S_OK)
+            {
+                results->Clear();
+                return hres;
+            }
+            hres = replay->recording.Read(key, results);
+            timer.Lap(kReadStage);
+        }
+        if (hres == kQueryNotRecorded && (replay == NULL || replay->options.fallback))
+        {
+            hres = provider_->Query(wmi_namespace, query, options, results);
+        }
+
+        if (recording)
+        {
+            Record(key, hres, *results);
+        }
+        return hres;
+    }
+
+    HRESULT RecordingQueryProvider::QueryBatches(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch)
+    {
+        std::shared_ptr<const Replay> replay = GetReplay();
+        bool recording = IsRecording();
+        if (replay == NULL && !recording)
+        {
+            return provider_->QueryBatches(wmi_namespace, query, options, batch_size, on_batch);
+        }
+
+        std::wstring key = GetResultKey(GetPoolKey(wmi_namespace), query, options);
+        if (replay != NULL)
+        {
+            StageTimer timer(options.timings);
+            HRESULT hres = WaitReplayLatency(replay->options.latency_ms, options);
+            timer.Lap(kExecStage);
+            if (hres != S_OK)
+            {
+                return hres;
+            }
+
+            ResultSet results;
+            hres = replay->recording.Read(key, &results);
+            timer.Lap(kReadStage);
+            if (hres != kQueryNotRecorded || !replay->options.fallback)
+            {
+                if (recording)
+                {
+                    Record(key, hres, results);
+                }
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+
+                // The recording holds the whole result set, hand it out in batches the size the stream asked for
+                ResultSet batch;
+                for (size_t row = 0; row < results.size();)
+                {
+                    if (options.IsCancelled())
+                    {
+                        return kQueryCancelled;
+                    }
+                    batch.Clear();
+                    for (size_t end = std::min(row + std::max<size_t>(batch_size, 1), results.size()); row < end; ++row)
+                    {
+                        batch.AppendRow(results, row);
+                    }
+                    if (!on_batch(batch))
+                    {
+                        break;
+                    }
+                }
+                return hres;
+            }
+        }
+
+        // Keep a copy of every batch before the consumer moves it away, only complete runs are recorded.
+        // Streams don't return a result set to mark, a rejected one is told by its timings.
+        ResultSet recorded;
+        bool stopped = false;
+        QueryOptions stream_options = options;
+        QueryTimings timings;
+        if (recording && stream_options.timings == NULL)
+        {
+            stream_options.timings = &timings;
+        }
+        HRESULT hres = provider_->QueryBatches(
+            wmi_namespace,
+            query,
+            stream_options,
+            batch_size,
+            [&](ResultSet &batch)
+            {
+                if (recording)
+                {
+                    for (size_t row = 0; row < batch.size(); ++row)
+                    {
+                        recorded.AppendRow(batch, row);
+                    }
+                }
+                stopped = !on_batch(batch);
+                return !stopped;
+            });
+        if (recording && !stopped)
+        {
+            recorded.SetRejected(stream_options.timings->rejected);
+            Record(key, hres, recorded);
+        }
+        return hres;
+    }
+
+    HRESULT RecordingQueryProvider::Subscribe(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        std::shared_ptr<EventListener> listener,
+        std::unique_ptr<EventSubscription> *subscription)
+    {
+        // Events aren't recorded, replays without a fallback have nothing to deliver them from
+        std::shared_ptr<const Replay> replay = GetReplay();
+        if (replay != NULL && !replay->options.fallback)
+        {
+            return E_NOTIMPL;
+        }
+        return provider_->Subscribe(wmi_namespace, query, options, std::move(listener), subscription);
+    }
+
+    HRESULT RecordingQueryProvider::CreateSampleSource(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name,
+        const std::vector<std::wstring> &properties,
+        std::unique_ptr<SampleSource> *source)
+    {
+        std::shared_ptr<const Replay> replay = GetReplay();
+        if (replay != NULL && !replay->options.fallback)
+        {
+            return E_NOTIMPL;
+        }
+        return provider_->CreateSampleSource(wmi_namespace, class_name, properties, source);
+    }
+
+    WorkerPool *RecordingQueryProvider::GetWorkerPool()
+    {
+        return provider_->GetWorkerPool();
+    }
+
+    void RecordingQueryProvider::Close()
+    {
+        provider_->Close();
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "query_provider.h"
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    // Returned when replaying a query that isn't in the recording, same as HRESULT_FROM_WIN32(ERROR_NOT_FOUND)
+    const HRESULT kQueryNotRecorded = static_cast<HRESULT>(0x80070490L);
+    // The recording file couldn't be opened or written, same as HRESULT_FROM_WIN32(ERROR_OPEN_FAILED)
+    const HRESULT kRecordingUnavailable = static_cast<HRESULT>(0x8007006EL);
+    // The file isn't a recording or was cut short, same as HRESULT_FROM_WIN32(ERROR_INVALID_DATA)
+    const HRESULT kRecordingInvalid = static_cast<HRESULT>(0x8007000DL);
+
+    const uint32_t kRecordingVersion = 1;
+
+    /**
+     * A file mapped read only into memory, the pages are only read from disk when touched
+     */
+    class MappedFile
+    {
+    public:
+        MappedFile() : view_(NULL), size_(0) {}
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        // Maps the file at the UTF-8 path, returns false when it can't be opened or is empty
+        bool Open(const std::string &path);
+
+        const uint8_t *GetData() const
+        {
+            return view_;
+        }
+
+        size_t GetSize() const
+        {
+            return size_;
+        }
+
+    private:
+        const uint8_t *view_;
+        size_t size_;
+    };
+
+    struct RecordingStats
+    {
+        uint64_t entries = 0; // Recorded queries
+        uint64_t bytes = 0;   // Size of the recording file
+    };
+
+    // A query as it is stored in a recording: the result set serialized by ResultSet::Serialize
+    struct RecordedQuery
+    {
+        HRESULT hres = S_OK;
+        std::vector<uint8_t> data;
+    };
+
+    /**
+     * Writes recorded queries to a file Recording can open. The file holds a header (the magic
+     * "WMIRECRD", uint32 version, uint32 entry count and uint64 offset of the index), the serialized
+     * result sets aligned to 8 bytes and the index: per query the result key (see GetResultKey),
+     * uint32 HRESULT, uint64 offset and uint64 size of its result set. Everything is little-endian.
+     */
+    HRESULT WriteRecording(
+        const std::string &path,
+        const std::map<std::wstring, RecordedQuery> &queries,
+        RecordingStats *stats);
+
+    /**
+     * A recording file mapped into memory. Opening it only reads the index, result sets are read from
+     * the mapping when a query asks for them, so large recordings start as fast as small ones.
+     */
+    class Recording
+    {
+    public:
+        HRESULT Open(const std::string &path);
+
+        size_t GetEntryCount() const
+        {
+            return entries_.size();
+        }
+
+        /**
+         * Reads the results recorded for a result key
+         *
+         * @return The HRESULT the query returned when it was recorded, kQueryNotRecorded when it
+         *         wasn't, kRecordingInvalid when its result set doesn't read back
+         */
+        HRESULT Read(const std::wstring &key, ResultSet *results) const;
+
+    private:
+        struct Entry
+        {
+            HRESULT hres;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        MappedFile file_;
+        std::unordered_map<std::wstring, Entry> entries_;
+    };
+
+    struct ReplayOptions
+    {
+        uint32_t latency_ms = 0; // Time every replayed query takes, as if WMI had been asked
+        bool fallback = false;   // Run queries that aren't in the recording instead of failing them
+    };
+
+    /**
+     * Provider between the result cache and the provider that runs queries. While recording it
+     * keeps the results of every query that completes, while replaying it answers queries from a
+     * recording instead of running them, so benchmarks run offline and the results of classes that
+     * don't change can be served at startup. Events and samples are always live. All methods are
+     * thread safe.
+     */
+    class RecordingQueryProvider : public QueryProvider
+    {
+    public:
+        explicit RecordingQueryProvider(QueryProvider *provider);
+
+        // Starts keeping the results of queries, dropping those kept since the last StartRecording
+        void StartRecording();
+
+        /**
+         * Stops recording and writes the queries recorded to a file
+         *
+         * @return S_FALSE when no recording was started, kRecordingUnavailable when the file can't be written
+         */
+        HRESULT StopRecording(const std::string &path, RecordingStats *stats);
+
+        bool IsRecording();
+
+        /**
+         * Answers queries from a recording until StopReplay, replacing the replay running
+         *
+         * @return kRecordingUnavailable or kRecordingInvalid when the file can't be replayed
+         */
+        HRESULT StartReplay(const std::string &path, const ReplayOptions &options, RecordingStats *stats);
+
+        void StopReplay();
+
+        bool IsReplaying();
+
+        HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            ResultSet *results) override;
+
+        HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch) override;
+
+        HRESULT Subscribe(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::shared_ptr<EventListener> listener,
+            std::unique_ptr<EventSubscription> *subscription) override;
+
+        HRESULT CreateSampleSource(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::vector<std::wstring> &properties,
+            std::unique_ptr<SampleSource> *source) override;
+
+        WorkerPool *GetWorkerPool() override;
+
+        void Close() override;
+
+    private:
+        struct Replay
+        {
+            Recording recording;
+            ReplayOptions options;
+        };
+
+        std::shared_ptr<const Replay> GetReplay();
+        void Record(const std::wstring &key, HRESULT hres, const ResultSet &results);
+
+        QueryProvider *provider_;
+        std::mutex mutex_;
+        bool recording_;
+        std::map<std::wstring, RecordedQuery> recorded_;
+        std::shared_ptr<const Replay> replay_; // Queries running keep the replay they started with
+    };
+
+};
\ No newline at end of file
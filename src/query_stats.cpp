@@ -0,0 +1,271 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "query_stats.h"
+
+#include <algorithm>
+#include <cwctype>
+
+#include "connection_pool.h"
+
+namespace wmi_wrapper
+{
+
+    const char *GetQueryStageName(
+        QueryStage stage)
+    {
+        static const char *const kNames[kQueryStageCount] = {"queue", "connect", "exec", "next", "read", "marshal", "total"};
+        return kNames[stage];
+    }
+
+    LatencyHistogram::LatencyHistogram()
+        : count_(0),
+          total_ns_(0),
+          max_ns_(0)
+    {
+        for (std::atomic<uint64_t> &bucket : buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void LatencyHistogram::Record(
+        int64_t ns)
+    {
+        uint64_t value = ns > 0 ? static_cast<uint64_t>(ns) : 0;
+        buckets_[GetBucket(value / 1000)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_ns_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (value > max && !max_ns_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    LatencySummary LatencyHistogram::GetSummary() const
+    {
+        // Read without a lock, a summary taken while queries finish may be off by those queries
+        uint64_t counts[kBucketCount];
+        uint64_t count = 0;
+        for (size_t i = 0; i < kBucketCount; ++i)
+        {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            count += counts[i];
+        }
+
+        LatencySummary summary;
+        summary.count = count;
+        summary.total_ms = static_cast<double>(total_ns_.load(std::memory_order_relaxed)) / 1e6;
+        summary.max_ms = static_cast<double>(max_ns_.load(std::memory_order_relaxed)) / 1e6;
+        if (count == 0)
+        {
+            return summary;
+        }
+
+        double *percentiles[] = {&summary.p50_ms, &summary.p90_ms, &summary.p99_ms};
+        const double kFractions[] = {0.5, 0.9, 0.99};
+        uint64_t seen = 0;
+        size_t next = 0;
+        for (size_t i = 0; i < kBucketCount && next < 3; ++i)
+        {
+            seen += counts[i];
+            while (next < 3 && static_cast<double>(seen) >= kFractions[next] * static_cast<double>(count))
+            {
+                *percentiles[next++] = std::min(GetBucketMidpointMs(i), summary.max_ms);
+            }
+        }
+        return summary;
+    }
+
+    size_t LatencyHistogram::GetBucket(
+        uint64_t us)
+    {
+        // Four linear buckets per power of two, exact below 4us
+        if (us < 4)
+        {
+            return static_cast<size_t>(us);
+        }
+
+        size_t msb = 2;
+        while ((us >> (msb + 1)) != 0)
+        {
+            ++msb;
+        }
+        size_t bucket = (msb - 1) * 4 + static_cast<size_t>((us >> (msb - 2)) & 3);
+        return std::min(bucket, kBucketCount - 1);
+    }
+
+    double LatencyHistogram::GetBucketMidpointMs(
+        size_t bucket)
+    {
+        if (bucket < 4)
+        {
+            return (static_cast<double>(bucket) + 0.5) / 1000;
+        }
+
+        size_t msb = bucket / 4 + 1;
+        double width = static_cast<double>(uint64_t(1) << (msb - 2));
+        double lower = static_cast<double>(4 + bucket % 4) * width;
+        return (lower + width / 2) / 1000;
+    }
+
+    QueryStatsRegistry::QueryStatsRegistry()
+        : enabled_(true)
+    {
+    }
+
+    void QueryStatsRegistry::Record(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name,
+        HRESULT hres,
+        const QueryTimings &timings)
+    {
+        std::shared_ptr<ClassCounters> counters = GetCounters(wmi_namespace, class_name);
+
+        counters->queries.fetch_add(1, std::memory_order_relaxed);
+        HRESULT error = FAILED(hres) ? hres : timings.rejected;
+        if (FAILED(error))
+        {
+            counters->failures.fetch_add(1, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(counters->errors_mutex);
+            ++counters->errors[error];
+        }
+        if (timings.cached)
+        {
+            counters->cache_hits.fetch_add(1, std::memory_order_relaxed);
+        }
+        counters->rows.fetch_add(timings.rows, std::memory_order_relaxed);
+        counters->bytes.fetch_add(timings.bytes, std::memory_order_relaxed);
+
+        for (size_t stage = 0; stage < kQueryStageCount; ++stage)
+        {
+            if (timings.HasStage(static_cast<QueryStage>(stage)))
+            {
+                counters->stages[stage].Record(timings.stage_ns[stage]);
+            }
+        }
+    }
+
+    std::vector<QueryClassStats> QueryStatsRegistry::GetStats()
+    {
+        std::vector<std::shared_ptr<ClassCounters>> classes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto &entry : classes_)
+            {
+                classes.push_back(entry.second);
+            }
+        }
+
+        std::vector<QueryClassStats> stats;
+        for (const std::shared_ptr<ClassCounters> &counters : classes)
+        {
+            QueryClassStats class_stats;
+            class_stats.wmi_namespace = counters->wmi_namespace;
+            class_stats.class_name = counters->class_name;
+            class_stats.queries = counters->queries.load(std::memory_order_relaxed);
+            class_stats.failures = counters->failures.load(std::memory_order_relaxed);
+            class_stats.cache_hits = counters->cache_hits.load(std::memory_order_relaxed);
+            class_stats.rows = counters->rows.load(std::memory_order_relaxed);
+            class_stats.bytes = counters->bytes.load(std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(counters->errors_mutex);
+                class_stats.errors = counters->errors;
+            }
+            for (size_t stage = 0; stage < kQueryStageCount; ++stage)
+            {
+                class_stats.stages[stage] = counters->stages[stage].GetSummary();
+            }
+            stats.push_back(std::move(class_stats));
+        }
+        return stats;
+    }
+
+    void QueryStatsRegistry::Reset()
+    {
+        // Queries still recording into the dropped counters keep them alive until they are done
+        std::lock_guard<std::mutex> lock(mutex_);
+        classes_.clear();
+    }
+
+    void QueryStatsRegistry::SetEnabled(
+        bool enabled)
+    {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<QueryStatsRegistry::ClassCounters> QueryStatsRegistry::GetCounters(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name)
+    {
+        // Namespaces and class names are case insensitive, the first spelling seen is reported
+        std::wstring class_key = class_name;
+        std::transform(
+            class_key.begin(),
+            class_key.end(),
+            class_key.begin(),
+            [](wchar_t c)
+            { return static_cast<wchar_t>(std::towlower(c)); });
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::shared_ptr<ClassCounters> &counters = classes_[std::make_pair(GetPoolKey(wmi_namespace), class_key)];
+        if (!counters)
+        {
+            counters = std::make_shared<ClassCounters>();
+            counters->wmi_namespace = wmi_namespace;
+            counters->class_name = class_name;
+        }
+        return counters;
+    }
+
+    QueryStatsRegistry &GetQueryStats()
+    {
+        static QueryStatsRegistry stats;
+        return stats;
+    }
+
+    void StartQueryTimings(
+        QueryOptions *options,
+        QueryTimings *timings)
+    {
+        if (options->report_timings || GetQueryStats().IsEnabled())
+        {
+            *timings = QueryTimings();
+            options->timings = timings;
+        }
+    }
+
+    void CountQueryResults(
+        const ResultSet &results,
+        const QueryOptions &options)
+    {
+        if (options.timings != NULL)
+        {
+            options.timings->rows = results.size();
+            options.timings->bytes = results.GetBytes();
+        }
+    }
+
+}
\ No newline at end of file
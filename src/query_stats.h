@@ -0,0 +1,235 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Stages a query goes through, in order
+     */
+    enum QueryStage
+    {
+        kQueueStage,   // Waiting for a worker thread
+        kConnectStage, // Getting the pooled connection, including connecting and health checks
+        kExecStage,    // ExecQuery, until the enumerator is returned
+        kNextStage,    // Enumerator Next calls
+        kReadStage,    // Reading and converting property values
+        kMarshalStage, // Converting the results to JavaScript values
+        kTotalStage,   // From the call until the results are ready for JavaScript
+        kQueryStageCount
+    };
+
+    /**
+     * Returns the name the stage is reported under, such as "connect"
+     */
+    const char *GetQueryStageName(QueryStage stage);
+
+    /**
+     * Time spent in each stage of one query. Filled in by the providers when QueryOptions::timings
+     * is set, stages a query didn't go through, like most of them for cached results, stay unset.
+     */
+    struct QueryTimings
+    {
+        std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+        int64_t stage_ns[kQueryStageCount] = {};
+        uint32_t stages = 0; // Bit per stage the query went through
+        uint64_t rows = 0;
+        uint64_t bytes = 0;  // Estimated size of the results
+        bool cached = false; // Served by the result cache, the query didn't run
+        HRESULT rejected = S_OK; // Error of a query WMI rejected, which returned no results instead of failing
+
+        void Add(QueryStage stage, std::chrono::steady_clock::duration elapsed)
+        {
+            stage_ns[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            stages |= 1u << stage;
+        }
+
+        bool HasStage(QueryStage stage) const
+        {
+            return (stages & (1u << stage)) != 0;
+        }
+    };
+
+    /**
+     * Attributes the time between laps to stages. Does nothing without timings, so the hot paths
+     * don't read the clock when nobody looks at the timings.
+     */
+    class StageTimer
+    {
+    public:
+        explicit StageTimer(QueryTimings *timings)
+            : timings_(timings)
+        {
+            if (timings_ != NULL)
+            {
+                lap_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        // Adds the time since the previous lap to stage
+        void Lap(QueryStage stage)
+        {
+            if (timings_ != NULL)
+            {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                timings_->Add(stage, now - lap_);
+                lap_ = now;
+            }
+        }
+
+        // Starts the next lap without attributing the time since the previous one
+        void Skip()
+        {
+            if (timings_ != NULL)
+            {
+                lap_ = std::chrono::steady_clock::now();
+            }
+        }
+
+    private:
+        QueryTimings *timings_;
+        std::chrono::steady_clock::time_point lap_;
+    };
+
+    struct LatencySummary
+    {
+        uint64_t count = 0;
+        double total_ms = 0;
+        double max_ms = 0;
+        double p50_ms = 0;
+        double p90_ms = 0;
+        double p99_ms = 0;
+    };
+
+    /**
+     * Latency distribution with buckets a quarter of a power of two wide, from 1us to over an hour.
+     * Recording only does relaxed atomic increments, so it never blocks the query threads.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const size_t kBucketCount = 128;
+
+        LatencyHistogram();
+
+        void Record(int64_t ns);
+        LatencySummary GetSummary() const;
+
+    private:
+        static size_t GetBucket(uint64_t us);
+        static double GetBucketMidpointMs(size_t bucket);
+
+        std::atomic<uint64_t> buckets_[kBucketCount];
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> total_ns_;
+        std::atomic<uint64_t> max_ns_;
+    };
+
+    struct QueryClassStats
+    {
+        std::string wmi_namespace;
+        std::wstring class_name;
+        uint64_t queries = 0;
+        uint64_t failures = 0;
+        uint64_t cache_hits = 0;
+        uint64_t rows = 0;
+        uint64_t bytes = 0;
+        std::map<HRESULT, uint64_t> errors; // Failures by error code
+        LatencySummary stages[kQueryStageCount];
+    };
+
+    /**
+     * Query statistics per namespace and class. Thread safe, the counters of a class are atomics
+     * and the lock is only held to find them.
+     */
+    class QueryStatsRegistry
+    {
+    public:
+        QueryStatsRegistry();
+
+        void Record(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            HRESULT hres,
+            const QueryTimings &timings);
+
+        std::vector<QueryClassStats> GetStats();
+        void Reset();
+
+        // Queries only collect timings while enabled, or when the caller asks for them
+        void SetEnabled(bool enabled);
+        bool IsEnabled() const
+        {
+            return enabled_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct ClassCounters
+        {
+            std::string wmi_namespace;
+            std::wstring class_name;
+            std::atomic<uint64_t> queries{0};
+            std::atomic<uint64_t> failures{0};
+            std::atomic<uint64_t> cache_hits{0};
+            std::atomic<uint64_t> rows{0};
+            std::atomic<uint64_t> bytes{0};
+            std::mutex errors_mutex;
+            std::map<HRESULT, uint64_t> errors;
+            LatencyHistogram stages[kQueryStageCount];
+        };
+
+        std::shared_ptr<ClassCounters> GetCounters(const std::string &wmi_namespace, const std::wstring &class_name);
+
+        std::mutex mutex_;
+        std::map<std::pair<std::string, std::wstring>, std::shared_ptr<ClassCounters>> classes_;
+        std::atomic<bool> enabled_;
+    };
+
+    QueryStatsRegistry &GetQueryStats();
+
+    /**
+     * Starts timing a query when statistics are collected or the caller asked for its timings
+     */
+    void StartQueryTimings(QueryOptions *options, QueryTimings *timings);
+
+    /**
+     * Counts the rows and bytes of a timed query, call before the results are converted
+     */
+    void CountQueryResults(const ResultSet &results, const QueryOptions &options);
+
+};
\ No newline at end of file
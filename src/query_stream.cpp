@@ -0,0 +1,368 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "query_stream.h"
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <napi.h>
+
+#include "columnar_results.h"
+#include "marshalling.h"
+#include "query_bindings.h"
+
+namespace wmi_wrapper
+{
+
+    const uint32_t kDefaultBatchSize = 100;
+    const uint32_t kDefaultMaxBufferedBatches = 4;
+
+    Napi::Object CreateIteratorResult(
+        Napi::Env env,
+        Napi::Value value,
+        bool done)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("value", value);
+        result.Set("done", Napi::Boolean::New(env, done));
+        return result;
+    }
+
+    Napi::Function QueryStream::GetClass(
+        Napi::Env env)
+    {
+        return DefineClass(
+            env,
+            "QueryStream",
+            {InstanceMethod("next", &QueryStream::Next),
+             InstanceMethod("return", &QueryStream::Return),
+             InstanceMethod(Napi::Symbol::WellKnown(env, "asyncIterator"), &QueryStream::GetAsyncIterator)});
+    }
+
+    QueryStream::QueryStream(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<QueryStream>(info),
+          running_(false),
+          done_(true),
+          event_loop_ref_(false)
+    {
+    }
+
+    bool QueryStream::Start(
+        Napi::Env env,
+        QueryProvider *provider,
+        std::string wmi_namespace,
+        WmiQueryParams params,
+        const QueryOptions &options,
+        Napi::Object signal_options,
+        size_t batch_size,
+        size_t max_buffered_batches)
+    {
+        channel_ = std::make_shared<BatchChannel>(max_buffered_batches);
+        options_ = options;
+
+        // Also releases a query blocked on a full channel, the consumer is woken once it stopped
+        std::shared_ptr<BatchChannel> channel = channel_;
+        if (!abort_.Listen(signal_options, &options_, [channel]()
+                           { channel->Cancel(); }))
+        {
+            return false;
+        }
+
+        running_ = true;
+        done_ = false;
+
+        // Keep the iterator alive until the query thread is gone, the thread calls back into it
+        Ref();
+
+        wake_ = Napi::ThreadSafeFunction::New(
+            env,
+            Napi::Function::New(env, [](const Napi::CallbackInfo &) {}),
+            "wmi_native_module:queryStream",
+            0,
+            1,
+            [this](Napi::Env env)
+            {
+                running_ = false;
+                napi_remove_env_cleanup_hook(env, CancelOnEnvCleanup, this);
+                Unref();
+            });
+
+        // Only pending next() calls keep the process alive, not an abandoned iterator
+        wake_.Unref(env);
+
+        // A query blocked on a consumer that never comes back must still stop when the environment exits
+        napi_add_env_cleanup_hook(env, CancelOnEnvCleanup, this);
+
+        Napi::ThreadSafeFunction wake = wake_;
+        QueryStream *stream = this;
+        QueryOptions query_options = options_;
+
+        std::thread(
+            [provider, wmi_namespace, params, query_options, batch_size, channel, wake, stream]()
+            {
+                auto settle = [stream](Napi::Env env, Napi::Function)
+                {
+                    stream->Settle(env);
+                };
+
+                HRESULT hres = provider->QueryBatches(
+                    wmi_namespace,
+                    params,
+                    query_options,
+                    batch_size,
+                    [&](ResultSet &batch)
+                    {
+                        bool wake_consumer = false;
+                        if (!channel->Push(std::move(batch), &wake_consumer))
+                        {
+                            return false;
+                        }
+                        if (wake_consumer)
+                        {
+                            wake.NonBlockingCall(settle);
+                        }
+                        return true;
+                    });
+
+                if (channel->Complete(hres))
+                {
+                    wake.NonBlockingCall(settle);
+                }
+                wake.Release();
+            })
+            .detach();
+        return true;
+    }
+
+    void QueryStream::CancelOnEnvCleanup(
+        void *data)
+    {
+        static_cast<QueryStream *>(data)->channel_->Cancel();
+    }
+
+    Napi::Value QueryStream::Next(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        pending_.push_back(deferred);
+        Settle(env);
+        return deferred.Promise();
+    }
+
+    Napi::Value QueryStream::Return(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (channel_)
+        {
+            channel_->Cancel();
+        }
+        done_ = true;
+        abort_.Stop();
+        Settle(env);
+
+        Napi::Value value = info.Length() > 0 ? info[0] : env.Undefined();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+        deferred.Resolve(CreateIteratorResult(env, value, true));
+        return deferred.Promise();
+    }
+
+    Napi::Value QueryStream::GetAsyncIterator(
+        const Napi::CallbackInfo &info)
+    {
+        return info.This();
+    }
+
+    void QueryStream::Settle(
+        Napi::Env env)
+    {
+        Napi::HandleScope scope(env);
+
+        while (!pending_.empty())
+        {
+            Napi::Promise::Deferred deferred = pending_.front();
+
+            if (done_)
+            {
+                pending_.pop_front();
+                deferred.Resolve(CreateIteratorResult(env, env.Undefined(), true));
+                continue;
+            }
+
+            ResultSet batch;
+            HRESULT status = S_OK;
+            BatchChannel::PopResult pop_result = channel_->Pop(&batch, &status);
+            if (pop_result == BatchChannel::kPending)
+            {
+                break;
+            }
+
+            pending_.pop_front();
+            if (pop_result == BatchChannel::kBatch && options_.columnar)
+            {
+                ColumnarResults columnar;
+                status = BuildColumnarResults(std::move(batch), options_, &columnar);
+                if (SUCCEEDED(status))
+                {
+                    deferred.Resolve(CreateIteratorResult(env, ConvertColumnarResults(std::move(columnar), options_, env), false));
+                    continue;
+                }
+            }
+            else if (pop_result == BatchChannel::kBatch)
+            {
+                deferred.Resolve(CreateIteratorResult(env, ConvertResultsArray(batch, options_, env), false));
+                continue;
+            }
+
+            done_ = true;
+            abort_.Stop();
+            if (abort_.IsAborted())
+            {
+                deferred.Reject(abort_.GetReason(env));
+            }
+            else if (FAILED(status))
+            {
+                // Also stops the query when the batch itself couldn't be converted
+                channel_->Cancel();
+                deferred.Reject(Napi::Error::New(env, GetQueryErrorMessage(status)).Value());
+            }
+            else
+            {
+                // Only visible to callers of next(), a for await loop just ends
+                Napi::Object result = CreateIteratorResult(env, env.Undefined(), true);
+                MarkLimitedResults(status, result);
+                deferred.Resolve(result);
+            }
+        }
+
+        UpdateEventLoopRef(env);
+    }
+
+    void QueryStream::UpdateEventLoopRef(
+        Napi::Env env)
+    {
+        if (!running_)
+        {
+            return;
+        }
+
+        bool needs_ref = !pending_.empty();
+        if (needs_ref && !event_loop_ref_)
+        {
+            wake_.Ref(env);
+        }
+        else if (!needs_ref && event_loop_ref_)
+        {
+            wake_.Unref(env);
+        }
+        event_loop_ref_ = needs_ref;
+    }
+
+    bool ReadStreamOption(
+        Napi::Object options,
+        const char *name,
+        uint32_t *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+        if (!option.IsNumber() || option.As<Napi::Number>().DoubleValue() < 1)
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *value = option.As<Napi::Number>().Uint32Value();
+        return true;
+    }
+
+    Napi::Value WmiQueryStream(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string wmi_namespace;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        if (!ParseQueryArguments(info, &wmi_namespace, &wstr_params, &options) ||
+            !ParseQueryOptions(options, &query_options) ||
+            !CheckNotAborted(options))
+        {
+            return env.Null();
+        }
+
+        // A stream converts small batches as they come, aggregates and lazy instances come from query
+        if (query_options.aggregate || query_options.lazy_objects)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        uint32_t batch_size = kDefaultBatchSize;
+        uint32_t max_buffered_batches = kDefaultMaxBufferedBatches;
+        if (!ReadStreamOption(options, "batchSize", &batch_size) ||
+            !ReadStreamOption(options, "maxBufferedBatches", &max_buffered_batches))
+        {
+            return env.Null();
+        }
+
+        Napi::Object stream = GetAddonData(env)->query_stream_constructor.New({});
+        if (!QueryStream::Unwrap(stream)->Start(
+                env,
+                provider,
+                std::move(wmi_namespace),
+                std::move(wstr_params),
+                query_options,
+                options,
+                batch_size,
+                max_buffered_batches))
+        {
+            return env.Null();
+        }
+        return stream;
+    }
+
+    void RegisterQueryStream(
+        Napi::Env env,
+        Napi::Object exports,
+        AddonData *addon_data)
+    {
+        addon_data->query_stream_constructor = Napi::Persistent(QueryStream::GetClass(env));
+        exports.Set("queryStream", Napi::Function::New(env, wmi_wrapper::WmiQueryStream));
+    }
+
+}
\ No newline at end of file
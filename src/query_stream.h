@@ -0,0 +1,110 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "abort_signal.h"
+#include "addon_data.h"
+#include "batch_channel.h"
+#include "query_provider.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Async iterator over the results of a query, returned by queryStream.
+     *
+     * The query runs on its own thread and hands batches of rows to the iterator through a
+     * bounded BatchChannel, so a consumer that stops calling next() pauses the enumeration
+     * instead of letting results pile up in memory.
+     */
+    class QueryStream : public Napi::ObjectWrap<QueryStream>
+    {
+    public:
+        static Napi::Function GetClass(Napi::Env env);
+
+        explicit QueryStream(const Napi::CallbackInfo &info);
+
+        /**
+         * Starts the query on its own thread
+         *
+         * @param signal_options The options object passed from JavaScript, whose signal stops the query
+         *                       and rejects the pending and later next() calls
+         * @return false when listening to the signal failed, a JavaScript exception is pending then
+         */
+        bool Start(
+            Napi::Env env,
+            QueryProvider *provider,
+            std::string wmi_namespace,
+            WmiQueryParams params,
+            const QueryOptions &options,
+            Napi::Object signal_options,
+            size_t batch_size,
+            size_t max_buffered_batches);
+
+    private:
+        Napi::Value Next(const Napi::CallbackInfo &info);
+        Napi::Value Return(const Napi::CallbackInfo &info);
+        Napi::Value GetAsyncIterator(const Napi::CallbackInfo &info);
+
+        // Settles as many pending next() calls as the channel allows
+        void Settle(Napi::Env env);
+        void UpdateEventLoopRef(Napi::Env env);
+
+        static void CancelOnEnvCleanup(void *data);
+
+        std::shared_ptr<BatchChannel> channel_;
+        Napi::ThreadSafeFunction wake_;
+        std::deque<Napi::Promise::Deferred> pending_;
+        QueryOptions options_;
+        AbortListener abort_;
+
+        bool running_;
+        bool done_;
+        bool event_loop_ref_;
+    };
+
+    /**
+     * Streams the results of a query as an async iterator of row batches
+     *
+     * @param info[0] String containing the Namespace
+     * @param info[1] String containing the WQL query
+     * @param info[2] Optional: Array of strings containing the desired properties
+     * @param info[3] Optional: Object with batchSize (rows per batch, default 100),
+     *                maxBufferedBatches (batches produced ahead of the consumer, default 4),
+     *                signal (an AbortSignal that stops the query) and the value conversion settings of WmiQuery
+     * @return An async iterator whose values are arrays of row objects
+     */
+    Napi::Value WmiQueryStream(const Napi::CallbackInfo &info);
+
+    void RegisterQueryStream(Napi::Env env, Napi::Object exports, AddonData *addon_data);
+
+};
\ No newline at end of file
@@ -0,0 +1,156 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cancellation.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+// COM status codes are used throughout the module, including by the parts that
+// are shared with the unsupported OS build, so provide the handful we rely on.
+typedef int32_t HRESULT;
+
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define S_OK ((HRESULT)0L)
+#define S_FALSE ((HRESULT)1L)
+#define E_NOTIMPL ((HRESULT)0x80004001L)
+#define E_ABORT ((HRESULT)0x80004004L)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY ((HRESULT)0x8007000EL)
+#define E_INVALIDARG ((HRESULT)0x80070057L)
+#define RPC_E_DISCONNECTED ((HRESULT)0x80010108L)
+#define ERROR_SUCCESS 0L
+#endif
+
+namespace wmi_wrapper
+{
+
+    /**
+     * A property value read from an instance. Unless typed values were requested every
+     * value is formatted as a string.
+     */
+    struct WmiValue
+    {
+        enum Type : uint8_t
+        {
+            kNull,
+            kString,
+            kBoolean,
+            kSigned,   // signed_value, size holds the width in bytes
+            kUnsigned, // unsigned_value, size holds the width in bytes
+            kReal,     // real_value, size holds the width in bytes
+            kDateTime, // real_value holds milliseconds since the Unix epoch
+            kArray     // elements
+        };
+
+        Type type = kNull;
+        uint8_t size = 0;
+        union
+        {
+            bool boolean_value;
+            int64_t signed_value;
+            uint64_t unsigned_value;
+            double real_value;
+        };
+        std::wstring string_value;
+        std::vector<WmiValue> elements;
+
+        WmiValue() : unsigned_value(0) {}
+
+        explicit WmiValue(std::wstring value)
+            : type(kString),
+              unsigned_value(0),
+              string_value(std::move(value))
+        {
+        }
+    };
+
+    typedef std::vector<std::pair<std::wstring, WmiValue>> WmiQueryResult;
+    typedef std::pair<std::wstring, std::vector<std::wstring>> WmiQueryParams;
+
+    /**
+     * Order in which queued queries get a worker thread, see WorkerPool. Synchronous queries block
+     * the JavaScript thread while they wait, they go ahead of every other query.
+     */
+    enum JobPriority : uint8_t
+    {
+        kSynchronousPriority,
+        kHighPriority,
+        kNormalPriority,
+        kLowPriority
+    };
+
+    const size_t kJobPriorityCount = 4;
+
+    // Success codes of queries that stopped at one of their limits, the results hold what was read until then
+    const HRESULT kQueryTimedOut = 0x00040004L; // Same as WBEM_S_TIMEDOUT
+    const HRESULT kQueryMaxRows = 0x00040201L;
+    const HRESULT kQueryMaxBytes = 0x00040202L;
+
+    // Same as WBEM_E_CALL_CANCELLED, returned by queries whose CancellationToken was cancelled
+    const HRESULT kQueryCancelled = static_cast<HRESULT>(0x80041032L);
+
+    struct QueryTimings;
+    class PreparedQuery;
+    struct AggregateSpec;
+    class TypedClass;
+
+    /**
+     * Per query settings passed in by the caller
+     */
+    struct QueryOptions
+    {
+        bool typed_values = false;    // Read values as numbers, booleans, dates and arrays instead of strings
+        bool int64_as_bigint = true;  // Typed values only: 64 bit integers become BigInt instead of Number
+        bool datetime_as_date = true; // Typed values only: datetimes become Date instead of epoch milliseconds
+        bool columnar = false;        // Return one array per property instead of one object per instance
+        int64_t cache_ttl_ms = -1;    // How long results may be served from the result cache, -1 uses the class TTL
+        JobPriority priority = kNormalPriority;
+        bool report_timings = false;  // Attach the time spent per stage to the results
+        QueryTimings *timings = NULL; // Filled in with the time spent per stage when set, see query_stats.h
+        const PreparedQuery *prepared = NULL; // Set when running a prepared query, holds what was derived from the query text
+        bool partial_instances = false; // Ask providers for the properties that are read only, see RewriteProjection
+        uint32_t timeout_ms = 0; // Time the enumeration of the instances may take, 0 waits for ever
+        uint64_t max_rows = 0;   // Instances read before the query stops, 0 reads every instance
+        uint64_t max_bytes = 0;  // Result bytes (ResultSet::GetBytes) read before the query stops, 0 has no limit
+        std::shared_ptr<const CancellationToken> cancellation; // Set when the caller passed an AbortSignal
+        std::shared_ptr<const AggregateSpec> aggregate; // Reduce the results to this aggregation instead of returning them, see aggregation.h
+        bool lazy_objects = false; // Return instances whose values are converted when first read, see lazy_results.h
+        const TypedClass *typed_class = NULL; // Read the instances with the extractor of this class, see class_descriptors.h
+
+        bool IsCancelled() const
+        {
+            return cancellation && cancellation->IsCancelled();
+        }
+    };
+
+};
\ No newline at end of file
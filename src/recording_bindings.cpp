@@ -0,0 +1,175 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "recording_bindings.h"
+
+#include <limits>
+#include <string>
+
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "query_recording.h"
+#include "result_cache.h"
+
+namespace wmi_wrapper
+{
+
+    const char *GetRecordingErrorMessage(
+        HRESULT hres)
+    {
+        if (hres == kRecordingInvalid)
+        {
+            return "Not a valid recording";
+        }
+        return "Could not open the recording";
+    }
+
+    // Replayed and live results must not stand in for each other
+    void InvalidateResultCache()
+    {
+        ResultCache *cache = GetResultCache();
+        if (cache != NULL)
+        {
+            cache->Invalidate(std::string(), std::wstring());
+        }
+    }
+
+    Napi::Value WmiStartRecording(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 0)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        GetRecordingQueryProvider()->StartRecording();
+        return env.Undefined();
+    }
+
+    Napi::Value WmiStopRecording(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 1 || !info[0].IsString())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        RecordingStats stats;
+        HRESULT hres = GetRecordingQueryProvider()->StopRecording(info[0].As<Napi::String>().Utf8Value(), &stats);
+        if (hres == S_FALSE)
+        {
+            Napi::Error::New(env, "Recording was not started").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, "Could not write the recording").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("entries", Napi::Number::New(env, static_cast<double>(stats.entries)));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+        return result;
+    }
+
+    Napi::Value WmiStartReplay(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || info.Length() > 2 || !info[0].IsString() ||
+            (info.Length() > 1 && !info[1].IsUndefined() && !info[1].IsObject()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        ReplayOptions options;
+        if (info.Length() > 1 && info[1].IsObject())
+        {
+            Napi::Object replay_options = info[1].As<Napi::Object>();
+            Napi::Value latency = replay_options.Get("latencyMs");
+            Napi::Value fallback = replay_options.Get("fallback");
+            double latency_ms = latency.IsNumber() ? latency.As<Napi::Number>().DoubleValue() : -1;
+            if ((!latency.IsUndefined() && !(latency_ms >= 0 && latency_ms <= std::numeric_limits<uint32_t>::max())) ||
+                (!fallback.IsUndefined() && !fallback.IsBoolean()))
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            if (!latency.IsUndefined())
+            {
+                options.latency_ms = static_cast<uint32_t>(latency_ms);
+            }
+            if (!fallback.IsUndefined())
+            {
+                options.fallback = fallback.As<Napi::Boolean>().Value();
+            }
+        }
+
+        RecordingStats stats;
+        HRESULT hres = GetRecordingQueryProvider()->StartReplay(info[0].As<Napi::String>().Utf8Value(), options, &stats);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, GetRecordingErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        InvalidateResultCache();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("entries", Napi::Number::New(env, static_cast<double>(stats.entries)));
+        return result;
+    }
+
+    Napi::Value WmiStopReplay(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 0)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        // Where only a replay makes queries possible the cache goes away with it
+        InvalidateResultCache();
+        GetRecordingQueryProvider()->StopReplay();
+        return env.Undefined();
+    }
+
+    void RegisterRecordingBindings(
+        Napi::Env env,
+        Napi::Object exports)
+    {
+        exports.Set("startRecording", Napi::Function::New(env, wmi_wrapper::WmiStartRecording));
+        exports.Set("stopRecording", Napi::Function::New(env, wmi_wrapper::WmiStopRecording));
+        exports.Set("startReplay", Napi::Function::New(env, wmi_wrapper::WmiStartReplay));
+        exports.Set("stopReplay", Napi::Function::New(env, wmi_wrapper::WmiStopReplay));
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Starts keeping the results of the queries that complete, dropping what an earlier recording kept
+     */
+    Napi::Value WmiStartRecording(const Napi::CallbackInfo &info);
+
+    /**
+     * Stops recording and writes the recorded queries to a file
+     *
+     * @param info[0] Path of the recording file, replaced when it exists
+     * @return Object with entries (queries recorded) and bytes (size of the file)
+     */
+    Napi::Value WmiStopRecording(const Napi::CallbackInfo &info);
+
+    /**
+     * Answers queries from a recording file until stopReplay is called, cached results are dropped
+     *
+     * @param info[0] Path of the recording file, mapped into memory for as long as it is replayed
+     * @param info[1] Optional: Object with latencyMs (time every replayed query takes) and fallback
+     *                (run the queries that aren't in the recording instead of failing them)
+     * @return Object with entries, the number of queries in the recording
+     */
+    Napi::Value WmiStartReplay(const Napi::CallbackInfo &info);
+
+    /**
+     * Runs queries against WMI again, cached results are dropped
+     */
+    Napi::Value WmiStopReplay(const Napi::CallbackInfo &info);
+
+    void RegisterRecordingBindings(Napi::Env env, Napi::Object exports);
+
+};
\ No newline at end of file
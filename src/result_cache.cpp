@@ -0,0 +1,416 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "result_cache.h"
+
+#include <cwctype>
+#include <iterator>
+#include <utility>
+
+#include "connection_pool.h"
+#include "prepared_query.h"
+#include "query_stats.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    std::wstring GetLowercase(const std::wstring &value)
+    {
+        std::wstring lowercase = value;
+        for (wchar_t &c : lowercase)
+        {
+            c = static_cast<wchar_t>(std::towlower(c));
+        }
+        return lowercase;
+    }
+
+    std::wstring GetResultKey(
+        const std::string &namespace_key,
+        const WmiQueryParams &query,
+        const QueryOptions &options)
+    {
+        // Namespaces are ASCII, widening byte by byte is enough for a key
+        std::wstring key(namespace_key.begin(), namespace_key.end());
+        key += L'\n';
+        if (options.prepared != NULL)
+        {
+            key += options.prepared->GetNormalizedQuery();
+        }
+        else
+        {
+            key += NormalizeQuery(query.first);
+        }
+        for (const std::wstring &property : query.second)
+        {
+            key += L'\n';
+            key += property;
+        }
+
+        // Only the settings that change the values read from WMI, the format is applied afterwards
+        key += L'\n';
+        key += options.typed_values ? L'T' : L'S';
+        key += options.int64_as_bigint ? L'B' : L'N';
+        key += options.datetime_as_date ? L'D' : L'N';
+
+        // Results read under a row or byte limit can only stand in for queries with the same limits
+        if (options.max_rows > 0 || options.max_bytes > 0)
+        {
+            key += L'\n';
+            key += std::to_wstring(options.max_rows);
+            key += L'/';
+            key += std::to_wstring(options.max_bytes);
+        }
+        return key;
+    }
+
+    ResultCache::ResultCache(
+        Clock *clock,
+        size_t max_bytes)
+        : clock_(clock),
+          max_bytes_(max_bytes),
+          generation_(0)
+    {
+    }
+
+    HRESULT ResultCache::Query(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        const Fetch &fetch,
+        ResultSet *results)
+    {
+        std::wstring class_name = GetLowercase(options.prepared != NULL ? options.prepared->GetClassName() : GetQueryClassName(query.first));
+        std::string namespace_key = GetPoolKey(wmi_namespace);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint32_t ttl_ms = GetTtlLocked(class_name, options);
+        if (ttl_ms == 0)
+        {
+            lock.unlock();
+            return fetch(results);
+        }
+
+        std::wstring key = GetResultKey(namespace_key, query, options);
+        auto cached = index_.find(key);
+        if (cached != index_.end())
+        {
+            // A result cached with a longer TTL than this query allows may be too old for it
+            EntryList::iterator entry = cached->second;
+            TimePoint now = clock_->Now();
+            if (now < entry->expires && now < entry->stored + std::chrono::milliseconds(ttl_ms))
+            {
+                stats_.hits++;
+                entries_.splice(entries_.begin(), entries_, entry);
+                std::shared_ptr<const ResultSet> cached_results = entry->results;
+                lock.unlock();
+
+                *results = *cached_results;
+                return S_OK;
+            }
+
+            if (now >= entry->expires)
+            {
+                stats_.expirations++;
+            }
+            EraseLocked(entry);
+        }
+
+        auto running = flights_.find(key);
+        if (running != flights_.end())
+        {
+            // Share the execution that is already running instead of starting another one
+            stats_.coalesced++;
+            std::shared_ptr<Flight> flight = running->second;
+            // The timeout isn't part of the key, a query waiting for one without a timeout still keeps its own
+            const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.timeout_ms);
+            while (!flight->done)
+            {
+                // This query can be cancelled while the other one keeps running
+                if (options.IsCancelled())
+                {
+                    return kQueryCancelled;
+                }
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (options.timeout_ms > 0 && now >= deadline)
+                {
+                    return kQueryTimedOut;
+                }
+                if (options.cancellation)
+                {
+                    std::chrono::steady_clock::time_point poll = now + kCancellationPollInterval;
+                    flight_done_.wait_until(lock, options.timeout_ms > 0 && deadline < poll ? deadline : poll);
+                }
+                else if (options.timeout_ms > 0)
+                {
+                    flight_done_.wait_until(lock, deadline);
+                }
+                else
+                {
+                    flight_done_.wait(lock);
+                }
+            }
+            lock.unlock();
+
+            // Results another query cut short at its timeout or cancelled aren't all of them, and a query
+            // WMI rejected may be accepted again by the time this one runs, so it runs on its own
+            bool rejected = flight->results && FAILED(flight->results->GetRejected());
+            if (flight->hres != kQueryTimedOut && flight->hres != kQueryCancelled && !rejected)
+            {
+                if (flight->results)
+                {
+                    *results = *flight->results;
+                }
+                return flight->hres;
+            }
+            return fetch(results);
+        }
+
+        stats_.misses++;
+        std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+        flights_[key] = flight;
+        uint64_t generation = generation_;
+        lock.unlock();
+
+        ResultSet fetched;
+        HRESULT hres = fetch(&fetched);
+        std::shared_ptr<const ResultSet> shared_results = std::make_shared<const ResultSet>(std::move(fetched));
+
+        lock.lock();
+        flight->done = true;
+        flight->hres = hres;
+        flight->results = shared_results;
+        flights_.erase(key);
+
+        // Results of a query that was running while the cache was invalidated may already be stale,
+        // results of a query stopped at a limit are incomplete, and a rejected query has none
+        if (hres == S_OK && !FAILED(shared_results->GetRejected()) && generation == generation_)
+        {
+            Entry entry;
+            entry.key = std::move(key);
+            entry.wmi_namespace = std::move(namespace_key);
+            entry.class_name = std::move(class_name);
+            entry.results = shared_results;
+            entry.bytes = shared_results->GetBytes();
+            entry.stored = clock_->Now();
+            entry.expires = entry.stored + std::chrono::milliseconds(ttl_ms);
+            StoreLocked(std::move(entry));
+        }
+        lock.unlock();
+        flight_done_.notify_all();
+
+        *results = *shared_results;
+        return hres;
+    }
+
+    void ResultCache::SetClassTtl(
+        const std::wstring &class_name,
+        uint32_t ttl_ms)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ttl_ms == 0)
+        {
+            class_ttls_.erase(GetLowercase(class_name));
+        }
+        else
+        {
+            class_ttls_[GetLowercase(class_name)] = ttl_ms;
+        }
+    }
+
+    void ResultCache::SetMaxBytes(
+        size_t max_bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+        while (stats_.bytes > max_bytes_ && !entries_.empty())
+        {
+            stats_.evictions++;
+            EraseLocked(std::prev(entries_.end()));
+        }
+    }
+
+    void ResultCache::Invalidate(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name)
+    {
+        std::string namespace_key = GetPoolKey(wmi_namespace);
+        std::wstring class_key = GetLowercase(class_name);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+        for (EntryList::iterator entry = entries_.begin(); entry != entries_.end();)
+        {
+            EntryList::iterator next = std::next(entry);
+            if ((namespace_key.empty() || entry->wmi_namespace == namespace_key) &&
+                (class_key.empty() || entry->class_name == class_key))
+            {
+                stats_.invalidations++;
+                EraseLocked(entry);
+            }
+            entry = next;
+        }
+    }
+
+    ResultCacheStats ResultCache::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    uint32_t ResultCache::GetTtlLocked(
+        const std::wstring &class_name,
+        const QueryOptions &options)
+    {
+        if (options.cache_ttl_ms >= 0)
+        {
+            return static_cast<uint32_t>(options.cache_ttl_ms);
+        }
+
+        auto class_ttl = class_ttls_.find(class_name);
+        return class_ttl != class_ttls_.end() ? class_ttl->second : 0;
+    }
+
+    void ResultCache::EraseLocked(
+        EntryList::iterator entry)
+    {
+        stats_.bytes -= entry->bytes;
+        stats_.entries--;
+        index_.erase(entry->key);
+        entries_.erase(entry);
+    }
+
+    void ResultCache::StoreLocked(
+        Entry entry)
+    {
+        if (entry.bytes > max_bytes_)
+        {
+            // Would evict everything else and still not fit
+            return;
+        }
+
+        // Make room, expired results go first, then the least recently used ones
+        if (stats_.bytes + entry.bytes > max_bytes_)
+        {
+            TimePoint now = clock_->Now();
+            for (EntryList::iterator cached = entries_.begin(); cached != entries_.end();)
+            {
+                EntryList::iterator next = std::next(cached);
+                if (now >= cached->expires)
+                {
+                    stats_.expirations++;
+                    EraseLocked(cached);
+                }
+                cached = next;
+            }
+        }
+        while (stats_.bytes + entry.bytes > max_bytes_)
+        {
+            stats_.evictions++;
+            EraseLocked(std::prev(entries_.end()));
+        }
+
+        stats_.bytes += entry.bytes;
+        stats_.entries++;
+        entries_.push_front(std::move(entry));
+        index_[entries_.front().key] = entries_.begin();
+    }
+
+    CachingQueryProvider::CachingQueryProvider(
+        QueryProvider *provider,
+        Clock *clock)
+        : provider_(provider),
+          cache_(clock)
+    {
+    }
+
+    HRESULT CachingQueryProvider::Query(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        ResultSet *results)
+    {
+        bool ran = false;
+        HRESULT hres = cache_.Query(
+            wmi_namespace,
+            query,
+            options,
+            [&](ResultSet *fetched)
+            {
+                ran = true;
+                return provider_->Query(wmi_namespace, query, options, fetched);
+            },
+            results);
+
+        // Results shared with a query that was already running count as cached too
+        if (!ran && options.timings != NULL)
+        {
+            options.timings->cached = true;
+        }
+        return hres;
+    }
+
+    HRESULT CachingQueryProvider::QueryBatches(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch)
+    {
+        return provider_->QueryBatches(wmi_namespace, query, options, batch_size, on_batch);
+    }
+
+    HRESULT CachingQueryProvider::Subscribe(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        std::shared_ptr<EventListener> listener,
+        std::unique_ptr<EventSubscription> *subscription)
+    {
+        // Events are never cached
+        return provider_->Subscribe(wmi_namespace, query, options, std::move(listener), subscription);
+    }
+
+    HRESULT CachingQueryProvider::CreateSampleSource(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name,
+        const std::vector<std::wstring> &properties,
+        std::unique_ptr<SampleSource> *source)
+    {
+        // Samples are always refreshed
+        return provider_->CreateSampleSource(wmi_namespace, class_name, properties, source);
+    }
+
+    WorkerPool *CachingQueryProvider::GetWorkerPool()
+    {
+        return provider_->GetWorkerPool();
+    }
+
+    void CachingQueryProvider::Close()
+    {
+        provider_->Close();
+        cache_.Invalidate(std::string(), std::wstring());
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "query_provider.h"
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    struct ResultCacheStats
+    {
+        uint64_t hits = 0;          // Queries answered from a cached result
+        uint64_t misses = 0;        // Cacheable queries that had to run
+        uint64_t coalesced = 0;     // Queries that waited for an identical query already running
+        uint64_t expirations = 0;   // Results dropped because their TTL ran out
+        uint64_t evictions = 0;     // Results dropped to stay within the byte limit
+        uint64_t invalidations = 0; // Results dropped by an explicit invalidation
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * Key of the results of a query: the namespace key (see GetPoolKey), the normalized WQL, the
+     * property list and the settings that change the values read. Recordings use the same keys.
+     */
+    std::wstring GetResultKey(
+        const std::string &namespace_key,
+        const WmiQueryParams &query,
+        const QueryOptions &options);
+
+    /**
+     * Cache of query results keyed by lowercase namespace, normalized WQL, property list and value
+     * settings. Results expire after their TTL and the least recently used ones are evicted once the
+     * cached results exceed the byte limit. Identical queries that arrive while one is running wait
+     * for its result instead of running again. All methods are thread safe.
+     */
+    class ResultCache
+    {
+    public:
+        typedef std::function<HRESULT(ResultSet *results)> Fetch;
+
+        static const size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+
+        explicit ResultCache(Clock *clock, size_t max_bytes = kDefaultMaxBytes);
+
+        /**
+         * Returns the cached results of a query or runs fetch to produce them
+         *
+         * @param options options.cache_ttl_ms, or the TTL configured for the class when it is -1,
+         *                decides how long the results are kept. Queries without a TTL always run. A query
+         *                waiting for an identical one returns kQueryTimedOut without results once its own
+         *                options.timeout_ms passed.
+         * @param fetch Runs the query, called at most once per key at any time
+         */
+        HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            const Fetch &fetch,
+            ResultSet *results);
+
+        /**
+         * Sets the TTL used for queries of a class that don't pass their own, 0 stops caching the class
+         */
+        void SetClassTtl(const std::wstring &class_name, uint32_t ttl_ms);
+
+        void SetMaxBytes(size_t max_bytes);
+
+        /**
+         * Drops cached results
+         *
+         * @param wmi_namespace Only drop results of this namespace, empty for every namespace
+         * @param class_name Only drop results of this class, empty for every class
+         */
+        void Invalidate(const std::string &wmi_namespace, const std::wstring &class_name);
+
+        ResultCacheStats GetStats();
+
+    private:
+        struct Entry
+        {
+            std::wstring key;
+            std::string wmi_namespace;
+            std::wstring class_name;
+            std::shared_ptr<const ResultSet> results;
+            size_t bytes;
+            TimePoint stored;
+            TimePoint expires;
+        };
+
+        // An execution of a query identical queries wait for
+        struct Flight
+        {
+            bool done = false;
+            HRESULT hres = S_OK;
+            std::shared_ptr<const ResultSet> results;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        uint32_t GetTtlLocked(const std::wstring &class_name, const QueryOptions &options);
+        void EraseLocked(EntryList::iterator entry);
+        void StoreLocked(Entry entry);
+
+        std::mutex mutex_;
+        std::condition_variable flight_done_;
+        Clock *clock_;
+        size_t max_bytes_;
+        uint64_t generation_;
+
+        EntryList entries_; // Most recently used first
+        std::map<std::wstring, EntryList::iterator> index_;
+        std::map<std::wstring, std::shared_ptr<Flight>> flights_;
+        std::map<std::wstring, uint32_t> class_ttls_;
+        ResultCacheStats stats_;
+    };
+
+    /**
+     * Provider that answers Query from a result cache and forwards everything else to another provider.
+     * Streamed queries are never cached.
+     */
+    class CachingQueryProvider : public QueryProvider
+    {
+    public:
+        CachingQueryProvider(QueryProvider *provider, Clock *clock);
+
+        HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            ResultSet *results) override;
+
+        HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch) override;
+
+        HRESULT Subscribe(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::shared_ptr<EventListener> listener,
+            std::unique_ptr<EventSubscription> *subscription) override;
+
+        HRESULT CreateSampleSource(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::vector<std::wstring> &properties,
+            std::unique_ptr<SampleSource> *source) override;
+
+        WorkerPool *GetWorkerPool() override;
+
+        void Close() override;
+
+        ResultCache &GetResultCache()
+        {
+            return cache_;
+        }
+
+    private:
+        QueryProvider *provider_;
+        ResultCache cache_;
+    };
+
+};
\ No newline at end of file
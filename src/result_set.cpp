@@ -0,0 +1,537 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "result_set.h"
+
+#include <cstring>
+#include <cwchar>
+
+#include "binary_io.h"
+
+namespace wmi_wrapper
+{
+
+    void ResultSet::Clear()
+    {
+        schemas_.clear();
+        rows_.clear();
+        values_.clear();
+        elements_.clear();
+        strings_.clear();
+        rejected_ = S_OK;
+    }
+
+    void ResultSet::AddRow(
+        const std::shared_ptr<const Schema> &schema)
+    {
+        // Instances of a query rarely have more than a couple of schemas, mostly just one
+        size_t index = schemas_.size();
+        while (index > 0 && schemas_[index - 1] != schema)
+        {
+            --index;
+        }
+        if (index == 0)
+        {
+            schemas_.push_back(schema);
+            index = schemas_.size();
+        }
+
+        Row row;
+        row.schema = static_cast<uint32_t>(index - 1);
+        row.first_value = static_cast<uint32_t>(values_.size());
+        rows_.push_back(row);
+    }
+
+    void ResultSet::AddValue(
+        const WmiValue &value)
+    {
+        values_.emplace_back();
+        StoreValue(value, &values_.back());
+    }
+
+    void ResultSet::StoreValue(
+        const WmiValue &value,
+        Value *stored)
+    {
+        stored->type = value.type;
+        stored->size = value.size;
+        switch (value.type)
+        {
+        case WmiValue::kString:
+            stored->offset = strings_.size();
+            stored->length = static_cast<uint32_t>(value.string_value.size());
+            strings_.insert(strings_.end(), value.string_value.begin(), value.string_value.end());
+            break;
+        case WmiValue::kArray:
+        {
+            // Elements are scalars, storing them only appends characters
+            size_t first = elements_.size();
+            elements_.resize(first + value.elements.size());
+            for (size_t i = 0; i < value.elements.size(); ++i)
+            {
+                StoreValue(value.elements[i], &elements_[first + i]);
+            }
+            stored->offset = first;
+            stored->length = static_cast<uint32_t>(value.elements.size());
+            break;
+        }
+        default:
+            stored->unsigned_value = value.unsigned_value;
+            break;
+        }
+    }
+
+    WmiValue ResultSet::GetWmiValue(
+        const Value &value) const
+    {
+        WmiValue copy;
+        copy.type = value.type;
+        copy.size = value.size;
+        switch (value.type)
+        {
+        case WmiValue::kString:
+            copy.string_value.assign(GetString(value), value.length);
+            break;
+        case WmiValue::kArray:
+        {
+            const Value *elements = GetElements(value);
+            copy.elements.reserve(value.length);
+            for (uint32_t i = 0; i < value.length; ++i)
+            {
+                copy.elements.push_back(GetWmiValue(elements[i]));
+            }
+            break;
+        }
+        default:
+            copy.unsigned_value = value.unsigned_value;
+            break;
+        }
+        return copy;
+    }
+
+    size_t ResultSet::GetBytes() const
+    {
+        size_t bytes = sizeof(ResultSet) +
+                       schemas_.capacity() * sizeof(schemas_[0]) +
+                       rows_.capacity() * sizeof(Row) +
+                       values_.capacity() * sizeof(Value) +
+                       elements_.capacity() * sizeof(Value) +
+                       strings_.capacity() * sizeof(wchar_t);
+        for (const std::shared_ptr<const Schema> &schema : schemas_)
+        {
+            for (const std::wstring &name : *schema)
+            {
+                bytes += sizeof(std::wstring) + name.capacity() * sizeof(wchar_t);
+            }
+        }
+        return bytes;
+    }
+
+    size_t ResultSet::GetBlocks() const
+    {
+        const size_t inline_capacity = std::wstring().capacity();
+        size_t blocks = (schemas_.capacity() > 0) + (rows_.capacity() > 0) + (values_.capacity() > 0) +
+                        (elements_.capacity() > 0) + (strings_.capacity() > 0);
+        for (const std::shared_ptr<const Schema> &schema : schemas_)
+        {
+            // The schema shares one block with its reference count, plus its array of names
+            blocks += 1 + (schema->capacity() > 0);
+            for (const std::wstring &name : *schema)
+            {
+                blocks += name.capacity() > inline_capacity;
+            }
+        }
+        return blocks;
+    }
+
+    void ResultSet::AppendRow(
+        const ResultSet &source,
+        size_t row)
+    {
+        AddRow(source.schemas_[source.rows_[row].schema]);
+        const Value *values = source.GetValues(row);
+        size_t count = source.GetNames(row).size();
+        for (size_t j = 0; j < count; ++j)
+        {
+            values_.emplace_back();
+            CopyValue(source, values[j], &values_.back());
+        }
+    }
+
+    void ResultSet::CopyValue(
+        const ResultSet &source,
+        const Value &value,
+        Value *copy)
+    {
+        *copy = value;
+        switch (value.type)
+        {
+        case WmiValue::kString:
+        {
+            const wchar_t *characters = source.GetString(value);
+            copy->offset = strings_.size();
+            strings_.insert(strings_.end(), characters, characters + value.length);
+            break;
+        }
+        case WmiValue::kArray:
+        {
+            // Elements are scalars, copying them only appends characters
+            size_t first = elements_.size();
+            elements_.resize(first + value.length);
+            const Value *elements = source.GetElements(value);
+            for (uint32_t i = 0; i < value.length; ++i)
+            {
+                CopyValue(source, elements[i], &elements_[first + i]);
+            }
+            copy->offset = first;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    /*
+     * Serialized layout:
+     *   uint32 schema count, per schema uint32 name count and the names (uint32 length, UTF-16)
+     *   uint32 row count, per row uint32 schema and uint32 first value
+     *   uint32 value count, per value uint8 type, uint8 size, uint16 0, uint32 length and uint64 payload:
+     *          the number, 0 or 1 for booleans, the first code unit of a string or first element of an array
+     *   the elements, laid out like the values
+     *   uint32 code unit count and the UTF-16 code units of every string
+     */
+    void ResultSet::Serialize(
+        std::vector<uint8_t> *buffer) const
+    {
+        BinaryWriter writer(buffer);
+        writer.Write32(static_cast<uint32_t>(schemas_.size()));
+        for (const std::shared_ptr<const Schema> &schema : schemas_)
+        {
+            writer.Write32(static_cast<uint32_t>(schema->size()));
+            for (const std::wstring &name : *schema)
+            {
+                writer.WriteString(name);
+            }
+        }
+
+        writer.Write32(static_cast<uint32_t>(rows_.size()));
+        for (const Row &row : rows_)
+        {
+            writer.Write32(row.schema);
+            writer.Write32(row.first_value);
+        }
+
+        // Strings are re-encoded as they are met, so their offsets count UTF-16 code units
+        std::vector<uint8_t> strings;
+        BinaryWriter string_writer(&strings);
+        for (const std::vector<Value> *values : {&values_, &elements_})
+        {
+            writer.Write32(static_cast<uint32_t>(values->size()));
+            for (const Value &value : *values)
+            {
+                uint32_t length = value.length;
+                uint64_t payload = 0;
+                switch (value.type)
+                {
+                case WmiValue::kNull:
+                    break;
+                case WmiValue::kBoolean:
+                    payload = value.boolean_value ? 1 : 0;
+                    break;
+                case WmiValue::kString:
+                    payload = strings.size() / 2;
+                    length = string_writer.WriteUtf16(GetString(value), value.length);
+                    break;
+                case WmiValue::kArray:
+                    payload = value.offset;
+                    break;
+                default:
+                    payload = value.unsigned_value;
+                    break;
+                }
+                writer.Write8(static_cast<uint8_t>(value.type));
+                writer.Write8(value.size);
+                writer.Write16(0);
+                writer.Write32(length);
+                writer.Write64(payload);
+            }
+        }
+
+        writer.Write32(static_cast<uint32_t>(strings.size() / 2));
+        writer.WriteBytes(strings.data(), strings.size());
+    }
+
+    bool ResultSet::Deserialize(
+        const uint8_t *data,
+        size_t size)
+    {
+        Clear();
+        if (!ReadSerialized(data, size))
+        {
+            Clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool ResultSet::ReadSerializedValues(
+        BinaryReader *reader,
+        std::vector<Value> *values)
+    {
+        const size_t kSerializedValueSize = 16;
+        uint32_t count;
+        if (!reader->Read32(&count) || count > reader->GetRemaining() / kSerializedValueSize)
+        {
+            return false;
+        }
+
+        values->resize(count);
+        for (Value &value : *values)
+        {
+            uint8_t type;
+            uint16_t reserved;
+            uint64_t payload;
+            if (!reader->Read8(&type) || !reader->Read8(&value.size) || !reader->Read16(&reserved) ||
+                !reader->Read32(&value.length) || !reader->Read64(&payload) || type > WmiValue::kArray)
+            {
+                return false;
+            }
+            value.type = static_cast<WmiValue::Type>(type);
+            switch (value.type)
+            {
+            case WmiValue::kBoolean:
+                value.boolean_value = payload != 0;
+                break;
+            case WmiValue::kString:
+            case WmiValue::kArray:
+                value.offset = static_cast<size_t>(payload);
+                break;
+            default:
+                value.unsigned_value = payload;
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool ResultSet::ReadSerialized(
+        const uint8_t *data,
+        size_t size)
+    {
+        BinaryReader reader(data, size);
+        uint32_t schema_count;
+        if (!reader.Read32(&schema_count) || schema_count > reader.GetRemaining() / 4)
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < schema_count; ++i)
+        {
+            uint32_t name_count;
+            if (!reader.Read32(&name_count) || name_count > reader.GetRemaining() / 4)
+            {
+                return false;
+            }
+            std::shared_ptr<Schema> schema = std::make_shared<Schema>(name_count);
+            for (std::wstring &name : *schema)
+            {
+                if (!reader.ReadString(&name))
+                {
+                    return false;
+                }
+            }
+            schemas_.push_back(std::move(schema));
+        }
+
+        uint32_t row_count;
+        if (!reader.Read32(&row_count) || row_count > reader.GetRemaining() / 8)
+        {
+            return false;
+        }
+        rows_.resize(row_count);
+        for (Row &row : rows_)
+        {
+            if (!reader.Read32(&row.schema) || !reader.Read32(&row.first_value) || row.schema >= schema_count)
+            {
+                return false;
+            }
+        }
+
+        uint32_t string_units;
+        const uint8_t *units;
+        if (!ReadSerializedValues(&reader, &values_) || !ReadSerializedValues(&reader, &elements_) ||
+            !reader.Read32(&string_units) || (units = reader.ReadBytes(static_cast<size_t>(string_units) * 2)) == NULL ||
+            reader.GetRemaining() != 0)
+        {
+            return false;
+        }
+
+        // Nothing may refer past the arenas it was read with
+        for (const Row &row : rows_)
+        {
+            if (row.first_value > values_.size() || values_.size() - row.first_value < schemas_[row.schema]->size())
+            {
+                return false;
+            }
+        }
+        for (const std::vector<Value> *values : {&values_, &elements_})
+        {
+            for (const Value &value : *values)
+            {
+                if (value.type != WmiValue::kString && value.type != WmiValue::kArray)
+                {
+                    continue;
+                }
+                // Elements of arrays are scalars
+                size_t arena_size = value.type == WmiValue::kString ? string_units : values == &values_ ? elements_.size() : 0;
+                if (value.offset > arena_size || arena_size - value.offset < value.length)
+                {
+                    return false;
+                }
+            }
+        }
+
+        // Where wchar_t is UTF-16 the code units are the characters, elsewhere surrogate pairs become
+        // one character, which moves the strings that follow them
+        bool has_surrogates = false;
+        for (uint32_t i = 0; sizeof(wchar_t) > 2 && i < string_units && !has_surrogates; ++i)
+        {
+            has_surrogates = (units[2 * i + 1] & 0xF8) == 0xD8;
+        }
+        if (!has_surrogates)
+        {
+            strings_.reserve(string_units);
+            BinaryReader::AppendUtf16(units, string_units, &strings_);
+            return true;
+        }
+        for (std::vector<Value> *values : {&values_, &elements_})
+        {
+            for (Value &value : *values)
+            {
+                if (value.type == WmiValue::kString)
+                {
+                    size_t first = strings_.size();
+                    BinaryReader::AppendUtf16(units + 2 * value.offset, value.length, &strings_);
+                    value.offset = first;
+                    value.length = static_cast<uint32_t>(strings_.size() - first);
+                }
+            }
+        }
+        return true;
+    }
+
+    uint64_t HashValue(
+        const ResultSet &results,
+        const ResultSet::Value &value,
+        uint64_t hash)
+    {
+        hash = HashUnit(hash, (static_cast<uint64_t>(value.type) << 8) | value.size);
+        switch (value.type)
+        {
+        case WmiValue::kString:
+        {
+            const wchar_t *characters = results.GetString(value);
+            hash = HashUnit(hash, value.length);
+            for (uint32_t i = 0; i < value.length; ++i)
+            {
+                hash = HashUnit(hash, static_cast<uint64_t>(characters[i]));
+            }
+            return hash;
+        }
+        case WmiValue::kArray:
+        {
+            const ResultSet::Value *elements = results.GetElements(value);
+            hash = HashUnit(hash, value.length);
+            for (uint32_t i = 0; i < value.length; ++i)
+            {
+                hash = HashValue(results, elements[i], hash);
+            }
+            return hash;
+        }
+        case WmiValue::kBoolean:
+            return HashUnit(hash, value.boolean_value ? 1 : 0);
+        case WmiValue::kSigned:
+            return HashUnit(hash, static_cast<uint64_t>(value.signed_value));
+        case WmiValue::kUnsigned:
+            return HashUnit(hash, value.unsigned_value);
+        case WmiValue::kReal:
+        case WmiValue::kDateTime:
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value.real_value, sizeof(bits));
+            return HashUnit(hash, bits);
+        }
+        default:
+            return hash;
+        }
+    }
+
+    bool ValuesEqual(
+        const ResultSet &first_results,
+        const ResultSet::Value &first,
+        const ResultSet &second_results,
+        const ResultSet::Value &second)
+    {
+        if (first.type != second.type || first.size != second.size)
+        {
+            return false;
+        }
+
+        switch (first.type)
+        {
+        case WmiValue::kString:
+            return first.length == second.length &&
+                   std::wmemcmp(first_results.GetString(first), second_results.GetString(second), first.length) == 0;
+        case WmiValue::kArray:
+        {
+            if (first.length != second.length)
+            {
+                return false;
+            }
+            const ResultSet::Value *first_elements = first_results.GetElements(first);
+            const ResultSet::Value *second_elements = second_results.GetElements(second);
+            for (uint32_t i = 0; i < first.length; ++i)
+            {
+                if (!ValuesEqual(first_results, first_elements[i], second_results, second_elements[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case WmiValue::kBoolean:
+            return first.boolean_value == second.boolean_value;
+        case WmiValue::kSigned:
+            return first.signed_value == second.signed_value;
+        case WmiValue::kUnsigned:
+            return first.unsigned_value == second.unsigned_value;
+        case WmiValue::kReal:
+        case WmiValue::kDateTime:
+            // Bitwise, so unchanged NaNs compare equal
+            return std::memcmp(&first.real_value, &second.real_value, sizeof(first.real_value)) == 0;
+        default:
+            return true;
+        }
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    class BinaryReader;
+
+    /**
+     * Instances returned by a query. Property names are interned once per schema and shared by every
+     * instance that has it, values are appended to arenas that are released all at once with the set.
+     * Once the arenas have grown, reading an instance doesn't allocate per property.
+     */
+    class ResultSet
+    {
+    public:
+        /**
+         * A value in the arenas. Same members as WmiValue, except that strings and arrays refer to
+         * characters and elements stored by the set.
+         */
+        struct Value
+        {
+            WmiValue::Type type = WmiValue::kNull;
+            uint8_t size = 0;
+            uint32_t length = 0; // Characters of a string, elements of an array
+            union
+            {
+                bool boolean_value;
+                int64_t signed_value;
+                uint64_t unsigned_value;
+                double real_value;
+                size_t offset; // First character of a string or first element of an array
+            };
+
+            Value() : unsigned_value(0) {}
+        };
+
+        // Property names of an instance, in the order of its values
+        typedef std::vector<std::wstring> Schema;
+
+        size_t size() const
+        {
+            return rows_.size();
+        }
+
+        bool empty() const
+        {
+            return rows_.empty();
+        }
+
+        void Clear();
+
+        /**
+         * Error of a query that connected but was turned down and left the set empty, recorded
+         * here instead of failing the query so callers that keep state across queries, snapshots,
+         * the cache and recordings, can tell it from a query that found no instances. S_OK otherwise.
+         */
+        HRESULT GetRejected() const
+        {
+            return rejected_;
+        }
+
+        void SetRejected(HRESULT rejected)
+        {
+            rejected_ = rejected;
+        }
+
+        /**
+         * Starts a new instance, followed by one AddValue per name in the schema
+         *
+         * @param schema Shared with the reader, the set only keeps a reference
+         */
+        void AddRow(const std::shared_ptr<const Schema> &schema);
+        void AddValue(const WmiValue &value);
+
+        const Schema &GetNames(size_t row) const
+        {
+            return *schemas_[rows_[row].schema];
+        }
+
+        // Schemas are numbered in the order their first instance was added
+        size_t GetSchemaCount() const
+        {
+            return schemas_.size();
+        }
+
+        const Schema &GetSchema(size_t schema) const
+        {
+            return *schemas_[schema];
+        }
+
+        size_t GetSchemaIndex(size_t row) const
+        {
+            return rows_[row].schema;
+        }
+
+        // An instance without properties starts at the end of the values, which can't be indexed
+        const Value *GetValues(size_t row) const
+        {
+            return values_.data() + rows_[row].first_value;
+        }
+
+        const wchar_t *GetString(const Value &value) const
+        {
+            return strings_.data() + value.offset;
+        }
+
+        const Value *GetElements(const Value &value) const
+        {
+            return elements_.data() + value.offset;
+        }
+
+        // Copies a value out of the arenas
+        WmiValue GetWmiValue(const Value &value) const;
+
+        // Memory held by the set, including the schemas it refers to
+        size_t GetBytes() const;
+
+        // Heap blocks behind GetBytes, strings short enough to be stored inline don't have one
+        size_t GetBlocks() const;
+
+        // Appends a copy of an instance of another set, sharing its schema
+        void AppendRow(const ResultSet &source, size_t row);
+
+        /**
+         * Appends the set to buffer in a form that doesn't depend on the platform, little-endian
+         * integers and UTF-16 strings, so sets written on Windows read back on Linux. Recordings
+         * are made of these, see query_recording.h.
+         */
+        void Serialize(std::vector<uint8_t> *buffer) const;
+
+        /**
+         * Replaces the contents of the set with a set written by Serialize
+         *
+         * @return false when the data was cut short or refers past its own arenas, the set is empty then
+         */
+        bool Deserialize(const uint8_t *data, size_t size);
+
+    private:
+        struct Row
+        {
+            uint32_t schema;
+            uint32_t first_value;
+        };
+
+        void StoreValue(const WmiValue &value, Value *stored);
+        void CopyValue(const ResultSet &source, const Value &value, Value *copy);
+        bool ReadSerialized(const uint8_t *data, size_t size);
+        static bool ReadSerializedValues(BinaryReader *reader, std::vector<Value> *values);
+
+        std::vector<std::shared_ptr<const Schema>> schemas_;
+        std::vector<Row> rows_;
+        std::vector<Value> values_;
+        std::vector<Value> elements_;
+        std::vector<wchar_t> strings_;
+        HRESULT rejected_ = S_OK;
+    };
+
+    // FNV-1a over whole characters and numbers instead of bytes, folding the high bits back in
+    // after every step so values that only differ in their high bits still land in different buckets.
+    // Hashes and compares values of result sets for the snapshot diff and the aggregation.
+    const uint64_t kHashOffset = 14695981039346656037ull;
+    const uint64_t kHashPrime = 1099511628211ull;
+
+    inline uint64_t HashUnit(
+        uint64_t hash,
+        uint64_t unit)
+    {
+        hash = (hash ^ unit) * kHashPrime;
+        return hash ^ (hash >> 32);
+    }
+
+    // Mixes a value into hash, arrays element by element
+    uint64_t HashValue(const ResultSet &results, const ResultSet::Value &value, uint64_t hash);
+
+    // Compares values of the same or of different result sets, reals bit by bit
+    bool ValuesEqual(const ResultSet &first_results, const ResultSet::Value &first, const ResultSet &second_results, const ResultSet::Value &second);
+
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "sample_buffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace wmi_wrapper
+{
+
+    uint32_t SampleInstanceTable::GetId(
+        const std::wstring &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = ids_.find(name);
+        if (found != ids_.end())
+        {
+            return found->second;
+        }
+
+        uint32_t id = static_cast<uint32_t>(names_.size());
+        ids_.emplace(name, id);
+        names_.push_back(name);
+        return id;
+    }
+
+    std::vector<std::wstring> SampleInstanceTable::GetNames()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_;
+    }
+
+    SampleFrame::SampleFrame(
+        SampleInstanceTable *instances,
+        size_t property_count)
+        : instances_(instances),
+          property_count_(property_count)
+    {
+    }
+
+    void SampleFrame::Clear()
+    {
+        instance_ids_.clear();
+        values_.clear();
+    }
+
+    double *SampleFrame::AddRow(
+        const std::wstring &instance)
+    {
+        instance_ids_.push_back(instances_->GetId(instance));
+        values_.resize(values_.size() + property_count_, std::numeric_limits<double>::quiet_NaN());
+        return values_.data() + values_.size() - property_count_;
+    }
+
+    SampleBuffer::SampleBuffer(
+        size_t capacity,
+        size_t property_count)
+        : capacity_(capacity > 0 ? capacity : 1),
+          property_count_(property_count),
+          written_(0),
+          timestamps_(capacity_),
+          values_(capacity_ * property_count),
+          instance_ids_(capacity_)
+    {
+    }
+
+    void SampleBuffer::Append(
+        double timestamp_ms,
+        const SampleFrame &frame)
+    {
+        size_t row_count = frame.GetRowCount();
+        const uint32_t *instance_ids = frame.GetInstanceIds();
+        const double *values = frame.GetValues();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Rows that would be overwritten by later rows of the same frame are skipped
+        size_t skipped = row_count > capacity_ ? row_count - capacity_ : 0;
+        written_ += skipped;
+        for (size_t row = skipped; row < row_count; ++row)
+        {
+            size_t slot = static_cast<size_t>(written_ % capacity_);
+            timestamps_[slot] = timestamp_ms;
+            instance_ids_[slot] = instance_ids[row];
+            for (size_t property = 0; property < property_count_; ++property)
+            {
+                values_[property * capacity_ + slot] = values[row * property_count_ + property];
+            }
+            ++written_;
+        }
+    }
+
+    template <typename T>
+    void SampleBuffer::CopyColumn(
+        const T *column,
+        uint64_t first,
+        size_t count,
+        T *destination)
+    {
+        size_t slot = static_cast<size_t>(first % capacity_);
+        size_t until_end = std::min(count, capacity_ - slot);
+        std::memcpy(destination, column + slot, until_end * sizeof(T));
+        std::memcpy(destination + until_end, column, (count - until_end) * sizeof(T));
+    }
+
+    HRESULT SampleBuffer::Read(
+        uint64_t since,
+        size_t max_rows,
+        SampleWindow *window)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        uint64_t oldest = written_ > capacity_ ? written_ - capacity_ : 0;
+        uint64_t first = std::min(std::max(since, oldest), written_);
+        size_t row_count = static_cast<size_t>(std::min<uint64_t>(written_ - first, max_rows));
+
+        window->first = first;
+        window->lost = since < oldest ? oldest - since : 0;
+        window->row_count = row_count;
+        window->values_offset = row_count * sizeof(double);
+        window->instances_offset = window->values_offset + row_count * property_count_ * sizeof(double);
+        window->size = window->instances_offset + row_count * sizeof(uint32_t);
+
+        // Always allocate, even for an empty window, so the buffer can back an ArrayBuffer
+        window->data.reset(static_cast<uint8_t *>(std::malloc(std::max<size_t>(window->size, 1))));
+        if (!window->data)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        uint8_t *data = window->data.get();
+        CopyColumn(timestamps_.data(), first, row_count, reinterpret_cast<double *>(data));
+        for (size_t property = 0; property < property_count_; ++property)
+        {
+            CopyColumn(
+                values_.data() + property * capacity_,
+                first,
+                row_count,
+                reinterpret_cast<double *>(data + window->values_offset) + property * row_count);
+        }
+        CopyColumn(instance_ids_.data(), first, row_count, reinterpret_cast<uint32_t *>(data + window->instances_offset));
+        return S_OK;
+    }
+
+    uint64_t SampleBuffer::GetWrittenCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return written_;
+    }
+
+    SampleCollector::SampleCollector(
+        std::unique_ptr<SampleSource> source,
+        size_t property_count,
+        size_t capacity,
+        std::chrono::microseconds interval)
+        : source_(std::move(source)),
+          buffer_(capacity, property_count),
+          frame_(&instances_, property_count),
+          interval_(interval),
+          capacity_(capacity > 0 ? capacity : 1),
+          opened_(false),
+          stopped_(false),
+          open_result_(S_OK),
+          total_lateness_ms_(0)
+    {
+    }
+
+    SampleCollector::~SampleCollector()
+    {
+        Stop();
+    }
+
+    HRESULT SampleCollector::Start()
+    {
+        thread_ = std::thread(&SampleCollector::Run, this);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(
+            lock,
+            [this]()
+            { return opened_; });
+        HRESULT hres = open_result_;
+        lock.unlock();
+
+        if (FAILED(hres))
+        {
+            thread_.join();
+        }
+        return hres;
+    }
+
+    void SampleCollector::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        wake_.notify_all();
+
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    bool SampleCollector::IsRunning()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return opened_ && SUCCEEDED(open_result_) && !stopped_;
+    }
+
+    SamplerStats SampleCollector::GetStats()
+    {
+        uint64_t written = buffer_.GetWrittenCount();
+
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        SamplerStats stats = stats_;
+        stats.overwritten_rows = written > capacity_ ? written - capacity_ : 0;
+        stats.mean_lateness_ms = stats.refreshes + stats.failed_refreshes > 0
+                                     ? total_lateness_ms_ / static_cast<double>(stats.refreshes + stats.failed_refreshes)
+                                     : 0;
+        return stats;
+    }
+
+    void SampleCollector::Run()
+    {
+        HRESULT hres = source_->Open();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            opened_ = true;
+            open_result_ = hres;
+        }
+        wake_.notify_all();
+        if (FAILED(hres))
+        {
+            return;
+        }
+
+        // The first refresh runs right away
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (wake_.wait_until(
+                        lock,
+                        next,
+                        [this]()
+                        { return stopped_; }))
+                {
+                    break;
+                }
+            }
+
+            std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+            frame_.Clear();
+            hres = source_->Refresh(&frame_);
+            double timestamp_ms = static_cast<double>(
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) / 1000;
+            if (SUCCEEDED(hres))
+            {
+                buffer_.Append(timestamp_ms, frame_);
+            }
+
+            double lateness_ms = std::chrono::duration<double, std::milli>(started - next).count();
+            next += interval_;
+
+            // Skip the ticks the refresh overran, the next refresh serves the most recent one
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            uint64_t missed = now > next ? static_cast<uint64_t>((now - next) / interval_) : 0;
+            next += interval_ * missed;
+
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            if (SUCCEEDED(hres))
+            {
+                ++stats_.refreshes;
+                stats_.rows += frame_.GetRowCount();
+            }
+            else
+            {
+                ++stats_.failed_refreshes;
+                stats_.last_error = hres;
+            }
+            stats_.missed_ticks += missed;
+            stats_.max_lateness_ms = std::max(stats_.max_lateness_ms, lateness_ms);
+            total_lateness_ms_ += lateness_ms;
+        }
+
+        source_->Close();
+    }
+
+}
\ No newline at end of file
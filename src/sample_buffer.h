@@ -0,0 +1,255 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "columnar_results.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Maps the names of sampled instances to ids, so rows only carry a number. Ids are never
+     * reused while the table exists. Thread safe.
+     */
+    class SampleInstanceTable
+    {
+    public:
+        uint32_t GetId(const std::wstring &name);
+        std::vector<std::wstring> GetNames();
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<std::wstring, uint32_t> ids_;
+        std::vector<std::wstring> names_;
+    };
+
+    /**
+     * The rows produced by one refresh, one per instance. Frames are reused between refreshes,
+     * so sampling doesn't allocate once the number of instances is stable.
+     */
+    class SampleFrame
+    {
+    public:
+        SampleFrame(SampleInstanceTable *instances, size_t property_count);
+
+        // Starts the next refresh
+        void Clear();
+
+        /**
+         * Adds a row for an instance
+         *
+         * @return The row's property_count values to fill in, initialized to NaN
+         */
+        double *AddRow(const std::wstring &instance);
+
+        size_t GetRowCount() const
+        {
+            return instance_ids_.size();
+        }
+
+        size_t GetPropertyCount() const
+        {
+            return property_count_;
+        }
+
+        const uint32_t *GetInstanceIds() const
+        {
+            return instance_ids_.data();
+        }
+
+        // property_count values per row, row after row
+        const double *GetValues() const
+        {
+            return values_.data();
+        }
+
+    private:
+        SampleInstanceTable *instances_;
+        size_t property_count_;
+        std::vector<uint32_t> instance_ids_;
+        std::vector<double> values_;
+    };
+
+    /**
+     * Performance counters refreshed in place, an IWbemRefresher enumerator on Windows.
+     * Every method is called on the sampling thread.
+     */
+    class SampleSource
+    {
+    public:
+        virtual ~SampleSource() {}
+
+        // Registers the counters before the first refresh
+        virtual HRESULT Open() = 0;
+
+        // Refreshes the counters and adds one row per instance to the frame
+        virtual HRESULT Refresh(SampleFrame *frame) = 0;
+
+        // Releases the counters after the last refresh
+        virtual void Close() {}
+    };
+
+    /**
+     * Rows copied out of a SampleBuffer, laid out in one buffer that can become an ArrayBuffer:
+     * row_count timestamps, then one column of row_count values per property, then row_count
+     * instance ids.
+     */
+    struct SampleWindow
+    {
+        uint64_t first = 0; // Sequence number of the first row, the next read continues at first + row_count
+        uint64_t lost = 0;  // Rows after the requested one that were overwritten before they were read
+        size_t row_count = 0;
+        ColumnBuffer data;
+        size_t size = 0;
+        size_t values_offset = 0;
+        size_t instances_offset = 0;
+    };
+
+    /**
+     * Ring buffer holding the most recent capacity rows. Every row gets a sequence number, so
+     * readers can continue where they left off and tell how many rows they missed.
+     * Storage is allocated once, up front. Thread safe.
+     */
+    class SampleBuffer
+    {
+    public:
+        SampleBuffer(size_t capacity, size_t property_count);
+
+        void Append(double timestamp_ms, const SampleFrame &frame);
+
+        /**
+         * Copies up to max_rows rows, starting at sequence number since or at the oldest row still
+         * held when that one was already overwritten
+         *
+         * @return S_OK on success, E_OUTOFMEMORY if the window could not be allocated
+         */
+        HRESULT Read(uint64_t since, size_t max_rows, SampleWindow *window);
+
+        // Number of rows appended so far, which is the sequence number of the next row
+        uint64_t GetWrittenCount();
+
+    private:
+        // Copies count rows of a column stored per slot, starting at sequence number first
+        template <typename T>
+        void CopyColumn(const T *column, uint64_t first, size_t count, T *destination);
+
+        std::mutex mutex_;
+        size_t capacity_;
+        size_t property_count_;
+        uint64_t written_;
+
+        // Column-major, so a window is copied with at most two copies per column
+        std::vector<double> timestamps_;
+        std::vector<double> values_;
+        std::vector<uint32_t> instance_ids_;
+    };
+
+    struct SamplerStats
+    {
+        uint64_t refreshes = 0;        // Successful refreshes
+        uint64_t failed_refreshes = 0; // Refreshes that returned an error, see last_error
+        uint64_t missed_ticks = 0;     // Ticks skipped because a refresh overran the interval
+        uint64_t rows = 0;             // Rows appended to the buffer
+        uint64_t overwritten_rows = 0; // Rows pushed out of the buffer by newer ones
+        double mean_lateness_ms = 0;   // How long after their scheduled time refreshes started
+        double max_lateness_ms = 0;
+        HRESULT last_error = S_OK;
+    };
+
+    /**
+     * Refreshes a SampleSource on its own thread at a fixed rate and appends the rows to a
+     * SampleBuffer. Ticks are scheduled from the start time rather than from the end of the
+     * previous refresh, so slow refreshes don't make the sampler drift. A refresh that overruns
+     * the interval skips the ticks that already passed instead of running them back to back.
+     */
+    class SampleCollector
+    {
+    public:
+        SampleCollector(
+            std::unique_ptr<SampleSource> source,
+            size_t property_count,
+            size_t capacity,
+            std::chrono::microseconds interval);
+
+        ~SampleCollector();
+
+        /**
+         * Starts the sampling thread and waits until the source is open
+         *
+         * @return The result of SampleSource::Open, the collector is stopped when it failed
+         */
+        HRESULT Start();
+
+        // Stops the sampling thread, the samples stay readable
+        void Stop();
+
+        bool IsRunning();
+
+        HRESULT Read(uint64_t since, size_t max_rows, SampleWindow *window)
+        {
+            return buffer_.Read(since, max_rows, window);
+        }
+
+        std::vector<std::wstring> GetInstanceNames()
+        {
+            return instances_.GetNames();
+        }
+
+        SamplerStats GetStats();
+
+    private:
+        void Run();
+
+        std::unique_ptr<SampleSource> source_;
+        SampleInstanceTable instances_;
+        SampleBuffer buffer_;
+        SampleFrame frame_;
+        std::chrono::microseconds interval_;
+        size_t capacity_;
+
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool opened_;
+        bool stopped_;
+        HRESULT open_result_;
+
+        std::mutex stats_mutex_;
+        SamplerStats stats_;
+        double total_lateness_ms_;
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,344 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "sampler.h"
+
+#include <chrono>
+#include <limits>
+#include <utility>
+
+#include <napi.h>
+
+#include "marshalling.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+
+namespace wmi_wrapper
+{
+
+    const uint32_t kDefaultSamplerCapacity = 4096;
+    const uint32_t kMaxSamplerCapacity = 1 << 24;
+
+    Napi::Function Sampler::GetClass(
+        Napi::Env env)
+    {
+        return DefineClass(
+            env,
+            "Sampler",
+            {InstanceMethod("read", &Sampler::Read),
+             InstanceMethod("stats", &Sampler::Stats),
+             InstanceMethod("close", &Sampler::Close),
+             InstanceAccessor("active", &Sampler::GetActive, nullptr)});
+    }
+
+    Sampler::Sampler(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<Sampler>(info)
+    {
+    }
+
+    Sampler::~Sampler()
+    {
+        if (collector_)
+        {
+            napi_remove_env_cleanup_hook(Env(), StopOnEnvCleanup, this);
+            collector_->Stop();
+        }
+    }
+
+    HRESULT Sampler::Start(
+        Napi::Env env,
+        std::unique_ptr<SampleSource> source,
+        const std::vector<std::wstring> &properties,
+        size_t capacity,
+        uint32_t interval_ms)
+    {
+        for (const std::wstring &property : properties)
+        {
+            properties_.push_back(ConvertWstringToString(property));
+        }
+
+        collector_.reset(new SampleCollector(
+            std::move(source),
+            properties.size(),
+            capacity,
+            std::chrono::milliseconds(interval_ms)));
+
+        HRESULT hres = collector_->Start();
+        if (FAILED(hres))
+        {
+            collector_.reset();
+            return hres;
+        }
+
+        // The sampling thread never calls into JavaScript, so a sampler doesn't keep the process
+        // running, but it must stop before the environment goes away
+        napi_add_env_cleanup_hook(env, StopOnEnvCleanup, this);
+        return hres;
+    }
+
+    void Sampler::StopOnEnvCleanup(
+        void *data)
+    {
+        static_cast<Sampler *>(data)->collector_->Stop();
+    }
+
+    bool ReadCount(
+        Napi::Value value,
+        double min,
+        double max,
+        double *count)
+    {
+        if (value.IsUndefined())
+        {
+            return true;
+        }
+
+        double number = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+        if (!(number >= min && number <= max))
+        {
+            Napi::Error::New(value.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *count = number;
+        return true;
+    }
+
+    bool CheckStarted(
+        Napi::Env env,
+        const std::unique_ptr<SampleCollector> &collector)
+    {
+        // The constructor is reachable from JavaScript through the prototype of a sampler
+        if (!collector)
+        {
+            Napi::Error::New(env, "Sampler was not started").ThrowAsJavaScriptException();
+            return false;
+        }
+        return true;
+    }
+
+    Napi::Value Sampler::Read(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!CheckStarted(env, collector_))
+        {
+            return env.Null();
+        }
+
+        // Sequence numbers stay exact up to 2^53
+        double since = 0;
+        double max_rows = static_cast<double>(std::numeric_limits<uint32_t>::max());
+        if (info.Length() > 2 ||
+            !ReadCount(info[0], 0, 9007199254740991.0, &since) ||
+            !ReadCount(info[1], 1, max_rows, &max_rows))
+        {
+            if (!env.IsExceptionPending())
+            {
+                Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
+            }
+            return env.Null();
+        }
+
+        SampleWindow window;
+        HRESULT hres = collector_->Read(static_cast<uint64_t>(since), static_cast<size_t>(max_rows), &window);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        size_t row_count = window.row_count;
+        Napi::ArrayBuffer array_buffer = CreateColumnArrayBuffer(&window.data, window.size, env);
+
+        Napi::Array columns = Napi::Array::New(env, properties_.size());
+        Napi::Object data = Napi::Object::New(env);
+        for (size_t i = 0; i < properties_.size(); ++i)
+        {
+            columns.Set(static_cast<uint32_t>(i), Napi::String::New(env, properties_[i]));
+            data.Set(
+                properties_[i],
+                Napi::Float64Array::New(env, row_count, array_buffer, window.values_offset + i * row_count * sizeof(double), napi_float64_array));
+        }
+
+        std::vector<std::wstring> names = collector_->GetInstanceNames();
+        Napi::Array instance_names = Napi::Array::New(env, names.size());
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            instance_names.Set(static_cast<uint32_t>(i), ConvertWstringToJsString(names[i], env));
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("cursor", Napi::Number::New(env, static_cast<double>(window.first + row_count)));
+        result.Set("lost", Napi::Number::New(env, static_cast<double>(window.lost)));
+        result.Set("rows", Napi::Number::New(env, static_cast<double>(row_count)));
+        result.Set("timestamps", Napi::Float64Array::New(env, row_count, array_buffer, 0, napi_float64_array));
+        result.Set("instances", Napi::Uint32Array::New(env, row_count, array_buffer, window.instances_offset, napi_uint32_array));
+        result.Set("instanceNames", instance_names);
+        result.Set("columns", columns);
+        result.Set("data", data);
+        return result;
+    }
+
+    Napi::Value Sampler::Stats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!CheckStarted(env, collector_))
+        {
+            return env.Null();
+        }
+        SamplerStats stats = collector_->GetStats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("refreshes", Napi::Number::New(env, static_cast<double>(stats.refreshes)));
+        result.Set("failedRefreshes", Napi::Number::New(env, static_cast<double>(stats.failed_refreshes)));
+        result.Set("missedTicks", Napi::Number::New(env, static_cast<double>(stats.missed_ticks)));
+        result.Set("rows", Napi::Number::New(env, static_cast<double>(stats.rows)));
+        result.Set("overwrittenRows", Napi::Number::New(env, static_cast<double>(stats.overwritten_rows)));
+        result.Set("meanLatenessMs", Napi::Number::New(env, stats.mean_lateness_ms));
+        result.Set("maxLatenessMs", Napi::Number::New(env, stats.max_lateness_ms));
+        result.Set("lastError", FAILED(stats.last_error) ? Napi::Number::New(env, stats.last_error) : env.Null());
+        return result;
+    }
+
+    Napi::Value Sampler::Close(
+        const Napi::CallbackInfo &info)
+    {
+        if (collector_)
+        {
+            collector_->Stop();
+        }
+        return info.Env().Undefined();
+    }
+
+    Napi::Value Sampler::GetActive(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Boolean::New(info.Env(), collector_ && collector_->IsRunning());
+    }
+
+    Napi::Value WmiCreateSampler(
+        const Napi::CallbackInfo &info)
+    {
+        const size_t kNamespaceParam = 0;
+        const size_t kClassParam = 1;
+        const size_t kPropertiesParam = 2;
+        const size_t kIntervalParam = 3;
+        const size_t kOptionsParam = 4; // optional
+
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        if (info.Length() < 4 || info.Length() > 5)
+        {
+            Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool has_options = info.Length() > kOptionsParam && !info[kOptionsParam].IsUndefined();
+        if (!info[kNamespaceParam].IsString() ||
+            !info[kClassParam].IsString() ||
+            info[kClassParam].As<Napi::String>().Utf8Value().empty() ||
+            !info[kPropertiesParam].IsArray() ||
+            info[kPropertiesParam].As<Napi::Array>().Length() == 0 ||
+            (has_options && !info[kOptionsParam].IsObject()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::String wmi_namespace = info[kNamespaceParam].As<Napi::String>();
+        if (!CheckNamespace(wmi_namespace))
+        {
+            return env.Null();
+        }
+
+        Napi::Array property_list = info[kPropertiesParam].As<Napi::Array>();
+        std::vector<std::wstring> properties;
+        for (uint32_t i = 0; i < property_list.Length(); ++i)
+        {
+            Napi::Value property = property_list.Get(i);
+            if (!property.IsString())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            properties.push_back(ConvertStringToWstring(property.As<Napi::String>().Utf8Value()));
+        }
+
+        double interval_ms = 0;
+        double capacity = kDefaultSamplerCapacity;
+        if (!info[kIntervalParam].IsNumber() ||
+            !ReadCount(info[kIntervalParam], 1, std::numeric_limits<uint32_t>::max(), &interval_ms) ||
+            (has_options && !ReadCount(info[kOptionsParam].As<Napi::Object>().Get("capacity"), 1, kMaxSamplerCapacity, &capacity)))
+        {
+            if (!env.IsExceptionPending())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            }
+            return env.Null();
+        }
+
+        std::unique_ptr<SampleSource> source;
+        HRESULT hres = provider->CreateSampleSource(
+            wmi_namespace.Utf8Value(),
+            ConvertStringToWstring(info[kClassParam].As<Napi::String>().Utf8Value()),
+            properties,
+            &source);
+
+        Napi::Object sampler = GetAddonData(env)->sampler_constructor.New({});
+        if (SUCCEEDED(hres))
+        {
+            hres = Sampler::Unwrap(sampler)->Start(
+                env,
+                std::move(source),
+                properties,
+                static_cast<size_t>(capacity),
+                static_cast<uint32_t>(interval_ms));
+        }
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return sampler;
+    }
+
+    void RegisterSamplers(
+        Napi::Env env,
+        Napi::Object exports,
+        AddonData *addon_data)
+    {
+        addon_data->sampler_constructor = Napi::Persistent(Sampler::GetClass(env));
+        exports.Set("createSampler", Napi::Function::New(env, wmi_wrapper::WmiCreateSampler));
+    }
+
+}
\ No newline at end of file
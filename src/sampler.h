@@ -0,0 +1,92 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "addon_data.h"
+#include "sample_buffer.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Handle returned by createSampler.
+     *
+     * The counters are refreshed on a native thread into a preallocated ring buffer, JavaScript
+     * only runs when it reads a window of samples, which it gets as TypedArrays over one buffer.
+     */
+    class Sampler : public Napi::ObjectWrap<Sampler>
+    {
+    public:
+        static Napi::Function GetClass(Napi::Env env);
+
+        explicit Sampler(const Napi::CallbackInfo &info);
+        ~Sampler() override;
+
+        /**
+         * Opens the source on the sampling thread and starts refreshing it
+         *
+         * @return The result of opening the source
+         */
+        HRESULT Start(
+            Napi::Env env,
+            std::unique_ptr<SampleSource> source,
+            const std::vector<std::wstring> &properties,
+            size_t capacity,
+            uint32_t interval_ms);
+
+    private:
+        Napi::Value Read(const Napi::CallbackInfo &info);
+        Napi::Value Stats(const Napi::CallbackInfo &info);
+        Napi::Value Close(const Napi::CallbackInfo &info);
+        Napi::Value GetActive(const Napi::CallbackInfo &info);
+
+        static void StopOnEnvCleanup(void *data);
+
+        std::unique_ptr<SampleCollector> collector_;
+        std::vector<std::string> properties_;
+    };
+
+    /**
+     * Samples numeric properties of every instance of a class, typically performance counters,
+     * at a fixed interval
+     *
+     * @param info[0] String containing the Namespace
+     * @param info[1] String containing the class name (example: 'Win32_PerfFormattedData_PerfOS_Processor')
+     * @param info[2] Array of strings containing the numeric properties to sample
+     * @param info[3] Number of milliseconds between refreshes
+     * @param info[4] Optional: Object with capacity (number of rows kept, default 4096)
+     * @return An object with read(since?, maxRows?), stats(), close() and active
+     */
+    Napi::Value WmiCreateSampler(const Napi::CallbackInfo &info);
+
+    void RegisterSamplers(Napi::Env env, Napi::Object exports, AddonData *addon_data);
+
+};
\ No newline at end of file
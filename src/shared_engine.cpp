@@ -0,0 +1,77 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "shared_engine.h"
+
+namespace wmi_wrapper
+{
+
+    void SharedEngine::Attach()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.environments++;
+        stats_.attached++;
+    }
+
+    bool SharedEngine::Detach(
+        const Release &release)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--stats_.environments > 0)
+        {
+            return false;
+        }
+
+        release();
+        stats_.releases++;
+        return true;
+    }
+
+    bool SharedEngine::ReleaseUnused(
+        const Release &release)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stats_.environments > 0)
+        {
+            return false;
+        }
+
+        release();
+        stats_.releases++;
+        return true;
+    }
+
+    SharedEngineStats SharedEngine::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    SharedEngine &GetSharedEngine()
+    {
+        static SharedEngine engine;
+        return engine;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace wmi_wrapper
+{
+
+    struct SharedEngineStats
+    {
+        uint64_t environments = 0; // Environments that have the module loaded
+        uint64_t attached = 0;     // Environments that loaded the module since the process started
+        uint64_t releases = 0;     // Times the last environment went away and the engine was released
+    };
+
+    // Whether an environment still holds its share of the engine, it gives it up when it closes the module
+    struct EngineShare
+    {
+        bool attached = false;
+    };
+
+    /**
+     * Counts the Node.js environments, the main thread and every worker_threads Worker, that loaded the
+     * module. They share one set of providers, worker threads, pooled connections and cached results,
+     * while each keeps its own JavaScript state (see AddonData), so an environment that goes away must
+     * leave the shared state to the others. All methods are thread safe.
+     */
+    class SharedEngine
+    {
+    public:
+        typedef std::function<void()> Release;
+
+        void Attach();
+
+        /**
+         * @param release Runs when this was the last environment, environments attaching meanwhile
+         *                wait until it returned
+         * @return true when release ran
+         */
+        bool Detach(const Release &release);
+
+        /**
+         * Runs release when no environment is attached, for an environment that already detached
+         *
+         * @return true when release ran
+         */
+        bool ReleaseUnused(const Release &release);
+
+        SharedEngineStats GetStats();
+
+    private:
+        std::mutex mutex_;
+        SharedEngineStats stats_;
+    };
+
+    SharedEngine &GetSharedEngine();
+
+};
\ No newline at end of file
@@ -0,0 +1,400 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "snapshot_bindings.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <napi.h>
+
+#include "marshalling.h"
+#include "pool_worker.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "stats_bindings.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    const char kSnapshotClosedMessage[] = "Snapshot watch is closed";
+
+    std::string GetSnapshotErrorMessage(
+        HRESULT hres)
+    {
+        if (hres == kSnapshotKeyMissing)
+        {
+            return "Instance is missing a key property";
+        }
+        // A snapshot cut short would report the instances it missed as removed
+        if (hres == kQueryTimedOut || hres == kQueryMaxRows || hres == kQueryMaxBytes)
+        {
+            return "Snapshot query stopped at a limit, the previous snapshot was kept";
+        }
+        return GetQueryErrorMessage(hres);
+    }
+
+    // Polls on a worker thread, queued like queryAsync
+    class SnapshotPollWorker : public PoolWorker
+    {
+    public:
+        SnapshotPollWorker(
+            Napi::Env env,
+            QueryProvider *provider,
+            std::shared_ptr<const PreparedQuery> prepared,
+            std::shared_ptr<SnapshotDiffer> differ,
+            const QueryOptions &options,
+            AbortListener abort)
+            : PoolWorker(env, "wmi_native_module:pollSnapshot"),
+              deferred_(Napi::Promise::Deferred::New(env)),
+              provider_(provider),
+              prepared_(std::move(prepared)),
+              differ_(std::move(differ)),
+              options_(options),
+              abort_(std::move(abort))
+        {
+            options_.prepared = prepared_.get();
+            StartQueryTimings(&options_, &timings_);
+            queued_ = StageTimer(options_.timings);
+        }
+
+        Napi::Promise GetPromise() const
+        {
+            return deferred_.Promise();
+        }
+
+        void Queue()
+        {
+            PoolWorker::Queue(provider_->GetWorkerPool(), options_.priority);
+        }
+
+    protected:
+        void Execute(HRESULT thread_status) override
+        {
+            queued_.Lap(kQueueStage);
+            ResultSet results;
+            hres_ = SUCCEEDED(thread_status) ? provider_->Query(prepared_->GetNamespace(), prepared_->GetParams(), options_, &results) : thread_status;
+            CountQueryResults(results, options_);
+            // A rejected query found nothing to compare, diffing its empty set would report every
+            // instance removed and then added again by the next poll. The snapshot is kept instead.
+            if (hres_ == S_OK && !FAILED(results.GetRejected()))
+            {
+                StageTimer timer(options_.timings);
+                hres_ = differ_->Update(std::move(results), &changes_);
+                timer.Lap(kMarshalStage);
+            }
+            if (hres_ != S_OK)
+            {
+                SetError(GetSnapshotErrorMessage(hres_));
+            }
+        }
+
+        void OnOK() override
+        {
+            Napi::Env env = Env();
+            StageTimer timer(options_.timings);
+
+            Napi::Object result = Napi::Object::New(env);
+            // A rejected poll has no current snapshot and no changes
+            result.Set("added", changes_.current
+                                    ? ConvertResultRows(*changes_.current, changes_.added, options_, env)
+                                    : Napi::Array::New(env));
+            result.Set("removed", changes_.previous
+                                      ? ConvertResultRows(*changes_.previous, changes_.removed, options_, env)
+                                      : Napi::Array::New(env));
+            result.Set("changed", changes_.current
+                                      ? ConvertResultRows(*changes_.current, changes_.changed, options_, env)
+                                      : Napi::Array::New(env));
+
+            // One view per changed instance on a single buffer
+            size_t mask_bytes = changes_.change_masks.size() * sizeof(uint32_t);
+            Napi::ArrayBuffer mask_buffer = Napi::ArrayBuffer::New(env, mask_bytes);
+            if (mask_bytes > 0)
+            {
+                std::memcpy(mask_buffer.Data(), changes_.change_masks.data(), mask_bytes);
+            }
+            Napi::Array change_masks = Napi::Array::New(env, changes_.changed.size());
+            for (size_t i = 0; i < changes_.changed.size(); ++i)
+            {
+                change_masks.Set(
+                    static_cast<uint32_t>(i),
+                    Napi::Uint32Array::New(env, changes_.mask_words, mask_buffer, i * changes_.mask_words * sizeof(uint32_t), napi_uint32_array));
+            }
+            result.Set("changeMasks", change_masks);
+            timer.Lap(kMarshalStage);
+
+            // The previous snapshot was only kept for its removed instances
+            changes_ = SnapshotChanges();
+            FinishQueryTimings(prepared_->GetNamespace(), prepared_->GetParams(), hres_, options_, result);
+            abort_.Stop();
+            deferred_.Resolve(result);
+        }
+
+        void OnError(const Napi::Error &error) override
+        {
+            FinishQueryTimings(prepared_->GetNamespace(), prepared_->GetParams(), hres_, options_, Env().Undefined());
+            abort_.Stop();
+            deferred_.Reject(hres_ == kQueryCancelled ? abort_.GetReason(Env()) : error.Value());
+        }
+
+        void OnEnvCleanup() override
+        {
+            abort_.Release();
+        }
+
+    private:
+        Napi::Promise::Deferred deferred_;
+        QueryProvider *provider_;
+        std::shared_ptr<const PreparedQuery> prepared_;
+        std::shared_ptr<SnapshotDiffer> differ_;
+        QueryOptions options_;
+        QueryTimings timings_;
+        StageTimer queued_ = StageTimer(NULL); // Time waiting for a worker thread
+        AbortListener abort_;
+        HRESULT hres_ = S_OK;
+        SnapshotChanges changes_;
+    };
+
+    Napi::Function SnapshotWatch::GetClass(
+        Napi::Env env)
+    {
+        return DefineClass(
+            env,
+            "SnapshotWatch",
+            {InstanceMethod("poll", &SnapshotWatch::Poll),
+             InstanceMethod("close", &SnapshotWatch::Close),
+             InstanceAccessor("keyProperties", &SnapshotWatch::GetKeyProperties, nullptr),
+             InstanceAccessor("rows", &SnapshotWatch::GetRows, nullptr),
+             InstanceAccessor("closed", &SnapshotWatch::GetClosed, nullptr)});
+    }
+
+    SnapshotWatch::SnapshotWatch(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<SnapshotWatch>(info)
+    {
+    }
+
+    void SnapshotWatch::Init(
+        std::shared_ptr<const PreparedQuery> prepared,
+        std::shared_ptr<SnapshotDiffer> differ,
+        const QueryOptions &options)
+    {
+        prepared_ = std::move(prepared);
+        differ_ = std::move(differ);
+        options_ = options;
+    }
+
+    Napi::Value SnapshotWatch::Poll(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            deferred.Reject(Napi::Error::New(env, kUnsupportedOsMessage).Value());
+            return deferred.Promise();
+        }
+        if (!prepared_)
+        {
+            deferred.Reject(Napi::Error::New(env, kSnapshotClosedMessage).Value());
+            return deferred.Promise();
+        }
+        if (info.Length() > 1 || (info.Length() == 1 && !info[0].IsUndefined() && !info[0].IsObject()))
+        {
+            deferred.Reject(Napi::Error::New(env, "Invalid Parameter").Value());
+            return deferred.Promise();
+        }
+
+        // Options left out of the poll keep the value given to watchSnapshot
+        QueryOptions options = options_;
+        AbortListener abort;
+        if (info.Length() == 1 && !info[0].IsUndefined())
+        {
+            Napi::Object poll_options = info[0].As<Napi::Object>();
+            if (!ParseQueryOptions(poll_options, &options) || !abort.Listen(poll_options, &options))
+            {
+                deferred.Reject(env.GetAndClearPendingException().Value());
+                return deferred.Promise();
+            }
+            if (options.aggregate || options.lazy_objects)
+            {
+                abort.Stop();
+                deferred.Reject(Napi::Error::New(env, "Invalid Parameter").Value());
+                return deferred.Promise();
+            }
+        }
+        options.columnar = false;
+        options.cache_ttl_ms = 0;
+        if (abort.IsAborted())
+        {
+            deferred.Reject(abort.GetReason(env));
+            return deferred.Promise();
+        }
+
+        // The worker deletes itself once the Promise has been settled
+        SnapshotPollWorker *worker = new SnapshotPollWorker(env, provider, prepared_, differ_, options, std::move(abort));
+        Napi::Promise promise = worker->GetPromise();
+        worker->Queue();
+        return promise;
+    }
+
+    Napi::Value SnapshotWatch::Close(
+        const Napi::CallbackInfo &info)
+    {
+        // Polls that are still in progress keep the query and snapshot until they are done
+        prepared_.reset();
+        differ_.reset();
+        return info.Env().Undefined();
+    }
+
+    Napi::Value SnapshotWatch::GetKeyProperties(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (!differ_)
+        {
+            return env.Null();
+        }
+
+        const std::vector<std::wstring> &keys = differ_->GetKeyProperties();
+        Napi::Array key_list = Napi::Array::New(env, keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            key_list.Set(static_cast<uint32_t>(i), ConvertWstringToJsString(keys[i], env));
+        }
+        return key_list;
+    }
+
+    Napi::Value SnapshotWatch::GetRows(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Number::New(info.Env(), differ_ ? static_cast<double>(differ_->GetRowCount()) : 0);
+    }
+
+    Napi::Value SnapshotWatch::GetClosed(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Boolean::New(info.Env(), !prepared_);
+    }
+
+    Napi::Value WmiWatchSnapshot(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        // The key properties take the place of the properties of the other query entry points
+        std::string wmi_namespace;
+        WmiQueryParams wstr_params;
+        Napi::Object options;
+        QueryOptions query_options;
+        if (!ParseQueryArguments(info, &wmi_namespace, &wstr_params, &options) ||
+            !ParseQueryOptions(options, &query_options))
+        {
+            return env.Null();
+        }
+        // Snapshots are made of instances that outlive the poll, there is nothing to aggregate or read lazily
+        if (query_options.aggregate || query_options.lazy_objects)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        // Diffs are always rows, and a cached snapshot would never differ from the last one
+        query_options.columnar = false;
+        query_options.cache_ttl_ms = 0;
+
+        SelectQuery select;
+        if (!ParseSelectQuery(wstr_params.first, &select))
+        {
+            Napi::Error::New(env, "Invalid Query").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::vector<std::wstring> properties = std::move(select.properties);
+        Napi::Value property_list = options.Get("properties");
+        if (!property_list.IsUndefined())
+        {
+            if (!property_list.IsArray())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+            properties = GetWstrParams(Napi::String::New(env, ""), property_list.As<Napi::Array>(), env).second;
+            if (env.IsExceptionPending())
+            {
+                return env.Null();
+            }
+        }
+
+        std::shared_ptr<SnapshotDiffer> differ = std::make_shared<SnapshotDiffer>(std::move(wstr_params.second));
+        // Instances are matched by their keys, so a property list always reads them
+        if (!properties.empty())
+        {
+            for (const std::wstring &key : differ->GetKeyProperties())
+            {
+                if (!ContainsIgnoreCase(properties, key))
+                {
+                    properties.push_back(key);
+                }
+            }
+        }
+
+        std::shared_ptr<const PreparedQuery> prepared;
+        HRESULT hres = PreparedQuery::Create(
+            std::move(wmi_namespace),
+            std::move(wstr_params.first),
+            std::move(properties),
+            &prepared);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, hres == E_INVALIDARG ? "Invalid Query" : GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object watch = GetAddonData(env)->snapshot_watch_constructor.New({});
+        SnapshotWatch::Unwrap(watch)->Init(std::move(prepared), std::move(differ), query_options);
+        return watch;
+    }
+
+    void RegisterSnapshotWatches(
+        Napi::Env env,
+        Napi::Object exports,
+        AddonData *addon_data)
+    {
+        addon_data->snapshot_watch_constructor = Napi::Persistent(SnapshotWatch::GetClass(env));
+        exports.Set("watchSnapshot", Napi::Function::New(env, wmi_wrapper::WmiWatchSnapshot));
+    }
+
+}
\ No newline at end of file
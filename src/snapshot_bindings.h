@@ -0,0 +1,84 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+
+#include "abort_signal.h"
+#include "addon_data.h"
+#include "prepared_query.h"
+#include "query_types.h"
+#include "snapshot_diff.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Handle returned by watchSnapshot. It keeps the last snapshot of its query natively, each poll
+     * runs the query on a worker thread and only converts the instances that were added, removed or
+     * changed since the previous poll.
+     */
+    class SnapshotWatch : public Napi::ObjectWrap<SnapshotWatch>
+    {
+    public:
+        static Napi::Function GetClass(Napi::Env env);
+
+        explicit SnapshotWatch(const Napi::CallbackInfo &info);
+
+        void Init(std::shared_ptr<const PreparedQuery> prepared, std::shared_ptr<SnapshotDiffer> differ, const QueryOptions &options);
+
+    private:
+        Napi::Value Poll(const Napi::CallbackInfo &info);
+        Napi::Value Close(const Napi::CallbackInfo &info);
+        Napi::Value GetKeyProperties(const Napi::CallbackInfo &info);
+        Napi::Value GetRows(const Napi::CallbackInfo &info);
+        Napi::Value GetClosed(const Napi::CallbackInfo &info);
+
+        std::shared_ptr<const PreparedQuery> prepared_; // NULL once closed
+        std::shared_ptr<SnapshotDiffer> differ_;        // NULL once closed
+        QueryOptions options_;
+    };
+
+    /**
+     * Watches the results of a query by polling it and reporting the differences between snapshots
+     *
+     * @param info[0] String containing the Namespace
+     * @param info[1] String containing a WQL SELECT query
+     * @param info[2] Optional: Array of strings containing the properties that identify an instance, __PATH when
+     *                left out or empty
+     * @param info[3] Optional: Object with properties (the properties to read, taken from the select list when
+     *                left out, the key properties are always read) and the options of every poll, see
+     *                ParseQueryOptions. Results are always returned as rows and never served from the cache.
+     * @return An object with poll(options?), close(), keyProperties, rows and closed. poll returns a Promise
+     *         resolved with { added, removed, changed, changeMasks }, changeMasks holding one Uint32Array per
+     *         changed instance with bit j set when its j-th property changed.
+     */
+    Napi::Value WmiWatchSnapshot(const Napi::CallbackInfo &info);
+
+    void RegisterSnapshotWatches(Napi::Env env, Napi::Object exports, AddonData *addon_data);
+
+};
\ No newline at end of file
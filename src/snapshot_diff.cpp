@@ -0,0 +1,220 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "snapshot_diff.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    SnapshotDiffer::SnapshotDiffer(
+        std::vector<std::wstring> key_properties)
+        : key_properties_(std::move(key_properties))
+    {
+        if (key_properties_.empty())
+        {
+            key_properties_.push_back(kPathProperty);
+        }
+    }
+
+    HRESULT SnapshotDiffer::HashRows(
+        Snapshot *snapshot) const
+    {
+        const ResultSet &results = *snapshot->results;
+
+        // Names and key positions are looked up once per schema
+        std::vector<std::vector<uint64_t>> name_hashes(results.GetSchemaCount());
+        snapshot->key_columns.resize(results.GetSchemaCount());
+        for (size_t schema = 0; schema < results.GetSchemaCount(); ++schema)
+        {
+            const ResultSet::Schema &names = results.GetSchema(schema);
+            for (const std::wstring &name : names)
+            {
+                uint64_t hash = kHashOffset;
+                for (wchar_t c : name)
+                {
+                    hash = HashUnit(hash, static_cast<uint64_t>(c));
+                }
+                name_hashes[schema].push_back(hash);
+            }
+
+            for (const std::wstring &key : key_properties_)
+            {
+                size_t column = 0;
+                while (column < names.size() && !EqualsIgnoreCase(names[column], key))
+                {
+                    ++column;
+                }
+                if (column == names.size())
+                {
+                    return kSnapshotKeyMissing;
+                }
+                snapshot->key_columns[schema].push_back(column);
+            }
+        }
+
+        snapshot->rows.resize(results.size());
+        snapshot->index.reserve(results.size());
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            size_t schema = results.GetSchemaIndex(i);
+            const std::vector<uint64_t> &names = name_hashes[schema];
+            const ResultSet::Value *values = results.GetValues(i);
+
+            Row &row = snapshot->rows[i];
+            row.first_hash = static_cast<uint32_t>(snapshot->property_hashes.size());
+            row.property_count = static_cast<uint32_t>(names.size());
+            row.row_hash = HashUnit(kHashOffset, names.size());
+            for (size_t j = 0; j < names.size(); ++j)
+            {
+                uint64_t hash = HashValue(results, values[j], names[j]);
+                snapshot->property_hashes.push_back(hash);
+                row.row_hash = HashUnit(row.row_hash, hash);
+            }
+
+            row.key_hash = kHashOffset;
+            for (size_t column : snapshot->key_columns[schema])
+            {
+                row.key_hash = HashValue(results, values[column], row.key_hash);
+            }
+            snapshot->index.emplace(row.key_hash, static_cast<uint32_t>(i));
+        }
+        return S_OK;
+    }
+
+    bool SnapshotDiffer::FindPrevious(
+        const Snapshot &next,
+        uint32_t row,
+        const std::vector<bool> &matched,
+        uint32_t *previous_row) const
+    {
+        const ResultSet &results = *next.results;
+        const std::vector<size_t> &key_columns = next.key_columns[results.GetSchemaIndex(row)];
+        const ResultSet::Value *values = results.GetValues(row);
+
+        auto candidates = snapshot_.index.equal_range(next.rows[row].key_hash);
+        for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+        {
+            uint32_t previous = candidate->second;
+            if (matched[previous])
+            {
+                continue;
+            }
+
+            // Equal hashes are only a hint, the key values decide
+            const ResultSet &previous_results = *snapshot_.results;
+            const std::vector<size_t> &previous_columns = snapshot_.key_columns[previous_results.GetSchemaIndex(previous)];
+            const ResultSet::Value *previous_values = previous_results.GetValues(previous);
+            bool same_key = true;
+            for (size_t k = 0; k < key_columns.size() && same_key; ++k)
+            {
+                same_key = ValuesEqual(results, values[key_columns[k]], previous_results, previous_values[previous_columns[k]]);
+            }
+            if (same_key)
+            {
+                *previous_row = previous;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    HRESULT SnapshotDiffer::Update(
+        ResultSet results,
+        SnapshotChanges *changes)
+    {
+        // Hashing takes most of the time and doesn't need the previous snapshot
+        Snapshot next;
+        next.results = std::make_shared<const ResultSet>(std::move(results));
+        HRESULT hres = HashRows(&next);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        changes->current = next.results;
+        changes->previous = snapshot_.results;
+
+        std::vector<bool> matched(snapshot_.rows.size(), false);
+        std::vector<uint32_t> changed_from;
+        uint32_t max_properties = 0;
+        for (uint32_t i = 0; i < next.rows.size(); ++i)
+        {
+            uint32_t previous = 0;
+            if (!FindPrevious(next, i, matched, &previous))
+            {
+                changes->added.push_back(i);
+                continue;
+            }
+
+            matched[previous] = true;
+            if (next.rows[i].row_hash != snapshot_.rows[previous].row_hash)
+            {
+                changes->changed.push_back(i);
+                changed_from.push_back(previous);
+                max_properties = std::max(max_properties, next.rows[i].property_count);
+            }
+        }
+
+        for (uint32_t previous = 0; previous < matched.size(); ++previous)
+        {
+            if (!matched[previous])
+            {
+                changes->removed.push_back(previous);
+            }
+        }
+
+        changes->mask_words = (max_properties + 31) / 32;
+        changes->change_masks.assign(changes->changed.size() * changes->mask_words, 0);
+        for (size_t c = 0; c < changes->changed.size(); ++c)
+        {
+            const Row &row = next.rows[changes->changed[c]];
+            const Row &previous = snapshot_.rows[changed_from[c]];
+            uint32_t *mask = &changes->change_masks[c * changes->mask_words];
+            for (uint32_t j = 0; j < row.property_count; ++j)
+            {
+                if (row.property_count != previous.property_count ||
+                    next.property_hashes[row.first_hash + j] != snapshot_.property_hashes[previous.first_hash + j])
+                {
+                    mask[j / 32] |= 1u << (j % 32);
+                }
+            }
+        }
+
+        snapshot_ = std::move(next);
+        return S_OK;
+    }
+
+    size_t SnapshotDiffer::GetRowCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshot_.rows.size();
+    }
+
+}
\ No newline at end of file
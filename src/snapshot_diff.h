@@ -0,0 +1,130 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "query_types.h"
+#include "result_set.h"
+
+namespace wmi_wrapper
+{
+
+    // The key of an instance, the property that identifies it when no key properties are given
+    const wchar_t kPathProperty[] = L"__PATH";
+
+    // Returned when an instance doesn't have one of the key properties
+    const HRESULT kSnapshotKeyMissing = static_cast<HRESULT>(0x80041002L); // Same as WBEM_E_NOT_FOUND
+
+    /**
+     * How a snapshot differs from the one before it. Rows refer to the snapshots, which stay alive as
+     * long as the changes do.
+     */
+    struct SnapshotChanges
+    {
+        std::shared_ptr<const ResultSet> current;  // The new snapshot
+        std::shared_ptr<const ResultSet> previous; // The snapshot it replaced, NULL for the first one
+
+        std::vector<uint32_t> added;   // Rows of current whose key wasn't in previous
+        std::vector<uint32_t> changed; // Rows of current with a value that differs from previous
+        std::vector<uint32_t> removed; // Rows of previous whose key isn't in current
+
+        // mask_words words per changed row. Bit j (of word j / 32) is set when the j-th property of
+        // the row changed or wasn't there before, every bit when the row has a different number of properties.
+        std::vector<uint32_t> change_masks;
+        uint32_t mask_words = 0;
+    };
+
+    /**
+     * Keeps the last snapshot of a query as hashed rows and reports how each new snapshot differs
+     * from it, so a poller only converts what changed.
+     *
+     * Instances are matched by the values of their key properties (__PATH by default). Every value
+     * is hashed once when its snapshot comes in; an instance whose hashes match the ones of its
+     * previous version is unchanged without comparing its values. Instances that share a key are
+     * paired up one to one. Updates are serialized, the engine doesn't depend on WMI.
+     */
+    class SnapshotDiffer
+    {
+    public:
+        /**
+         * @param key_properties Properties whose values identify an instance, empty for __PATH
+         */
+        explicit SnapshotDiffer(std::vector<std::wstring> key_properties);
+
+        const std::vector<std::wstring> &GetKeyProperties() const
+        {
+            return key_properties_;
+        }
+
+        /**
+         * Makes results the snapshot and reports how it differs from the previous one. The first
+         * snapshot reports every instance as added.
+         *
+         * @return kSnapshotKeyMissing, leaving the snapshot as it was, when an instance doesn't have
+         *         all key properties
+         */
+        HRESULT Update(ResultSet results, SnapshotChanges *changes);
+
+        // Instances in the snapshot
+        size_t GetRowCount();
+
+    private:
+        // The hashes of one instance of the snapshot
+        struct Row
+        {
+            uint64_t key_hash;
+            uint64_t row_hash;        // Of every name and value, compared first
+            uint32_t first_hash;      // Index of its first property hash in property_hashes
+            uint32_t property_count;
+        };
+
+        struct Snapshot
+        {
+            std::shared_ptr<const ResultSet> results;
+            std::vector<Row> rows; // One per row of results
+            std::vector<uint64_t> property_hashes;
+            std::vector<std::vector<size_t>> key_columns; // Positions of the key properties per schema of results
+            std::unordered_multimap<uint64_t, uint32_t> index; // Key hash to row
+        };
+
+        // Hashes every row of snapshot->results
+        HRESULT HashRows(Snapshot *snapshot) const;
+
+        // Finds the row of the snapshot with the key of row of next that isn't matched yet, or returns false
+        bool FindPrevious(const Snapshot &next, uint32_t row, const std::vector<bool> &matched, uint32_t *previous_row) const;
+
+        std::vector<std::wstring> key_properties_;
+        std::mutex mutex_;
+        Snapshot snapshot_;
+    };
+
+};
\ No newline at end of file
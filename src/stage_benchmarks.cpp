@@ -0,0 +1,367 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "stage_benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#include "marshalling.h"
+#include "query_types.h"
+#include "result_set.h"
+#include "stand_in_provider.h"
+#include "variant_conversion.h"
+
+namespace wmi_wrapper
+{
+
+    // Same cap as Google Benchmark
+    const uint64_t kMaxStageIterations = 1000000000;
+
+    // Stand-in properties with a typed representation, the rest of the properties are strings
+    const wchar_t *const kBenchmarkTypedProperties[] = {L"Count", L"Total", L"InstallDate", L"Enabled", L"Ratio", L"Label", L"Samples", L"Level"};
+
+    StageBenchmarkResult RunStageBenchmark(
+        const std::string &name,
+        uint32_t min_time_ms,
+        const std::function<void(uint64_t iterations)> &body)
+    {
+        const double min_time_ns = static_cast<double>(min_time_ms) * 1e6;
+
+        StageBenchmarkResult result;
+        result.name = name;
+        uint64_t iterations = 1;
+        for (;;)
+        {
+            std::clock_t cpu_start = std::clock();
+            auto start = std::chrono::steady_clock::now();
+            body(iterations);
+            double real_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            double cpu_ns = static_cast<double>(std::clock() - cpu_start) * 1e9 / CLOCKS_PER_SEC;
+
+            if (real_ns >= min_time_ns || iterations >= kMaxStageIterations)
+            {
+                result.iterations = iterations;
+                result.real_time_ns = real_ns / static_cast<double>(iterations);
+                result.cpu_time_ns = cpu_ns / static_cast<double>(iterations);
+                return result;
+            }
+
+            // Aim 40% past the minimum so the next run is likely the last, growing at most tenfold
+            double multiplier = real_ns > 0 ? std::min(min_time_ns * 1.4 / real_ns, 10.0) : 10.0;
+            uint64_t next = static_cast<uint64_t>(static_cast<double>(iterations) * multiplier);
+            iterations = std::min(std::max(next, iterations + 1), kMaxStageIterations);
+        }
+    }
+
+    std::vector<std::wstring> GetBenchmarkProperties(
+        const StageBenchmarkOptions &options)
+    {
+        std::vector<std::wstring> properties;
+        for (uint32_t i = 0; i < options.properties; ++i)
+        {
+            size_t typed_count = sizeof(kBenchmarkTypedProperties) / sizeof(kBenchmarkTypedProperties[0]);
+            properties.push_back(options.typed && i < typed_count ? std::wstring(kBenchmarkTypedProperties[i])
+                                                                  : L"Property" + std::to_wstring(i));
+        }
+        return properties;
+    }
+
+    WmiQueryParams GetBenchmarkQuery(
+        const StageBenchmarkOptions &options)
+    {
+        std::vector<std::wstring> properties = GetBenchmarkProperties(options);
+        std::wstring query = L"SELECT ";
+        for (size_t i = 0; i < properties.size(); ++i)
+        {
+            query += i == 0 ? L"" : L", ";
+            query += properties[i];
+        }
+        query += L" FROM StandIn_Benchmark";
+        return WmiQueryParams(std::move(query), std::move(properties));
+    }
+
+    // Reads the instances of the benchmark query from a stand-in provider that isn't shared with the tests
+    HRESULT BuildBenchmarkResults(
+        StandInProvider *provider,
+        const WmiQueryParams &query,
+        const QueryOptions &query_options,
+        ResultSet *results)
+    {
+        results->Clear();
+        return provider->Query("root/cimv2", query, query_options, results);
+    }
+
+    // Memory held by results in the legacy layout, the way the result cache used to count it
+    void GetLegacyValueMemory(
+        const WmiValue &value,
+        size_t *bytes,
+        size_t *blocks)
+    {
+        *bytes += sizeof(WmiValue) + value.string_value.capacity() * sizeof(wchar_t);
+        *blocks += (value.string_value.capacity() > std::wstring().capacity()) + (value.elements.capacity() > 0);
+        for (const WmiValue &element : value.elements)
+        {
+            GetLegacyValueMemory(element, bytes, blocks);
+        }
+    }
+
+    void GetLegacyMemory(
+        const std::vector<WmiQueryResult> &results,
+        size_t *bytes,
+        size_t *blocks)
+    {
+        *bytes = sizeof(results);
+        *blocks = results.capacity() > 0;
+        for (const WmiQueryResult &result : results)
+        {
+            *bytes += sizeof(WmiQueryResult);
+            *blocks += result.capacity() > 0;
+            for (const auto &property : result)
+            {
+                *bytes += sizeof(std::wstring) + property.first.capacity() * sizeof(wchar_t);
+                *blocks += property.first.capacity() > std::wstring().capacity();
+                GetLegacyValueMemory(property.second, bytes, blocks);
+            }
+        }
+    }
+
+    StageBenchmarkResult BenchmarkParams(
+        const StageBenchmarkOptions &options,
+        Napi::Env env)
+    {
+        WmiQueryParams params = GetBenchmarkQuery(options);
+        Napi::String query = Napi::String::New(env, ConvertWstringToString(params.first));
+        Napi::Array properties = Napi::Array::New(env, params.second.size());
+        uint64_t bytes = query.Utf8Value().size();
+        for (size_t i = 0; i < params.second.size(); ++i)
+        {
+            std::string property = ConvertWstringToString(params.second[i]);
+            bytes += property.size();
+            properties.Set(static_cast<uint32_t>(i), Napi::String::New(env, property));
+        }
+
+        StageBenchmarkResult result = RunStageBenchmark(
+            "params/properties:" + std::to_string(options.properties),
+            options.min_time_ms,
+            [&](uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    WmiQueryParams converted = GetWstrParams(query, properties, env);
+                }
+            });
+        result.items = params.second.size() + 1;
+        result.bytes = bytes;
+        return result;
+    }
+
+    StageBenchmarkResult BenchmarkFormat(
+        const StageBenchmarkOptions &options)
+    {
+        // One instance's values, in the VARIANT types WMI hands out for their CIM types
+        std::vector<VARIANT> variants(options.properties);
+        std::vector<CIMTYPE> cim_types(options.properties);
+        for (uint32_t i = 0; i < options.properties; ++i)
+        {
+            VARIANT &variant = variants[i];
+            VariantInit(&variant);
+            switch (i % 6)
+            {
+            case 0:
+                variant.vt = VT_I4;
+                variant.lVal = static_cast<LONG>(4000000000u + i);
+                cim_types[i] = CIM_UINT32;
+                break;
+            case 1:
+                variant.vt = VT_BSTR;
+                variant.bstrVal = SysAllocString(L"9007199254740993");
+                cim_types[i] = CIM_UINT64;
+                break;
+            case 2:
+                variant.vt = VT_BSTR;
+                variant.bstrVal = SysAllocString(L"20230102030405.678000+060");
+                cim_types[i] = CIM_DATETIME;
+                break;
+            case 3:
+                variant.vt = VT_R8;
+                variant.dblVal = i + 0.5;
+                cim_types[i] = CIM_REAL64;
+                break;
+            case 4:
+                variant.vt = VT_BOOL;
+                variant.boolVal = VARIANT_TRUE;
+                cim_types[i] = CIM_BOOLEAN;
+                break;
+            default:
+                variant.vt = VT_BSTR;
+                variant.bstrVal = SysAllocString(L"StandIn_Benchmark.Property.0");
+                cim_types[i] = CIM_STRING;
+                break;
+            }
+        }
+
+        QueryOptions query_options;
+        query_options.typed_values = options.typed;
+        WmiValue value;
+        StageBenchmarkResult result = RunStageBenchmark(
+            "format/properties:" + std::to_string(options.properties) + (options.typed ? "/typed" : "/strings"),
+            options.min_time_ms,
+            [&](uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    for (uint32_t property = 0; property < options.properties; ++property)
+                    {
+                        ConvertPropertyValue(variants[property], cim_types[property], query_options, &value);
+                    }
+                }
+            });
+        result.items = options.properties;
+
+        for (VARIANT &variant : variants)
+        {
+            VariantClear(&variant);
+        }
+        return result;
+    }
+
+    StageBenchmarkResult BenchmarkBuild(
+        const StageBenchmarkOptions &options,
+        StandInProvider *provider)
+    {
+        WmiQueryParams query = GetBenchmarkQuery(options);
+        QueryOptions query_options;
+        query_options.typed_values = options.typed;
+        std::string name = "build/rows:" + std::to_string(options.rows) + "/properties:" + std::to_string(options.properties) +
+                           (options.typed ? "/typed" : "/strings");
+
+        if (options.legacy_layout)
+        {
+            std::vector<WmiQueryResult> legacy_results;
+            StageBenchmarkResult result = RunStageBenchmark(
+                name + "/legacy",
+                options.min_time_ms,
+                [&](uint64_t iterations)
+                {
+                    for (uint64_t i = 0; i < iterations; ++i)
+                    {
+                        // As with BuildBenchmarkResults only the outer array is reused, every instance allocates its own
+                        legacy_results.clear();
+                        provider->ReadLegacyResults(query, query_options, &legacy_results);
+                    }
+                });
+            size_t bytes = 0;
+            size_t blocks = 0;
+            GetLegacyMemory(legacy_results, &bytes, &blocks);
+            result.items = options.rows;
+            result.bytes = bytes;
+            result.blocks = blocks;
+            return result;
+        }
+
+        ResultSet results;
+        StageBenchmarkResult result = RunStageBenchmark(
+            name,
+            options.min_time_ms,
+            [&](uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    BuildBenchmarkResults(provider, query, query_options, &results);
+                }
+            });
+        result.items = options.rows;
+        result.bytes = results.GetBytes();
+        result.blocks = results.GetBlocks();
+        return result;
+    }
+
+    StageBenchmarkResult BenchmarkMarshal(
+        const StageBenchmarkOptions &options,
+        StandInProvider *provider,
+        Napi::Env env)
+    {
+        WmiQueryParams query = GetBenchmarkQuery(options);
+        QueryOptions query_options;
+        query_options.typed_values = options.typed;
+        ResultSet results;
+        BuildBenchmarkResults(provider, query, query_options, &results);
+
+        StageBenchmarkResult result = RunStageBenchmark(
+            "marshal/rows:" + std::to_string(options.rows) + "/properties:" + std::to_string(options.properties) +
+                (options.typed ? "/typed" : "/strings"),
+            options.min_time_ms,
+            [&](uint64_t iterations)
+            {
+                for (uint64_t i = 0; i < iterations; ++i)
+                {
+                    // Lets the objects of one iteration be collected during the next
+                    Napi::HandleScope scope(env);
+                    ConvertResultsObject(results, query_options, env);
+                }
+            });
+        result.items = options.rows;
+        result.bytes = results.GetBytes();
+        return result;
+    }
+
+    bool BenchmarkPipelineStage(
+        const std::string &stage,
+        const StageBenchmarkOptions &options,
+        Napi::Env env,
+        StageBenchmarkResult *result)
+    {
+        if (options.properties == 0)
+        {
+            return false;
+        }
+        if (stage == "params")
+        {
+            *result = BenchmarkParams(options, env);
+            return true;
+        }
+        if (stage == "format")
+        {
+            *result = BenchmarkFormat(options);
+            return true;
+        }
+        if (stage != "build" && stage != "marshal")
+        {
+            return false;
+        }
+
+        StandInProvider provider;
+        StandInOptions stand_in_options;
+        stand_in_options.row_count = options.rows;
+        provider.Configure(stand_in_options);
+        *result = stage == "build" ? BenchmarkBuild(options, &provider) : BenchmarkMarshal(options, &provider, env);
+        provider.Close();
+        return true;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * What the stage benchmarks run on, see BenchmarkPipelineStage
+     */
+    struct StageBenchmarkOptions
+    {
+        uint32_t rows = 1000;       // Instances built or converted per iteration
+        uint32_t properties = 20;   // Properties per instance
+        bool typed = false;         // Typed values instead of strings
+        bool legacy_layout = false; // Build one WmiQueryResult per instance instead of a ResultSet
+        uint32_t min_time_ms = 500; // Time the measured run takes at least
+    };
+
+    /**
+     * Timing of one stage benchmark, named and measured the way Google Benchmark reports its runs
+     */
+    struct StageBenchmarkResult
+    {
+        std::string name;        // Stage and its arguments, such as "marshal/rows:1000/properties:20/typed"
+        uint64_t iterations = 0;
+        double real_time_ns = 0; // Wall time per iteration
+        double cpu_time_ns = 0;  // CPU time of the process per iteration
+        uint64_t items = 0;      // Items (strings, values or instances) processed per iteration
+        uint64_t bytes = 0;      // Bytes processed per iteration
+        uint64_t blocks = 0;     // Heap blocks held by the results built per iteration, build only
+    };
+
+    /**
+     * Runs body with a growing number of iterations until one run takes min_time_ms, like Google
+     * Benchmark does, and reports that run
+     *
+     * @param body Runs the benchmarked code the given number of times
+     */
+    StageBenchmarkResult RunStageBenchmark(
+        const std::string &name,
+        uint32_t min_time_ms,
+        const std::function<void(uint64_t iterations)> &body);
+
+    /**
+     * Benchmarks one stage of the query pipeline in a native loop, so the numbers don't include
+     * calls from JavaScript. Runs on fake instances of the stand-in provider, a provider of its own
+     * which doesn't change the options passed to standIn.enable.
+     *
+     * @param stage 'params' (GetWstrParams on the query and property list), 'format' (the conversion
+     *              of the VARIANTs of one instance), 'build' (reading the instances of a query into a
+     *              ResultSet, or into the legacy layout of one WmiQueryResult per instance) or 'marshal'
+     *              (ConvertResultsObject on the instances of a query)
+     * @return false when stage is none of these or there are no properties
+     */
+    bool BenchmarkPipelineStage(
+        const std::string &stage,
+        const StageBenchmarkOptions &options,
+        Napi::Env env,
+        StageBenchmarkResult *result);
+
+};
\ No newline at end of file
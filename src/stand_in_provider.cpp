@@ -0,0 +1,1130 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "stand_in_provider.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <memory>
+#include <thread>
+
+#include "class_descriptors.h"
+#include "enumeration.h"
+#include "prepared_query.h"
+#include "property_access.h"
+#include "query_stats.h"
+#include "sample_buffer.h"
+#include "variant_conversion.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    void SetBstr(
+        const std::wstring &value,
+        VARIANT *variant)
+    {
+        variant->vt = VT_BSTR;
+        variant->bstrVal = SysAllocStringLen(value.c_str(), static_cast<unsigned int>(value.size()));
+    }
+
+    template <typename T>
+    void SetArray(
+        VARTYPE vt,
+        const std::vector<T> &elements,
+        VARIANT *variant)
+    {
+        variant->vt = VT_ARRAY | vt;
+        variant->parray = SafeArrayCreateVector(vt, 0, static_cast<ULONG>(elements.size()));
+        T *data;
+        SafeArrayAccessData(variant->parray, reinterpret_cast<void **>(&data));
+        std::copy(elements.begin(), elements.end(), data);
+        SafeArrayUnaccessData(variant->parray);
+    }
+
+    /**
+     * Properties the stand-in returns as VARIANTs shaped the way WMI hands out their CIM type,
+     * so both value conversions can be exercised without WMI. Any other property is a plain string.
+     */
+    struct StandInTypedProperty
+    {
+        const wchar_t *name;
+        CIMTYPE cim_type;
+        void (*generate)(uint32_t row, VARIANT *variant);
+    };
+
+    const StandInTypedProperty kTypedProperties[] = {
+        {L"Enabled", CIM_BOOLEAN, [](uint32_t row, VARIANT *variant)
+         {
+             variant->vt = VT_BOOL;
+             variant->boolVal = row % 2 == 0 ? VARIANT_TRUE : VARIANT_FALSE;
+         }},
+        {L"Level", CIM_UINT8, [](uint32_t row, VARIANT *variant)
+         {
+             variant->vt = VT_UI1;
+             variant->bVal = static_cast<uint8_t>(row % 256);
+         }},
+        {L"Offset", CIM_SINT8, [](uint32_t row, VARIANT *variant)
+         {
+             // WMI widens sint8 to VT_I2
+             variant->vt = VT_I2;
+             variant->iVal = static_cast<int16_t>(-static_cast<int32_t>(row % 128));
+         }},
+        {L"Port", CIM_UINT16, [](uint32_t row, VARIANT *variant)
+         {
+             // and uint16 to VT_I4
+             variant->vt = VT_I4;
+             variant->lVal = static_cast<LONG>(65535 - row % 65536);
+         }},
+        {L"Count", CIM_UINT32, [](uint32_t row, VARIANT *variant)
+         {
+             // uint32 is passed in VT_I4, so large values arrive as negative numbers
+             variant->vt = VT_I4;
+             variant->lVal = static_cast<LONG>(4000000000u + row);
+         }},
+        {L"Capacity", CIM_UINT32, [](uint32_t row, VARIANT *variant)
+         {
+             // Null on odd rows, which property handles can't read
+             if (row % 2 == 0)
+             {
+                 variant->vt = VT_I4;
+                 variant->lVal = static_cast<LONG>(row * 1024);
+             }
+             else
+             {
+                 variant->vt = VT_NULL;
+             }
+         }},
+        {L"Delta", CIM_SINT32, [](uint32_t row, VARIANT *variant)
+         {
+             variant->vt = VT_I4;
+             variant->lVal = -static_cast<LONG>(row);
+         }},
+        {L"Total", CIM_UINT64, [](uint32_t row, VARIANT *variant)
+         {
+             // 64 bit integers are passed as strings
+             SetBstr(std::to_wstring(9007199254740993ull + row), variant);
+         }},
+        {L"Balance", CIM_SINT64, [](uint32_t row, VARIANT *variant)
+         {
+             SetBstr(std::to_wstring(-static_cast<int64_t>(row) * 1000000000000ll - 1), variant);
+         }},
+        {L"Ratio", CIM_REAL64, [](uint32_t row, VARIANT *variant)
+         {
+             variant->vt = VT_R8;
+             variant->dblVal = row + 0.5;
+         }},
+        {L"Load", CIM_REAL32, [](uint32_t row, VARIANT *variant)
+         {
+             variant->vt = VT_R4;
+             variant->fltVal = static_cast<float>(row % 1024) * 0.25f;
+         }},
+        {L"InstallDate", CIM_DATETIME, [](uint32_t row, VARIANT *variant)
+         {
+             // 2023-01-02 03:04:SS.678 at UTC+1
+             std::wstring seconds = std::to_wstring(row % 60);
+             SetBstr(L"2023010203" L"04" + std::wstring(2 - seconds.size(), L'0') + seconds + L".678000+060", variant);
+         }},
+        {L"Uptime", CIM_DATETIME, [](uint32_t, VARIANT *variant)
+         {
+             // Intervals are not points in time and stay strings
+             SetBstr(L"00000001020304.000000:000", variant);
+         }},
+        {L"Description", CIM_STRING, [](uint32_t row, VARIANT *variant)
+         {
+             SetBstr(std::wstring(2048, L'd') + std::to_wstring(row), variant);
+         }},
+        {L"Label", CIM_STRING, [](uint32_t row, VARIANT *variant)
+         {
+             // Characters past U+FFFF take a surrogate pair in UTF-16
+             SetBstr(L"Ger\u00E4t \u8A2D\u5B9A \U0001F4A1 " + std::to_wstring(row), variant);
+         }},
+        {L"Status", CIM_STRING, [](uint32_t, VARIANT *variant)
+         {
+             variant->vt = VT_NULL;
+         }},
+        {L"Samples", CIM_UINT32 | CIM_FLAG_ARRAY, [](uint32_t row, VARIANT *variant)
+         {
+             SetArray<LONG>(VT_I4, {static_cast<LONG>(row), static_cast<LONG>(row + 1), -1}, variant);
+         }},
+        {L"Readings", CIM_REAL64 | CIM_FLAG_ARRAY, [](uint32_t row, VARIANT *variant)
+         {
+             SetArray<double>(VT_R8, {row * 0.5, row * 1.5}, variant);
+         }},
+        {L"Flags", CIM_BOOLEAN | CIM_FLAG_ARRAY, [](uint32_t row, VARIANT *variant)
+         {
+             SetArray<VARIANT_BOOL>(VT_BOOL, {VARIANT_TRUE, row % 2 == 0 ? VARIANT_TRUE : VARIANT_FALSE}, variant);
+         }},
+        {L"Names", CIM_STRING | CIM_FLAG_ARRAY, [](uint32_t row, VARIANT *variant)
+         {
+             std::wstring prefix = L"Name." + std::to_wstring(row) + L".";
+             SetArray<BSTR>(VT_BSTR, {SysAllocString((prefix + L"0").c_str()), SysAllocString((prefix + L"1").c_str())}, variant);
+         }},
+        {L"Totals", CIM_UINT64 | CIM_FLAG_ARRAY, [](uint32_t row, VARIANT *variant)
+         {
+             SetArray<BSTR>(VT_BSTR, {SysAllocString(std::to_wstring(row).c_str()), SysAllocString(L"18446744073709551615")}, variant);
+         }},
+    };
+
+    const StandInTypedProperty *FindTypedProperty(
+        const std::wstring &property)
+    {
+        for (const StandInTypedProperty &typed_property : kTypedProperties)
+        {
+            if (property == typed_property.name)
+            {
+                return &typed_property;
+            }
+        }
+        return NULL;
+    }
+
+    /**
+     * Values of the non-string properties of the typed classes (class_descriptors.h), shaped the way WMI
+     * hands out their CIM type so the extractors read the same VARIANTs they get from WMI
+     */
+    void GenerateClassValue(
+        CIMTYPE cim_type,
+        uint32_t row,
+        VARIANT *variant)
+    {
+        switch (cim_type)
+        {
+        case CIM_BOOLEAN:
+            variant->vt = VT_BOOL;
+            variant->boolVal = row % 2 == 0 ? VARIANT_TRUE : VARIANT_FALSE;
+            break;
+        case CIM_UINT8:
+            variant->vt = VT_UI1;
+            variant->bVal = static_cast<uint8_t>(row % 256);
+            break;
+        case CIM_UINT16:
+            variant->vt = VT_I4;
+            variant->lVal = static_cast<LONG>(65535 - row % 65536);
+            break;
+        case CIM_UINT32:
+            // Null on every fourth row, which property handles can't read
+            if (row % 4 == 3)
+            {
+                variant->vt = VT_NULL;
+            }
+            else
+            {
+                variant->vt = VT_I4;
+                variant->lVal = static_cast<LONG>(2147483648u + row);
+            }
+            break;
+        case CIM_UINT64:
+            SetBstr(std::to_wstring(9007199254740993ull + row), variant);
+            break;
+        case CIM_DATETIME:
+            FindTypedProperty(L"InstallDate")->generate(row, variant);
+            break;
+        case CIM_UINT16 | CIM_FLAG_ARRAY:
+            // Like the character codes of WmiMonitorID, zero padded
+            SetArray<LONG>(VT_I4, {static_cast<LONG>(L'A' + row % 26), static_cast<LONG>(L'0' + row % 10), 0}, variant);
+            break;
+        default:
+            variant->vt = VT_NULL;
+            break;
+        }
+    }
+
+    // Handles of the properties of a typed class start here, below are the indexes into kTypedProperties
+    const long kClassHandleBase = 0x10000;
+
+    // The revision of the values of a row, 0 for rows that weren't changed
+    uint32_t GetRowRevision(
+        const StandInOptions &options,
+        uint32_t row)
+    {
+        uint32_t interval = std::max<uint32_t>(options.revision_interval, 1);
+        return row % interval == 0 ? options.revision : 0;
+    }
+
+    // Same as WBEM_E_NOT_FOUND, which Get returns for a property the class doesn't have
+    const HRESULT kPropertyNotFound = static_cast<HRESULT>(0x80041002L);
+
+    /**
+     * Fake instance with the IWbemObjectAccess surface, handles are indexes into kTypedProperties
+     * and every other property can only be read by name. Instances of a typed class also have the
+     * properties of its descriptor, with their declared CIM types. The missing properties can't be
+     * read at all.
+     */
+    class StandInInstance : public InstanceAccess
+    {
+    public:
+        /**
+         * @param typed_class The typed class named class_name, NULL for any other class
+         */
+        StandInInstance(
+            const std::wstring &class_name,
+            const TypedClass *typed_class,
+            const std::vector<std::wstring> &missing_properties,
+            uint32_t property_count,
+            uint32_t row,
+            uint32_t revision)
+            : class_name_(class_name),
+              typed_class_(typed_class),
+              missing_properties_(missing_properties),
+              property_count_(property_count),
+              row_(row),
+              revision_(revision)
+        {
+        }
+
+        HRESULT GetClassName(std::wstring *class_name) override
+        {
+            *class_name = class_name_;
+            return S_OK;
+        }
+
+        HRESULT GetNames(std::vector<std::wstring> *names) override
+        {
+            for (uint32_t i = 0; i < property_count_; ++i)
+            {
+                names->push_back(L"Property" + std::to_wstring(i));
+            }
+            return S_OK;
+        }
+
+        HRESULT GetPropertyHandle(
+            const std::wstring &property,
+            CIMTYPE *cim_type,
+            long *handle) override
+        {
+            if (ContainsIgnoreCase(missing_properties_, property))
+            {
+                return kPropertyNotFound;
+            }
+
+            size_t class_property = FindClassProperty(property);
+            if (class_property != kNoClassProperty)
+            {
+                *cim_type = typed_class_->GetProperty(class_property).cim_type;
+                *handle = kClassHandleBase + static_cast<long>(class_property);
+                return S_OK;
+            }
+
+            const StandInTypedProperty *typed_property = FindTypedProperty(property);
+            if (typed_property == NULL)
+            {
+                *cim_type = CIM_STRING;
+                *handle = -1;
+                return S_OK;
+            }
+
+            *cim_type = typed_property->cim_type;
+            *handle = static_cast<long>(typed_property - kTypedProperties);
+            return S_OK;
+        }
+
+        HRESULT ReadDWORD(long handle, uint32_t *value) override
+        {
+            VARIANT variant;
+            HRESULT hres = GenerateHandleValue(handle, &variant);
+            if (hres == S_OK && variant.vt == VT_R4)
+            {
+                std::memcpy(value, &variant.fltVal, sizeof(*value));
+            }
+            else if (hres == S_OK)
+            {
+                *value = static_cast<uint32_t>(variant.lVal);
+            }
+            VariantClear(&variant);
+            return hres;
+        }
+
+        HRESULT ReadQWORD(long handle, uint64_t *value) override
+        {
+            VARIANT variant;
+            HRESULT hres = GenerateHandleValue(handle, &variant);
+            if (hres == S_OK && variant.vt == VT_R8)
+            {
+                std::memcpy(value, &variant.dblVal, sizeof(*value));
+            }
+            else if (hres == S_OK && variant.vt == VT_BSTR)
+            {
+                // The stand-in keeps 64 bit integers as the strings Get returns for them
+                *value = GetHandleType(handle) == CIM_SINT64
+                             ? static_cast<uint64_t>(std::wcstoll(variant.bstrVal, NULL, 10))
+                             : std::wcstoull(variant.bstrVal, NULL, 10);
+            }
+            else if (hres == S_OK)
+            {
+                hres = DISP_E_TYPEMISMATCH;
+            }
+            VariantClear(&variant);
+            return hres;
+        }
+
+        HRESULT Get(
+            const std::wstring &property,
+            VARIANT *variant,
+            CIMTYPE *cim_type) override
+        {
+            if (ContainsIgnoreCase(missing_properties_, property))
+            {
+                return kPropertyNotFound;
+            }
+
+            size_t class_property = FindClassProperty(property);
+            if (class_property != kNoClassProperty && typed_class_->GetProperty(class_property).cim_type != CIM_STRING)
+            {
+                *cim_type = typed_class_->GetProperty(class_property).cim_type;
+                GenerateClassValue(*cim_type, row_, variant);
+                return S_OK;
+            }
+
+            const StandInTypedProperty *typed_property = FindTypedProperty(property);
+            if (typed_property == NULL)
+            {
+                *cim_type = CIM_STRING;
+                std::wstring value = class_name_ + L"." + property + L"." + std::to_wstring(row_);
+                // System properties such as __PATH identify the instance and stay the same
+                if (revision_ != 0 && property.compare(0, 2, L"__") != 0)
+                {
+                    value += L".r" + std::to_wstring(revision_);
+                }
+                SetBstr(value, variant);
+                return S_OK;
+            }
+
+            *cim_type = typed_property->cim_type;
+            typed_property->generate(row_, variant);
+            return S_OK;
+        }
+
+    private:
+        static const size_t kNoClassProperty = static_cast<size_t>(-1);
+
+        size_t FindClassProperty(const std::wstring &property)
+        {
+            if (typed_class_ == NULL)
+            {
+                return kNoClassProperty;
+            }
+            size_t index = typed_class_->FindProperty(property);
+            return index < typed_class_->GetPropertyCount() ? index : kNoClassProperty;
+        }
+
+        bool IsClassHandle(long handle)
+        {
+            return typed_class_ != NULL && handle >= kClassHandleBase &&
+                   static_cast<size_t>(handle - kClassHandleBase) < typed_class_->GetPropertyCount();
+        }
+
+        CIMTYPE GetHandleType(long handle)
+        {
+            return IsClassHandle(handle) ? typed_class_->GetProperty(handle - kClassHandleBase).cim_type
+                                         : kTypedProperties[handle].cim_type;
+        }
+
+        HRESULT GenerateHandleValue(long handle, VARIANT *variant)
+        {
+            VariantInit(variant);
+            if (IsClassHandle(handle))
+            {
+                CIMTYPE cim_type = GetHandleType(handle);
+                if (cim_type == CIM_STRING)
+                {
+                    return E_INVALIDARG;
+                }
+                GenerateClassValue(cim_type, row_, variant);
+                return variant->vt == VT_NULL ? S_FALSE : S_OK;
+            }
+            if (handle < 0 || static_cast<size_t>(handle) >= sizeof(kTypedProperties) / sizeof(kTypedProperties[0]))
+            {
+                return E_INVALIDARG;
+            }
+
+            kTypedProperties[handle].generate(row_, variant);
+            // Like IWbemObjectAccess, null values have no fixed size representation
+            return variant->vt == VT_NULL ? S_FALSE : S_OK;
+        }
+
+        const std::wstring &class_name_;
+        const TypedClass *typed_class_;
+        const std::vector<std::wstring> &missing_properties_;
+        uint32_t property_count_;
+        uint32_t row_;
+        uint32_t revision_;
+    };
+
+    /**
+     * Hands out the instances of a stand-in query the way IEnumWbemClassObject::Next does, taking
+     * next_latency_ms per call and row_latency_ms per instance, and blocking until the timeout
+     * once hang_after_rows instances were handed out. The first call fails with next_error when
+     * it is set, like the first call of a query ExecQuery returned before WMI checked it.
+     */
+    class StandInEnumerator : public InstanceEnumerator
+    {
+    public:
+        StandInEnumerator(
+            const StandInOptions &options,
+            const std::wstring &class_name,
+            HRESULT next_error,
+            std::atomic<uint64_t> *generated_rows)
+            : options_(options),
+              class_name_(class_name),
+              typed_class_(FindTypedClass(class_name)),
+              next_error_(next_error),
+              generated_rows_(generated_rows),
+              first_row_(0),
+              next_row_(0)
+        {
+        }
+
+        HRESULT Next(
+            uint32_t timeout_ms,
+            uint32_t count,
+            uint32_t *returned) override
+        {
+            next_counts_.push_back(count);
+            first_row_ = next_row_;
+            if (FAILED(next_error_))
+            {
+                *returned = 0;
+                return next_error_;
+            }
+
+            uint32_t remaining = options_.row_count - next_row_;
+            uint32_t until_hang = options_.hang_after_rows > next_row_ ? options_.hang_after_rows - next_row_ : 0;
+            uint32_t available = std::min(count, std::min(remaining, until_hang));
+            bool hung = until_hang < std::min(count, remaining);
+            uint64_t latency_ms = options_.next_latency_ms + static_cast<uint64_t>(options_.row_latency_ms) * available;
+
+            HRESULT hres = available == count ? S_OK : S_FALSE;
+            if (timeout_ms != kInfiniteTimeout && (hung || latency_ms > timeout_ms))
+            {
+                // The call returns at the timeout with the instances that arrived until then
+                if (options_.next_latency_ms > timeout_ms)
+                {
+                    available = 0;
+                }
+                else if (options_.row_latency_ms > 0)
+                {
+                    available = std::min<uint32_t>(available, (timeout_ms - options_.next_latency_ms) / options_.row_latency_ms);
+                }
+                latency_ms = timeout_ms;
+                hres = kQueryTimedOut;
+            }
+            // Without a timeout a hung stand-in ends the enumeration instead of blocking for ever
+
+            if (latency_ms > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+            }
+            next_row_ += available;
+            *returned = available;
+            return hres;
+        }
+
+        HRESULT Read(
+            uint32_t index,
+            InstanceReader *reader,
+            ResultSet *results) override
+        {
+            uint32_t row = options_.first_row + first_row_ + index;
+            StandInInstance instance(class_name_, typed_class_, options_.missing_properties, options_.property_count, row, GetRowRevision(options_, row));
+            HRESULT hres = reader->Read(&instance, results);
+            if (SUCCEEDED(hres))
+            {
+                ++*generated_rows_;
+            }
+            return hres;
+        }
+
+        std::vector<uint32_t> &GetNextCounts()
+        {
+            return next_counts_;
+        }
+
+    private:
+        const StandInOptions &options_;
+        const std::wstring &class_name_;
+        const TypedClass *typed_class_;
+        HRESULT next_error_;
+        std::atomic<uint64_t> *generated_rows_;
+        uint32_t first_row_; // Row of the first instance of the last Next call
+        uint32_t next_row_;
+        std::vector<uint32_t> next_counts_;
+    };
+
+    HRESULT GenerateBatches(
+        const StandInOptions &options,
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &query_options,
+        size_t batch_size,
+        HRESULT next_error,
+        PropertyHandleCache *property_handles,
+        std::atomic<uint64_t> *generated_rows,
+        std::vector<uint32_t> *next_counts,
+        const QueryBatchCallback &on_batch)
+    {
+        StageTimer timer(query_options.timings);
+        if (options.latency_ms > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.latency_ms));
+        }
+
+        // Mirror WMI, where an unparsable query produces no instances
+        std::wstring class_name = query_options.prepared != NULL ? query_options.prepared->GetClassName() : GetQueryClassName(query.first);
+        if (class_name.empty())
+        {
+            return S_OK;
+        }
+
+        // Values go through the same reads and conversions as instances returned by WMI
+        InstanceReader reader(
+            options.property_handles ? property_handles : NULL,
+            wmi_namespace,
+            query.first,
+            query.second,
+            query_options);
+        timer.Lap(kExecStage);
+
+        StandInEnumerator instances(options, class_name, next_error, generated_rows);
+        HRESULT hres = EnumerateInstances(&instances, &reader, query_options, batch_size, &timer, on_batch);
+        *next_counts = std::move(instances.GetNextCounts());
+        return hres;
+    }
+
+    /**
+     * Like ExecQuery, rejects a select list naming a property that's missing. With reject_on_next
+     * the query is accepted and the error goes to next_error, for the first Next call to report.
+     */
+    HRESULT CheckSelectList(
+        const StandInOptions &options,
+        const std::wstring &query,
+        HRESULT *next_error)
+    {
+        *next_error = S_OK;
+        SelectQuery select;
+        if (ParseSelectQuery(query, &select))
+        {
+            for (const std::wstring &property : select.properties)
+            {
+                if (ContainsIgnoreCase(options.missing_properties, property))
+                {
+                    if (options.reject_on_next)
+                    {
+                        *next_error = kInvalidQuery;
+                        return S_OK;
+                    }
+                    return kInvalidQuery;
+                }
+            }
+        }
+        return S_OK;
+    }
+
+    HRESULT StandInConnector::Connect(
+        const std::string &wmi_namespace,
+        std::shared_ptr<ServiceConnection> *connection)
+    {
+        uint32_t latency_ms = connect_latency_ms_;
+        if (latency_ms > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+        }
+
+        ++connects_;
+        // A restarted service may come back with different class definitions
+        property_handles_->Invalidate(wmi_namespace);
+        *connection = std::make_shared<StandInConnection>(&generation_, generation_);
+        return S_OK;
+    }
+
+    /**
+     * Produces event_batch_size events every event_interval_ms on its own thread until cancelled
+     */
+    class StandInSubscription : public EventSubscription
+    {
+    public:
+        StandInSubscription() : stopped_(false) {}
+
+        ~StandInSubscription() override
+        {
+            Cancel();
+        }
+
+        void Start(
+            const StandInOptions &options,
+            ConnectionPool *pool,
+            PropertyHandleCache *property_handles,
+            std::atomic<uint64_t> *generated_events,
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &query_options,
+            std::shared_ptr<EventListener> listener)
+        {
+            thread_ = std::thread(
+                [this, options, pool, property_handles, generated_events, wmi_namespace, query, query_options, listener]()
+                {
+                    HRESULT hres = Generate(options, pool, property_handles, generated_events, wmi_namespace, query, query_options, listener.get());
+                    if (hres != S_OK)
+                    {
+                        listener->OnComplete(hres);
+                    }
+                });
+        }
+
+        void Cancel() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
+            }
+            wake_.notify_all();
+
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+    private:
+        /**
+         * @return S_OK once cancelled, otherwise why the subscription ended
+         */
+        HRESULT Generate(
+            const StandInOptions &options,
+            ConnectionPool *pool,
+            PropertyHandleCache *property_handles,
+            std::atomic<uint64_t> *generated_events,
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &query_options,
+            EventListener *listener)
+        {
+            // WMI rejects an event query it can't parse
+            std::wstring class_name = GetQueryClassName(query.first);
+            if (class_name.empty())
+            {
+                return kInvalidQuery;
+            }
+
+            std::shared_ptr<ServiceConnection> connection;
+            HRESULT hres = pool->Acquire(wmi_namespace, &connection);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            InstanceReader reader(
+                options.property_handles ? property_handles : NULL,
+                wmi_namespace,
+                query.first,
+                query.second,
+                query_options);
+
+            const TypedClass *typed_class = FindTypedClass(class_name);
+            uint64_t sequence = 0;
+            while (!WaitForStop(sequence == 0 ? 0 : options.event_interval_ms))
+            {
+                // Like a sink whose WMI service restarted, a broken connection ends the subscription
+                if (!connection->IsHealthy())
+                {
+                    pool->Invalidate(wmi_namespace, connection);
+                    return RPC_E_DISCONNECTED;
+                }
+
+                std::vector<WmiQueryResult> events;
+                events.reserve(options.event_batch_size);
+                for (uint32_t i = 0; i < options.event_batch_size && options.row_count > 0; ++i)
+                {
+                    uint32_t row = static_cast<uint32_t>(sequence % options.row_count);
+                    StandInInstance instance(class_name, typed_class, options.missing_properties, options.property_count, row, GetRowRevision(options, row));
+                    WmiQueryResult event;
+                    hres = reader.Read(&instance, &event);
+                    if (FAILED(hres))
+                    {
+                        return hres;
+                    }
+                    events.push_back(std::move(event));
+                    ++sequence;
+                }
+
+                *generated_events += events.size();
+                if (!events.empty())
+                {
+                    listener->OnEvents(events);
+                }
+            }
+            return S_OK;
+        }
+
+        // Returns true once the subscription was cancelled
+        bool WaitForStop(uint32_t interval_ms)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return wake_.wait_for(
+                lock,
+                std::chrono::milliseconds(interval_ms),
+                [this]()
+                { return stopped_; });
+        }
+
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stopped_;
+    };
+
+    /**
+     * Fake refresher. Every refresh produces row_count instances named "<Class>.Name.<Row>" whose
+     * properties hold refresh * 100 + row * 10 + property index, counting refreshes from 0.
+     * A broken connection fails one refresh, the next one reconnects.
+     */
+    class StandInSampleSource : public SampleSource
+    {
+    public:
+        StandInSampleSource(
+            const StandInOptions &options,
+            ConnectionPool *pool,
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            size_t property_count)
+            : options_(options),
+              pool_(pool),
+              wmi_namespace_(wmi_namespace),
+              property_count_(property_count),
+              refreshes_(0)
+        {
+            for (uint32_t row = 0; row < options.row_count; ++row)
+            {
+                names_.push_back(class_name + L".Name." + std::to_wstring(row));
+            }
+        }
+
+        HRESULT Open() override
+        {
+            return pool_->Acquire(wmi_namespace_, &connection_);
+        }
+
+        HRESULT Refresh(SampleFrame *frame) override
+        {
+            if (!connection_)
+            {
+                HRESULT hres = pool_->Acquire(wmi_namespace_, &connection_);
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+            }
+
+            // Like a refresher whose WMI service restarted, the enumerator has to be registered again
+            if (!connection_->IsHealthy())
+            {
+                pool_->Invalidate(wmi_namespace_, connection_);
+                connection_.reset();
+                return RPC_E_DISCONNECTED;
+            }
+
+            if (options_.refresh_latency_ms > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options_.refresh_latency_ms));
+            }
+
+            for (size_t row = 0; row < names_.size(); ++row)
+            {
+                double *values = frame->AddRow(names_[row]);
+                for (size_t property = 0; property < property_count_; ++property)
+                {
+                    values[property] = static_cast<double>(refreshes_ * 100 + row * 10 + property);
+                }
+            }
+            ++refreshes_;
+            return S_OK;
+        }
+
+        void Close() override
+        {
+            connection_.reset();
+        }
+
+    private:
+        StandInOptions options_;
+        ConnectionPool *pool_;
+        std::string wmi_namespace_;
+        size_t property_count_;
+        std::vector<std::wstring> names_;
+        std::shared_ptr<ServiceConnection> connection_;
+        uint64_t refreshes_;
+    };
+
+    StandInProvider::StandInProvider()
+        : generated_rows_(0),
+          queries_(0),
+          generated_events_(0),
+          connector_(&property_handles_),
+          pool_(&connector_, &clock_),
+          workers_(NULL, kDefaultWorkerThreads)
+    {
+    }
+
+    void StandInProvider::Configure(
+        const StandInOptions &options)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        connector_.SetConnectLatency(options.connect_latency_ms);
+    }
+
+    HRESULT StandInProvider::Subscribe(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        std::shared_ptr<EventListener> listener,
+        std::unique_ptr<EventSubscription> *subscription)
+    {
+        std::unique_ptr<StandInSubscription> stand_in_subscription(new StandInSubscription());
+        stand_in_subscription->Start(
+            GetOptions(),
+            &pool_,
+            &property_handles_,
+            &generated_events_,
+            wmi_namespace,
+            query,
+            options,
+            std::move(listener));
+        *subscription = std::move(stand_in_subscription);
+        return S_OK;
+    }
+
+    HRESULT StandInProvider::CreateSampleSource(
+        const std::string &wmi_namespace,
+        const std::wstring &class_name,
+        const std::vector<std::wstring> &properties,
+        std::unique_ptr<SampleSource> *source)
+    {
+        source->reset(new StandInSampleSource(GetOptions(), &pool_, wmi_namespace, class_name, properties.size()));
+        return S_OK;
+    }
+
+    void StandInProvider::Close()
+    {
+        pool_.Close();
+        property_handles_.Clear();
+    }
+
+    StandInOptions StandInProvider::GetOptions()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return options_;
+    }
+
+    HRESULT StandInProvider::Query(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        ResultSet *results)
+    {
+        // Like WMI queries, stand-in queries run on the worker threads
+        StageTimer timer(options.timings);
+        HRESULT rejected = S_OK;
+        HRESULT hres = workers_.Run(
+            options.priority,
+            [&]()
+            {
+                timer.Lap(kQueueStage);
+                // A query cancelled while it waited for a thread doesn't start
+                if (options.IsCancelled())
+                {
+                    return kQueryCancelled;
+                }
+                return QueryBatches(
+                    wmi_namespace,
+                    query,
+                    options,
+                    std::numeric_limits<size_t>::max(),
+                    [results](ResultSet &batch)
+                    {
+                        *results = std::move(batch);
+                        return true;
+                    },
+                    &rejected);
+            });
+
+        if (FAILED(rejected))
+        {
+            results->Clear();
+            results->SetRejected(rejected);
+        }
+        return hres;
+    }
+
+    HRESULT StandInProvider::QueryBatches(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &query_options,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch)
+    {
+        return QueryBatches(wmi_namespace, query, query_options, batch_size, on_batch, NULL);
+    }
+
+    HRESULT StandInProvider::QueryBatches(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &query_options,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch,
+        HRESULT *rejected)
+    {
+        StandInOptions options = GetOptions();
+        ++queries_;
+        std::wstring exec_query = RecordExecQuery(query, query_options);
+
+        StageTimer timer(query_options.timings);
+        bool connected = false;
+        HRESULT result = pool_.Execute(
+            wmi_namespace,
+            [&](ServiceConnection *connection, bool *retryable)
+            {
+                connected = true;
+                timer.Lap(kConnectStage);
+                // Like a proxy to a restarted WMI service, a broken connection fails every call
+                if (!connection->IsHealthy())
+                {
+                    return RPC_E_DISCONNECTED;
+                }
+
+                // A rejected projection is sent again as the query was written, see EnumerateValues
+                bool rewritten = exec_query != query.first;
+                auto exec_as_written = [&](HRESULT *next_error)
+                {
+                    rewritten = false;
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    last_exec_query_.query = query.first;
+                    last_exec_query_.partial_instances = false;
+                    last_exec_query_.ext_properties.clear();
+                    return CheckSelectList(options, query.first, next_error);
+                };
+
+                HRESULT next_error;
+                HRESULT hres = CheckSelectList(options, exec_query, &next_error);
+                if (IsRejectedProjection(hres) && rewritten)
+                {
+                    hres = exec_as_written(&next_error);
+                }
+
+                std::vector<uint32_t> next_counts;
+                while (SUCCEEDED(hres))
+                {
+                    hres = GenerateBatches(
+                        options,
+                        wmi_namespace,
+                        query,
+                        query_options,
+                        batch_size,
+                        next_error,
+                        &property_handles_,
+                        &generated_rows_,
+                        &next_counts,
+                        [&](ResultSet &batch)
+                        {
+                            *retryable = false;
+                            return on_batch(batch);
+                        });
+
+                    // The first Next call rejected the projection before any instance was handed out
+                    if (!IsRejectedProjection(hres) || hres != next_error || !rewritten)
+                    {
+                        break;
+                    }
+                    hres = exec_as_written(&next_error);
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                last_exec_query_.next_counts = std::move(next_counts);
+                return hres;
+            });
+
+        return connected && options.mask_rejected_queries ? GetConnectedQueryResult(result, query_options.timings, rejected) : result;
+    }
+
+    HRESULT StandInProvider::ReadLegacyResults(
+        const WmiQueryParams &query,
+        const QueryOptions &query_options,
+        std::vector<WmiQueryResult> *results)
+    {
+        StandInOptions options = GetOptions();
+        std::wstring class_name = GetQueryClassName(query.first);
+        InstanceReader reader(
+            options.property_handles ? &property_handles_ : NULL,
+            "root/cimv2",
+            query.first,
+            query.second,
+            query_options);
+
+        const TypedClass *typed_class = FindTypedClass(class_name);
+        results->reserve(options.row_count);
+        for (uint32_t row = 0; row < options.row_count; ++row)
+        {
+            StandInInstance instance(class_name, typed_class, options.missing_properties, options.property_count, row, GetRowRevision(options, row));
+            WmiQueryResult result;
+            HRESULT hres = reader.Read(&instance, &result);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            results->push_back(std::move(result));
+        }
+        return S_OK;
+    }
+
+    std::wstring StandInProvider::RecordExecQuery(
+        const WmiQueryParams &query,
+        const QueryOptions &options)
+    {
+        // Derived the same way as for ExecQuery, see EnumerateValues
+        StandInExecQuery exec_query;
+        if (options.prepared != NULL)
+        {
+            BSTR query_text = options.prepared->GetQueryText();
+            exec_query.query.assign(query_text, SysStringLen(query_text));
+        }
+        else if (!RewriteProjection(query.first, query.second, &exec_query.query))
+        {
+            exec_query.query = query.first;
+        }
+        exec_query.partial_instances = options.partial_instances && GetProjection(query.second, &exec_query.ext_properties);
+        if (!exec_query.partial_instances)
+        {
+            exec_query.ext_properties.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_exec_query_ = exec_query;
+        return exec_query.query;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,272 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "connection_pool.h"
+#include "property_access.h"
+#include "query_provider.h"
+#include "worker_pool.h"
+
+namespace wmi_wrapper
+{
+
+    struct StandInOptions
+    {
+        uint32_t row_count = 4;      // Instances returned by every query
+        uint32_t property_count = 8; // Properties per instance when no property list is given
+        uint32_t latency_ms = 0;     // Time each query blocks before producing results
+        uint32_t connect_latency_ms = 0; // Time opening a new connection takes
+        bool property_handles = true;    // Read fixed size properties through cached handles
+        uint32_t event_interval_ms = 10; // Time between event batches of a subscription, 0 produces them back to back
+        uint32_t event_batch_size = 1;   // Events delivered at a time by a subscription
+        uint32_t refresh_latency_ms = 0; // Time each refresh of a sampler takes
+        uint32_t next_latency_ms = 0;    // Time each Next call of a query takes
+        uint32_t row_latency_ms = 0;     // Time each instance adds to the Next call that returns it
+        uint32_t hang_after_rows = UINT32_MAX; // Instances after which Next blocks until its timeout, like a hung provider
+        uint32_t first_row = 0;         // Row of the first instance of a query, moving instances in and out of the results
+        uint32_t revision = 0;          // Appended to the string values of changed rows when not 0, as if they were updated
+        uint32_t revision_interval = 1; // Every revision_interval-th row is changed
+        bool mask_rejected_queries = false; // Report errors after connecting like the WMI build, see GetConnectedQueryResult
+        std::vector<std::wstring> missing_properties; // Properties no class has, selecting one fails the query
+        bool reject_on_next = false; // Fail such a query from its first Next call instead of ExecQuery, as WMI may
+    };
+
+    /**
+     * What the last query sent to the stand-in would have passed to ExecQuery
+     */
+    struct StandInExecQuery
+    {
+        std::wstring query;                       // The query text, with its projection rewritten
+        bool partial_instances = false;           // Whether a partial instance context was passed
+        std::vector<std::wstring> ext_properties; // __GET_EXT_PROPERTIES of that context
+        std::vector<uint32_t> next_counts;        // Instances asked for by each Next call
+    };
+
+    /**
+     * Fake connections that break when the connector's generation moves on,
+     * which is how the stand-in simulates a restart of the WMI service.
+     */
+    class StandInConnection : public ServiceConnection
+    {
+    public:
+        StandInConnection(const std::atomic<uint64_t> *current_generation, uint64_t generation)
+            : current_generation_(current_generation),
+              generation_(generation)
+        {
+        }
+
+        bool IsHealthy() override
+        {
+            return *current_generation_ == generation_;
+        }
+
+    private:
+        const std::atomic<uint64_t> *current_generation_;
+        uint64_t generation_;
+    };
+
+    class StandInConnector : public ServiceConnector
+    {
+    public:
+        explicit StandInConnector(PropertyHandleCache *property_handles)
+            : property_handles_(property_handles),
+              generation_(0),
+              connects_(0),
+              connect_latency_ms_(0)
+        {
+        }
+
+        HRESULT Connect(const std::string &wmi_namespace, std::shared_ptr<ServiceConnection> *connection) override;
+
+        void SetConnectLatency(uint32_t latency_ms)
+        {
+            connect_latency_ms_ = latency_ms;
+        }
+
+        // Breaks every connection opened so far
+        void BreakConnections()
+        {
+            ++generation_;
+        }
+
+        uint64_t GetConnectCount() const
+        {
+            return connects_;
+        }
+
+    private:
+        PropertyHandleCache *property_handles_;
+        std::atomic<uint64_t> generation_;
+        std::atomic<uint64_t> connects_;
+        std::atomic<uint32_t> connect_latency_ms_;
+    };
+
+    /**
+     * Synthetic provider used by the unsupported OS build so the query pipeline can be
+     * exercised without WMI. Every query returns options.row_count instances of the class
+     * named in the FROM clause with deterministic values ("<Class>.<Property>.<Row>"), except for
+     * a fixed set of typed properties (Enabled, Count, Total, InstallDate, Samples, ...) which are
+     * produced as VARIANTs and converted like values read from WMI.
+     *
+     * Event subscriptions run a generator thread that keeps producing instances of the class named in
+     * the FROM clause, cycling through the rows, until they are cancelled or their connection breaks.
+     *
+     * Samplers refresh a fake refresher that produces row_count instances of the class, see
+     * StandInSampleSource.
+     */
+    class StandInProvider : public QueryProvider
+    {
+    public:
+        StandInProvider();
+
+        void Configure(const StandInOptions &options);
+        StandInOptions GetOptions();
+
+        HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            ResultSet *results) override;
+
+        HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch) override;
+
+        HRESULT Subscribe(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::shared_ptr<EventListener> listener,
+            std::unique_ptr<EventSubscription> *subscription) override;
+
+        HRESULT CreateSampleSource(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::vector<std::wstring> &properties,
+            std::unique_ptr<SampleSource> *source) override;
+
+        /**
+         * Reads the instances of a query into one WmiQueryResult each, the layout query results had
+         * before ResultSet, on the calling thread and without a connection. Only there to compare
+         * the two layouts, see BenchmarkPipelineStage.
+         */
+        HRESULT ReadLegacyResults(
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::vector<WmiQueryResult> *results);
+
+        WorkerPool *GetWorkerPool() override
+        {
+            return &workers_;
+        }
+
+        void Close() override;
+
+        // Queries that reached the provider, including streamed ones
+        uint64_t GetQueryCount() const
+        {
+            return queries_;
+        }
+
+        StandInExecQuery GetLastExecQuery()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return last_exec_query_;
+        }
+
+        // Rows produced by every query so far, which shows how far ahead of a consumer a query ran
+        uint64_t GetGeneratedRows() const
+        {
+            return generated_rows_;
+        }
+
+        // Events produced by every subscription so far, including the ones a subscriber dropped
+        uint64_t GetGeneratedEvents() const
+        {
+            return generated_events_;
+        }
+
+        StandInConnector &GetConnector()
+        {
+            return connector_;
+        }
+
+        ConnectionPool &GetConnectionPool()
+        {
+            return pool_;
+        }
+
+        PropertyHandleCache &GetPropertyHandleCache()
+        {
+            return property_handles_;
+        }
+
+        // Time as seen by the connection pool, only moves when advanced
+        ManualClock &GetClock()
+        {
+            return clock_;
+        }
+
+    private:
+        // Returns the query text
+        std::wstring RecordExecQuery(const WmiQueryParams &query, const QueryOptions &options);
+
+        // QueryBatches that also reports the error of a masked rejected query, see GetConnectedQueryResult
+        HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch,
+            HRESULT *rejected);
+
+        std::mutex mutex_;
+        StandInOptions options_;
+        StandInExecQuery last_exec_query_;
+        std::atomic<uint64_t> generated_rows_;
+        std::atomic<uint64_t> queries_;
+        std::atomic<uint64_t> generated_events_;
+
+        PropertyHandleCache property_handles_;
+        StandInConnector connector_;
+        ManualClock clock_;
+        ConnectionPool pool_;
+
+        // Declared last so the threads are stopped before anything they use is destroyed
+        WorkerPool workers_;
+    };
+
+};
\ No newline at end of file
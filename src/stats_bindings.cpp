@@ -0,0 +1,185 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "stats_bindings.h"
+
+#include <chrono>
+
+#include "marshalling.h"
+#include "prepared_query.h"
+#include "wql.h"
+
+namespace wmi_wrapper
+{
+
+    double GetMilliseconds(
+        int64_t ns)
+    {
+        return static_cast<double>(ns) / 1e6;
+    }
+
+    Napi::Object ConvertQueryTimings(
+        const QueryTimings &timings,
+        Napi::Env env)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        for (size_t stage = 0; stage < kQueryStageCount; ++stage)
+        {
+            std::string name = std::string(GetQueryStageName(static_cast<QueryStage>(stage))) + "Ms";
+            result.Set(name, Napi::Number::New(env, GetMilliseconds(timings.stage_ns[stage])));
+        }
+        result.Set("rows", Napi::Number::New(env, static_cast<double>(timings.rows)));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(timings.bytes)));
+        result.Set("cached", Napi::Boolean::New(env, timings.cached));
+        return result;
+    }
+
+    void FinishQueryTimings(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &params,
+        HRESULT hres,
+        const QueryOptions &options,
+        Napi::Value results)
+    {
+        QueryTimings *timings = options.timings;
+        if (timings == NULL)
+        {
+            return;
+        }
+
+        timings->Add(kTotalStage, std::chrono::steady_clock::now() - timings->started);
+        if (GetQueryStats().IsEnabled())
+        {
+            GetQueryStats().Record(
+                wmi_namespace,
+                options.prepared != NULL ? options.prepared->GetClassName() : GetQueryClassName(params.first),
+                hres,
+                *timings);
+        }
+
+        // Kept out of enumeration so results still compare and serialize like before
+        if (options.report_timings && results.IsObject())
+        {
+            results.As<Napi::Object>().DefineProperty(
+                Napi::PropertyDescriptor::Value("timings", ConvertQueryTimings(*timings, results.Env()), napi_default));
+        }
+    }
+
+    Napi::Object ConvertLatencySummary(
+        const LatencySummary &summary,
+        Napi::Env env)
+    {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("count", Napi::Number::New(env, static_cast<double>(summary.count)));
+        result.Set("totalMs", Napi::Number::New(env, summary.total_ms));
+        result.Set("maxMs", Napi::Number::New(env, summary.max_ms));
+        result.Set("p50Ms", Napi::Number::New(env, summary.p50_ms));
+        result.Set("p90Ms", Napi::Number::New(env, summary.p90_ms));
+        result.Set("p99Ms", Napi::Number::New(env, summary.p99_ms));
+        return result;
+    }
+
+    Napi::Value WmiGetStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        std::vector<QueryClassStats> stats = GetQueryStats().GetStats();
+        Napi::Array result = Napi::Array::New(env, stats.size());
+        for (uint32_t i = 0; i < stats.size(); ++i)
+        {
+            const QueryClassStats &class_stats = stats[i];
+            Napi::Object entry = Napi::Object::New(env);
+            entry.Set("namespace", class_stats.wmi_namespace);
+            entry.Set("className", ConvertWstringToString(class_stats.class_name));
+            entry.Set("queries", Napi::Number::New(env, static_cast<double>(class_stats.queries)));
+            entry.Set("failures", Napi::Number::New(env, static_cast<double>(class_stats.failures)));
+            entry.Set("cacheHits", Napi::Number::New(env, static_cast<double>(class_stats.cache_hits)));
+            entry.Set("rows", Napi::Number::New(env, static_cast<double>(class_stats.rows)));
+            entry.Set("bytes", Napi::Number::New(env, static_cast<double>(class_stats.bytes)));
+
+            // Keyed by the same decimal error code query errors report
+            Napi::Object errors = Napi::Object::New(env);
+            for (const auto &error : class_stats.errors)
+            {
+                errors.Set(std::to_string(error.first), Napi::Number::New(env, static_cast<double>(error.second)));
+            }
+            entry.Set("errors", errors);
+
+            Napi::Object stages = Napi::Object::New(env);
+            for (size_t stage = 0; stage < kQueryStageCount; ++stage)
+            {
+                if (class_stats.stages[stage].count > 0)
+                {
+                    stages.Set(
+                        GetQueryStageName(static_cast<QueryStage>(stage)),
+                        ConvertLatencySummary(class_stats.stages[stage], env));
+                }
+            }
+            entry.Set("stages", stages);
+            result.Set(i, entry);
+        }
+        return result;
+    }
+
+    Napi::Value WmiResetStats(
+        const Napi::CallbackInfo &info)
+    {
+        GetQueryStats().Reset();
+        return info.Env().Undefined();
+    }
+
+    Napi::Value WmiConfigureStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 1 || !info[0].IsObject())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Value enabled = info[0].As<Napi::Object>().Get("enabled");
+        if (!enabled.IsUndefined())
+        {
+            if (!enabled.IsBoolean())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            GetQueryStats().SetEnabled(enabled.As<Napi::Boolean>().Value());
+        }
+        return env.Undefined();
+    }
+
+    void RegisterStatsBindings(
+        Napi::Env env,
+        Napi::Object exports)
+    {
+        exports.Set("getStats", Napi::Function::New(env, wmi_wrapper::WmiGetStats));
+        exports.Set("resetStats", Napi::Function::New(env, wmi_wrapper::WmiResetStats));
+        exports.Set("configureStats", Napi::Function::New(env, wmi_wrapper::WmiConfigureStats));
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <string>
+
+#include <napi.h>
+
+#include "query_stats.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Records a timed query in the statistics. When the caller asked for its timings they are
+     * attached to the converted results as the non-enumerable timings property.
+     *
+     * @param results The converted results, undefined for a failed query
+     */
+    void FinishQueryTimings(
+        const std::string &wmi_namespace,
+        const WmiQueryParams &params,
+        HRESULT hres,
+        const QueryOptions &options,
+        Napi::Value results);
+
+    /**
+     * Returns the statistics of every class queried since the last reset, one object per namespace
+     * and class with the query, failure, cache hit, row and byte counts, the failures per error code
+     * and a latency summary per stage
+     */
+    Napi::Value WmiGetStats(const Napi::CallbackInfo &info);
+
+    /**
+     * Drops all query statistics
+     */
+    Napi::Value WmiResetStats(const Napi::CallbackInfo &info);
+
+    /**
+     * Turns collecting query statistics on or off
+     *
+     * @param info[0] Object with enabled, on by default
+     */
+    Napi::Value WmiConfigureStats(const Napi::CallbackInfo &info);
+
+    void RegisterStatsBindings(Napi::Env env, Napi::Object exports);
+
+};
\ No newline at end of file
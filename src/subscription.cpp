@@ -0,0 +1,381 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "subscription.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <napi.h>
+
+#include "marshalling.h"
+#include "query_bindings.h"
+
+namespace wmi_wrapper
+{
+
+    const uint32_t kDefaultMaxQueuedEvents = 1000;
+    const uint32_t kDefaultMaxEventBatchSize = 100;
+
+    /**
+     * Queues the events of a provider subscription and wakes the JavaScript thread when it
+     * is waiting for them.
+     */
+    class SubscriptionListener : public EventListener
+    {
+    public:
+        SubscriptionListener(
+            std::shared_ptr<EventQueue> queue,
+            Napi::ThreadSafeFunction deliver,
+            Subscription *subscription)
+            : queue_(std::move(queue)),
+              deliver_(deliver),
+              subscription_(subscription),
+              released_(false)
+        {
+        }
+
+        void OnEvents(std::vector<WmiQueryResult> &events) override
+        {
+            if (queue_->Push(std::move(events)))
+            {
+                Wake();
+            }
+        }
+
+        void OnComplete(HRESULT hres) override
+        {
+            if (queue_->Complete(hres))
+            {
+                Wake();
+            }
+        }
+
+        // Schedules a delivery on the JavaScript thread
+        void Wake()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (released_)
+            {
+                return;
+            }
+
+            Subscription *subscription = subscription_;
+            deliver_.NonBlockingCall(
+                [subscription](Napi::Env env, Napi::Function callback)
+                {
+                    subscription->Deliver(env, callback);
+                });
+        }
+
+        // Called on the JavaScript thread once no more deliveries are needed
+        void Release()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!released_)
+            {
+                released_ = true;
+                deliver_.Release();
+            }
+        }
+
+    private:
+        std::shared_ptr<EventQueue> queue_;
+        std::mutex mutex_;
+        Napi::ThreadSafeFunction deliver_;
+        Subscription *subscription_;
+        bool released_;
+    };
+
+    Napi::Function Subscription::GetClass(
+        Napi::Env env)
+    {
+        return DefineClass(
+            env,
+            "Subscription",
+            {InstanceMethod("unsubscribe", &Subscription::Unsubscribe),
+             InstanceAccessor("active", &Subscription::GetActive, nullptr)});
+    }
+
+    Subscription::Subscription(
+        const Napi::CallbackInfo &info)
+        : Napi::ObjectWrap<Subscription>(info),
+          max_batch_size_(kDefaultMaxEventBatchSize),
+          active_(false)
+    {
+    }
+
+    HRESULT Subscription::Start(
+        Napi::Env env,
+        QueryProvider *provider,
+        const std::string &wmi_namespace,
+        const WmiQueryParams &params,
+        const QueryOptions &options,
+        Napi::Function callback,
+        size_t max_queued_events,
+        EventQueue::OverflowPolicy overflow,
+        size_t max_batch_size)
+    {
+        queue_ = std::make_shared<EventQueue>(max_queued_events, overflow);
+        options_ = options;
+        max_batch_size_ = max_batch_size;
+        active_ = true;
+
+        // Keep the handle alive while events can arrive, even when JavaScript dropped it.
+        // Like a timer, an active subscription also keeps the process running.
+        Ref();
+
+        Napi::ThreadSafeFunction deliver = Napi::ThreadSafeFunction::New(
+            env,
+            callback,
+            "wmi_native_module:subscribe",
+            0,
+            1,
+            [this](Napi::Env env)
+            {
+                napi_remove_env_cleanup_hook(env, StopOnEnvCleanup, this);
+                Unref();
+            });
+
+        // Provider threads must not be left delivering into an environment that is going away
+        napi_add_env_cleanup_hook(env, StopOnEnvCleanup, this);
+
+        listener_ = std::make_shared<SubscriptionListener>(queue_, deliver, this);
+        HRESULT hres = provider->Subscribe(wmi_namespace, params, options, listener_, &subscription_);
+        if (FAILED(hres))
+        {
+            Stop();
+        }
+        return hres;
+    }
+
+    void Subscription::StopOnEnvCleanup(
+        void *data)
+    {
+        static_cast<Subscription *>(data)->Stop();
+    }
+
+    void Subscription::Stop()
+    {
+        if (!active_)
+        {
+            return;
+        }
+        active_ = false;
+
+        // Once cancelled the provider no longer calls the listener
+        if (subscription_)
+        {
+            subscription_->Cancel();
+            subscription_.reset();
+        }
+        queue_->Cancel();
+        listener_->Release();
+    }
+
+    void Subscription::Deliver(
+        Napi::Env env,
+        Napi::Function callback)
+    {
+        if (!active_)
+        {
+            return;
+        }
+
+        Napi::HandleScope scope(env);
+        EventBatch batch;
+        if (!queue_->Take(max_batch_size_, &batch))
+        {
+            return;
+        }
+
+        if (batch.complete)
+        {
+            Stop();
+        }
+
+        if (!batch.events.empty() || batch.dropped > 0 || batch.coalesced > 0)
+        {
+            Napi::Object info = Napi::Object::New(env);
+            info.Set("dropped", Napi::Number::New(env, static_cast<double>(batch.dropped)));
+            info.Set("coalesced", Napi::Number::New(env, static_cast<double>(batch.coalesced)));
+            callback.Call({env.Null(), ConvertResultsArray(std::move(batch.events), options_, env), info});
+            if (env.IsExceptionPending())
+            {
+                // Reported as an uncaught exception once this call returns
+                return;
+            }
+        }
+
+        if (batch.complete)
+        {
+            if (FAILED(batch.status))
+            {
+                callback.Call({Napi::Error::New(env, GetQueryErrorMessage(batch.status)).Value()});
+            }
+        }
+        else if (active_)
+        {
+            // More events may be queued, drain them in a later call so other callbacks get a turn
+            listener_->Wake();
+        }
+    }
+
+    Napi::Value Subscription::Unsubscribe(
+        const Napi::CallbackInfo &info)
+    {
+        Stop();
+        return info.Env().Undefined();
+    }
+
+    Napi::Value Subscription::GetActive(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Boolean::New(info.Env(), active_);
+    }
+
+    bool ReadSubscriptionOption(
+        Napi::Object options,
+        const char *name,
+        uint32_t *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+        if (!option.IsNumber() || option.As<Napi::Number>().DoubleValue() < 1)
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *value = option.As<Napi::Number>().Uint32Value();
+        return true;
+    }
+
+    Napi::Value WmiSubscribe(
+        const Napi::CallbackInfo &info)
+    {
+        const size_t kNamespaceParam = 0;
+        const size_t kQueryParam = 1;
+        const size_t kCallbackParam = 2;
+        const size_t kOptionsParam = 3; // optional
+
+        Napi::Env env = info.Env();
+
+        QueryProvider *provider = GetQueryProvider();
+        if (provider == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        if (info.Length() < 3 || info.Length() > 4)
+        {
+            Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool has_options = info.Length() > kOptionsParam && !info[kOptionsParam].IsUndefined();
+        if (!info[kNamespaceParam].IsString() ||
+            !info[kQueryParam].IsString() ||
+            !info[kCallbackParam].IsFunction() ||
+            (has_options && !info[kOptionsParam].IsObject()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::String wmi_namespace = info[kNamespaceParam].As<Napi::String>();
+        if (!CheckNamespace(wmi_namespace))
+        {
+            return env.Null();
+        }
+
+        Napi::Object options = has_options ? info[kOptionsParam].As<Napi::Object>() : Napi::Object::New(env);
+        Napi::Value properties = options.Get("properties");
+        if (!properties.IsUndefined() && !properties.IsArray())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        QueryOptions query_options;
+        uint32_t max_queued_events = kDefaultMaxQueuedEvents;
+        uint32_t max_batch_size = kDefaultMaxEventBatchSize;
+        bool drop_oldest = true;
+        if (!ParseQueryOptions(options, &query_options) ||
+            !ReadSubscriptionOption(options, "maxQueuedEvents", &max_queued_events) ||
+            !ReadSubscriptionOption(options, "maxBatchSize", &max_batch_size) ||
+            !ReadStringOption(options, "overflow", "dropOldest", "coalesce", &drop_oldest))
+        {
+            return env.Null();
+        }
+
+        // Events arrive a few at a time, there is nothing to pivot, aggregate or leave unconverted
+        if (query_options.columnar || query_options.aggregate || query_options.lazy_objects)
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        WmiQueryParams params = GetWstrParams(
+            info[kQueryParam].As<Napi::String>(),
+            properties.IsArray() ? properties.As<Napi::Array>() : Napi::Array::New(env),
+            env);
+        if (env.IsExceptionPending())
+        {
+            return env.Null();
+        }
+
+        Napi::Object subscription = GetAddonData(env)->subscription_constructor.New({});
+        HRESULT hres = Subscription::Unwrap(subscription)->Start(
+            env,
+            provider,
+            wmi_namespace.Utf8Value(),
+            params,
+            query_options,
+            info[kCallbackParam].As<Napi::Function>(),
+            max_queued_events,
+            drop_oldest ? EventQueue::kDropOldest : EventQueue::kCoalesce,
+            max_batch_size);
+        if (FAILED(hres))
+        {
+            Napi::Error::New(env, GetQueryErrorMessage(hres)).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        return subscription;
+    }
+
+    void RegisterSubscriptions(
+        Napi::Env env,
+        Napi::Object exports,
+        AddonData *addon_data)
+    {
+        addon_data->subscription_constructor = Napi::Persistent(Subscription::GetClass(env));
+        exports.Set("subscribe", Napi::Function::New(env, wmi_wrapper::WmiSubscribe));
+    }
+
+}
\ No newline at end of file
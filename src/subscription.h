@@ -0,0 +1,106 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+
+#include "addon_data.h"
+#include "event_queue.h"
+#include "query_provider.h"
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    class SubscriptionListener;
+
+    /**
+     * Handle returned by subscribe.
+     *
+     * Events are pushed by the provider into a bounded EventQueue from whichever thread receives
+     * them, and a ThreadSafeFunction delivers them to the callback in batches. The JavaScript thread
+     * is only woken when it isn't already scheduled to drain the queue, so a burst of events costs a
+     * single call per batch instead of one per event.
+     */
+    class Subscription : public Napi::ObjectWrap<Subscription>
+    {
+    public:
+        static Napi::Function GetClass(Napi::Env env);
+
+        explicit Subscription(const Napi::CallbackInfo &info);
+
+        HRESULT Start(
+            Napi::Env env,
+            QueryProvider *provider,
+            const std::string &wmi_namespace,
+            const WmiQueryParams &params,
+            const QueryOptions &options,
+            Napi::Function callback,
+            size_t max_queued_events,
+            EventQueue::OverflowPolicy overflow,
+            size_t max_batch_size);
+
+        // Hands the next batch of events to the callback, called on the JavaScript thread
+        void Deliver(Napi::Env env, Napi::Function callback);
+
+    private:
+        Napi::Value Unsubscribe(const Napi::CallbackInfo &info);
+        Napi::Value GetActive(const Napi::CallbackInfo &info);
+
+        // Cancels the subscription and lets the ThreadSafeFunction go
+        void Stop();
+
+        static void StopOnEnvCleanup(void *data);
+
+        std::shared_ptr<EventQueue> queue_;
+        std::shared_ptr<SubscriptionListener> listener_;
+        std::unique_ptr<EventSubscription> subscription_;
+        QueryOptions options_;
+        size_t max_batch_size_;
+        bool active_;
+    };
+
+    /**
+     * Subscribes to the events matched by a WQL event query
+     *
+     * @param info[0] String containing the Namespace
+     * @param info[1] String containing the WQL event query
+     *                (example: "SELECT * FROM __InstanceCreationEvent WITHIN 1 WHERE TargetInstance ISA 'Win32_Process'")
+     * @param info[2] Function called as callback(null, events, {dropped, coalesced}) for every batch of events,
+     *                or as callback(error) once when the subscription fails
+     * @param info[3] Optional: Object with properties (array of property names, dotted paths such as
+     *                'TargetInstance.Name' read embedded objects), maxQueuedEvents (default 1000),
+     *                overflow ('dropOldest' or 'coalesce'), maxBatchSize (default 100) and the value
+     *                conversion settings of WmiQuery
+     * @return An object with unsubscribe() and active
+     */
+    Napi::Value WmiSubscribe(const Napi::CallbackInfo &info);
+
+    void RegisterSubscriptions(Napi::Env env, Napi::Object exports, AddonData *addon_data);
+
+};
\ No newline at end of file
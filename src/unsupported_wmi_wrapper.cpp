@@ -24,23 +24,522 @@
 
 #include "unsupported_wmi_wrapper.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <napi.h>
 
+#include "marshalling.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "query_recording.h"
+#include "result_cache.h"
+#include "result_set.h"
+#include "stage_benchmarks.h"
+#include "stand_in_provider.h"
+
 namespace wmi_wrapper
 {
 
-    Napi::Value WmiQuery(
+    StandInProvider stand_in_provider;
+    RecordingQueryProvider recording_provider(&stand_in_provider);
+    // Results expire on the stand-in's clock, so tests control TTLs with advanceClock
+    CachingQueryProvider caching_provider(&recording_provider, &stand_in_provider.GetClock());
+    std::atomic<bool> stand_in_enabled(false);
+
+    // A replay answers queries without the stand-in, which is how recordings made on Windows are used here
+    bool IsQueryingSupported()
+    {
+        return stand_in_enabled || recording_provider.IsReplaying();
+    }
+
+    QueryProvider *GetQueryProvider()
+    {
+        return IsQueryingSupported() ? &caching_provider : NULL;
+    }
+
+    ResultCache *GetResultCache()
+    {
+        return IsQueryingSupported() ? &caching_provider.GetResultCache() : NULL;
+    }
+
+    RecordingQueryProvider *GetRecordingQueryProvider()
+    {
+        return &recording_provider;
+    }
+
+    bool ReadOption(Napi::Object options, const char *name, uint32_t *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+        if (!option.IsNumber() || option.As<Napi::Number>().DoubleValue() < 0)
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *value = option.As<Napi::Number>().Uint32Value();
+        return true;
+    }
+
+    bool ReadOption(Napi::Object options, const char *name, bool *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+        if (!option.IsBoolean())
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+        *value = option.As<Napi::Boolean>().Value();
+        return true;
+    }
+
+    bool ReadOption(Napi::Object options, const char *name, std::vector<std::wstring> *value)
+    {
+        Napi::Value option = options.Get(name);
+        if (option.IsUndefined())
+        {
+            return true;
+        }
+        if (!option.IsArray())
+        {
+            Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Array names = option.As<Napi::Array>();
+        value->clear();
+        for (uint32_t i = 0; i < names.Length(); ++i)
+        {
+            Napi::Value name_value = names.Get(i);
+            if (!name_value.IsString())
+            {
+                Napi::Error::New(options.Env(), "Invalid Parameter").ThrowAsJavaScriptException();
+                return false;
+            }
+            value->push_back(ConvertStringToWstring(name_value.As<Napi::String>().Utf8Value()));
+        }
+        return true;
+    }
+
+    /**
+     * Routes queries to the synthetic stand-in provider instead of failing with "This OS is not supported."
+     *
+     * @param info[0] Optional: Object with rowCount, propertyCount, latencyMs, connectLatencyMs,
+     *                propertyHandles, eventIntervalMs, eventBatchSize, refreshLatencyMs, nextLatencyMs,
+     *                rowLatencyMs, hangAfterRows, firstRow, revision, revisionInterval,
+     *                maskRejectedQueries, missingProperties and rejectOnNext overrides
+     */
+    Napi::Value EnableStandIn(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        StandInOptions options;
+
+        if (info.Length() > 0 && !info[0].IsUndefined())
+        {
+            if (!info[0].IsObject())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            Napi::Object values = info[0].As<Napi::Object>();
+            if (!ReadOption(values, "rowCount", &options.row_count) ||
+                !ReadOption(values, "propertyCount", &options.property_count) ||
+                !ReadOption(values, "latencyMs", &options.latency_ms) ||
+                !ReadOption(values, "connectLatencyMs", &options.connect_latency_ms) ||
+                !ReadOption(values, "propertyHandles", &options.property_handles) ||
+                !ReadOption(values, "eventIntervalMs", &options.event_interval_ms) ||
+                !ReadOption(values, "eventBatchSize", &options.event_batch_size) ||
+                !ReadOption(values, "refreshLatencyMs", &options.refresh_latency_ms) ||
+                !ReadOption(values, "nextLatencyMs", &options.next_latency_ms) ||
+                !ReadOption(values, "rowLatencyMs", &options.row_latency_ms) ||
+                !ReadOption(values, "hangAfterRows", &options.hang_after_rows) ||
+                !ReadOption(values, "firstRow", &options.first_row) ||
+                !ReadOption(values, "revision", &options.revision) ||
+                !ReadOption(values, "revisionInterval", &options.revision_interval) ||
+                !ReadOption(values, "maskRejectedQueries", &options.mask_rejected_queries) ||
+                !ReadOption(values, "missingProperties", &options.missing_properties) ||
+                !ReadOption(values, "rejectOnNext", &options.reject_on_next))
+            {
+                return env.Undefined();
+            }
+        }
+
+        stand_in_provider.Configure(options);
+        stand_in_enabled = true;
+        return env.Undefined();
+    }
+
+    Napi::Value DisableStandIn(
         const Napi::CallbackInfo &info)
     {
-        Napi::Error::New(info.Env(), "This OS is not supported.").ThrowAsJavaScriptException();
-        return Napi::Object::New(info.Env());
+        stand_in_enabled = false;
+        return info.Env().Undefined();
+    }
+
+    /**
+     * Simulates a restart of the WMI service by breaking every open stand-in connection
+     */
+    Napi::Value BreakStandInConnections(
+        const Napi::CallbackInfo &info)
+    {
+        stand_in_provider.GetConnector().BreakConnections();
+        return info.Env().Undefined();
+    }
+
+    /**
+     * Moves the clock used by the connection pool forward
+     *
+     * @param info[0] Number of milliseconds to advance
+     */
+    Napi::Value AdvanceStandInClock(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 1 || !info[0].IsNumber())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        stand_in_provider.GetClock().Advance(std::chrono::milliseconds(info[0].As<Napi::Number>().Int64Value()));
+        return env.Undefined();
+    }
+
+    Napi::Value GetStandInConnectionStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        ConnectionPoolStats stats = stand_in_provider.GetConnectionPool().GetStats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+        result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+        result.Set("reconnects", Napi::Number::New(env, static_cast<double>(stats.reconnects)));
+        result.Set("evictions", Napi::Number::New(env, static_cast<double>(stats.evictions)));
+        result.Set("failedHealthChecks", Napi::Number::New(env, static_cast<double>(stats.failed_health_checks)));
+        result.Set("openConnections", Napi::Number::New(env, static_cast<double>(stats.open_connections)));
+        result.Set("connects", Napi::Number::New(env, static_cast<double>(stand_in_provider.GetConnector().GetConnectCount())));
+        return result;
+    }
+
+    Napi::Value GetStandInQueryCount(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Number::New(info.Env(), static_cast<double>(stand_in_provider.GetQueryCount()));
+    }
+
+    Napi::Value GetStandInGeneratedRows(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Number::New(info.Env(), static_cast<double>(stand_in_provider.GetGeneratedRows()));
+    }
+
+    Napi::Value GetStandInGeneratedEvents(
+        const Napi::CallbackInfo &info)
+    {
+        return Napi::Number::New(info.Env(), static_cast<double>(stand_in_provider.GetGeneratedEvents()));
+    }
+
+    /**
+     * Returns the query text the last query would have passed to ExecQuery, the properties of
+     * its partial instance context (null without one) and the instances asked for by each Next call
+     */
+    Napi::Value GetStandInLastExecQuery(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        StandInExecQuery exec_query = stand_in_provider.GetLastExecQuery();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("query", ConvertWstringToJsString(exec_query.query, env));
+        if (exec_query.partial_instances)
+        {
+            Napi::Array ext_properties = Napi::Array::New(env, exec_query.ext_properties.size());
+            for (size_t i = 0; i < exec_query.ext_properties.size(); ++i)
+            {
+                ext_properties.Set(static_cast<uint32_t>(i), ConvertWstringToJsString(exec_query.ext_properties[i], env));
+            }
+            result.Set("extProperties", ext_properties);
+        }
+        else
+        {
+            result.Set("extProperties", env.Null());
+        }
+
+        Napi::Array next_counts = Napi::Array::New(env, exec_query.next_counts.size());
+        for (size_t i = 0; i < exec_query.next_counts.size(); ++i)
+        {
+            next_counts.Set(static_cast<uint32_t>(i), Napi::Number::New(env, exec_query.next_counts[i]));
+        }
+        result.Set("nextCounts", next_counts);
+        return result;
+    }
+
+    /**
+     * Returns how often property handles were resolved or reused and how values were read
+     */
+    Napi::Value GetStandInPropertyHandleStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        PropertyHandleCacheStats stats = stand_in_provider.GetPropertyHandleCache().GetStats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+        result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+        result.Set("invalidations", Napi::Number::New(env, static_cast<double>(stats.invalidations)));
+        result.Set("handleReads", Napi::Number::New(env, static_cast<double>(stats.handle_reads)));
+        result.Set("namedReads", Napi::Number::New(env, static_cast<double>(stats.named_reads)));
+        result.Set("cachedSchemas", Napi::Number::New(env, static_cast<double>(stats.cached_schemas)));
+        return result;
+    }
+
+    // Integers that fit 32 bits are signed, BigInts 64 bit integers, other numbers reals
+    bool ReadResultValue(Napi::Value input, bool element, WmiValue *value)
+    {
+        *value = WmiValue();
+        if (input.IsNull() || input.IsUndefined())
+        {
+            return true;
+        }
+        if (input.IsString())
+        {
+            *value = WmiValue(ConvertStringToWstring(input.As<Napi::String>().Utf8Value()));
+            return true;
+        }
+        if (input.IsBoolean())
+        {
+            value->type = WmiValue::kBoolean;
+            value->size = 1;
+            value->boolean_value = input.As<Napi::Boolean>().Value();
+            return true;
+        }
+        if (input.IsNumber())
+        {
+            double number = input.As<Napi::Number>().DoubleValue();
+            if (number == static_cast<double>(static_cast<int32_t>(number)))
+            {
+                value->type = WmiValue::kSigned;
+                value->size = 4;
+                value->signed_value = static_cast<int32_t>(number);
+            }
+            else
+            {
+                value->type = WmiValue::kReal;
+                value->size = 8;
+                value->real_value = number;
+            }
+            return true;
+        }
+        if (input.IsBigInt())
+        {
+            bool lossless = false;
+            value->size = 8;
+            value->type = WmiValue::kSigned;
+            value->signed_value = input.As<Napi::BigInt>().Int64Value(&lossless);
+            if (!lossless)
+            {
+                value->type = WmiValue::kUnsigned;
+                value->unsigned_value = input.As<Napi::BigInt>().Uint64Value(&lossless);
+            }
+            return lossless;
+        }
+        // Elements of arrays are scalars, as in WMI
+        if (input.IsArray() && !element)
+        {
+            Napi::Array elements = input.As<Napi::Array>();
+            value->type = WmiValue::kArray;
+            value->elements.resize(elements.Length());
+            for (uint32_t i = 0; i < elements.Length(); ++i)
+            {
+                if (!ReadResultValue(elements.Get(i), true, &value->elements[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Stores instances in a ResultSet and reads them back, which tests the set without a query
+     *
+     * @param info[0] Array of objects, each an instance whose keys are its property names. Instances
+     *                with the same names share a schema.
+     * @return { rows, marshalled, schemaIndexes, schemaCount, bytes, heapBlocks }: the instances as
+     *         copied out of the set (GetWmiValue) and as marshalled from it, the schema of each
+     *         instance, the number of schemas and the memory the set holds
+     */
+    Napi::Value BuildStandInResultSet(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() != 1 || !info[0].IsArray())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Array instances = info[0].As<Napi::Array>();
+        std::vector<std::shared_ptr<const ResultSet::Schema>> schemas;
+        ResultSet results;
+        WmiValue value;
+        for (uint32_t i = 0; i < instances.Length(); ++i)
+        {
+            Napi::Value instance_value = instances.Get(i);
+            if (!instance_value.IsObject() || instance_value.IsArray())
+            {
+                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+
+            Napi::Object instance = instance_value.As<Napi::Object>();
+            Napi::Array keys = instance.GetPropertyNames();
+            std::shared_ptr<ResultSet::Schema> names = std::make_shared<ResultSet::Schema>();
+            for (uint32_t j = 0; j < keys.Length(); ++j)
+            {
+                names->push_back(ConvertStringToWstring(keys.Get(j).As<Napi::String>().Utf8Value()));
+            }
+
+            std::shared_ptr<const ResultSet::Schema> schema = names;
+            for (const std::shared_ptr<const ResultSet::Schema> &known : schemas)
+            {
+                if (*known == *names)
+                {
+                    schema = known;
+                }
+            }
+            if (schema == names)
+            {
+                schemas.push_back(schema);
+            }
+
+            results.AddRow(schema);
+            for (uint32_t j = 0; j < keys.Length(); ++j)
+            {
+                if (!ReadResultValue(instance.Get(keys.Get(j)), false, &value))
+                {
+                    Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+                results.AddValue(value);
+            }
+        }
+
+        QueryOptions options;
+        options.typed_values = true;
+        Napi::Array rows = Napi::Array::New(env, results.size());
+        Napi::Array schema_indexes = Napi::Array::New(env, results.size());
+        for (size_t row = 0; row < results.size(); ++row)
+        {
+            const ResultSet::Schema &names = results.GetNames(row);
+            const ResultSet::Value *values = results.GetValues(row);
+            WmiQueryResult copy;
+            for (size_t j = 0; j < names.size(); ++j)
+            {
+                copy.emplace_back(names[j], results.GetWmiValue(values[j]));
+            }
+            rows.Set(static_cast<uint32_t>(row), ConvertResultObject(copy, options, env));
+            schema_indexes.Set(static_cast<uint32_t>(row), Napi::Number::New(env, static_cast<double>(results.GetSchemaIndex(row))));
+        }
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("rows", rows);
+        result.Set("marshalled", ConvertResultsArray(results, options, env));
+        result.Set("schemaIndexes", schema_indexes);
+        result.Set("schemaCount", Napi::Number::New(env, static_cast<double>(results.GetSchemaCount())));
+        result.Set("bytes", Napi::Number::New(env, static_cast<double>(results.GetBytes())));
+        result.Set("heapBlocks", Napi::Number::New(env, static_cast<double>(results.GetBlocks())));
+        return result;
+    }
+
+    /**
+     * Benchmarks one stage of the query pipeline natively, see BenchmarkPipelineStage
+     *
+     * @param info[0] 'params', 'format', 'build' or 'marshal'
+     * @param info[1] Optional: Object with rows (default 1000), properties (default 20), typed (default false),
+     *                legacyLayout (default false) and minTimeMs (default 500) overrides
+     * @return { name, iterations, realTimeNs, cpuTimeNs, itemsPerSecond, bytesPerSecond, heapBlocks }
+     */
+    Napi::Value BenchmarkStandInStage(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+        if (info.Length() < 1 || info.Length() > 2 || !info[0].IsString() ||
+            (info.Length() > 1 && !info[1].IsObject() && !info[1].IsUndefined()))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        StageBenchmarkOptions options;
+        if (info.Length() > 1 && info[1].IsObject())
+        {
+            Napi::Object values = info[1].As<Napi::Object>();
+            if (!ReadOption(values, "rows", &options.rows) ||
+                !ReadOption(values, "properties", &options.properties) ||
+                !ReadOption(values, "typed", &options.typed) ||
+                !ReadOption(values, "legacyLayout", &options.legacy_layout) ||
+                !ReadOption(values, "minTimeMs", &options.min_time_ms))
+            {
+                return env.Undefined();
+            }
+        }
+
+        StageBenchmarkResult result;
+        if (!BenchmarkPipelineStage(info[0].As<Napi::String>().Utf8Value(), options, env, &result))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        double seconds_per_iteration = result.real_time_ns / 1e9;
+        Napi::Object stats = Napi::Object::New(env);
+        stats.Set("name", Napi::String::New(env, result.name));
+        stats.Set("iterations", Napi::Number::New(env, static_cast<double>(result.iterations)));
+        stats.Set("realTimeNs", Napi::Number::New(env, result.real_time_ns));
+        stats.Set("cpuTimeNs", Napi::Number::New(env, result.cpu_time_ns));
+        stats.Set("itemsPerSecond", Napi::Number::New(env, seconds_per_iteration > 0 ? result.items / seconds_per_iteration : 0));
+        stats.Set("bytesPerSecond", Napi::Number::New(env, seconds_per_iteration > 0 ? result.bytes / seconds_per_iteration : 0));
+        stats.Set("heapBlocks", Napi::Number::New(env, static_cast<double>(result.blocks)));
+        return stats;
     }
 
     Napi::Object Init(
         Napi::Env env,
         Napi::Object exports)
     {
-        exports.Set("query", Napi::Function::New(env, WmiQuery));
+        RegisterQueryBindings(env, exports);
+
+        // Test hooks, only present in the unsupported OS build
+        Napi::Object stand_in = Napi::Object::New(env);
+        stand_in.Set("enable", Napi::Function::New(env, EnableStandIn));
+        stand_in.Set("disable", Napi::Function::New(env, DisableStandIn));
+        stand_in.Set("breakConnections", Napi::Function::New(env, BreakStandInConnections));
+        stand_in.Set("advanceClock", Napi::Function::New(env, AdvanceStandInClock));
+        stand_in.Set("connectionStats", Napi::Function::New(env, GetStandInConnectionStats));
+        stand_in.Set("generatedRows", Napi::Function::New(env, GetStandInGeneratedRows));
+        stand_in.Set("generatedEvents", Napi::Function::New(env, GetStandInGeneratedEvents));
+        stand_in.Set("queryCount", Napi::Function::New(env, GetStandInQueryCount));
+        stand_in.Set("propertyHandleStats", Napi::Function::New(env, GetStandInPropertyHandleStats));
+        stand_in.Set("lastExecQuery", Napi::Function::New(env, GetStandInLastExecQuery));
+        stand_in.Set("benchmark", Napi::Function::New(env, BenchmarkStandInStage));
+        stand_in.Set("resultSet", Napi::Function::New(env, BuildStandInResultSet));
+        exports.Set("standIn", stand_in);
+
         return exports;
     }
 
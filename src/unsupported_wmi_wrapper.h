@@ -29,8 +29,6 @@
 namespace wmi_wrapper
 {
 
-    Napi::Value WmiQuery(const Napi::CallbackInfo &info);
-
     Napi::Object Init(Napi::Env env, Napi::Object exports);
 
 };
\ No newline at end of file
@@ -0,0 +1,358 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "variant_conversion.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cwchar>
+#include <string>
+
+#ifdef _WIN32
+#include <propvarutil.h>
+#endif
+
+namespace wmi_wrapper
+{
+
+    const double kMillisecondsPerDay = 86400000.0;
+    const double kOleDateUnixEpoch = 25569.0; // 1970-01-01 as an OLE automation date
+
+    void SetSigned(
+        int64_t number,
+        uint8_t size,
+        WmiValue *value)
+    {
+        value->type = WmiValue::kSigned;
+        value->size = size;
+        value->signed_value = number;
+    }
+
+    void SetUnsigned(
+        uint64_t number,
+        uint8_t size,
+        WmiValue *value)
+    {
+        value->type = WmiValue::kUnsigned;
+        value->size = size;
+        value->unsigned_value = number;
+    }
+
+    void SetReal(
+        double number,
+        uint8_t size,
+        WmiValue *value)
+    {
+        value->type = WmiValue::kReal;
+        value->size = size;
+        value->real_value = number;
+    }
+
+    int64_t GetDaysFromCivil(
+        int64_t year,
+        int64_t month,
+        int64_t day)
+    {
+        // Days between 1970-01-01 and the given date in the proleptic Gregorian calendar
+        year -= month <= 2 ? 1 : 0;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        int64_t year_of_era = year - era * 400;
+        int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+        return era * 146097 + day_of_era - 719468;
+    }
+
+    bool ParseDigits(
+        const wchar_t *text,
+        size_t count,
+        int64_t *number)
+    {
+        *number = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (text[i] < L'0' || text[i] > L'9')
+            {
+                return false;
+            }
+            *number = *number * 10 + (text[i] - L'0');
+        }
+        return true;
+    }
+
+    bool ParseCimDateTime(
+        const wchar_t *datetime,
+        size_t length,
+        double *epoch_ms)
+    {
+        // yyyymmddHHMMSS.mmmmmmsUUU, intervals use ':' instead of the UTC offset sign
+        const size_t kDateTimeLength = 25;
+        if (length != kDateTimeLength || datetime[14] != L'.' || (datetime[21] != L'+' && datetime[21] != L'-'))
+        {
+            return false;
+        }
+
+        int64_t year, month, day, hours, minutes, seconds, microseconds, offset_minutes;
+        if (!ParseDigits(datetime, 4, &year) ||
+            !ParseDigits(datetime + 4, 2, &month) ||
+            !ParseDigits(datetime + 6, 2, &day) ||
+            !ParseDigits(datetime + 8, 2, &hours) ||
+            !ParseDigits(datetime + 10, 2, &minutes) ||
+            !ParseDigits(datetime + 12, 2, &seconds) ||
+            !ParseDigits(datetime + 15, 6, &microseconds) ||
+            !ParseDigits(datetime + 22, 3, &offset_minutes))
+        {
+            // Wildcards ('*') mark fields that are not significant
+            return false;
+        }
+
+        if (month < 1 || month > 12 || day < 1 || day > 31 || hours > 23 || minutes > 59 || seconds > 60)
+        {
+            return false;
+        }
+
+        // The timestamp is local time at the given offset from UTC
+        if (datetime[21] == L'-')
+        {
+            offset_minutes = -offset_minutes;
+        }
+
+        int64_t local_seconds = GetDaysFromCivil(year, month, day) * 86400 + hours * 3600 + minutes * 60 + seconds;
+        int64_t utc_seconds = local_seconds - offset_minutes * 60;
+        *epoch_ms = static_cast<double>(utc_seconds) * 1000.0 + static_cast<double>(microseconds) / 1000.0;
+        return true;
+    }
+
+    void ConvertStringElement(
+        BSTR string,
+        CIMTYPE cim_type,
+        WmiValue *value)
+    {
+        size_t length = SysStringLen(string);
+        const wchar_t *text = string != NULL ? string : L"";
+
+        // WMI passes 64 bit integers and datetimes as strings
+        if ((cim_type == CIM_SINT64 || cim_type == CIM_UINT64) && length > 0)
+        {
+            wchar_t *end = NULL;
+            errno = 0;
+            if (cim_type == CIM_SINT64)
+            {
+                long long number = std::wcstoll(text, &end, 10);
+                if (errno == 0 && end == text + length)
+                {
+                    SetSigned(number, 8, value);
+                    return;
+                }
+            }
+            else if (text[0] != L'-')
+            {
+                unsigned long long number = std::wcstoull(text, &end, 10);
+                if (errno == 0 && end == text + length)
+                {
+                    SetUnsigned(number, 8, value);
+                    return;
+                }
+            }
+        }
+        else if (cim_type == CIM_DATETIME)
+        {
+            double epoch_ms;
+            if (ParseCimDateTime(text, length, &epoch_ms))
+            {
+                value->type = WmiValue::kDateTime;
+                value->real_value = epoch_ms;
+                return;
+            }
+        }
+
+        // Anything that doesn't parse is passed on as the original string
+        value->type = WmiValue::kString;
+        value->string_value.assign(text, length);
+    }
+
+    HRESULT ConvertElement(
+        VARTYPE vt,
+        const void *data,
+        CIMTYPE cim_type,
+        WmiValue *value)
+    {
+        switch (vt)
+        {
+        case VT_EMPTY:
+        case VT_NULL:
+            value->type = WmiValue::kNull;
+            return S_OK;
+        case VT_BSTR:
+            ConvertStringElement(*static_cast<const BSTR *>(data), cim_type, value);
+            return S_OK;
+        case VT_BOOL:
+            value->type = WmiValue::kBoolean;
+            value->boolean_value = *static_cast<const VARIANT_BOOL *>(data) != VARIANT_FALSE;
+            return S_OK;
+        case VT_I1:
+            SetSigned(*static_cast<const int8_t *>(data), 1, value);
+            return S_OK;
+        case VT_UI1:
+            SetUnsigned(*static_cast<const uint8_t *>(data), 1, value);
+            return S_OK;
+        case VT_I2:
+        {
+            // sint8 and char16 are widened to VT_I2
+            int16_t number = *static_cast<const int16_t *>(data);
+            if (cim_type == CIM_CHAR16)
+            {
+                value->type = WmiValue::kString;
+                value->string_value.assign(1, static_cast<wchar_t>(static_cast<uint16_t>(number)));
+            }
+            else
+            {
+                SetSigned(number, cim_type == CIM_SINT8 ? 1 : 2, value);
+            }
+            return S_OK;
+        }
+        case VT_UI2:
+            SetUnsigned(*static_cast<const uint16_t *>(data), 2, value);
+            return S_OK;
+        case VT_I4:
+        case VT_INT:
+        {
+            // uint16 and uint32 are passed as VT_I4
+            int32_t number = *static_cast<const int32_t *>(data);
+            if (cim_type == CIM_UINT32)
+            {
+                SetUnsigned(static_cast<uint32_t>(number), 4, value);
+            }
+            else if (cim_type == CIM_UINT16)
+            {
+                SetUnsigned(static_cast<uint16_t>(number), 2, value);
+            }
+            else
+            {
+                SetSigned(number, 4, value);
+            }
+            return S_OK;
+        }
+        case VT_UI4:
+        case VT_UINT:
+            SetUnsigned(*static_cast<const uint32_t *>(data), 4, value);
+            return S_OK;
+        case VT_I8:
+            SetSigned(*static_cast<const int64_t *>(data), 8, value);
+            return S_OK;
+        case VT_UI8:
+            SetUnsigned(*static_cast<const uint64_t *>(data), 8, value);
+            return S_OK;
+        case VT_R4:
+            SetReal(*static_cast<const float *>(data), 4, value);
+            return S_OK;
+        case VT_R8:
+            SetReal(*static_cast<const double *>(data), 8, value);
+            return S_OK;
+        case VT_DATE:
+            value->type = WmiValue::kDateTime;
+            value->real_value = (*static_cast<const DATE *>(data) - kOleDateUnixEpoch) * kMillisecondsPerDay;
+            return S_OK;
+        default:
+            value->type = WmiValue::kNull;
+            return DISP_E_TYPEMISMATCH;
+        }
+    }
+
+    HRESULT ConvertVariant(
+        const VARIANT &variant,
+        CIMTYPE cim_type,
+        WmiValue *value)
+    {
+        if (!(variant.vt & VT_ARRAY))
+        {
+            // Every scalar member starts at the beginning of the VARIANT's value union
+            return ConvertElement(variant.vt, &variant.llVal, cim_type, value);
+        }
+
+        SAFEARRAY *safe_array = variant.parray;
+        VARTYPE element_vt = static_cast<VARTYPE>(variant.vt & VT_TYPEMASK);
+        CIMTYPE element_cim_type = cim_type & ~CIM_FLAG_ARRAY;
+
+        LONG start;
+        LONG end;
+        HRESULT hres = SafeArrayGetLBound(safe_array, 1, &start);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+        hres = SafeArrayGetUBound(safe_array, 1, &end);
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        char *data;
+        hres = SafeArrayAccessData(safe_array, reinterpret_cast<void **>(&data));
+        if (FAILED(hres))
+        {
+            return hres;
+        }
+
+        value->type = WmiValue::kArray;
+        value->elements.resize(end >= start ? static_cast<size_t>(end - start) + 1 : 0);
+        for (size_t i = 0; i < value->elements.size(); ++i)
+        {
+            // Elements without a typed representation stay null
+            ConvertElement(element_vt, data + i * safe_array->cbElements, element_cim_type, &value->elements[i]);
+        }
+
+        return SafeArrayUnaccessData(safe_array);
+    }
+
+    HRESULT ConvertVariantToString(
+        const VARIANT &variant,
+        WmiValue *value)
+    {
+        value->type = WmiValue::kString;
+        value->string_value.clear();
+
+        PWSTR result = NULL;
+        HRESULT hres = VariantToStringAlloc(variant, &result);
+        if (SUCCEEDED(hres))
+        {
+            value->string_value = result;
+            CoTaskMemFree(result);
+        }
+        return hres;
+    }
+
+    HRESULT ConvertPropertyValue(
+        const VARIANT &variant,
+        CIMTYPE cim_type,
+        const QueryOptions &options,
+        WmiValue *value)
+    {
+        if (options.typed_values)
+        {
+            return ConvertVariant(variant, cim_type, value);
+        }
+        return ConvertVariantToString(variant, value);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Wbemidl.h>
+#else
+#include "fake_variant.h"
+#endif
+
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Converts a property value to its typed representation without formatting it as a string first.
+     * WMI hands some CIM types out in a wider or different VARIANT type (uint32 in VT_I4, 64 bit
+     * integers and datetimes in VT_BSTR), the CIM type is used to restore the original meaning.
+     *
+     * @param variant The value as returned by IWbemClassObject::Get
+     * @param cim_type The CIM type of the property, CIM_EMPTY when unknown
+     * @param value Receives the converted value, left null for values that have no typed representation
+     * @return S_OK on success, DISP_E_TYPEMISMATCH for unsupported VARIANT types such as embedded objects
+     */
+    HRESULT ConvertVariant(const VARIANT &variant, CIMTYPE cim_type, WmiValue *value);
+
+    /**
+     * Formats a property value as a string, arrays are joined with "; "
+     */
+    HRESULT ConvertVariantToString(const VARIANT &variant, WmiValue *value);
+
+    /**
+     * Converts a property value the way the query options ask for
+     */
+    HRESULT ConvertPropertyValue(const VARIANT &variant, CIMTYPE cim_type, const QueryOptions &options, WmiValue *value);
+
+    /**
+     * Parses a CIM_DATETIME timestamp (yyyymmddHHMMSS.mmmmmmsUUU)
+     *
+     * @param datetime The timestamp, intervals and timestamps with wildcards are rejected
+     * @param length Number of characters in datetime
+     * @param epoch_ms Receives the time in milliseconds since the Unix epoch
+     * @return true if datetime is a complete timestamp
+     */
+    bool ParseCimDateTime(const wchar_t *datetime, size_t length, double *epoch_ms);
+
+};
\ No newline at end of file
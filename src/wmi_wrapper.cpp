@@ -29,9 +29,32 @@
 #include <Wbemidl.h>
 #include <Windows.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <napi.h>
 
-#include "namespaces.h"
+#include "clock.h"
+#include "connection_pool.h"
+#include "enumeration.h"
+#include "prepared_query.h"
+#include "property_access.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "query_recording.h"
+#include "query_stats.h"
+#include "result_cache.h"
+#include "sample_buffer.h"
+#include "variant_conversion.h"
+#include "worker_pool.h"
+#include "wql.h"
 
 #pragma comment(lib, "wbemuuid.lib")
 #pragma comment(lib, "propsys.lib")
@@ -39,186 +62,677 @@
 namespace wmi_wrapper
 {
 
-    std::string ConvertWstringToString(const std::wstring &wstring)
+    /**
+     * InstanceAccess over an instance returned by WMI. Handles come from IWbemObjectAccess,
+     * which is available on instances from the local WMI service.
+     */
+    class ComInstanceAccess : public InstanceAccess
     {
-        if (wstring.empty())
-            return std::string();
+    public:
+        explicit ComInstanceAccess(IWbemClassObject *class_object)
+            : class_object_(class_object),
+              object_access_(NULL)
+        {
+        }
 
-        int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstring[0], (int)wstring.size(), NULL, 0, NULL, NULL);
-        std::string str(size_needed, 0);
-        WideCharToMultiByte(CP_UTF8, 0, &wstring[0], (int)wstring.size(), &str[0], size_needed, NULL, NULL);
-        return str;
-    }
+        ~ComInstanceAccess() override
+        {
+            if (object_access_ != NULL)
+            {
+                object_access_->Release();
+            }
+        }
 
-    std::wstring ConvertStringToWstring(const std::string &string)
-    {
-        if (string.empty())
+        HRESULT GetClassName(std::wstring *class_name) override
         {
-            return std::wstring();
+            VARIANT variant;
+            VariantInit(&variant);
+            HRESULT hres = class_object_->Get(L"__CLASS", 0, &variant, NULL, NULL);
+            if (SUCCEEDED(hres) && variant.vt == VT_BSTR)
+            {
+                class_name->assign(variant.bstrVal, SysStringLen(variant.bstrVal));
+            }
+            VariantClear(&variant);
+            return hres;
         }
 
-        int size_needed = MultiByteToWideChar(CP_UTF8, 0, &string[0], (int)string.size(), NULL, 0);
-        std::wstring wstr(size_needed, 0);
-        MultiByteToWideChar(CP_UTF8, 0, &string[0], (int)string.size(), &wstr[0], size_needed);
-        return wstr;
-    }
+        HRESULT GetNames(std::vector<std::wstring> *names) override
+        {
+            HRESULT hres;
+            SAFEARRAY *names_array = NULL;
+            LONG start = 0;
+            LONG end = -1;
 
-    std::wstring GetPropertyValue(
-        const std::wstring &property,
-        IWbemClassObject *class_object)
-    {
-        HRESULT hres;
-        VARIANT variant;
-        std::wstring value = L"";
-        VariantInit(&variant);
-
-        hres = class_object->Get(
-            property.c_str(), // property name
-            0,                // reserved, must be 0
-            &variant,         // when successfull, this will hold the requested value
-            NULL,             // Optional CIM type of the property
-            NULL              // If specified receives information about the origin of the property
-        );
+            hres = class_object_->GetNames(
+                0,
+                WBEM_FLAG_ALWAYS,
+                0,
+                &names_array);
+
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            hres = SafeArrayGetLBound(names_array, 1, &start);
+            if (SUCCEEDED(hres))
+            {
+                hres = SafeArrayGetUBound(names_array, 1, &end);
+            }
+            BSTR *values = NULL;
+            if (SUCCEEDED(hres))
+            {
+                hres = SafeArrayAccessData(names_array, (void HUGEP **)&values);
+            }
+            if (SUCCEEDED(hres))
+            {
+                for (LONG i = start; i <= end; ++i)
+                {
+                    names->push_back(values[i - start]);
+                }
+                hres = SafeArrayUnaccessData(names_array);
+            }
+            SafeArrayDestroy(names_array);
+            return hres;
+        }
 
-        if (!FAILED(hres))
+        HRESULT GetPropertyHandle(
+            const std::wstring &property,
+            CIMTYPE *cim_type,
+            long *handle) override
         {
+            HRESULT hres = GetObjectAccess();
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            return object_access_->GetPropertyHandle(property.c_str(), cim_type, handle);
+        }
 
-            const UINT kMaxStrLength = 1024;
-            wchar_t result[kMaxStrLength];
-            VariantToString(variant, result, kMaxStrLength);
-            value = std::wstring(result);
+        HRESULT ReadDWORD(long handle, uint32_t *value) override
+        {
+            HRESULT hres = GetObjectAccess();
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            DWORD dword = 0;
+            hres = object_access_->ReadDWORD(handle, &dword);
+            *value = dword;
+            return hres;
         }
-        VariantClear(&variant);
 
-        return value;
-    }
+        HRESULT ReadQWORD(long handle, uint64_t *value) override
+        {
+            HRESULT hres = GetObjectAccess();
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            return object_access_->ReadQWORD(handle, value);
+        }
 
-    HRESULT GetPropertyValues(
-        std::vector<std::wstring> properties,
-        WmiQueryResult *results,
-        IWbemClassObject *class_object)
-    {
-        HRESULT hres = ERROR_SUCCESS;
-        for (size_t i = 0; i < properties.size(); ++i)
+        HRESULT Get(
+            const std::wstring &property,
+            VARIANT *variant,
+            CIMTYPE *cim_type) override
         {
-            std::wstring value = GetPropertyValue(properties[i], class_object);
-            (*results).push_back(make_pair(properties[i], std::wstring(std::move(value))));
+            // Events carry the instance they are about as an embedded object, read as TargetInstance.Name
+            size_t separator = property.find(L'.');
+            if (separator != std::wstring::npos)
+            {
+                return GetEmbedded(property.substr(0, separator), property.substr(separator + 1), variant, cim_type);
+            }
+
+            return class_object_->Get(
+                property.c_str(), // property name
+                0,                // reserved, must be 0
+                variant,          // when successfull, this will hold the requested value
+                cim_type,         // CIM type of the property, tells how to read the VARIANT
+                NULL              // If specified receives information about the origin of the property
+            );
         }
-        return hres;
-    }
 
-    HRESULT GetAllPropertyValues(
-        IWbemClassObject *class_object,
-        WmiQueryResult *results)
+    private:
+        HRESULT GetEmbedded(
+            const std::wstring &object_property,
+            const std::wstring &property,
+            VARIANT *variant,
+            CIMTYPE *cim_type)
+        {
+            VARIANT object_variant;
+            VariantInit(&object_variant);
+            HRESULT hres = class_object_->Get(object_property.c_str(), 0, &object_variant, NULL, NULL);
+            if (SUCCEEDED(hres) && (object_variant.vt != VT_UNKNOWN || object_variant.punkVal == NULL))
+            {
+                hres = WBEM_E_NOT_FOUND;
+            }
+
+            IWbemClassObject *embedded_object = NULL;
+            if (SUCCEEDED(hres))
+            {
+                hres = object_variant.punkVal->QueryInterface(IID_IWbemClassObject, (void **)&embedded_object);
+            }
+            if (SUCCEEDED(hres))
+            {
+                ComInstanceAccess embedded(embedded_object);
+                hres = embedded.Get(property, variant, cim_type);
+                embedded_object->Release();
+            }
+
+            VariantClear(&object_variant);
+            return hres;
+        }
+
+        HRESULT GetObjectAccess()
+        {
+            if (object_access_ != NULL)
+            {
+                return S_OK;
+            }
+            return class_object_->QueryInterface(IID_IWbemObjectAccess, (void **)&object_access_);
+        }
+
+        IWbemClassObject *class_object_;
+        IWbemObjectAccess *object_access_;
+    };
+
+    /**
+     * Hands out the instances of a semisynchronous query, see EnumerateInstances
+     */
+    class ComInstanceEnumerator : public InstanceEnumerator
     {
-        HRESULT hres;
-        SAFEARRAY *names_array;
-        LONG start;
-        LONG end;
+    public:
+        // Takes over the reference to enumerator
+        explicit ComInstanceEnumerator(IEnumWbemClassObject *enumerator)
+            : enumerator_(enumerator),
+              returned_any_(false)
+        {
+        }
 
-        hres = class_object->GetNames(
-            0,
-            WBEM_FLAG_ALWAYS,
-            0,
-            &names_array);
+        ~ComInstanceEnumerator() override
+        {
+            ReleaseObjects();
+            // Releasing the enumerator of a query that is still running cancels it
+            enumerator_->Release();
+        }
 
-        if (FAILED(hres))
+        HRESULT Next(
+            uint32_t timeout_ms,
+            uint32_t count,
+            uint32_t *returned) override
         {
+            ReleaseObjects();
+            objects_.resize(count);
+
+            ULONG num_objs_returned = 0;
+            HRESULT hres = enumerator_->Next(
+                static_cast<long>(timeout_ms), // Timeout: maximum amount of time the call blocks before returning, WBEM_INFINITE waits for ever
+                count,                         // Number of requested IWbemClassObjects
+                objects_.data(),               // Pointer to location with space to hold pointers to the number of objects specified
+                &num_objs_returned             // number of objects returned (can be less than number requested, but not NULL)
+            );
+            objects_.resize(SUCCEEDED(hres) ? num_objs_returned : 0);
+            *returned = static_cast<uint32_t>(objects_.size());
+            returned_any_ = returned_any_ || !objects_.empty();
+
+            // WBEM_S_NO_ERROR, WBEM_S_FALSE and WBEM_S_TIMEDOUT are S_OK, S_FALSE and kQueryTimedOut
             return hres;
         }
-        hres = SafeArrayGetLBound(names_array, 1, &start);
-        if (FAILED(hres))
+
+        HRESULT Read(
+            uint32_t index,
+            InstanceReader *reader,
+            ResultSet *results) override
         {
-            return hres;
+            ComInstanceAccess instance(objects_[index]);
+            return reader->Read(&instance, results);
+        }
+
+        // Whether any Next call returned instances, after which the query can't be run again
+        bool HasReturned() const
+        {
+            return returned_any_;
         }
-        hres = SafeArrayGetUBound(names_array, 1, &end);
+
+    private:
+        void ReleaseObjects()
+        {
+            for (IWbemClassObject *object : objects_)
+            {
+                object->Release();
+            }
+            objects_.clear();
+        }
+
+        IEnumWbemClassObject *enumerator_;
+        std::vector<IWbemClassObject *> objects_;
+        bool returned_any_;
+    };
+
+    PropertyHandleCache &GetPropertyHandleCache()
+    {
+        static PropertyHandleCache cache;
+        return cache;
+    }
+
+    const bstr_t &GetQueryLanguage()
+    {
+        // WQL is the only language WMI takes, so it is allocated once
+        static const bstr_t language(L"WQL");
+        return language;
+    }
+
+    /**
+     * Creates the context that asks providers for partial instances holding only the given
+     * properties. Providers that don't support partial instances ignore it.
+     */
+    HRESULT CreatePartialInstanceContext(
+        const std::vector<std::wstring> &properties,
+        IWbemContext **context)
+    {
+        HRESULT hres = CoCreateInstance(
+            CLSID_WbemContext,
+            NULL,
+            CLSCTX_INPROC_SERVER,
+            IID_IWbemContext,
+            (void **)context);
         if (FAILED(hres))
         {
             return hres;
         }
-        BSTR *names;
-        hres = SafeArrayAccessData(names_array, (void HUGEP **)&names);
-        for (int i = start; i <= end; ++i)
+
+        VARIANT names;
+        VariantInit(&names);
+        names.parray = SafeArrayCreateVector(VT_BSTR, 0, static_cast<ULONG>(properties.size()));
+        if (names.parray != NULL)
+        {
+            names.vt = VT_ARRAY | VT_BSTR;
+        }
+        else
+        {
+            hres = E_OUTOFMEMORY;
+        }
+        for (LONG i = 0; SUCCEEDED(hres) && i < static_cast<LONG>(properties.size()); ++i)
+        {
+            // SafeArrayPutElement stores a copy of the string
+            bstr_t name(properties[i].c_str());
+            hres = SafeArrayPutElement(names.parray, &i, static_cast<BSTR>(name));
+        }
+
+        VARIANT enabled;
+        VariantInit(&enabled);
+        enabled.vt = VT_BOOL;
+        enabled.boolVal = VARIANT_TRUE;
+        if (SUCCEEDED(hres))
+        {
+            hres = (*context)->SetValue(L"__GET_EXTENSIONS", 0, &enabled);
+        }
+        if (SUCCEEDED(hres))
+        {
+            hres = (*context)->SetValue(L"__GET_EXT_CLIENT_REQUEST", 0, &enabled);
+        }
+        if (SUCCEEDED(hres))
+        {
+            hres = (*context)->SetValue(L"__GET_EXT_PROPERTIES", 0, &names);
+        }
+        VariantClear(&names);
+
+        if (FAILED(hres))
         {
-            std::wstring value = GetPropertyValue(names[i], class_object);
-            (*results).push_back(make_pair(names[i], std::wstring(std::move(value))));
+            (*context)->Release();
+            *context = NULL;
         }
-        hres = SafeArrayUnaccessData(names_array);
         return hres;
     }
 
-    HRESULT GetAllValues(
+    HRESULT EnumerateValues(
+        const std::string &wmi_namespace,
         const std::wstring &query,
-        std::vector<std::wstring> properties,
-        std::vector<WmiQueryResult> *results,
-        IWbemServices *service)
+        const std::vector<std::wstring> &properties,
+        const QueryOptions &options,
+        IWbemServices *service,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch)
     {
         HRESULT hres;
         IEnumWbemClassObject *enumerator = NULL;
+        StageTimer timer(options.timings);
+
+        // Prepared queries allocated their text once, with the projection already rewritten
+        bstr_t query_copy;
+        BSTR query_text = options.prepared != NULL ? options.prepared->GetQueryText() : NULL;
+        if (query_text == NULL)
+        {
+            std::wstring projected;
+            query_copy = bstr_t(RewriteProjection(query, properties, &projected) ? projected.c_str() : query.c_str());
+            query_text = query_copy;
+        }
+
+        // Partial instances are only a hint, the query runs without them when the context can't be created
+        IWbemContext *context = NULL;
+        std::vector<std::wstring> projection;
+        if (options.partial_instances && GetProjection(properties, &projection))
+        {
+            CreatePartialInstanceContext(projection, &context);
+        }
 
         hres = service->ExecQuery(
-            bstr_t("WQL"),                                         // Query language, must be "WQL" for WMI
-            bstr_t(query.c_str()),                                 // Query text
+            GetQueryLanguage(),                                    // Query language, must be "WQL" for WMI
+            query_text,                                            // Query text
             WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY, // These flags suggested for best performance
-            NULL,                                                  // Typically NULL
+            context,                                               // Partial instance hints, typically NULL
             &enumerator                                            // Enumerator to get the instances in the results
         );
 
-        if (FAILED(hres))
+        // The projection named a property the class doesn't have, run the query as written without the hints
+        bool rewritten = query.compare(0, std::wstring::npos, query_text, SysStringLen(query_text)) != 0;
+        auto exec_as_written = [&]()
+        {
+            rewritten = false;
+            return service->ExecQuery(
+                GetQueryLanguage(),
+                bstr_t(query.c_str()),
+                WBEM_FLAG_FORWARD_ONLY | WBEM_FLAG_RETURN_IMMEDIATELY,
+                NULL,
+                &enumerator);
+        };
+        if (IsRejectedProjection(hres) && rewritten)
         {
-            return hres; // Query failed
+            hres = exec_as_written();
         }
+        timer.Lap(kExecStage);
 
-        const u_int kMaxNumObjects = 10;
-        IWbemClassObject *class_objects[kMaxNumObjects];
-        ULONG num_objs_returned = 0;
+        if (context != NULL)
+        {
+            context->Release();
+        }
 
-        HRESULT enum_next_result = WBEM_S_NO_ERROR;
+        InstanceReader reader(&GetPropertyHandleCache(), wmi_namespace, query, properties, options);
+        while (SUCCEEDED(hres))
+        {
+            ComInstanceEnumerator instances(enumerator);
+            hres = EnumerateInstances(&instances, &reader, options, batch_size, &timer, on_batch);
 
-        while (WBEM_S_NO_ERROR == enum_next_result)
+            // Returning immediately, ExecQuery may leave the rejection to the first Next call
+            if (!IsRejectedProjection(hres) || instances.HasReturned() || !rewritten)
+            {
+                return hres;
+            }
+            hres = exec_as_written();
+            timer.Lap(kExecStage);
+        }
+        return hres; // Query failed
+    }
+
+    HRESULT GetAllValues(
+        const std::string &wmi_namespace,
+        const std::wstring &query,
+        const std::vector<std::wstring> &properties,
+        const QueryOptions &options,
+        ResultSet *results,
+        IWbemServices *service)
+    {
+        // Everything is collected into a single batch
+        return EnumerateValues(
+            wmi_namespace,
+            query,
+            properties,
+            options,
+            service,
+            std::numeric_limits<size_t>::max(),
+            [results](ResultSet &batch)
+            {
+                *results = std::move(batch);
+                return true;
+            });
+    }
+
+    class ComServiceConnection : public ServiceConnection
+    {
+    public:
+        explicit ComServiceConnection(IWbemServices *service) : service_(service) {}
+
+        ~ComServiceConnection() override
         {
-            enum_next_result = enumerator->Next(
-                WBEM_INFINITE,     // Timeout: maximum amount of time the call blocks before returning
-                kMaxNumObjects,    // Number of requested IWbemClassObjects
-                class_objects,     // Pointer to location with space to hold pointers to the number of objects specified
-                &num_objs_returned // number of objects returned (can be less than number requested, but not NULL)
-            );
-            if (SUCCEEDED(enum_next_result) && num_objs_returned > 0)
+            service_->Release();
+        }
+
+        IWbemServices *GetService() const
+        {
+            return service_;
+        }
+
+        bool IsHealthy() override
+        {
+            IWbemClassObject *class_object = NULL;
+            HRESULT hres = service_->GetObject(bstr_t(L"__SystemClass"), 0, NULL, &class_object, NULL);
+            if (class_object != NULL)
             {
-                for (ULONG i = 0; i < num_objs_returned; ++i)
-                {
-                    HRESULT object_result;
-                    WmiQueryResult result;
-                    if (properties.size() > 0)
-                    {
-                        object_result = GetPropertyValues(properties, &result, class_objects[i]);
-                    }
-                    else
-                    {
-                        object_result = GetAllPropertyValues(class_objects[i], &result);
-                    }
-                    results->push_back(std::move(result));
+                class_object->Release();
+            }
+            return SUCCEEDED(hres);
+        }
 
-                    class_objects[i]->Release();
-                }
+    private:
+        IWbemServices *service_;
+    };
+
+    class ComServiceConnector : public ServiceConnector
+    {
+    public:
+        HRESULT Connect(
+            const std::string &wmi_namespace,
+            std::shared_ptr<ServiceConnection> *connection) override
+        {
+            // Pooled proxies belong to the MTA, keep it alive even when no thread has
+            // COM initialized so they can be used and released from any thread.
+            std::call_once(
+                mta_usage_once_,
+                [this]()
+                { CoIncrementMTAUsage(&mta_usage_cookie_); });
+
+            IWbemServices *service = NULL;
+            HRESULT hres = ConnectService(wmi_namespace.c_str(), &service);
+            if (FAILED(hres))
+            {
+                return hres;
             }
+
+            // A restarted service may come back with different class definitions
+            GetPropertyHandleCache().Invalidate(wmi_namespace);
+            *connection = std::make_shared<ComServiceConnection>(service);
+            return S_OK;
         }
 
-        if (enumerator != NULL)
+    private:
+        std::once_flag mta_usage_once_;
+        CO_MTA_USAGE_COOKIE mta_usage_cookie_ = NULL;
+    };
+
+    ConnectionPool &GetConnectionPool()
+    {
+        static ComServiceConnector connector;
+        static SteadyClock clock;
+        static ConnectionPool pool(&connector, &clock);
+        return pool;
+    }
+
+    HRESULT InitializeSecurity()
+    {
+        // Security can only be initialized once per process, remember when it's done
+        static std::atomic<bool> initialized(false);
+        if (initialized)
         {
-            enumerator->Release();
+            return S_OK;
         }
 
+        HRESULT hres = CoInitializeSecurity(
+            NULL,
+            -1,                          // COM authentication
+            NULL,                        // Authentication services
+            NULL,                        // Reserved
+            RPC_C_AUTHN_LEVEL_DEFAULT,   // Default authentication
+            RPC_C_IMP_LEVEL_IMPERSONATE, // Default Impersonation
+            NULL,                        // Authentication info
+            EOAC_NONE,                   // Additional capabilities
+            NULL                         // Reserved
+        );
+
+        // RCP_E_TOO_LATE = CoInitializeSecurity has already been called by
+        // the same process, in which case will continue to create instance.
+        if (SUCCEEDED(hres) || hres == RPC_E_TOO_LATE)
+        {
+            initialized = true;
+            return S_OK;
+        }
         return hres;
     }
 
-    HRESULT Query(
+    HRESULT ConnectService(
         const char *wmi_namespace,
-        WmiQueryParams query,
-        std::vector<WmiQueryResult> *results)
+        IWbemServices **service)
+    {
+        HRESULT hres;
+
+        // Obtain the initial locator to WMI
+        IWbemLocator *locator = NULL;
+
+        hres = CoCreateInstance(
+            CLSID_WbemLocator,
+            0,
+            CLSCTX_INPROC_SERVER,
+            IID_IWbemLocator,
+            (LPVOID *)&locator);
+
+        if (FAILED(hres))
+        {
+            // Failed to create IWbemLocator object.
+            return hres;
+        }
+
+        // Connect to the namespace with the current user and obtain pointer
+        // to make IWbemServices calls.
+        hres = locator->ConnectServer(
+            _bstr_t(wmi_namespace), // WMI namespace (root/wmi, root/cimv2, etc)
+            NULL,                   // User name. NULL = current user
+            NULL,                   // User password. NULL = current
+            0,                      // Locale. NULL indicates current
+            NULL,                   // Security flags.
+            0,                      // Authority (for example, Kerberos)
+            0,                      // Context object
+            service                 // pointer to IWbemServices proxy
+        );
+
+        // The locator is only needed to connect
+        locator->Release();
+
+        if (FAILED(hres))
+        {
+            // Could not connect.
+            *service = NULL;
+            return hres;
+        }
+
+        // Set security levels on the proxy
+        hres = CoSetProxyBlanket(
+            *service,                    // Indicates the proxy to set
+            RPC_C_AUTHN_WINNT,           // RPC_C_AUTHN_xxx
+            RPC_C_AUTHZ_NONE,            // RPC_C_AUTHZ_xxx
+            NULL,                        // Server principal name
+            RPC_C_AUTHN_LEVEL_CALL,      // RPC_C_AUTHN_LEVEL_xxx
+            RPC_C_IMP_LEVEL_IMPERSONATE, // RPC_C_IMP_LEVEL_xxx
+            NULL,                        // client identity
+            EOAC_NONE                    // proxy capabilities
+        );
+
+        if (FAILED(hres))
+        {
+            // Could not set proxy blanket.
+            (*service)->Release();
+            *service = NULL;
+            return hres;
+        }
+
+        return S_OK;
+    }
+
+    /**
+     * Worker threads join the MTA once, when they start, and stay in it until they exit
+     */
+    class ComWorkerThreadHooks : public WorkerThreadHooks
+    {
+    public:
+        HRESULT OnThreadStart() override
+        {
+            HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            hres = InitializeSecurity();
+            if (FAILED(hres))
+            {
+                CoUninitialize();
+            }
+            return hres;
+        }
+
+        void OnThreadStop() override
+        {
+            CoUninitialize();
+        }
+    };
+
+    WorkerPool &GetWorkerPool()
+    {
+        // Never destroyed: joining threads from a static destructor while the module unloads can
+        // deadlock, the threads are stopped by the environment cleanup hook instead
+        static ComWorkerThreadHooks hooks;
+        static WorkerPool *pool = new WorkerPool(&hooks, kDefaultWorkerThreads);
+        return *pool;
+    }
+
+    /**
+     * Runs operation with the pooled connection to the namespace, on a thread in the MTA.
+     * If the connection broke the pool reconnects and the operation is retried once.
+     * The error of a rejected query goes to rejected (when set), see GetConnectedQueryResult.
+     */
+    template <typename Operation>
+    HRESULT RunWithPooledService(
+        const char *wmi_namespace,
+        QueryTimings *timings,
+        HRESULT *rejected,
+        Operation operation)
+    {
+        bool connected = false;
+        HRESULT hres = GetConnectionPool().Execute(
+            wmi_namespace,
+            [&](ServiceConnection *connection, bool *retryable)
+            {
+                connected = true;
+                IWbemServices *service = static_cast<ComServiceConnection *>(connection)->GetService();
+                return operation(service, retryable);
+            });
+
+        return connected ? GetConnectedQueryResult(hres, timings, rejected) : hres;
+    }
+
+    /**
+     * Initializes COM on the calling thread and runs operation with a connection to the namespace.
+     * The operation is called as HRESULT operation(IWbemServices *service, bool *retryable),
+     * see ConnectionPool::Execute.
+     */
+    template <typename Operation>
+    HRESULT RunWithService(
+        const char *wmi_namespace,
+        QueryTimings *timings,
+        HRESULT *rejected,
+        Operation operation)
     {
 
         HRESULT hres;
+        bool multithreaded = true;
 
         // Initialize COM.
         hres = CoInitializeEx(0, COINIT_MULTITHREADED);
@@ -226,6 +740,7 @@ namespace wmi_wrapper
             if (FAILED(hres) && hres == RPC_E_CHANGED_MODE)
             {
                 // Was already initialized in a different mode, switch
+                multithreaded = false;
                 hres = CoInitializeEx(0, COINIT_APARTMENTTHREADED);
             }
             if (FAILED(hres))
@@ -234,225 +749,783 @@ namespace wmi_wrapper
                 return hres;
             }
 
-            // Initialize security
-            hres = CoInitializeSecurity(
-                NULL,
-                -1,                          // COM authentication
-                NULL,                        // Authentication services
-                NULL,                        // Reserved
-                RPC_C_AUTHN_LEVEL_DEFAULT,   // Default authentication
-                RPC_C_IMP_LEVEL_IMPERSONATE, // Default Impersonation
-                NULL,                        // Authentication info
-                EOAC_NONE,                   // Additional capabilities
-                NULL                         // Reserved
-            );
-
-            // RCP_E_TOO_LATE = CoInitializeSecurity has already been called by
-            // the same process, in which case will continue to create instance.
-            if (FAILED(hres) && hres != RPC_E_TOO_LATE)
+            hres = InitializeSecurity();
+            if (FAILED(hres))
             {
                 // Failed to initialize security
                 CoUninitialize();
                 return hres;
             }
 
-            // Obtain the initial locator to WMI
-            IWbemLocator *locator = NULL;
+            if (multithreaded)
+            {
+                // Pooled proxies can be used directly from any thread in the MTA
+                hres = RunWithPooledService(wmi_namespace, timings, rejected, operation);
+            }
+            else
+            {
+                // A proxy from the MTA can't be used in this apartment without marshalling,
+                // connect just for this operation instead.
+                IWbemServices *service = NULL;
+                hres = ConnectService(wmi_namespace, &service);
+                if (SUCCEEDED(hres))
+                {
+                    bool retryable = false;
+                    hres = GetConnectedQueryResult(operation(service, &retryable), timings, rejected);
+                    service->Release();
+                }
+            }
+        }
+
+        CoUninitialize();
 
-            hres = CoCreateInstance(
-                CLSID_WbemLocator,
-                0,
-                CLSCTX_INPROC_SERVER,
-                IID_IWbemLocator,
-                (LPVOID *)&locator);
+        return hres;
+    }
 
-            if (FAILED(hres))
+    HRESULT Query(
+        const char *wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        ResultSet *results)
+    {
+        // The worker threads are already in the MTA, COM is neither initialized per query nor
+        // on the calling thread, whose apartment may belong to someone else
+        StageTimer timer(options.timings);
+        HRESULT rejected = S_OK;
+        HRESULT hres = GetWorkerPool().Run(
+            options.priority,
+            [&]()
             {
-                // Failed to create IWbemLocator object.
-                CoUninitialize();
-                return hres;
-            }
+                timer.Lap(kQueueStage);
+                // A query cancelled while it waited for a thread doesn't start
+                if (options.IsCancelled())
+                {
+                    return kQueryCancelled;
+                }
+                return RunWithPooledService(
+                    wmi_namespace,
+                    options.timings,
+                    &rejected,
+                    [&](IWbemServices *service, bool *)
+                    {
+                        timer.Lap(kConnectStage);
+                        results->Clear();
+                        return GetAllValues(wmi_namespace, query.first, query.second, options, results, service);
+                    });
+            });
 
-            // Connect to WMI through the IWbemLocator::ConnectServer method
-            IWbemServices *service = NULL;
+        if (FAILED(rejected))
+        {
+            // Instances read before the query was turned down aren't its results
+            results->Clear();
+            results->SetRejected(rejected);
+        }
+        return hres;
+    }
 
-            // Connect to the namespace with the current user and obtain pointer
-            // to make IWbemServices calls.
-            hres = locator->ConnectServer(
-                _bstr_t(wmi_namespace), // WMI namespace (root/wmi, root/cimv2, etc)
-                NULL,                   // User name. NULL = current user
-                NULL,                   // User password. NULL = current
-                0,                      // Locale. NULL indicates current
-                NULL,                   // Security flags.
-                0,                      // Authority (for example, Kerberos)
-                0,                      // Context object
-                &service                // pointer to IWbemServices proxy
-            );
+    HRESULT QueryBatches(
+        const char *wmi_namespace,
+        const WmiQueryParams &query,
+        const QueryOptions &options,
+        size_t batch_size,
+        const QueryBatchCallback &on_batch)
+    {
+        StageTimer timer(options.timings);
+        return RunWithService(
+            wmi_namespace,
+            options.timings,
+            NULL,
+            [&](IWbemServices *service, bool *retryable)
+            {
+                timer.Lap(kConnectStage);
+                return EnumerateValues(
+                    wmi_namespace,
+                    query.first,
+                    query.second,
+                    options,
+                    service,
+                    batch_size,
+                    [&](ResultSet &batch)
+                    {
+                        // Rows already handed out can't be taken back by a retry
+                        *retryable = false;
+                        return on_batch(batch);
+                    });
+            });
+    }
 
-            if (FAILED(hres))
+    /**
+     * Receives the events of ExecNotificationQueryAsync on threads owned by WMI and hands them to
+     * the listener. WMI only calls the sink through an unsecured apartment stub, so the calls back
+     * into this process are not subject to an access check.
+     */
+    class ComEventSink : public IWbemObjectSink
+    {
+    public:
+        ComEventSink(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::shared_ptr<EventListener> listener)
+            : ref_count_(1),
+              query_(query),
+              reader_(&GetPropertyHandleCache(), wmi_namespace, query_.first, query_.second, options),
+              listener_(std::move(listener)),
+              cancelled_(false)
+        {
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return static_cast<ULONG>(InterlockedIncrement(&ref_count_));
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            LONG ref_count = InterlockedDecrement(&ref_count_);
+            if (ref_count == 0)
             {
-                // Could not connect.
-                locator->Release();
-                CoUninitialize();
+                delete this;
             }
+            return static_cast<ULONG>(ref_count);
+        }
 
-            // Set security levels on the proxy
-            hres = CoSetProxyBlanket(
-                service,                     // Indicates the proxy to set
-                RPC_C_AUTHN_WINNT,           // RPC_C_AUTHN_xxx
-                RPC_C_AUTHZ_NONE,            // RPC_C_AUTHZ_xxx
-                NULL,                        // Server principal name
-                RPC_C_AUTHN_LEVEL_CALL,      // RPC_C_AUTHN_LEVEL_xxx
-                RPC_C_IMP_LEVEL_IMPERSONATE, // RPC_C_IMP_LEVEL_xxx
-                NULL,                        // client identity
-                EOAC_NONE                    // proxy capabilities
-            );
-
-            if (FAILED(hres))
+        HRESULT STDMETHODCALLTYPE QueryInterface(
+            REFIID riid,
+            void **object) override
+        {
+            if (riid == IID_IUnknown || riid == IID_IWbemObjectSink)
             {
-                // Could not set proxy blanket.
-                service->Release();
-                locator->Release();
-                CoUninitialize();
+                *object = static_cast<IWbemObjectSink *>(this);
+                AddRef();
+                return WBEM_S_NO_ERROR;
             }
+            *object = NULL;
+            return E_NOINTERFACE;
+        }
 
-            // Use the IWbemServices pointer to make requests of WMI
-            GetAllValues(query.first, query.second, results, service);
+        HRESULT STDMETHODCALLTYPE Indicate(
+            LONG object_count,
+            IWbemClassObject **objects) override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (cancelled_)
+            {
+                return WBEM_S_NO_ERROR;
+            }
 
-            // Cleanup
-            service->Release();
-            locator->Release();
+            std::vector<WmiQueryResult> events;
+            events.reserve(static_cast<size_t>(object_count));
+            for (LONG i = 0; i < object_count; ++i)
+            {
+                ComInstanceAccess instance(objects[i]);
+                WmiQueryResult event;
+                reader_.Read(&instance, &event);
+                events.push_back(std::move(event));
+            }
+            listener_->OnEvents(events);
+            return WBEM_S_NO_ERROR;
         }
 
-        CoUninitialize();
+        HRESULT STDMETHODCALLTYPE SetStatus(
+            LONG flags,
+            HRESULT hres,
+            BSTR,
+            IWbemClassObject *) override
+        {
+            if (flags != WBEM_STATUS_COMPLETE)
+            {
+                return WBEM_S_NO_ERROR;
+            }
 
-        // return status;
-        return ERROR_SUCCESS;
-    }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!cancelled_)
+            {
+                cancelled_ = true;
+                listener_->OnComplete(hres);
+            }
+            return WBEM_S_NO_ERROR;
+        }
 
-    WmiQueryParams wmi_wrapper::GetWstrParams(
-        Napi::String query,
-        Napi::Array properties,
-        Napi::Env env)
+        // Once Cancel returns the listener is no longer called, even if WMI still has events in flight
+        void Cancel()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+        }
+
+    private:
+        ~ComEventSink() {}
+
+        LONG ref_count_;
+        WmiQueryParams query_;
+        std::mutex mutex_;
+        InstanceReader reader_;
+        std::shared_ptr<EventListener> listener_;
+        bool cancelled_;
+    };
+
+    /**
+     * Owns the MTA thread of one subscription. The thread starts the notification query and, once
+     * cancelled, stops it with CancelAsyncCall, so the JavaScript thread never makes COM calls
+     * whatever apartment it is in.
+     */
+    class ComEventSubscription : public EventSubscription
     {
-        WmiQueryParams wstr_params;
-        std::wstring wstr_query = ConvertStringToWstring(query);
+    public:
+        explicit ComEventSubscription(ComEventSink *sink)
+            : sink_(sink),
+              stopped_(false)
+        {
+        }
 
-        std::vector<std::wstring> wstr_properties;
+        ~ComEventSubscription() override
+        {
+            Cancel();
+            sink_->Release();
+        }
 
-        for (uint32_t i = 0; i < properties.Length(); ++i)
+        void Start(
+            const std::string &wmi_namespace,
+            const std::wstring &query,
+            std::shared_ptr<EventListener> listener)
+        {
+            thread_ = std::thread(
+                [this, wmi_namespace, query, listener]()
+                {
+                    HRESULT hres = Run(wmi_namespace, query);
+                    if (FAILED(hres))
+                    {
+                        listener->OnComplete(hres);
+                    }
+                });
+        }
+
+        void Cancel() override
         {
-            Napi::Value param_value = properties[i];
-            if (param_value.IsString())
             {
-                std::string value = param_value.ToString().Utf8Value();
-                std::wstring wstr_value = ConvertStringToWstring(value);
-                wstr_properties.push_back(std::move(wstr_value));
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopped_ = true;
             }
-            else
+            stop_.notify_all();
+
+            if (thread_.joinable())
             {
-                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
-                return wstr_params;
+                thread_.join();
             }
         }
 
-        wstr_params = make_pair(wstr_query, wstr_properties);
-        return wstr_params;
-    }
+    private:
+        HRESULT Run(
+            const std::string &wmi_namespace,
+            const std::wstring &query)
+        {
+            HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
 
-    Napi::Object ConvertResultsObject(
-        std::vector<WmiQueryResult> results,
-        Napi::Env env)
-    {
-        Napi::Object return_values = Napi::Object::New(env);
+            hres = InitializeSecurity();
+            if (SUCCEEDED(hres))
+            {
+                hres = RunInApartment(wmi_namespace, query);
+            }
+
+            CoUninitialize();
+            return hres;
+        }
 
-        size_t results_length = results.size();
-        for (size_t i = 0; i < results_length; ++i)
+        HRESULT RunInApartment(
+            const std::string &wmi_namespace,
+            const std::wstring &query)
         {
-            Napi::Object return_obj = Napi::Object::New(env);
-            for (size_t j = 0; j < results[i].size(); ++j)
+            IUnsecuredApartment *apartment = NULL;
+            HRESULT hres = CoCreateInstance(
+                CLSID_UnsecuredApartment,
+                NULL,
+                CLSCTX_LOCAL_SERVER,
+                IID_IUnsecuredApartment,
+                (void **)&apartment);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            IUnknown *stub_object = NULL;
+            IWbemObjectSink *stub = NULL;
+            hres = apartment->CreateObjectStub(sink_, &stub_object);
+            if (SUCCEEDED(hres))
             {
-                std::wstring wst_key = results[i][j].first;
-                std::wstring wst_value = results[i][j].second;
+                hres = stub_object->QueryInterface(IID_IWbemObjectSink, (void **)&stub);
+                stub_object->Release();
+            }
 
-                std::string key = ConvertWstringToString(wst_key);
-                std::string value = ConvertWstringToString(wst_value);
+            // The pool reconnects and retries once if the pooled connection broke
+            IWbemServices *service = NULL;
+            if (SUCCEEDED(hres))
+            {
+                hres = GetConnectionPool().Execute(
+                    wmi_namespace,
+                    [&](ServiceConnection *connection, bool *)
+                    {
+                        IWbemServices *pooled_service = static_cast<ComServiceConnection *>(connection)->GetService();
+                        HRESULT exec_hres = pooled_service->ExecNotificationQueryAsync(
+                            bstr_t("WQL"),         // Query language, must be "WQL" for WMI
+                            bstr_t(query.c_str()), // Event query text
+                            WBEM_FLAG_SEND_STATUS, // Report the end of the subscription through SetStatus
+                            NULL,                  // Typically NULL
+                            stub                   // Receives the events
+                        );
+                        if (SUCCEEDED(exec_hres))
+                        {
+                            // Keep the proxy the query runs on, it is needed to cancel it
+                            service = pooled_service;
+                            service->AddRef();
+                        }
+                        return exec_hres;
+                    });
+            }
+
+            if (SUCCEEDED(hres))
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stop_.wait(
+                    lock,
+                    [this]()
+                    { return stopped_; });
+                lock.unlock();
+
+                sink_->Cancel();
+                service->CancelAsyncCall(stub);
+                service->Release();
+            }
 
-                return_obj.Set(key, Napi::String::New(env, value));
+            if (stub != NULL)
+            {
+                stub->Release();
             }
-            return_values.Set(i, return_obj);
+            apartment->Release();
+            return hres;
         }
-        return return_values;
-    }
 
-    Napi::Value WmiQuery(
-        const Napi::CallbackInfo &info)
+        ComEventSink *sink_;
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable stop_;
+        bool stopped_;
+    };
+
+    /**
+     * SampleSource over an IWbemRefresher enumerator. The enumerator is registered once and
+     * refreshed in place, property handles are resolved from the first refreshed instance.
+     */
+    class ComSampleSource : public SampleSource
     {
-        const int kNamespaceParam = 0;
-        const int kQueryParam = 1;
-        const int kPropertiesParam = 2; // optional
+    public:
+        ComSampleSource(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::vector<std::wstring> &properties)
+            : wmi_namespace_(wmi_namespace),
+              class_name_(class_name),
+              properties_(properties),
+              com_initialized_(false),
+              refresher_(NULL),
+              enumerator_(NULL),
+              enumerator_id_(0),
+              handles_resolved_(false),
+              name_handle_(0),
+              has_name_(false),
+              name_buffer_(256)
+        {
+        }
+
+        HRESULT Open() override
+        {
+            HRESULT hres = CoInitializeEx(0, COINIT_MULTITHREADED);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+            com_initialized_ = true;
+
+            hres = InitializeSecurity();
+            if (SUCCEEDED(hres))
+            {
+                hres = Register();
+            }
+            if (FAILED(hres))
+            {
+                Close();
+            }
+            return hres;
+        }
+
+        HRESULT Refresh(SampleFrame *frame) override
+        {
+            HRESULT hres = S_OK;
+            if (refresher_ == NULL)
+            {
+                hres = Register();
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+            }
 
-        const int kMinRequiredParamCount = 2;
-        const int kMaxAllowedParams = 3;
+            // Instances can be added between a call that asks for more room and the next one
+            const int kMaxGetObjectsAttempts = 4;
+            ULONG returned = 0;
+            hres = refresher_->Refresh(0L);
+            for (int attempt = 0; SUCCEEDED(hres) && attempt < kMaxGetObjectsAttempts; ++attempt)
+            {
+                // A call that fails reports the size it needs in returned and fills nothing
+                returned = 0;
+                hres = enumerator_->GetObjects(0L, static_cast<ULONG>(objects_.size()), objects_.data(), &returned);
+                if (hres != WBEM_E_BUFFER_TOO_SMALL)
+                {
+                    break;
+                }
+                // Keep the larger array for the following refreshes
+                objects_.resize(returned);
+            }
 
-        Napi::Env env = info.Env();
-        if (info.Length() < kMinRequiredParamCount || info.Length() > kMaxAllowedParams)
+            ULONG filled = SUCCEEDED(hres) ? returned : 0;
+            if (SUCCEEDED(hres))
+            {
+                hres = ReadObjects(filled, frame);
+            }
+            for (ULONG i = 0; i < filled && i < objects_.size(); ++i)
+            {
+                if (objects_[i] != NULL)
+                {
+                    objects_[i]->Release();
+                    objects_[i] = NULL;
+                }
+            }
+
+            if (IsBrokenConnectionError(hres))
+            {
+                // The enumerator is bound to the broken connection, register it again on the next refresh
+                GetConnectionPool().Invalidate(wmi_namespace_, connection_);
+                Unregister();
+            }
+            return hres;
+        }
+
+        void Close() override
         {
-            // Too few or too many parameters passed
-            Napi::Error::New(env, "Invalid Parameters").ThrowAsJavaScriptException();
-            return env.Null();
+            Unregister();
+            if (com_initialized_)
+            {
+                com_initialized_ = false;
+                CoUninitialize();
+            }
         }
 
-        if (!info[kNamespaceParam].IsString() || !info[kQueryParam].IsString())
+    private:
+        HRESULT Register()
         {
-            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
-            return env.Null();
+            HRESULT hres = GetConnectionPool().Acquire(wmi_namespace_, &connection_);
+            if (FAILED(hres))
+            {
+                return hres;
+            }
+
+            hres = CoCreateInstance(
+                CLSID_WbemRefresher,
+                NULL,
+                CLSCTX_INPROC_SERVER,
+                IID_IWbemRefresher,
+                (void **)&refresher_);
+
+            IWbemConfigureRefresher *configure = NULL;
+            if (SUCCEEDED(hres))
+            {
+                hres = refresher_->QueryInterface(IID_IWbemConfigureRefresher, (void **)&configure);
+            }
+            if (SUCCEEDED(hres))
+            {
+                hres = configure->AddEnum(
+                    static_cast<ComServiceConnection *>(connection_.get())->GetService(),
+                    class_name_.c_str(),
+                    0L,
+                    NULL,
+                    &enumerator_,
+                    &enumerator_id_);
+                configure->Release();
+            }
+
+            if (FAILED(hres))
+            {
+                Unregister();
+            }
+            return hres;
         }
 
-        Napi::String wmi_namespace = info[kNamespaceParam].As<Napi::String>();
-        if (!namespaces::IsSupportedNamespace(wmi_namespace))
+        void Unregister()
         {
-            Napi::Error::New(env, "Unsupported Namespace").ThrowAsJavaScriptException();
-            return env.Null();
+            if (enumerator_ != NULL)
+            {
+                enumerator_->Release();
+                enumerator_ = NULL;
+            }
+            if (refresher_ != NULL)
+            {
+                refresher_->Release();
+                refresher_ = NULL;
+            }
+            connection_.reset();
+            handles_resolved_ = false;
         }
 
-        Napi::String query = info[kQueryParam].As<Napi::String>();
+        HRESULT ResolveHandles(IWbemObjectAccess *object)
+        {
+            CIMTYPE cim_type = CIM_EMPTY;
 
-        Napi::Array properties = Napi::Array::New(env);
+            // Singleton counters, like the memory counters, have no Name
+            has_name_ = SUCCEEDED(object->GetPropertyHandle(L"Name", &cim_type, &name_handle_)) && cim_type == CIM_STRING;
 
-        // Properties param is optional
-        if (info.Length() == kMaxAllowedParams)
+            handles_.resize(properties_.size());
+            types_.resize(properties_.size());
+            for (size_t i = 0; i < properties_.size(); ++i)
+            {
+                HRESULT hres = object->GetPropertyHandle(properties_[i].c_str(), &types_[i], &handles_[i]);
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
+            }
+            handles_resolved_ = true;
+            return S_OK;
+        }
+
+        HRESULT ReadName(
+            IWbemObjectAccess *object,
+            std::wstring *name)
         {
-            // If specific properties are requested, they must be passed as an array
-            if (info[kPropertiesParam].IsArray())
+            if (!has_name_)
             {
-                properties = info[kPropertiesParam].As<Napi::Array>();
+                *name = class_name_;
+                return S_OK;
             }
-            else
+
+            long size = 0;
+            HRESULT hres = object->ReadPropertyValue(
+                name_handle_,
+                static_cast<long>(name_buffer_.size() * sizeof(wchar_t)),
+                &size,
+                reinterpret_cast<BYTE *>(name_buffer_.data()));
+            if (hres == WBEM_E_BUFFER_TOO_SMALL)
+            {
+                name_buffer_.resize(size / sizeof(wchar_t) + 1);
+                hres = object->ReadPropertyValue(
+                    name_handle_,
+                    static_cast<long>(name_buffer_.size() * sizeof(wchar_t)),
+                    &size,
+                    reinterpret_cast<BYTE *>(name_buffer_.data()));
+            }
+            if (SUCCEEDED(hres))
             {
-                Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
-                return env.Null();
+                name->assign(name_buffer_.data(), wcsnlen(name_buffer_.data(), size / sizeof(wchar_t)));
             }
+            return hres;
         }
 
-        WmiQueryParams wstr_params = GetWstrParams(query, properties, env);
+        HRESULT ReadObjects(
+            ULONG count,
+            SampleFrame *frame)
+        {
+            HRESULT hres = S_OK;
+            std::wstring name;
+            for (ULONG i = 0; i < count; ++i)
+            {
+                if (objects_[i] == NULL)
+                {
+                    continue;
+                }
+                if (!handles_resolved_)
+                {
+                    hres = ResolveHandles(objects_[i]);
+                    if (FAILED(hres))
+                    {
+                        return hres;
+                    }
+                }
+
+                hres = ReadName(objects_[i], &name);
+                if (FAILED(hres))
+                {
+                    return hres;
+                }
 
-        std::vector<WmiQueryResult> results;
-        HRESULT hres = wmi_wrapper::Query(wmi_namespace.Utf8Value().c_str(), std::move(wstr_params), &results);
-        if (FAILED(hres))
+                // Values that can't be read, or aren't numbers, stay NaN
+                double *values = frame->AddRow(name);
+                for (size_t property = 0; property < handles_.size(); ++property)
+                {
+                    ReadValue(objects_[i], property, &values[property]);
+                }
+            }
+            return S_OK;
+        }
+
+        void ReadValue(
+            IWbemObjectAccess *object,
+            size_t property,
+            double *value)
         {
-            std::string hresStr = std::to_string(hres);
-            Napi::Error::New(env, "Query failed with error code: " + hresStr).ThrowAsJavaScriptException();
+            DWORD dword = 0;
+            uint64_t qword = 0;
+            switch (types_[property])
+            {
+            case CIM_UINT32:
+                if (SUCCEEDED(object->ReadDWORD(handles_[property], &dword)))
+                {
+                    *value = static_cast<double>(dword);
+                }
+                break;
+            case CIM_SINT32:
+                if (SUCCEEDED(object->ReadDWORD(handles_[property], &dword)))
+                {
+                    *value = static_cast<double>(static_cast<int32_t>(dword));
+                }
+                break;
+            case CIM_UINT64:
+                if (SUCCEEDED(object->ReadQWORD(handles_[property], &qword)))
+                {
+                    *value = static_cast<double>(qword);
+                }
+                break;
+            case CIM_SINT64:
+                if (SUCCEEDED(object->ReadQWORD(handles_[property], &qword)))
+                {
+                    *value = static_cast<double>(static_cast<int64_t>(qword));
+                }
+                break;
+            case CIM_REAL32:
+                if (SUCCEEDED(object->ReadDWORD(handles_[property], &dword)))
+                {
+                    float real = 0;
+                    std::memcpy(&real, &dword, sizeof(real));
+                    *value = real;
+                }
+                break;
+            case CIM_REAL64:
+                if (SUCCEEDED(object->ReadQWORD(handles_[property], &qword)))
+                {
+                    std::memcpy(value, &qword, sizeof(*value));
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        std::string wmi_namespace_;
+        std::wstring class_name_;
+        std::vector<std::wstring> properties_;
+        bool com_initialized_;
+        std::shared_ptr<ServiceConnection> connection_;
+        IWbemRefresher *refresher_;
+        IWbemHiPerfEnum *enumerator_;
+        long enumerator_id_;
+        std::vector<IWbemObjectAccess *> objects_;
+        bool handles_resolved_;
+        long name_handle_;
+        bool has_name_;
+        std::vector<long> handles_;
+        std::vector<CIMTYPE> types_;
+        std::vector<wchar_t> name_buffer_;
+    };
+
+    class ComQueryProvider : public QueryProvider
+    {
+    public:
+        HRESULT Query(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            ResultSet *results) override
+        {
+            return wmi_wrapper::Query(wmi_namespace.c_str(), query, options, results);
+        }
+
+        HRESULT QueryBatches(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            size_t batch_size,
+            const QueryBatchCallback &on_batch) override
+        {
+            return wmi_wrapper::QueryBatches(wmi_namespace.c_str(), query, options, batch_size, on_batch);
+        }
+
+        HRESULT Subscribe(
+            const std::string &wmi_namespace,
+            const WmiQueryParams &query,
+            const QueryOptions &options,
+            std::shared_ptr<EventListener> listener,
+            std::unique_ptr<EventSubscription> *subscription) override
+        {
+            std::unique_ptr<ComEventSubscription> com_subscription(
+                new ComEventSubscription(new ComEventSink(wmi_namespace, query, options, listener)));
+            com_subscription->Start(wmi_namespace, query.first, std::move(listener));
+            *subscription = std::move(com_subscription);
+            return S_OK;
+        }
+
+        HRESULT CreateSampleSource(
+            const std::string &wmi_namespace,
+            const std::wstring &class_name,
+            const std::vector<std::wstring> &properties,
+            std::unique_ptr<SampleSource> *source) override
+        {
+            source->reset(new ComSampleSource(wmi_namespace, class_name, properties));
+            return S_OK;
+        }
+
+        WorkerPool *GetWorkerPool() override
+        {
+            return &wmi_wrapper::GetWorkerPool();
+        }
+
+        void Close() override
+        {
+            GetConnectionPool().Close();
+            GetPropertyHandleCache().Clear();
         }
+    };
+
+    RecordingQueryProvider *GetRecordingQueryProvider()
+    {
+        static ComQueryProvider com_provider;
+        static RecordingQueryProvider provider(&com_provider);
+        return &provider;
+    }
 
-        return ConvertResultsObject(std::move(results), env);
+    CachingQueryProvider &GetCachingQueryProvider()
+    {
+        static SteadyClock clock;
+        static CachingQueryProvider provider(GetRecordingQueryProvider(), &clock);
+        return provider;
+    }
+
+    QueryProvider *GetQueryProvider()
+    {
+        return &GetCachingQueryProvider();
+    }
+
+    ResultCache *GetResultCache()
+    {
+        return &GetCachingQueryProvider().GetResultCache();
     }
 
     Napi::Object Init(
         Napi::Env env,
         Napi::Object exports)
     {
-        exports.Set("query", Napi::Function::New(env, wmi_wrapper::WmiQuery));
+        RegisterQueryBindings(env, exports);
         return exports;
     }
 
@@ -28,31 +28,19 @@
 #include <Windows.h>
 #include <Wbemidl.h>
 
+#include "property_access.h"
+#include "query_provider.h"
+#include "query_types.h"
+
 namespace wmi_wrapper
 {
 
-    typedef std::vector<std::pair<std::wstring, std::wstring>> WmiQueryResult;
-    typedef std::pair<std::wstring, std::vector<std::wstring>> WmiQueryParams;
-
-    std::wstring GetPropertyValue(const std::wstring &property, IWbemClassObject *class_object);
-    HRESULT GetAllValues(const std::wstring &query, std::vector<std::wstring> properties, std::vector<WmiQueryResult> *results, IWbemServices *service);
-    HRESULT GetPropertyValues(std::vector<std::wstring> properties, WmiQueryResult *results, IWbemClassObject *class_object);
-    HRESULT GetAllPropertyValues(IWbemClassObject *class_object, WmiQueryResult *results);
-    HRESULT Query(const char *wmi_namespace, WmiQueryParams query, std::vector<WmiQueryResult> *results);
-
-    WmiQueryParams GetWstrParams(Napi::String query, Napi::Array keys, Napi::Env env);
-    Napi::Object ConvertResultsObject(std::vector<WmiQueryResult> results, Napi::Env env);
-
-    /**
-     * Queries WMI on the local system and returns an object with the requested values
-     *
-     * @param info[0] String containing the Namespace (example: 'root\wmi' or 'root\cimv2')
-     * @param info[1] String containing the WQL query (example: "SELECT * FROM Win32_OperatingSystem")
-     * @param info[2] Optional: Array of strings containing the desired data (example: ['Version','BuildNumber']).
-     *                If no value is passed, all properties will be returned from the object.
-     * @return An object containing objects with the requested data as strings (example: {'0': {'Version': '10.0.19044', 'BuildNumber': '19044'}})
-     */
-    Napi::Value WmiQuery(const Napi::CallbackInfo &info);
+    HRESULT EnumerateValues(const std::string &wmi_namespace, const std::wstring &query, const std::vector<std::wstring> &properties, const QueryOptions &options, IWbemServices *service, size_t batch_size, const QueryBatchCallback &on_batch);
+    HRESULT GetAllValues(const std::string &wmi_namespace, const std::wstring &query, const std::vector<std::wstring> &properties, const QueryOptions &options, ResultSet *results, IWbemServices *service);
+    PropertyHandleCache &GetPropertyHandleCache();
+    HRESULT ConnectService(const char *wmi_namespace, IWbemServices **service);
+    HRESULT Query(const char *wmi_namespace, const WmiQueryParams &query, const QueryOptions &options, ResultSet *results);
+    HRESULT QueryBatches(const char *wmi_namespace, const WmiQueryParams &query, const QueryOptions &options, size_t batch_size, const QueryBatchCallback &on_batch);
 
     Napi::Object Init(Napi::Env env, Napi::Object exports);
 
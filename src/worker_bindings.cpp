@@ -0,0 +1,177 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "worker_bindings.h"
+
+#include "addon_data.h"
+#include "query_bindings.h"
+#include "query_provider.h"
+#include "shared_engine.h"
+#include "worker_pool.h"
+
+namespace wmi_wrapper
+{
+
+    const uint32_t kMaxWorkerThreads = 64;
+
+    WorkerPool *GetProviderWorkerPool()
+    {
+        QueryProvider *provider = GetQueryProvider();
+        return provider != NULL ? provider->GetWorkerPool() : NULL;
+    }
+
+    Napi::Value WmiConfigureWorkers(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        WorkerPool *workers = GetProviderWorkerPool();
+        if (workers == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        if (info.Length() != 1 || !info[0].IsObject())
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Value threads = info[0].As<Napi::Object>().Get("threads");
+        if (threads.IsUndefined())
+        {
+            return env.Undefined();
+        }
+
+        double thread_count = threads.IsNumber() ? threads.As<Napi::Number>().DoubleValue() : 0;
+        if (!(thread_count >= 1 && thread_count <= kMaxWorkerThreads))
+        {
+            Napi::Error::New(env, "Invalid Parameter").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        workers->SetThreadCount(static_cast<size_t>(thread_count));
+        return env.Undefined();
+    }
+
+    Napi::Value WmiWorkerStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        WorkerPool *workers = GetProviderWorkerPool();
+        if (workers == NULL)
+        {
+            Napi::Error::New(env, kUnsupportedOsMessage).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        WorkerPoolStats stats = workers->GetStats();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("threads", Napi::Number::New(env, static_cast<double>(stats.threads)));
+        result.Set("maxThreads", Napi::Number::New(env, static_cast<double>(workers->GetThreadCount())));
+        result.Set("idleThreads", Napi::Number::New(env, static_cast<double>(stats.idle_threads)));
+        result.Set("queuedJobs", Napi::Number::New(env, static_cast<double>(stats.queued_jobs)));
+        result.Set("startedJobs", Napi::Number::New(env, static_cast<double>(stats.started_jobs)));
+        result.Set("threadStarts", Napi::Number::New(env, static_cast<double>(stats.thread_starts)));
+        result.Set("totalQueueMs", Napi::Number::New(env, stats.total_queue_ms));
+        result.Set("maxQueueMs", Napi::Number::New(env, stats.max_queue_ms));
+        return result;
+    }
+
+    Napi::Value WmiEngineStats(
+        const Napi::CallbackInfo &info)
+    {
+        Napi::Env env = info.Env();
+
+        SharedEngineStats stats = GetSharedEngine().GetStats();
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("environments", Napi::Number::New(env, static_cast<double>(stats.environments)));
+        result.Set("attached", Napi::Number::New(env, static_cast<double>(stats.attached)));
+        result.Set("releases", Napi::Number::New(env, static_cast<double>(stats.releases)));
+        return result;
+    }
+
+    void StopWorkers()
+    {
+        WorkerPool *workers = GetProviderWorkerPool();
+        if (workers != NULL)
+        {
+            workers->Stop();
+        }
+    }
+
+    void ReleaseEngine()
+    {
+        // Queued queries finish before the connections are released
+        StopWorkers();
+        CloseProvider();
+    }
+
+    void DetachEnvironment(
+        EngineShare *share)
+    {
+        // Jobs queued by an environment that goes away are waited for by its own async work, the worker
+        // threads and connections stay for the other environments until the last one is gone
+        if (share->attached)
+        {
+            GetSharedEngine().Detach(ReleaseEngine);
+        }
+        delete share;
+    }
+
+    void CloseEnvironment(
+        Napi::Env env)
+    {
+        // Later queries of the environment still work, they reconnect when the engine was released.
+        // The worker threads are kept, stopping them would block the JavaScript thread on queued queries.
+        EngineShare *share = GetAddonData(env)->engine_share;
+        if (share->attached)
+        {
+            share->attached = false;
+            GetSharedEngine().Detach(CloseProvider);
+        }
+        else
+        {
+            GetSharedEngine().ReleaseUnused(CloseProvider);
+        }
+    }
+
+    void RegisterWorkerBindings(
+        Napi::Env env,
+        Napi::Object exports)
+    {
+        exports.Set("configureWorkers", Napi::Function::New(env, wmi_wrapper::WmiConfigureWorkers));
+        exports.Set("workerStats", Napi::Function::New(env, wmi_wrapper::WmiWorkerStats));
+        exports.Set("engineStats", Napi::Function::New(env, wmi_wrapper::WmiEngineStats));
+
+        EngineShare *share = new EngineShare();
+        share->attached = true;
+        GetAddonData(env)->engine_share = share;
+        GetSharedEngine().Attach();
+        env.AddCleanupHook(DetachEnvironment, share);
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <napi.h>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Sets the number of worker threads queries run on
+     *
+     * @param info[0] Object with threads, the number of worker threads (1 to 64)
+     */
+    Napi::Value WmiConfigureWorkers(const Napi::CallbackInfo &info);
+
+    /**
+     * Returns the worker thread counters: threads, maxThreads, idleThreads, queuedJobs,
+     * startedJobs, threadStarts, totalQueueMs and maxQueueMs
+     */
+    Napi::Value WmiWorkerStats(const Napi::CallbackInfo &info);
+
+    /**
+     * Returns the counters of the environments sharing the module: environments (loaded now), attached
+     * (loaded since the process started) and releases (times the last one went away)
+     */
+    Napi::Value WmiEngineStats(const Napi::CallbackInfo &info);
+
+    /**
+     * Runs close: the environment gives up its share of the shared engine, whose provider is closed
+     * once no environment holds a share. Closing again closes it when no environment holds a share by then.
+     */
+    void CloseEnvironment(Napi::Env env);
+
+    /**
+     * Registers the worker thread functions and attaches the environment to the shared engine, see
+     * shared_engine.h. The last environment to go away stops the worker threads and closes the provider.
+     */
+    void RegisterWorkerBindings(Napi::Env env, Napi::Object exports);
+
+};
\ No newline at end of file
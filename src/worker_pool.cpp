@@ -0,0 +1,272 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace wmi_wrapper
+{
+
+    // The pool whose worker is running on this thread, if any
+    thread_local WorkerPool *current_worker_pool = NULL;
+
+    WorkerPool::WorkerPool(
+        WorkerThreadHooks *hooks,
+        size_t thread_count)
+        : hooks_(hooks),
+          queued_count_(0),
+          thread_count_(std::max<size_t>(thread_count, 1)),
+          running_count_(0),
+          idle_count_(0),
+          stopping_(false)
+    {
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        Stop();
+    }
+
+    void WorkerPool::Post(
+        JobPriority priority,
+        Job job)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queues_[priority].push_back({std::move(job), std::chrono::steady_clock::now()});
+        ++queued_count_;
+
+        // Idle threads that were notified but didn't wake up yet still count as idle,
+        // start a thread when there are more jobs than threads to take them
+        if (idle_count_ < queued_count_ && running_count_ < thread_count_ && !stopping_)
+        {
+            StartWorkerLocked();
+        }
+        else
+        {
+            job_queued_.notify_one();
+        }
+    }
+
+    HRESULT WorkerPool::Run(
+        JobPriority priority,
+        const std::function<HRESULT()> &operation)
+    {
+        if (current_worker_pool == this)
+        {
+            return operation();
+        }
+
+        std::mutex mutex;
+        std::condition_variable completed;
+        bool done = false;
+        HRESULT hres = S_OK;
+        Post(
+            priority,
+            [&](HRESULT thread_status)
+            {
+                HRESULT result = SUCCEEDED(thread_status) ? operation() : thread_status;
+
+                // Notify while holding the lock, the waiting caller owns the condition variable
+                std::lock_guard<std::mutex> lock(mutex);
+                hres = result;
+                done = true;
+                completed.notify_one();
+            });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        completed.wait(
+            lock,
+            [&done]()
+            { return done; });
+        return hres;
+    }
+
+    void WorkerPool::SetThreadCount(
+        size_t thread_count)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        thread_count_ = std::max<size_t>(thread_count, 1);
+
+        // Wakes surplus idle threads so they exit
+        job_queued_.notify_all();
+        size_t available = idle_count_;
+        while (!stopping_ && available < queued_count_ && running_count_ < thread_count_)
+        {
+            StartWorkerLocked();
+            ++available;
+        }
+    }
+
+    size_t WorkerPool::GetThreadCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return thread_count_;
+    }
+
+    void WorkerPool::Stop()
+    {
+        // A worker can't wait for itself to exit
+        if (current_worker_pool == this)
+        {
+            return;
+        }
+
+        std::list<Worker> workers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            job_queued_.notify_all();
+            workers.splice(workers.end(), workers_);
+        }
+
+        for (Worker &worker : workers)
+        {
+            worker.thread.join();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = false;
+
+        // Jobs posted while stopping are left for new threads
+        size_t available = 0;
+        while (available < queued_count_ && running_count_ < thread_count_)
+        {
+            StartWorkerLocked();
+            ++available;
+        }
+    }
+
+    WorkerPoolStats WorkerPool::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        WorkerPoolStats stats = stats_;
+        stats.threads = running_count_;
+        stats.idle_threads = idle_count_;
+        stats.queued_jobs = queued_count_;
+        return stats;
+    }
+
+    void WorkerPool::RunWorker(
+        Worker *worker)
+    {
+        HRESULT thread_status = hooks_ != NULL ? hooks_->OnThreadStart() : S_OK;
+        current_worker_pool = this;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_count_ <= thread_count_)
+        {
+            QueuedJob job;
+            if (!TakeJobLocked(&job))
+            {
+                if (stopping_)
+                {
+                    break;
+                }
+                ++idle_count_;
+                job_queued_.wait(lock);
+                --idle_count_;
+                continue;
+            }
+
+            // Counted before the job runs, so a caller woken up by its job already sees it
+            double queue_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.queued).count();
+            ++stats_.started_jobs;
+            stats_.total_queue_ms += queue_ms;
+            stats_.max_queue_ms = std::max(stats_.max_queue_ms, queue_ms);
+            lock.unlock();
+
+            job.job(thread_status);
+
+            lock.lock();
+            if (FAILED(thread_status))
+            {
+                break;
+            }
+        }
+        --running_count_;
+
+        // A thread that couldn't be prepared leaves the remaining jobs to a new one
+        if (FAILED(thread_status) && !stopping_ && idle_count_ < queued_count_ && running_count_ < thread_count_)
+        {
+            StartWorkerLocked();
+        }
+        lock.unlock();
+
+        current_worker_pool = NULL;
+        if (SUCCEEDED(thread_status) && hooks_ != NULL)
+        {
+            hooks_->OnThreadStop();
+        }
+
+        lock.lock();
+        worker->exited = true;
+    }
+
+    bool WorkerPool::TakeJobLocked(
+        QueuedJob *job)
+    {
+        for (std::deque<QueuedJob> &queue : queues_)
+        {
+            if (!queue.empty())
+            {
+                *job = std::move(queue.front());
+                queue.pop_front();
+                --queued_count_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerPool::StartWorkerLocked()
+    {
+        JoinExitedLocked();
+
+        workers_.emplace_back();
+        Worker *worker = &workers_.back();
+        ++running_count_;
+        ++stats_.thread_starts;
+        worker->thread = std::thread(&WorkerPool::RunWorker, this, worker);
+    }
+
+    void WorkerPool::JoinExitedLocked()
+    {
+        // Exited threads have nothing left to do but return, joining them doesn't wait on the lock
+        for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end();)
+        {
+            if (it->exited)
+            {
+                it->thread.join();
+                it = workers_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+}
\ No newline at end of file
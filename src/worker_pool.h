@@ -0,0 +1,145 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "query_types.h"
+
+namespace wmi_wrapper
+{
+
+    const size_t kDefaultWorkerThreads = 8;
+
+    /**
+     * Prepares the threads of a WorkerPool, on Windows by joining the multithreaded apartment.
+     * Both methods are called on the worker thread itself.
+     */
+    class WorkerThreadHooks
+    {
+    public:
+        virtual ~WorkerThreadHooks() {}
+
+        // Called once when the thread starts, before it runs any job
+        virtual HRESULT OnThreadStart() = 0;
+
+        // Called once before the thread exits, only when OnThreadStart succeeded
+        virtual void OnThreadStop() = 0;
+    };
+
+    struct WorkerPoolStats
+    {
+        uint64_t threads = 0;       // Threads currently running
+        uint64_t idle_threads = 0;  // Running threads waiting for a job
+        uint64_t queued_jobs = 0;   // Jobs waiting for a thread
+        uint64_t started_jobs = 0;  // Jobs that got a thread, counted before they run
+        uint64_t thread_starts = 0; // Threads started so far, each one prepared once by the hooks
+        double total_queue_ms = 0;  // Time started jobs spent waiting for a thread
+        double max_queue_ms = 0;
+    };
+
+    /**
+     * Long-lived threads that run jobs in priority order, first in first out within a priority.
+     *
+     * Threads are started on demand, up to the configured count, and then kept for the life of the
+     * pool so whatever the hooks set up is done once per thread instead of once per job. A thread
+     * whose OnThreadStart fails hands the error to the one job it takes and exits, the next job
+     * starts a new thread. All methods are thread safe.
+     */
+    class WorkerPool
+    {
+    public:
+        typedef std::function<void(HRESULT thread_status)> Job;
+
+        WorkerPool(WorkerThreadHooks *hooks, size_t thread_count);
+        ~WorkerPool();
+
+        /**
+         * Queues a job. The job is called with the result of OnThreadStart on its thread and must
+         * not run when that failed.
+         */
+        void Post(JobPriority priority, Job job);
+
+        /**
+         * Runs operation on a worker thread and waits for it. Called from a worker thread of this
+         * pool it runs operation right away, a job waiting for a queued job could deadlock the pool.
+         *
+         * @return The result of operation, or of preparing the thread when that failed
+         */
+        HRESULT Run(JobPriority priority, const std::function<HRESULT()> &operation);
+
+        /**
+         * Changes the number of threads. Surplus threads exit once they finish their current job.
+         */
+        void SetThreadCount(size_t thread_count);
+        size_t GetThreadCount();
+
+        /**
+         * Lets the threads finish every queued job and waits for them to exit.
+         * Jobs posted afterwards start new threads. Does nothing on a worker thread of the pool.
+         */
+        void Stop();
+
+        WorkerPoolStats GetStats();
+
+    private:
+        struct QueuedJob
+        {
+            Job job;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        struct Worker
+        {
+            std::thread thread;
+            bool exited = false;
+        };
+
+        void RunWorker(Worker *worker);
+        bool TakeJobLocked(QueuedJob *job);
+        void StartWorkerLocked();
+        void JoinExitedLocked();
+
+        WorkerThreadHooks *hooks_;
+        std::mutex mutex_;
+        std::condition_variable job_queued_;
+        std::deque<QueuedJob> queues_[kJobPriorityCount];
+        size_t queued_count_;
+        std::list<Worker> workers_;
+        size_t thread_count_;
+        size_t running_count_;
+        size_t idle_count_;
+        bool stopping_;
+        WorkerPoolStats stats_;
+    };
+
+};
\ No newline at end of file
@@ -0,0 +1,322 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#include "wql.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <cwctype>
+
+namespace wmi_wrapper
+{
+
+    std::wstring GetUpperQuery(const std::wstring &query)
+    {
+        std::wstring upper_query = query;
+        for (wchar_t &c : upper_query)
+        {
+            c = std::iswspace(c) ? L' ' : static_cast<wchar_t>(std::towupper(c));
+        }
+        return upper_query;
+    }
+
+    std::wstring GetQueryClassName(const std::wstring &query)
+    {
+        std::wstring upper_query = GetUpperQuery(query);
+
+        const std::wstring kFromKeyword = L" FROM ";
+        size_t from = upper_query.find(kFromKeyword);
+        if (from == std::wstring::npos)
+        {
+            return std::wstring();
+        }
+
+        size_t start = query.find_first_not_of(L" \t\r\n", from + kFromKeyword.size());
+        if (start == std::wstring::npos)
+        {
+            return std::wstring();
+        }
+
+        size_t end = query.find_first_of(L" \t\r\n", start);
+        return query.substr(start, end == std::wstring::npos ? std::wstring::npos : end - start);
+    }
+
+    std::wstring GetQuerySelection(const std::wstring &query)
+    {
+        std::wstring upper_query = GetUpperQuery(query);
+
+        const std::wstring kSelectKeyword = L"SELECT ";
+        const std::wstring kFromKeyword = L" FROM ";
+        size_t from = upper_query.find(kFromKeyword);
+        if (from == std::wstring::npos)
+        {
+            return upper_query;
+        }
+
+        size_t start = upper_query.find(kSelectKeyword);
+        start = start == std::wstring::npos || start > from ? 0 : start + kSelectKeyword.size();
+        return upper_query.substr(start, from - start);
+    }
+
+    std::wstring NormalizeQuery(const std::wstring &query)
+    {
+        std::wstring normalized;
+        normalized.reserve(query.size());
+
+        wchar_t quote = 0;
+        for (wchar_t c : query)
+        {
+            if (quote != 0)
+            {
+                // String literals are compared as written
+                normalized += c;
+                if (c == quote)
+                {
+                    quote = 0;
+                }
+            }
+            else if (std::iswspace(c))
+            {
+                if (!normalized.empty() && normalized.back() != L' ')
+                {
+                    normalized += L' ';
+                }
+            }
+            else
+            {
+                if (c == L'"' || c == L'\'')
+                {
+                    quote = c;
+                }
+                normalized += static_cast<wchar_t>(std::towupper(c));
+            }
+        }
+
+        if (!normalized.empty() && normalized.back() == L' ')
+        {
+            normalized.pop_back();
+        }
+        return normalized;
+    }
+
+    bool IsIdentifierCharacter(
+        wchar_t c)
+    {
+        // Anything outside ASCII is taken as part of a name, iswalnum depends on the locale there
+        return c == L'_' || c >= 0x80 || std::iswalnum(c);
+    }
+
+    /**
+     * Moves position past whitespace and, when it is there, the keyword in any case
+     *
+     * @return false when the keyword isn't next
+     */
+    bool SkipKeyword(
+        const std::wstring &query,
+        const wchar_t *keyword,
+        size_t *position)
+    {
+        size_t start = query.find_first_not_of(L" \t\r\n", *position);
+        if (start == std::wstring::npos)
+        {
+            return false;
+        }
+
+        size_t length = std::wcslen(keyword);
+        if (query.size() - start < length)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (static_cast<wchar_t>(std::towupper(query[start + i])) != keyword[i])
+            {
+                return false;
+            }
+        }
+
+        // The keyword must not run into an identifier
+        size_t end = start + length;
+        if (end < query.size() && IsIdentifierCharacter(query[end]) && IsIdentifierCharacter(keyword[length - 1]))
+        {
+            return false;
+        }
+        *position = end;
+        return true;
+    }
+
+    /**
+     * Reads an identifier after optional whitespace
+     *
+     * @return false when there is none
+     */
+    bool ReadIdentifier(
+        const std::wstring &query,
+        size_t *position,
+        std::wstring *identifier)
+    {
+        size_t start = query.find_first_not_of(L" \t\r\n", *position);
+        if (start == std::wstring::npos)
+        {
+            return false;
+        }
+
+        size_t end = start;
+        while (end < query.size() && IsIdentifierCharacter(query[end]))
+        {
+            ++end;
+        }
+        if (end == start)
+        {
+            return false;
+        }
+
+        identifier->assign(query, start, end - start);
+        *position = end;
+        return true;
+    }
+
+    bool ParseSelectQuery(
+        const std::wstring &query,
+        SelectQuery *select)
+    {
+        select->class_name.clear();
+        select->properties.clear();
+
+        size_t position = 0;
+        if (!SkipKeyword(query, L"SELECT", &position))
+        {
+            return false;
+        }
+
+        if (!SkipKeyword(query, L"*", &position))
+        {
+            do
+            {
+                std::wstring property;
+                if (!ReadIdentifier(query, &position, &property))
+                {
+                    return false;
+                }
+                select->properties.push_back(std::move(property));
+            } while (SkipKeyword(query, L",", &position));
+        }
+
+        if (!SkipKeyword(query, L"FROM", &position))
+        {
+            return false;
+        }
+        select->from_position = position - 4;
+        if (!ReadIdentifier(query, &position, &select->class_name))
+        {
+            return false;
+        }
+
+        // Anything after the class has to be separated from it
+        return position == query.size() || std::iswspace(query[position]);
+    }
+
+    bool EqualsIgnoreCase(
+        const std::wstring &first,
+        const std::wstring &second)
+    {
+        return first.size() == second.size() &&
+               std::equal(first.begin(), first.end(), second.begin(), [](wchar_t a, wchar_t b)
+                          { return std::towupper(a) == std::towupper(b); });
+    }
+
+    bool ContainsIgnoreCase(
+        const std::vector<std::wstring> &names,
+        const std::wstring &name)
+    {
+        return std::any_of(names.begin(), names.end(), [&name](const std::wstring &entry)
+                           { return EqualsIgnoreCase(entry, name); });
+    }
+
+    bool IsSystemName(
+        const std::wstring &name)
+    {
+        return name.compare(0, 2, L"__") == 0;
+    }
+
+    bool GetProjection(
+        const std::vector<std::wstring> &properties,
+        std::vector<std::wstring> *projection)
+    {
+        projection->clear();
+        for (const std::wstring &property : properties)
+        {
+            std::wstring name = property.substr(0, property.find(L'.'));
+            if (name.empty() || IsSystemName(name) || !std::all_of(name.begin(), name.end(), IsIdentifierCharacter))
+            {
+                return false;
+            }
+            if (!ContainsIgnoreCase(*projection, name))
+            {
+                projection->push_back(std::move(name));
+            }
+        }
+        return !projection->empty();
+    }
+
+    bool RewriteProjection(
+        const std::wstring &query,
+        const std::vector<std::wstring> &properties,
+        std::wstring *rewritten)
+    {
+        SelectQuery select;
+        std::vector<std::wstring> projection;
+        if (properties.empty() ||
+            !ParseSelectQuery(query, &select) ||
+            IsSystemName(select.class_name) ||
+            !GetProjection(properties, &projection))
+        {
+            return false;
+        }
+
+        // An explicit select list is only narrowed, never widened
+        if (!select.properties.empty() &&
+            (projection.size() >= select.properties.size() ||
+             !std::all_of(projection.begin(), projection.end(), [&select](const std::wstring &name)
+                          { return ContainsIgnoreCase(select.properties, name); })))
+        {
+            return false;
+        }
+
+        rewritten->assign(L"SELECT ");
+        for (size_t i = 0; i < projection.size(); ++i)
+        {
+            if (i > 0)
+            {
+                rewritten->append(L", ");
+            }
+            rewritten->append(projection[i]);
+        }
+        rewritten->push_back(L' ');
+        // FROM and everything after it, including the WHERE clause, are kept as written
+        rewritten->append(query, select.from_position, std::wstring::npos);
+        return true;
+    }
+
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace wmi_wrapper
+{
+
+    /**
+     * Returns the class named in the FROM clause of a WQL query, or an empty string if there is none.
+     */
+    std::wstring GetQueryClassName(const std::wstring &query);
+
+    /**
+     * Returns the uppercase select list of a WQL query ("NAME, SIZE" for "select Name, Size from ..."),
+     * or the whole query if it has no FROM clause
+     */
+    std::wstring GetQuerySelection(const std::wstring &query);
+
+    /**
+     * Returns the query with whitespace runs collapsed and everything outside of string literals
+     * uppercased, so queries that only differ in spelling compare equal
+     */
+    std::wstring NormalizeQuery(const std::wstring &query);
+
+    /**
+     * Compares property or class names, which WMI treats case-insensitively
+     */
+    bool EqualsIgnoreCase(const std::wstring &first, const std::wstring &second);
+    bool ContainsIgnoreCase(const std::vector<std::wstring> &names, const std::wstring &name);
+
+    /**
+     * The parts of a SELECT query that prepared queries derive up front
+     */
+    struct SelectQuery
+    {
+        std::wstring class_name;
+        std::vector<std::wstring> properties; // The select list as written, empty for SELECT *
+        size_t from_position = 0;             // Offset of the FROM keyword
+    };
+
+    /**
+     * Parses "SELECT <properties or *> FROM <class> [...]". Only the select list and the class name
+     * are checked, whatever follows the class, such as a WHERE clause, is left for WMI to validate.
+     *
+     * @return false when the query doesn't have that shape
+     */
+    bool ParseSelectQuery(const std::wstring &query, SelectQuery *select);
+
+    /**
+     * Returns the properties WMI has to retrieve to read the given property list, the name before
+     * the first dot of each one (the embedded object of "TargetInstance.Name"), without duplicates.
+     *
+     * @return false when one of them can't be selected, such as a system property like __PATH,
+     *         which WMI only fills in when every key property is selected as well
+     */
+    bool GetProjection(const std::vector<std::wstring> &properties, std::vector<std::wstring> *projection);
+
+    /**
+     * Narrows the select list of a query to the properties that are read from its results, so WMI
+     * doesn't produce values that are thrown away. "SELECT * FROM Win32_Process WHERE ..." read for
+     * Name and ProcessId becomes "SELECT Name, ProcessId FROM Win32_Process WHERE ...". WMI adds the
+     * key properties of the class to the instances of such a query on its own.
+     *
+     * Queries that aren't plain SELECT queries (ASSOCIATORS OF, REFERENCES OF), queries of system
+     * and event classes, and select lists that already name only what is read are left alone, as are
+     * select lists that don't include every property read.
+     *
+     * @return false when the query is to be sent as it is
+     */
+    bool RewriteProjection(
+        const std::wstring &query,
+        const std::vector<std::wstring> &properties,
+        std::wstring *rewritten);
+
+};
\ No newline at end of file
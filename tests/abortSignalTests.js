@@ -0,0 +1,236 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in hands out instances through the same enumeration loop as WMI, which checks the signal between Next calls
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT Caption FROM StandIn_Aborted';
+const kMaxAbortLatencyMs = 250;
+
+// Set for a second run in which errors after connecting are reported like the WMI build does, where
+// queries aborted while they read instances must still reject
+let maskRejectedQueries = false;
+
+function enableStandIn(options) {
+    standIn.enable(Object.assign({ maskRejectedQueries: maskRejectedQueries }, options));
+}
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+// Aborts after delayMs and resolves with the milliseconds from the abort until promise settled
+async function abortAfter(controller, delayMs, promise) {
+    await sleep(delayMs);
+    let aborted = process.hrtime.bigint();
+    controller.abort();
+    await assert.rejects(promise, { name: 'AbortError' });
+    return Number(process.hrtime.bigint() - aborted) / 1e6;
+}
+
+async function queryAsyncAbortTest() {
+    // Each Next call takes 5ms, reading every instance would take from seconds to hours
+    for (let rowCount of [10000, 10000000]) {
+        enableStandIn({ rowCount: rowCount, nextLatencyMs: 5 });
+        let controller = new AbortController();
+        let latencyMs = await abortAfter(controller, 50, wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: controller.signal }));
+        assert.ok(latencyMs < kMaxAbortLatencyMs, `${rowCount} rows took ${latencyMs}ms to abort`);
+
+        let generated = standIn.generatedRows();
+        await sleep(50);
+        assert.strictEqual(standIn.generatedRows(), generated);
+    }
+
+    // A provider that stops answering is still left behind
+    enableStandIn({ rowCount: 100, hangAfterRows: 15 });
+    let controller = new AbortController();
+    let latencyMs = await abortAfter(controller, 100, wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: controller.signal }));
+    assert.ok(latencyMs < kMaxAbortLatencyMs, `hung query took ${latencyMs}ms to abort`);
+
+    // The reason the signal was aborted with is what the query rejects with
+    enableStandIn({ rowCount: 10000, nextLatencyMs: 5 });
+    controller = new AbortController();
+    let promise = wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: controller.signal });
+    let reason = new Error('navigated away');
+    controller.abort(reason);
+    await assert.rejects(promise, error => error === reason);
+    console.log("queryAsyncAbortTest() complete");
+}
+
+async function alreadyAbortedTest() {
+    enableStandIn({ rowCount: 10 });
+    let queries = standIn.queryCount();
+    let signal = AbortSignal.abort();
+
+    assert.throws(() => wmi.query('root/cimv2', kQuery, ['Caption'], { signal: signal }), { name: 'AbortError' });
+    assert.throws(() => wmi.queryStream('root/cimv2', kQuery, ['Caption'], { signal: signal }), { name: 'AbortError' });
+    await assert.rejects(wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: signal }), { name: 'AbortError' });
+    await assert.rejects(wmi.queryMany([{ namespace: 'root/cimv2', query: kQuery }], { signal: signal }), { name: 'AbortError' });
+
+    let prepared = wmi.prepare('root/cimv2', kQuery);
+    assert.throws(() => prepared.run({ signal: signal }), { name: 'AbortError' });
+    await assert.rejects(prepared.runAsync({ signal: signal }), { name: 'AbortError' });
+    assert.strictEqual(standIn.queryCount(), queries);
+
+    // A signal that didn't fire doesn't change the results
+    let result = wmi.query('root/cimv2', kQuery, ['Caption'], { signal: new AbortController().signal });
+    assert.strictEqual(Object.keys(result).length, 10);
+    console.log("alreadyAbortedTest() complete");
+}
+
+async function queryStreamAbortTest() {
+    enableStandIn({ rowCount: 10000000 });
+    let controller = new AbortController();
+    let batches = 0;
+    let aborted;
+    await assert.rejects(async () => {
+        for await (let batch of wmi.queryStream('root/cimv2', kQuery, ['Caption'], { signal: controller.signal })) {
+            assert.strictEqual(batch.length, 100);
+            if (++batches == 3) {
+                aborted = process.hrtime.bigint();
+                controller.abort();
+            }
+        }
+    }, { name: 'AbortError' });
+    assert.strictEqual(batches, 3);
+    assert.ok(Number(process.hrtime.bigint() - aborted) / 1e6 < kMaxAbortLatencyMs);
+
+    // A pending next() is rejected once the query stopped, even while the provider hangs
+    enableStandIn({ rowCount: 100, hangAfterRows: 15 });
+    controller = new AbortController();
+    let stream = wmi.queryStream('root/cimv2', kQuery, ['Caption'], { signal: controller.signal, batchSize: 10 });
+    assert.strictEqual((await stream.next()).value.length, 10);
+    let next = stream.next();
+    let latencyMs = await abortAfter(controller, 50, next);
+    assert.ok(latencyMs < kMaxAbortLatencyMs, `hung stream took ${latencyMs}ms to abort`);
+    await assert.rejects(stream.next(), { name: 'AbortError' });
+    console.log("queryStreamAbortTest() complete");
+}
+
+async function queryManyAbortTest() {
+    enableStandIn({ rowCount: 10000, nextLatencyMs: 5 });
+
+    // Aborting one request rejects only that request
+    let controller = new AbortController();
+    let promise = wmi.queryMany([
+        { namespace: 'root/cimv2', query: 'SELECT Caption FROM StandIn_Small', options: { maxRows: 5 } },
+        { namespace: 'root/cimv2', query: kQuery, options: { signal: controller.signal } }
+    ]);
+    await sleep(50);
+    controller.abort();
+    let outcomes = await promise;
+    assert.strictEqual(outcomes[0].status, 'fulfilled');
+    assert.strictEqual(Object.keys(outcomes[0].value).length, 5);
+    assert.strictEqual(outcomes[1].status, 'rejected');
+    assert.strictEqual(outcomes[1].reason.name, 'AbortError');
+
+    // Aborting the batch rejects all of it
+    controller = new AbortController();
+    let latencyMs = await abortAfter(controller, 50, wmi.queryMany([
+        { namespace: 'root/cimv2', query: kQuery },
+        { namespace: 'root/cimv2', query: 'SELECT Caption FROM StandIn_Other' }
+    ], { signal: controller.signal }));
+    assert.ok(latencyMs < kMaxAbortLatencyMs, `batch took ${latencyMs}ms to abort`);
+    console.log("queryManyAbortTest() complete");
+}
+
+async function preparedAbortTest() {
+    enableStandIn({ rowCount: 10000, nextLatencyMs: 5 });
+    let prepared = wmi.prepare('root/cimv2', kQuery);
+    let controller = new AbortController();
+    let latencyMs = await abortAfter(controller, 50, prepared.runAsync({ signal: controller.signal }));
+    assert.ok(latencyMs < kMaxAbortLatencyMs);
+
+    // The signal of one run doesn't carry over to the next
+    enableStandIn({ rowCount: 10 });
+    assert.strictEqual(Object.keys(await prepared.runAsync()).length, 10);
+    console.log("preparedAbortTest() complete");
+}
+
+async function listenerCleanupTest() {
+    enableStandIn({ rowCount: 10 });
+
+    // Any object shaped like an AbortSignal works, and every listener is removed once the call settled
+    let listeners = new Set();
+    let signal = {
+        aborted: false,
+        addEventListener: (type, listener) => listeners.add(listener),
+        removeEventListener: (type, listener) => listeners.delete(listener)
+    };
+    for (let i = 0; i < 20; i++) {
+        await wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: signal });
+    }
+    await wmi.queryMany([{ namespace: 'root/cimv2', query: kQuery, options: { signal: signal } }], { signal: signal });
+    for await (let batch of wmi.queryStream('root/cimv2', kQuery, ['Caption'], { signal: signal })) {
+        assert.strictEqual(listeners.size, 1);
+    }
+    assert.strictEqual(listeners.size, 0);
+    console.log("listenerCleanupTest() complete");
+}
+
+async function badArgumentsTest_Exceptions() {
+    for (let signal of [null, 'abort', {}, { aborted: false, addEventListener: () => { } }]) {
+        assert.throws(() => wmi.query('root/cimv2', kQuery, ['Caption'], { signal: signal }), Error);
+        await assert.rejects(wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { signal: signal }), Error);
+    }
+    console.log("badArgumentsTest_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function windowsAbortTest() {
+    let controller = new AbortController();
+    let promise = wmi.queryAsync('root/cimv2', 'SELECT * FROM CIM_DataFile', ['Name'], { signal: controller.signal });
+    let latencyMs = await abortAfter(controller, 100, promise);
+    assert.ok(latencyMs < kMaxAbortLatencyMs * 4, `CIM_DataFile took ${latencyMs}ms to abort`);
+    console.log("windowsAbortTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        await windowsAbortTest();
+        await badArgumentsTest_Exceptions();
+        return;
+    }
+
+    for (let mask of [false, true]) {
+        maskRejectedQueries = mask;
+        await queryAsyncAbortTest();
+        await alreadyAbortedTest();
+        await queryStreamAbortTest();
+        await queryManyAbortTest();
+        await preparedAbortTest();
+        await listenerCleanupTest();
+    }
+    await badArgumentsTest_Exceptions();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,259 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider returns a fixed set of typed properties shaped the way WMI hands them out
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT * FROM StandIn_Aggregate';
+const kProperties = ['Caption', 'Enabled', 'Level', 'Delta', 'Ratio', 'Total', 'Balance', 'Capacity', 'InstallDate', 'Status'];
+
+// The same instances as row objects, to reduce in JavaScript
+function getRows() {
+    return Object.values(wmi.query('root/cimv2', kQuery, kProperties, { typed: true }));
+}
+
+function reductionsTest() {
+    standIn.enable({ rowCount: 100 });
+    let rows = getRows();
+    let result = wmi.query('root/cimv2', kQuery, undefined, {
+        aggregate: {
+            values: {
+                instances: { op: 'count' },
+                capacities: { op: 'count', property: 'Capacity' },
+                levels: { op: 'sum', property: 'Level' },
+                deltas: { op: 'sum', property: 'Delta' },
+                totals: { op: 'sum', property: 'Total' },
+                ratio: { op: 'avg', property: 'Ratio' },
+                lowest: { op: 'min', property: 'Balance' },
+                highest: { op: 'max', property: 'Balance' },
+                latest: { op: 'max', property: 'InstallDate' },
+                first: { op: 'min', property: 'Caption' },
+                last: { op: 'max', property: 'Caption' }
+            }
+        }
+    });
+
+    assert.strictEqual(result.instances, 100);
+    assert.strictEqual(result.capacities, rows.filter(row => row.Capacity !== null).length);
+    assert.strictEqual(result.levels, rows.reduce((sum, row) => sum + row.Level, 0));
+    assert.strictEqual(result.deltas, rows.reduce((sum, row) => sum + row.Delta, 0));
+    // 64-bit sums stay exact
+    assert.strictEqual(result.totals, rows.reduce((sum, row) => sum + row.Total, 0n));
+    assert.strictEqual(result.ratio, rows.reduce((sum, row) => sum + row.Ratio, 0) / rows.length);
+    assert.strictEqual(result.lowest, rows.reduce((min, row) => row.Balance < min ? row.Balance : min, rows[0].Balance));
+    assert.strictEqual(result.highest, rows.reduce((max, row) => row.Balance > max ? row.Balance : max, rows[0].Balance));
+    assert.deepStrictEqual(result.latest, new Date(Math.max(...rows.map(row => row.InstallDate.getTime()))));
+    assert.strictEqual(result.first, 'StandIn_Aggregate.Caption.0');
+    assert.strictEqual(result.last, 'StandIn_Aggregate.Caption.99');
+    console.log("reductionsTest() complete");
+}
+
+function whereTest() {
+    standIn.enable({ rowCount: 100 });
+    let rows = getRows();
+    const count = where => wmi.query('root/cimv2', kQuery, undefined, { aggregate: { where: where, values: { n: { op: 'count' } } } }).n;
+
+    assert.strictEqual(count([{ property: 'Enabled', op: '=', value: true }]), 50);
+    assert.strictEqual(count([{ property: 'Level', op: '>=', value: 90 }]), 10);
+    assert.strictEqual(count([{ property: 'Level', op: '>=', value: 90 }, { property: 'Enabled', op: '<>', value: true }]), 5);
+    assert.strictEqual(count([{ property: 'Total', op: '>', value: rows[9].Total }]), 90);
+    assert.strictEqual(count([{ property: 'InstallDate', op: '<', value: rows[3].InstallDate }]),
+        rows.filter(row => row.InstallDate < rows[3].InstallDate).length);
+    // Strings compare without regard to case
+    assert.strictEqual(count([{ property: 'Caption', op: '=', value: 'standin_aggregate.caption.7' }]), 1);
+    // Only null equals null, and a null never meets an ordering
+    assert.strictEqual(count([{ property: 'Status', op: '=', value: null }]), 100);
+    assert.strictEqual(count([{ property: 'Capacity', op: '!=', value: null }]), 50);
+    assert.strictEqual(count([{ property: 'Capacity', op: '>=', value: 0 }]), 50);
+    // Values of another type never match
+    assert.strictEqual(count([{ property: 'Caption', op: '<', value: 5 }]), 0);
+
+    let empty = wmi.query('root/cimv2', kQuery, undefined, {
+        aggregate: {
+            where: [{ property: 'Level', op: '>', value: 1000 }],
+            values: { n: { op: 'count' }, sum: { op: 'sum', property: 'Level' }, avg: { op: 'avg', property: 'Level' }, max: { op: 'max', property: 'Level' } }
+        }
+    });
+    assert.deepStrictEqual(empty, { n: 0, sum: 0, avg: null, max: null });
+    console.log("whereTest() complete");
+}
+
+function groupByTest() {
+    standIn.enable({ rowCount: 100 });
+    let groups = wmi.query('root/cimv2', kQuery, undefined, {
+        aggregate: { groupBy: 'Enabled', values: { n: { op: 'count' }, levels: { op: 'sum', property: 'Level' } } }
+    });
+    // Groups come in the order of their first instance
+    assert.deepStrictEqual(groups, [{ Enabled: true, n: 50, levels: 2450 }, { Enabled: false, n: 50, levels: 2500 }]);
+
+    standIn.enable({ rowCount: 1000 });
+    groups = wmi.query('root/cimv2', kQuery, undefined, {
+        aggregate: {
+            where: [{ property: 'Level', op: '<', value: 2 }],
+            groupBy: ['Level', 'Enabled'],
+            values: { n: { op: 'count' } }
+        }
+    });
+    assert.deepStrictEqual(groups, [{ Level: 0, Enabled: true, n: 4 }, { Level: 1, Enabled: false, n: 4 }]);
+
+    // Instances without a value form their own group
+    standIn.enable({ rowCount: 6 });
+    groups = wmi.query('root/cimv2', kQuery, undefined, { aggregate: { groupBy: 'Capacity', values: { n: { op: 'count' } } } });
+    assert.deepStrictEqual(groups, [{ Capacity: 0, n: 1 }, { Capacity: null, n: 3 }, { Capacity: 2048, n: 1 }, { Capacity: 4096, n: 1 }]);
+
+    standIn.enable({ rowCount: 0 });
+    assert.deepStrictEqual(wmi.query('root/cimv2', kQuery, undefined, { aggregate: { groupBy: 'Level', values: { n: { op: 'count' } } } }), []);
+    console.log("groupByTest() complete");
+}
+
+function conversionOptionsTest() {
+    standIn.enable({ rowCount: 10 });
+    let result = wmi.query('root/cimv2', kQuery, undefined, {
+        int64: 'number',
+        datetime: 'number',
+        aggregate: { values: { totals: { op: 'sum', property: 'Total' }, latest: { op: 'max', property: 'InstallDate' } } }
+    });
+    assert.strictEqual(typeof result.totals, 'number');
+    assert.strictEqual(typeof result.latest, 'number');
+    console.log("conversionOptionsTest() complete");
+}
+
+async function entryPointsTest() {
+    standIn.enable({ rowCount: 50 });
+    const options = { aggregate: { groupBy: 'Enabled', values: { n: { op: 'count' }, ratio: { op: 'avg', property: 'Ratio' } } } };
+    let expected = wmi.query('root/cimv2', kQuery, undefined, options);
+
+    assert.deepStrictEqual(await wmi.queryAsync('root/cimv2', kQuery, undefined, options), expected);
+    assert.deepStrictEqual(wmi.prepare('root/cimv2', kQuery, undefined, options).run(), expected);
+    let [outcome] = await wmi.queryMany([{ namespace: 'root/cimv2', query: kQuery, options: options }]);
+    assert.deepStrictEqual(outcome.value, expected);
+
+    // Only the aggregated properties are read
+    wmi.query('root/cimv2', kQuery, kProperties, options);
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT Enabled,Ratio FROM StandIn_Aggregate');
+    console.log("entryPointsTest() complete");
+}
+
+async function limitsAndTimingsTest() {
+    standIn.enable({ rowCount: 100 });
+    let result = wmi.query('root/cimv2', kQuery, undefined, { maxRows: 25, timings: true, aggregate: { values: { n: { op: 'count' } } } });
+    assert.strictEqual(result.n, 25);
+    assert.strictEqual(result.truncated, 'maxRows');
+    // The timings count the instances that were aggregated
+    assert.strictEqual(result.timings.rows, 25);
+    assert.ok(result.timings.totalMs >= 0);
+
+    result = await wmi.queryAsync('root/cimv2', kQuery, undefined, { maxRows: 10, aggregate: { values: { n: { op: 'count' } } } });
+    assert.strictEqual(result.n, 10);
+    assert.strictEqual(result.truncated, 'maxRows');
+    console.log("limitsAndTimingsTest() complete");
+}
+
+async function typeErrorsTest() {
+    standIn.enable({ rowCount: 10 });
+    const aggregate = values => ({ aggregate: { values: values } });
+
+    // Strings, booleans and arrays have no sum
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, aggregate({ v: { op: 'sum', property: 'Caption' } })),
+        /Aggregate function does not apply/);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, aggregate({ v: { op: 'sum', property: 'Enabled' } })),
+        /Aggregate function does not apply/);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, aggregate({ v: { op: 'max', property: 'Samples' } })),
+        /Aggregate function does not apply/);
+    await assert.rejects(wmi.queryAsync('root/cimv2', kQuery, undefined, aggregate({ v: { op: 'avg', property: 'InstallDate' } })),
+        /Aggregate function does not apply/);
+    // Counting applies to values of any type
+    assert.deepStrictEqual(wmi.query('root/cimv2', kQuery, undefined, aggregate({ v: { op: 'count', property: 'Samples' } })), { v: 10 });
+
+    // Without instances there is nothing the property could be missing from
+    assert.deepStrictEqual(wmi.query('root/cimv2', 'SELECT nothing', undefined, aggregate({ v: { op: 'sum', property: 'Level' } })), { v: 0 });
+    console.log("typeErrorsTest() complete");
+}
+
+function badInputTests_Exceptions() {
+    const query = options => () => wmi.query('root/cimv2', kQuery, undefined, options);
+
+    assert.throws(query({ aggregate: 5 }), Error);
+    assert.throws(query({ aggregate: {} }), Error);
+    assert.throws(query({ aggregate: { values: {} } }), Error);
+    assert.throws(query({ aggregate: { values: { v: { op: 'median', property: 'Level' } } } }), Error);
+    assert.throws(query({ aggregate: { values: { v: { op: 'sum' } } } }), Error);
+    assert.throws(query({ aggregate: { values: { v: { op: 'sum', property: '' } } } }), Error);
+    assert.throws(query({ aggregate: { groupBy: 5, values: { n: { op: 'count' } } } }), Error);
+    assert.throws(query({ aggregate: { where: {}, values: { n: { op: 'count' } } } }), Error);
+    assert.throws(query({ aggregate: { where: [{ property: 'Level', op: 'LIKE', value: 1 }], values: { n: { op: 'count' } } } }), Error);
+    assert.throws(query({ aggregate: { where: [{ property: 'Level', op: '=', value: {} }], values: { n: { op: 'count' } } } }), Error);
+
+    // Streams, subscriptions and snapshots hand out instances, not aggregates
+    const options = { aggregate: { values: { n: { op: 'count' } } } };
+    assert.throws(() => wmi.queryStream('root/cimv2', kQuery, undefined, options), Error);
+    assert.throws(() => wmi.subscribe('root/cimv2', 'SELECT * FROM __InstanceCreationEvent WITHIN 1', () => { }, options), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', kQuery, undefined, options), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+function windowsAggregationTest() {
+    let groups = wmi.query('root/cimv2', 'SELECT * FROM Win32_LogicalDisk', undefined, {
+        aggregate: {
+            where: [{ property: 'Size', op: '!=', value: null }],
+            groupBy: 'DriveType',
+            values: { disks: { op: 'count' }, free: { op: 'sum', property: 'FreeSpace' }, size: { op: 'sum', property: 'Size' } }
+        }
+    });
+    assert.ok(Array.isArray(groups));
+    for (let group of groups) {
+        assert.strictEqual(typeof group.DriveType, 'number');
+        assert.ok(group.disks > 0);
+        assert.ok(group.free <= group.size);
+    }
+    console.log("windowsAggregationTest() complete");
+}
+
+async function runTests() {
+    badInputTests_Exceptions();
+
+    if (!standIn) {
+        windowsAggregationTest();
+        return;
+    }
+
+    reductionsTest();
+    whereTest();
+    groupByTest();
+    conversionOptionsTest();
+    await entryPointsTest();
+    await limitsAndTimingsTest();
+    await typeErrorsTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
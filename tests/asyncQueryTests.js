@@ -0,0 +1,143 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the queries go to WMI
+const standIn = wmi.standIn;
+
+async function selectAllAsyncTest() {
+    let result = await wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor');
+    let keys = Object.keys(result);
+    if (keys.length === 0) {
+        assert.fail();
+    }
+    console.log('Win32_Processor (async): ');
+    console.log(result);
+}
+
+async function asyncMatchesSyncTest() {
+    const properties = ['DeviceID', 'Caption'];
+    const query = `SELECT ${properties.join(',')} FROM Win32_Processor`;
+
+    let syncResult = wmi.query('root/cimv2', query, properties);
+    let asyncResult = await wmi.queryAsync('root/cimv2', query, properties);
+    assert.deepStrictEqual(Object.keys(asyncResult), Object.keys(syncResult));
+    assert.deepStrictEqual(Object.keys(asyncResult['0']), properties);
+    console.log("asyncMatchesSyncTest() complete");
+}
+
+async function badInputAsyncTests_Rejections() {
+    let goodnamespace = 'root/cimv2';
+    let goodQuery = 'SELECT * FROM Win32_Processor';
+    let goodValues = ['DeviceID', 'Caption'];
+
+    await assert.rejects(wmi.queryAsync(123, goodQuery, goodValues), Error);
+    await assert.rejects(wmi.queryAsync(goodnamespace, 123, goodValues), Error);
+    await assert.rejects(wmi.queryAsync(goodnamespace, goodQuery, [123]), Error);
+    await assert.rejects(wmi.queryAsync(goodnamespace, goodQuery, 123), Error);
+    await assert.rejects(wmi.queryAsync('invalid', goodQuery, goodValues), Error);
+    console.log("badInputAsyncTests_Rejections() complete, all promises rejected as expected.");
+}
+
+async function eventLoopNotBlockedTest() {
+    const kLatencyMs = 500;
+    const kTickIntervalMs = 10;
+
+    standIn.enable({ rowCount: 1000, latencyMs: kLatencyMs });
+
+    let ticks = 0;
+    let timer = setInterval(() => ticks++, kTickIntervalMs);
+    let start = Date.now();
+    let result = await wmi.queryAsync('root/cimv2', 'SELECT * FROM StandIn_Slow');
+    let elapsed = Date.now() - start;
+    clearInterval(timer);
+
+    assert.strictEqual(Object.keys(result).length, 1000);
+    assert.ok(elapsed >= kLatencyMs);
+    // A blocked event loop would not have ticked at all while the query was running
+    assert.ok(ticks >= (kLatencyMs / kTickIntervalMs) / 4, `only ${ticks} ticks in ${elapsed}ms`);
+
+    // The synchronous query blocks for the whole latency, which is what queryAsync avoids
+    ticks = 0;
+    timer = setInterval(() => ticks++, kTickIntervalMs);
+    wmi.query('root/cimv2', 'SELECT * FROM StandIn_Slow');
+    await new Promise(resolve => setImmediate(resolve));
+    clearInterval(timer);
+    assert.ok(ticks <= 1);
+
+    console.log(`eventLoopNotBlockedTest() complete, ${elapsed}ms query`);
+}
+
+async function concurrentQueriesTest() {
+    const kLatencyMs = 300;
+    standIn.enable({ rowCount: 10, latencyMs: kLatencyMs });
+
+    let start = Date.now();
+    let results = await Promise.all([
+        wmi.queryAsync('root/cimv2', 'SELECT * FROM StandIn_A', ['Name']),
+        wmi.queryAsync('root/cimv2', 'SELECT * FROM StandIn_B', ['Name']),
+        wmi.queryAsync('root/wmi', 'SELECT * FROM StandIn_C', ['Name'])
+    ]);
+    let elapsed = Date.now() - start;
+
+    assert.strictEqual(results[0]['9'].Name, 'StandIn_A.Name.9');
+    assert.strictEqual(results[1]['0'].Name, 'StandIn_B.Name.0');
+    assert.strictEqual(results[2]['5'].Name, 'StandIn_C.Name.5');
+    // The queries run on the worker pool side by side rather than one after another
+    assert.ok(elapsed < kLatencyMs * 3, `${elapsed}ms for three concurrent queries`);
+    console.log("concurrentQueriesTest() complete");
+}
+
+async function unsupportedOsTest() {
+    standIn.disable();
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor'), /This OS is not supported/);
+    await assert.rejects(wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor'), /This OS is not supported/);
+    console.log("unsupportedOsTest() complete");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+
+    await selectAllAsyncTest();
+    await asyncMatchesSyncTest();
+    await badInputAsyncTests_Rejections();
+
+    if (standIn) {
+        await eventLoopNotBlockedTest();
+        await concurrentQueriesTest();
+        await unsupportedOsTest();
+    }
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
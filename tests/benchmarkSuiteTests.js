@@ -0,0 +1,156 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+const childProcess = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stage benchmarks and the soak test run on the stand-in provider, the comparison of reports
+// runs anywhere
+const standIn = wmi.standIn;
+
+const kBenchmarksPath = path.join(__dirname, '..', 'benchmarks');
+const kBaselinePath = path.join(os.tmpdir(), `wmi-baseline-${process.pid}.json`);
+const kCurrentPath = path.join(os.tmpdir(), `wmi-current-${process.pid}.json`);
+
+function runScript(script, args) {
+    return childProcess.spawnSync(process.execPath, ['--expose-gc', path.join(kBenchmarksPath, script), ...args], { encoding: 'utf8' });
+}
+
+function stageTest() {
+    for (let stage of ['params', 'format', 'build', 'marshal']) {
+        let result = standIn.benchmark(stage, { rows: 20, properties: 8, typed: true, minTimeMs: 5 });
+        assert.ok(result.name.startsWith(`${stage}/`));
+        assert.ok(result.iterations >= 1);
+        assert.ok(result.realTimeNs > 0);
+        assert.ok(result.cpuTimeNs >= 0);
+        assert.ok(result.itemsPerSecond > 0);
+        assert.ok(result.bytesPerSecond > 0);
+    }
+    assert.strictEqual(standIn.benchmark('marshal', { rows: 20, properties: 8, minTimeMs: 1 }).name, 'marshal/rows:20/properties:8/strings');
+    assert.strictEqual(standIn.benchmark('build', { rows: 7, properties: 3, typed: true, minTimeMs: 1 }).name, 'build/rows:7/properties:3/typed');
+
+    // Results in the legacy layout hold blocks per value, a ResultSet only per query
+    let arena = standIn.benchmark('build', { rows: 100, properties: 10, minTimeMs: 1 });
+    let legacy = standIn.benchmark('build', { rows: 100, properties: 10, legacyLayout: true, minTimeMs: 1 });
+    assert.strictEqual(legacy.name, 'build/rows:100/properties:10/strings/legacy');
+    assert.ok(legacy.heapBlocks > 100 * 10);
+    assert.ok(arena.heapBlocks < 20);
+    assert.strictEqual(standIn.benchmark('marshal', { rows: 20, minTimeMs: 1 }).heapBlocks, 0);
+
+    // The stages run on a provider of their own, the queries of the tests don't see them
+    standIn.enable({ rowCount: 3 });
+    let queries = standIn.queryCount();
+    standIn.benchmark('build', { rows: 10, minTimeMs: 1 });
+    assert.strictEqual(standIn.queryCount(), queries);
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', 'SELECT Name FROM StandIn_Stage', ['Name'])).length, 3);
+    console.log("stageTest() complete");
+}
+
+function badInputTests_Exceptions() {
+    assert.throws(() => standIn.benchmark(), Error);
+    assert.throws(() => standIn.benchmark(1), Error);
+    assert.throws(() => standIn.benchmark('parse'), Error);
+    assert.throws(() => standIn.benchmark('build', 'rows'), Error);
+    assert.throws(() => standIn.benchmark('build', { rows: -1 }), Error);
+    assert.throws(() => standIn.benchmark('build', { properties: 0 }), Error);
+    assert.throws(() => standIn.benchmark('build', { typed: 1 }), Error);
+    assert.throws(() => standIn.benchmark('build', { legacyLayout: 'yes' }), Error);
+    assert.throws(() => standIn.benchmark('build', { minTimeMs: 'long' }), Error);
+    assert.throws(() => standIn.benchmark('build', {}, 1), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+function soakTest() {
+    // A few seconds of the workload, sampled every half second
+    let run = runScript('soakTest.js', ['0.05', '0.5', '-']);
+    assert.strictEqual(run.status, 0, run.stderr);
+    let report = JSON.parse(run.stdout);
+    assert.strictEqual(report.context.provider, 'stand-in');
+    let summary = report.soak.summary;
+    assert.ok(summary.passed);
+    assert.strictEqual(summary.errors, 0);
+    assert.ok(summary.operations > 0);
+    assert.ok(report.soak.samples.length >= 2);
+    assert.ok(report.soak.samples.every(sample => sample.rss_mb > 0 && sample.file_descriptors > 0 && sample.open_connections >= 0));
+    console.log("soakTest() complete");
+}
+
+function compareTest() {
+    let benchmark = (name, realTime) => ({ name: name, run_type: 'iteration', iterations: 10, real_time: realTime, cpu_time: realTime, time_unit: 'ns' });
+    fs.writeFileSync(kBaselinePath, JSON.stringify({ context: {}, benchmarks: [benchmark('a', 1000), benchmark('b', 1000), benchmark('gone', 5)] }));
+
+    // Within the threshold, new and missing benchmarks don't count
+    fs.writeFileSync(kCurrentPath, JSON.stringify({ context: {}, benchmarks: [benchmark('a', 1080), benchmark('b', 500), benchmark('new', 1)] }));
+    let run = runScript('compareBenchmarks.js', [kBaselinePath, kCurrentPath]);
+    assert.strictEqual(run.status, 0, run.stdout);
+    assert.ok(/^new\s+new$/m.test(run.stdout));
+    assert.ok(/^gone\s+missing$/m.test(run.stdout));
+
+    // 20% slower fails at the default 10%, but not at 25%
+    fs.writeFileSync(kCurrentPath, JSON.stringify({ context: {}, benchmarks: [benchmark('a', 1200), benchmark('b', 1000)] }));
+    run = runScript('compareBenchmarks.js', [kBaselinePath, kCurrentPath]);
+    assert.strictEqual(run.status, 1);
+    assert.ok(/^a\s.*REGRESSION$/m.test(run.stdout));
+    assert.strictEqual(runScript('compareBenchmarks.js', [kBaselinePath, kCurrentPath, '25']).status, 0);
+
+    assert.strictEqual(runScript('compareBenchmarks.js', [kBaselinePath]).status, 2);
+    fs.unlinkSync(kBaselinePath);
+    fs.unlinkSync(kCurrentPath);
+    console.log("compareTest() complete");
+}
+
+function pipelineReportTest() {
+    let run = runScript('pipelineBenchmark.js', ['5', kCurrentPath]);
+    assert.strictEqual(run.status, 0, run.stderr);
+    let report = JSON.parse(fs.readFileSync(kCurrentPath, 'utf8'));
+    fs.unlinkSync(kCurrentPath);
+    assert.strictEqual(report.context.provider, standIn ? 'stand-in' : 'wmi');
+    assert.ok(report.benchmarks.length > 0);
+    for (let benchmark of report.benchmarks) {
+        assert.strictEqual(benchmark.time_unit, 'ns');
+        assert.ok(benchmark.iterations >= 1 && benchmark.real_time > 0, benchmark.name);
+    }
+    let names = report.benchmarks.map(benchmark => benchmark.name);
+    assert.ok(names.includes('e2e/queryTyped/Win32_Processor'));
+    if (standIn) {
+        assert.ok(names.includes('marshal/rows:1000/properties:20/typed'));
+        assert.ok(names.includes('e2e/query/rows:1000/properties:20'));
+    }
+    console.log("pipelineReportTest() complete");
+}
+
+compareTest();
+if (standIn) {
+    badInputTests_Exceptions();
+    stageTest();
+    soakTest();
+}
+pipelineReportTest();
\ No newline at end of file
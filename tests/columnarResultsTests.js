@@ -0,0 +1,142 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider returns a fixed set of typed properties shaped the way WMI hands them out
+const standIn = wmi.standIn;
+
+const kProperties = ['Caption', 'Level', 'Count', 'Ratio', 'Total', 'Balance', 'InstallDate', 'Status', 'Samples'];
+const kQuery = `SELECT ${kProperties.join(',')} FROM StandIn_Typed`;
+
+function matchesRowsTest() {
+    let rows = Object.values(wmi.query('root/cimv2', kQuery, kProperties, { typed: true }));
+    let columnar = wmi.query('root/cimv2', kQuery, kProperties, { typed: true, format: 'columnar' });
+
+    assert.deepStrictEqual(columnar.columns, kProperties);
+    assert.strictEqual(columnar.rows, rows.length);
+    for (let property of kProperties) {
+        assert.deepStrictEqual(Array.from(columnar.data[property]), rows.map(row => row[property]), property);
+    }
+    console.log("matchesRowsTest() complete");
+}
+
+function columnTypesTest() {
+    let { data } = wmi.query('root/cimv2', kQuery, kProperties, { typed: true, format: 'columnar' });
+
+    assert.ok(Array.isArray(data.Caption));
+    assert.ok(data.Level instanceof Float64Array);
+    assert.ok(data.Count instanceof Float64Array);
+    assert.ok(data.Ratio instanceof Float64Array);
+    assert.ok(data.Total instanceof BigUint64Array);
+    assert.ok(data.Balance instanceof BigInt64Array);
+    assert.ok(Array.isArray(data.InstallDate));
+    assert.ok(data.InstallDate[0] instanceof Date);
+    assert.deepStrictEqual(data.Status, [null, null, null, null]);
+    assert.ok(data.Samples[0] instanceof Uint32Array);
+    assert.deepStrictEqual(Array.from(data.Count), [4000000000, 4000000001, 4000000002, 4000000003]);
+
+    // Every numeric column is a view on the same buffer
+    assert.strictEqual(data.Level.buffer, data.Count.buffer);
+    assert.strictEqual(data.Level.buffer, data.Total.buffer);
+    console.log("columnTypesTest() complete");
+}
+
+function numberConversionOptionsTest() {
+    let { data } = wmi.query('root/cimv2', kQuery, kProperties, { typed: true, int64: 'number', datetime: 'number', format: 'columnar' });
+
+    assert.ok(data.Total instanceof Float64Array);
+    assert.ok(data.Balance instanceof Float64Array);
+    assert.ok(data.InstallDate instanceof Float64Array);
+    assert.strictEqual(data.InstallDate[1], Date.UTC(2023, 0, 2, 2, 4, 1, 678));
+    console.log("numberConversionOptionsTest() complete");
+}
+
+function stringColumnsTest() {
+    // Without typed values every column holds strings
+    let { columns, data } = wmi.query('root/cimv2', kQuery, kProperties, { format: 'columnar' });
+
+    assert.deepStrictEqual(columns, kProperties);
+    assert.deepStrictEqual(data.Level, ['0', '1', '2', '3']);
+    console.log("stringColumnsTest() complete");
+}
+
+function emptyResultTest() {
+    let result = wmi.query('root/cimv2', 'SELECT nothing', undefined, { format: 'columnar' });
+    assert.deepStrictEqual(result, { columns: [], rows: 0, data: {} });
+    console.log("emptyResultTest() complete");
+}
+
+async function asyncAndStreamTest() {
+    const options = { typed: true, format: 'columnar' };
+    let expected = wmi.query('root/cimv2', kQuery, kProperties, options);
+
+    assert.deepStrictEqual(await wmi.queryAsync('root/cimv2', kQuery, kProperties, options), expected);
+
+    let levels = [];
+    for await (let batch of wmi.queryStream('root/cimv2', kQuery, kProperties, { ...options, batchSize: 3 })) {
+        assert.deepStrictEqual(batch.columns, kProperties);
+        assert.ok(batch.data.Level instanceof Float64Array);
+        levels.push(...batch.data.Level);
+    }
+    assert.deepStrictEqual(levels, Array.from(expected.data.Level));
+    console.log("asyncAndStreamTest() complete");
+}
+
+function windowsColumnarTest() {
+    const properties = ['DeviceID', 'NumberOfCores', 'LoadPercentage'];
+    let result = wmi.query('root/cimv2', `SELECT ${properties.join(',')} FROM Win32_Processor`, properties, { typed: true, format: 'columnar' });
+
+    assert.deepStrictEqual(result.columns, properties);
+    assert.ok(result.rows > 0);
+    assert.ok(result.data.NumberOfCores instanceof Float64Array);
+    assert.strictEqual(result.data.DeviceID.length, result.rows);
+    console.log("windowsColumnarTest() complete");
+}
+
+async function runTests() {
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kProperties, { format: 'table' }), Error);
+
+    if (!standIn) {
+        windowsColumnarTest();
+        return;
+    }
+
+    standIn.enable();
+    matchesRowsTest();
+    columnTypesTest();
+    numberConversionOptionsTest();
+    stringColumnsTest();
+    emptyResultTest();
+    await asyncAndStreamTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
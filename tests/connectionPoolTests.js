@@ -0,0 +1,180 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Pool behaviour is observed through the stand-in provider's fake connector
+const standIn = wmi.standIn;
+
+const kHealthCheckIntervalMs = 30 * 1000;
+const kIdleTimeoutMs = 5 * 60 * 1000;
+
+function statsDelta(before) {
+    let after = standIn.connectionStats();
+    let delta = {};
+    for (let key of Object.keys(after)) {
+        delta[key] = after[key] - before[key];
+    }
+    delta.openConnections = after.openConnections;
+    return delta;
+}
+
+function reuseConnectionTest() {
+    wmi.close();
+    let before = standIn.connectionStats();
+
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    wmi.query('ROOT/CIMV2', 'SELECT * FROM Win32_Processor');
+    wmi.query('Root/Cimv2', 'SELECT * FROM Win32_BIOS');
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID');
+
+    let delta = statsDelta(before);
+    // Namespaces are pooled case insensitively
+    assert.strictEqual(delta.misses, 2);
+    assert.strictEqual(delta.hits, 2);
+    assert.strictEqual(delta.connects, 2);
+    assert.strictEqual(delta.openConnections, 2);
+    console.log("reuseConnectionTest() complete");
+}
+
+function reconnectAfterBrokenConnectionTest() {
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    let before = standIn.connectionStats();
+
+    // The pooled connection fails on use, the query is retried on a new connection
+    standIn.breakConnections();
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Name']);
+    assert.strictEqual(result['0'].Name, 'Win32_Processor.Name.0');
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.reconnects, 1);
+    assert.strictEqual(delta.connects, 1);
+    console.log("reconnectAfterBrokenConnectionTest() complete");
+}
+
+function healthCheckTest() {
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    let before = standIn.connectionStats();
+
+    // Connections idle past the health check interval are verified before reuse
+    standIn.breakConnections();
+    standIn.advanceClock(kHealthCheckIntervalMs);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.failedHealthChecks, 1);
+    assert.strictEqual(delta.reconnects, 1);
+
+    // A healthy connection passes the check and is reused
+    standIn.advanceClock(kHealthCheckIntervalMs);
+    before = standIn.connectionStats();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    delta = statsDelta(before);
+    assert.strictEqual(delta.failedHealthChecks, 0);
+    assert.strictEqual(delta.hits, 1);
+    console.log("healthCheckTest() complete");
+}
+
+function idleEvictionTest() {
+    wmi.close();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID');
+
+    standIn.advanceClock(kIdleTimeoutMs / 2);
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID');
+
+    let before = standIn.connectionStats();
+    standIn.advanceClock(kIdleTimeoutMs / 2 + 1);
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID');
+
+    // Only the connection that sat idle for the whole timeout is released
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.evictions, 1);
+    assert.strictEqual(delta.hits, 1);
+    assert.strictEqual(delta.openConnections, 1);
+    console.log("idleEvictionTest() complete");
+}
+
+function closeTest() {
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    wmi.close();
+    assert.strictEqual(standIn.connectionStats().openConnections, 0);
+
+    // The pool reconnects on demand after being closed
+    let before = standIn.connectionStats();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.misses, 1);
+    assert.strictEqual(delta.openConnections, 1);
+    console.log("closeTest() complete");
+}
+
+async function concurrentAsyncQueriesShareConnectionTest() {
+    const kConnectLatencyMs = 200;
+    standIn.enable({ connectLatencyMs: kConnectLatencyMs });
+
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    let before = standIn.connectionStats();
+
+    let start = Date.now();
+    let queries = [];
+    for (let i = 0; i < 16; ++i) {
+        queries.push(wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor'));
+    }
+    await Promise.all(queries);
+    let elapsed = Date.now() - start;
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.connects, 0);
+    assert.strictEqual(delta.hits, 16);
+    // None of the queries paid for connection setup
+    assert.ok(elapsed < kConnectLatencyMs * 4, `${elapsed}ms for 16 pooled queries`);
+
+    standIn.enable();
+    console.log("concurrentAsyncQueriesShareConnectionTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        console.log('Connection pool tests need the stand-in provider of the unsupported OS build, skipping.');
+        return;
+    }
+
+    standIn.enable();
+    reuseConnectionTest();
+    reconnectAfterBrokenConnectionTest();
+    healthCheckTest();
+    idleEvictionTest();
+    closeTest();
+    await concurrentAsyncQueriesShareConnectionTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,161 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider returns a fixed set of typed properties shaped the way WMI hands them out
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT * FROM StandIn_Lazy';
+const kTypedProperties = ['Caption', 'Level', 'Total', 'InstallDate', 'Status', 'Samples'];
+
+function matchesEagerTest() {
+    standIn.enable({ rowCount: 5, propertyCount: 50 });
+    let eager = wmi.query('root/cimv2', kQuery);
+    let lazy = wmi.query('root/cimv2', kQuery, undefined, { lazy: true });
+
+    assert.deepStrictEqual(Object.keys(lazy), Object.keys(eager));
+    assert.strictEqual(lazy[3].Property42, eager[3].Property42);
+    assert.strictEqual(JSON.stringify(lazy), JSON.stringify(eager));
+
+    // Typed values go through the same conversion
+    let options = { typed: true, int64: 'bigint' };
+    eager = wmi.query('root/cimv2', kQuery, kTypedProperties, options);
+    lazy = wmi.query('root/cimv2', kQuery, kTypedProperties, { ...options, lazy: true });
+    for (let row of Object.keys(eager)) {
+        for (let property of kTypedProperties) {
+            assert.deepStrictEqual(lazy[row][property], eager[row][property], property);
+        }
+    }
+    console.log("matchesEagerTest() complete");
+}
+
+function convertOnReadTest() {
+    standIn.enable({ rowCount: 2, propertyCount: 20 });
+    let [row] = Object.values(wmi.query('root/cimv2', kQuery, undefined, { lazy: true }));
+
+    // Every property is there, none was converted yet
+    assert.ok('Property7' in row);
+    assert.deepStrictEqual(Object.keys(row), []);
+
+    // A property read once becomes a value of its own
+    assert.strictEqual(row.Property7, 'StandIn_Lazy.Property7.0');
+    assert.deepStrictEqual(Object.keys(row), ['Property7']);
+    assert.strictEqual(Object.getOwnPropertyDescriptor(row, 'Property7').value, 'StandIn_Lazy.Property7.0');
+    assert.strictEqual(row.Property7, 'StandIn_Lazy.Property7.0');
+
+    // Properties can be assigned like those of eager results
+    row.Property8 = 'changed';
+    assert.strictEqual(row.Property8, 'changed');
+    assert.strictEqual(row.toJSON().Property8, 'changed');
+    assert.strictEqual(Object.keys(row.toJSON()).length, 20);
+    assert.strictEqual(row.Unknown, undefined);
+    console.log("convertOnReadTest() complete");
+}
+
+function disposeTest() {
+    standIn.enable({ rowCount: 3 });
+    let results = wmi.query('root/cimv2', kQuery, undefined, { lazy: true });
+    assert.ok(!Object.keys(results).includes('dispose'));
+
+    let [first, second, third] = Object.values(results);
+    assert.strictEqual(first.Property1, 'StandIn_Lazy.Property1.0');
+    second.dispose();
+    assert.throws(() => second.Property1, /Instance was disposed/);
+    assert.strictEqual(third.Property1, 'StandIn_Lazy.Property1.2');
+
+    // Disposing the results releases them for every instance, values already read stay
+    results.dispose();
+    assert.strictEqual(first.Property1, 'StandIn_Lazy.Property1.0');
+    assert.throws(() => first.Property2, /Instance was disposed/);
+    assert.throws(() => JSON.stringify(third), /Instance was disposed/);
+
+    // Disposing twice is harmless
+    results.dispose();
+    first.dispose();
+    console.log("disposeTest() complete");
+}
+
+async function entryPointsTest() {
+    standIn.enable({ rowCount: 4 });
+    const options = { typed: true, lazy: true };
+    let expected = JSON.stringify(wmi.query('root/cimv2', kQuery, ['Caption', 'Level'], { typed: true }));
+
+    assert.strictEqual(JSON.stringify(wmi.query('root/cimv2', kQuery, ['Caption', 'Level'], options)), expected);
+    assert.strictEqual(JSON.stringify(await wmi.queryAsync('root/cimv2', kQuery, ['Caption', 'Level'], options)), expected);
+    let prepared = wmi.prepare('root/cimv2', kQuery, ['Caption', 'Level'], options);
+    assert.strictEqual(JSON.stringify(prepared.run()), expected);
+    assert.strictEqual(JSON.stringify(await prepared.runAsync()), expected);
+    let [outcome] = await wmi.queryMany([{ namespace: 'root/cimv2', query: kQuery, properties: ['Caption', 'Level'], options: options }]);
+    assert.strictEqual(JSON.stringify(outcome.value), expected);
+
+    let limited = wmi.query('root/cimv2', kQuery, undefined, { lazy: true, maxRows: 2, timings: true });
+    assert.strictEqual(Object.keys(limited).length, 2);
+    assert.strictEqual(limited.truncated, 'maxRows');
+    assert.strictEqual(limited.timings.rows, 2);
+    console.log("entryPointsTest() complete");
+}
+
+function badInputTests_Exceptions() {
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, { lazy: 'yes' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, { lazy: true, format: 'columnar' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, { lazy: true, aggregate: { values: { n: { op: 'count' } } } }), Error);
+    assert.throws(() => wmi.queryStream('root/cimv2', kQuery, undefined, { lazy: true }), Error);
+    assert.throws(() => wmi.subscribe('root/cimv2', 'SELECT * FROM __InstanceCreationEvent WITHIN 1', () => { }, { lazy: true }), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', kQuery, undefined, { lazy: true }), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+function windowsLazyTest() {
+    let eager = wmi.query('root/cimv2', 'SELECT * FROM Win32_OperatingSystem');
+    let lazy = wmi.query('root/cimv2', 'SELECT * FROM Win32_OperatingSystem', undefined, { lazy: true });
+
+    assert.strictEqual(lazy[0].Caption, eager[0].Caption);
+    assert.strictEqual(lazy[0].BuildNumber, eager[0].BuildNumber);
+    lazy.dispose();
+    console.log("windowsLazyTest() complete");
+}
+
+async function runTests() {
+    badInputTests_Exceptions();
+
+    if (!standIn) {
+        windowsLazyTest();
+        return;
+    }
+
+    matchesEagerTest();
+    convertOnReadTest();
+    disposeTest();
+    await entryPointsTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,157 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider reads the same properties for prepared and ad hoc queries
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT Caption, Level, Total FROM StandIn_Prepared WHERE Level > 0';
+
+function selectListTest() {
+    let prepared = wmi.prepare('root/cimv2', kQuery);
+    assert.strictEqual(prepared.namespace, 'root/cimv2');
+    assert.strictEqual(prepared.query, kQuery);
+    assert.strictEqual(prepared.className, 'StandIn_Prepared');
+    assert.deepStrictEqual(prepared.properties, ['Caption', 'Level', 'Total']);
+    assert.strictEqual(prepared.closed, false);
+
+    // Same results as the query with the select list passed as its properties
+    let expected = wmi.query('root/cimv2', kQuery, ['Caption', 'Level', 'Total']);
+    assert.deepStrictEqual(prepared.run(), expected);
+    assert.deepStrictEqual(prepared.run(), expected);
+
+    // Explicit properties win over the select list, SELECT * without them reads everything
+    assert.deepStrictEqual(wmi.prepare('root/cimv2', kQuery, ['Level']).properties, ['Level']);
+    let all = wmi.prepare('ROOT/CIMV2', 'select * from StandIn_Prepared');
+    assert.deepStrictEqual(all.properties, []);
+    assert.deepStrictEqual(all.run(), wmi.query('root/cimv2', 'SELECT * FROM StandIn_Prepared'));
+    console.log("selectListTest() complete");
+}
+
+async function optionsTest() {
+    let prepared = wmi.prepare('root/cimv2', kQuery, undefined, { typed: true });
+    let row = prepared.run()[1];
+    assert.strictEqual(row.Level, 1);
+    assert.strictEqual(row.Total, 9007199254740994n);
+
+    // Options passed to a run only change what they set
+    row = prepared.run({ int64: 'number' })[1];
+    assert.strictEqual(row.Level, 1);
+    assert.strictEqual(row.Total, 9007199254740994);
+
+    let columnar = await prepared.runAsync({ format: 'columnar' });
+    assert.deepStrictEqual(columnar.columns, ['Caption', 'Level', 'Total']);
+    assert.deepStrictEqual(await prepared.runAsync(), prepared.run());
+
+    let timed = prepared.run({ timings: true });
+    assert.strictEqual(timed.timings.rows, Object.keys(timed).length);
+    assert.ok(wmi.getStats().some(entry => entry.className === 'StandIn_Prepared'));
+    console.log("optionsTest() complete");
+}
+
+function cacheTest() {
+    let prepared = wmi.prepare('root/cimv2', kQuery, undefined, { cacheTtlMs: 1000 });
+    let queries = standIn.queryCount();
+
+    let first = prepared.run();
+    // Prepared and ad hoc runs of the same query share cached results
+    let second = wmi.query('root/cimv2', 'select  Caption, Level, Total from StandIn_Prepared where Level > 0',
+        ['Caption', 'Level', 'Total'], { cacheTtlMs: 1000 });
+    assert.deepStrictEqual(second, first);
+    assert.strictEqual(standIn.queryCount() - queries, 1);
+
+    wmi.invalidateCache();
+    console.log("cacheTest() complete");
+}
+
+async function closeTest() {
+    let prepared = wmi.prepare('root/cimv2', kQuery);
+
+    // A run in progress keeps the query after close
+    let pending = prepared.runAsync();
+    prepared.close();
+    assert.strictEqual(Object.keys(await pending).length, 4);
+
+    assert.strictEqual(prepared.closed, true);
+    assert.strictEqual(prepared.className, null);
+    assert.throws(() => prepared.run(), /closed/);
+    await assert.rejects(() => prepared.runAsync(), /closed/);
+    prepared.close();
+    console.log("closeTest() complete");
+}
+
+async function badArgumentsTest_Exceptions() {
+    assert.throws(() => wmi.prepare('root/cimv2'), Error);
+    assert.throws(() => wmi.prepare('root/unsupported', kQuery), /Unsupported Namespace/);
+    assert.throws(() => wmi.prepare('root/cimv2', kQuery, 'Caption'), Error);
+    assert.throws(() => wmi.prepare('root/cimv2', kQuery, undefined, { typed: 'yes' }), Error);
+
+    // Only SELECT queries with a class can be prepared
+    assert.throws(() => wmi.prepare('root/cimv2', 'SELECT FROM StandIn_Prepared'), /Invalid Query/);
+    assert.throws(() => wmi.prepare('root/cimv2', 'SELECT Caption, FROM StandIn_Prepared'), /Invalid Query/);
+    assert.throws(() => wmi.prepare('root/cimv2', 'SELECT Caption FROM'), /Invalid Query/);
+    assert.throws(() => wmi.prepare('root/cimv2', 'ASSOCIATORS OF {Win32_Process.Handle=1}'), /Invalid Query/);
+
+    let prepared = wmi.prepare('root/cimv2', kQuery);
+    assert.throws(() => prepared.run('typed'), Error);
+    assert.throws(() => prepared.run({ typed: 1 }), Error);
+    await assert.rejects(() => prepared.runAsync({ format: 'table' }), Error);
+    console.log("badArgumentsTest_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function windowsPreparedTest() {
+    let prepared = wmi.prepare('root/cimv2', 'SELECT Name, ProcessId FROM Win32_Process', undefined, { typed: true });
+    assert.deepStrictEqual(prepared.properties, ['Name', 'ProcessId']);
+    for (let process of Object.values(await prepared.runAsync())) {
+        assert.strictEqual(typeof process.Name, 'string');
+        assert.strictEqual(typeof process.ProcessId, 'number');
+    }
+    prepared.close();
+    console.log("windowsPreparedTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        await windowsPreparedTest();
+        await badArgumentsTest_Exceptions();
+        return;
+    }
+
+    standIn.enable();
+    selectListTest();
+    await optionsTest();
+    cacheTest();
+    await closeTest();
+    await badArgumentsTest_Exceptions();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,211 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider reports the query text each query would have passed to ExecQuery
+const standIn = wmi.standIn;
+
+function execQuery(query, properties, options) {
+    wmi.query('root/cimv2', query, properties, options);
+    return standIn.lastExecQuery().query;
+}
+
+function selectAllTest() {
+    assert.strictEqual(execQuery('SELECT * FROM Win32_Process', ['Name', 'ProcessId']),
+        'SELECT Name, ProcessId FROM Win32_Process');
+    assert.strictEqual(execQuery('select * from Win32_Process', ['Name']), 'SELECT Name from Win32_Process');
+
+    // Properties are selected once, whatever their case
+    assert.strictEqual(execQuery('SELECT * FROM Win32_Process', ['Name', 'NAME', 'name']), 'SELECT Name FROM Win32_Process');
+
+    // Without a property list every property is read
+    assert.strictEqual(execQuery('SELECT * FROM Win32_Process'), 'SELECT * FROM Win32_Process');
+    assert.strictEqual(execQuery('SELECT * FROM Win32_Process', []), 'SELECT * FROM Win32_Process');
+
+    // The results are the same as without the rewrite
+    let result = wmi.query('root/cimv2', 'SELECT * FROM StandIn_Projected', ['Caption', 'Level'], { typed: true });
+    assert.deepStrictEqual(Object.keys(result[0]), ['Caption', 'Level']);
+    assert.strictEqual(result[1].Level, 1);
+    console.log("selectAllTest() complete");
+}
+
+function whereClauseTest() {
+    // Properties used in the WHERE clause don't have to be selected, literals are kept as written
+    assert.strictEqual(execQuery("SELECT * FROM Win32_Process WHERE Name = 'SELECT * FROM X' AND Handle > 4", ['Caption']),
+        "SELECT Caption FROM Win32_Process WHERE Name = 'SELECT * FROM X' AND Handle > 4");
+    assert.strictEqual(execQuery('SELECT *\r\n  FROM  Win32_Service\tWHERE State="Running"', ['Name', 'State']),
+        'SELECT Name, State FROM  Win32_Service\tWHERE State="Running"');
+    console.log("whereClauseTest() complete");
+}
+
+function selectListTest() {
+    // A select list is narrowed to the properties that are read
+    assert.strictEqual(execQuery('SELECT Name, Handle, Caption FROM Win32_Process', ['caption', 'Name']),
+        'SELECT caption, Name FROM Win32_Process');
+
+    // but never widened or repeated
+    assert.strictEqual(execQuery('SELECT Name, Handle FROM Win32_Process', ['Handle', 'Name']),
+        'SELECT Name, Handle FROM Win32_Process');
+    assert.strictEqual(execQuery('SELECT Name, Handle FROM Win32_Process', ['Name', 'Path']),
+        'SELECT Name, Handle FROM Win32_Process');
+    console.log("selectListTest() complete");
+}
+
+function embeddedObjectTest() {
+    // Dotted properties select their embedded object
+    assert.strictEqual(execQuery('SELECT * FROM MSFT_Partition', ['Disk.Size', 'Disk.Model', 'Offset']),
+        'SELECT Disk, Offset FROM MSFT_Partition');
+    console.log("embeddedObjectTest() complete");
+}
+
+function notRewrittenTest() {
+    const queries = [
+        // WQL has no aliases, such a query is left for WMI to reject
+        ['SELECT Name AS ProcessName FROM Win32_Process', ['Name']],
+        ['SELECT Win32_Process.Name FROM Win32_Process', ['Name']],
+        ['ASSOCIATORS OF {Win32_LogicalDisk.DeviceID="C:"} WHERE ResultClass = Win32_Directory', ['Name']],
+        ['REFERENCES OF {Win32_LogicalDisk.DeviceID="C:"}', ['Antecedent']],
+        ['SELECT * FROM __InstanceCreationEvent WITHIN 1 WHERE TargetInstance ISA "Win32_Process"', ['TargetInstance.Name']],
+        ['SELECT * FROM __Namespace', ['Name']],
+        // WMI only fills in system properties when every key property is selected
+        ['SELECT * FROM Win32_Process', ['Name', '__PATH']],
+        ['SELECT * FROM Win32_Process', ['Name', 'Bad Name']],
+        ['SELECT * FROM Win32_Process', ['.Name']],
+        ['SELECT * Win32_Process', ['Name']],
+        ['SELECT * FROM', ['Name']]
+    ];
+    for (let [query, properties] of queries) {
+        assert.strictEqual(execQuery(query, properties), query);
+    }
+    console.log("notRewrittenTest() complete");
+}
+
+async function partialInstancesTest() {
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', ['Name', 'Handle']);
+    assert.strictEqual(standIn.lastExecQuery().extProperties, null);
+
+    wmi.query('root/cimv2', 'SELECT * FROM MSFT_Partition', ['Disk.Size', 'Offset'], { partialInstances: true });
+    let { query, extProperties } = standIn.lastExecQuery();
+    assert.deepStrictEqual({ query, extProperties }, { query: 'SELECT Disk, Offset FROM MSFT_Partition', extProperties: ['Disk', 'Offset'] });
+
+    // Streams go through the same ExecQuery call
+    for await (let batch of wmi.queryStream('root/cimv2', 'SELECT * FROM Win32_Process', ['Name'], { partialInstances: true })) {
+        assert.strictEqual(batch.length, 4);
+    }
+    ({ query, extProperties } = standIn.lastExecQuery());
+    assert.deepStrictEqual({ query, extProperties }, { query: 'SELECT Name FROM Win32_Process', extProperties: ['Name'] });
+
+    // Nothing to ask for without a property list, or with one that can't be selected
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', undefined, { partialInstances: true });
+    assert.strictEqual(standIn.lastExecQuery().extProperties, null);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', ['__PATH'], { partialInstances: true });
+    assert.strictEqual(standIn.lastExecQuery().extProperties, null);
+
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', ['Name'], { partialInstances: 1 }), Error);
+    console.log("partialInstancesTest() complete");
+}
+
+function preparedTest() {
+    let prepared = wmi.prepare('root/cimv2', 'SELECT * FROM Win32_Process WHERE Handle > 4', ['Name']);
+    prepared.run();
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT Name FROM Win32_Process WHERE Handle > 4');
+
+    // The select list of a prepared query is what it reads
+    wmi.prepare('root/cimv2', 'SELECT Name, Handle FROM Win32_Process').run();
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT Name, Handle FROM Win32_Process');
+    console.log("preparedTest() complete");
+}
+
+function missingPropertyTest() {
+    standIn.enable({ missingProperties: ['VolumeSerialNumber'] });
+
+    // A projection WMI rejects is run again as written, the missing property reads as empty
+    let disks = Object.values(wmi.query('root/cimv2', 'SELECT * FROM CIM_LogicalDisk', ['DeviceID', 'VolumeSerialNumber']));
+    assert.strictEqual(disks.length, 4);
+    assert.strictEqual(disks[0].DeviceID, 'CIM_LogicalDisk.DeviceID.0');
+    assert.strictEqual(disks[0].VolumeSerialNumber, '');
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT * FROM CIM_LogicalDisk');
+
+    wmi.prepare('root/cimv2', 'SELECT * FROM CIM_LogicalDisk', ['DeviceID', 'VolumeSerialNumber']).run();
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT * FROM CIM_LogicalDisk');
+
+    // WMI may only reject the projection once the first instances are asked for, it is retried then as well
+    standIn.enable({ missingProperties: ['VolumeSerialNumber'], rejectOnNext: true });
+    disks = Object.values(wmi.query('root/cimv2', 'SELECT * FROM CIM_LogicalDisk', ['DeviceID', 'VolumeSerialNumber']));
+    assert.strictEqual(disks.length, 4);
+    assert.strictEqual(disks[0].VolumeSerialNumber, '');
+    assert.strictEqual(standIn.lastExecQuery().query, 'SELECT * FROM CIM_LogicalDisk');
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT VolumeSerialNumber FROM CIM_LogicalDisk'), Error);
+
+    // A select list written by the caller isn't retried, WMI rejects it like any other invalid query
+    standIn.enable({ missingProperties: ['VolumeSerialNumber'], maskRejectedQueries: true });
+    wmi.resetStats();
+    assert.deepStrictEqual(wmi.query('root/cimv2', 'SELECT VolumeSerialNumber FROM CIM_LogicalDisk'), {});
+    let entry = wmi.getStats().find(entry => entry.className === 'CIM_LogicalDisk');
+    assert.strictEqual(entry.failures, 1);
+    assert.strictEqual(entry.errors[String(0x80041017 | 0)], 1);
+
+    assert.throws(() => standIn.enable({ missingProperties: 'VolumeSerialNumber' }), Error);
+    standIn.enable();
+    console.log("missingPropertyTest() complete");
+}
+
+function windowsProjectionTest() {
+    const properties = ['Name', 'ProcessId'];
+    let all = wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', properties);
+    for (let process of Object.values(all)) {
+        assert.deepStrictEqual(Object.keys(process), properties);
+    }
+
+    let partial = wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', properties, { partialInstances: true });
+    assert.ok(Object.keys(partial).length > 0);
+    console.log("windowsProjectionTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        windowsProjectionTest();
+        return;
+    }
+
+    standIn.enable();
+    selectAllTest();
+    whereClauseTest();
+    selectListTest();
+    embeddedObjectTest();
+    notRewrittenTest();
+    await partialInstancesTest();
+    preparedTest();
+    missingPropertyTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Handle resolution and reuse are observed through the stand-in provider's fake instances
+const standIn = wmi.standIn;
+
+const kRowCount = 6;
+// Count, Delta, Total and Ratio are read through handles, the rest by name
+const kProperties = ['Count', 'Delta', 'Total', 'Ratio', 'Enabled', 'InstallDate', 'Name'];
+const kHandleProperties = 4;
+
+function statsDelta(before) {
+    let after = standIn.propertyHandleStats();
+    let delta = {};
+    for (let key of Object.keys(after)) {
+        delta[key] = after[key] - before[key];
+    }
+    delta.cachedSchemas = after.cachedSchemas;
+    return delta;
+}
+
+function sameResultsTest() {
+    const properties = kProperties.concat(['Capacity', 'Balance', 'Load', 'Status', 'Samples', 'Totals']);
+    for (let options of [{}, { typed: true }, { typed: true, int64: 'number' }]) {
+        standIn.enable({ rowCount: kRowCount, propertyHandles: true });
+        let withHandles = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', properties, options);
+        standIn.enable({ rowCount: kRowCount, propertyHandles: false });
+        let withoutHandles = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', properties, options);
+
+        // Handles only change how values are read, never what is returned
+        assert.deepStrictEqual(withHandles, withoutHandles);
+    }
+
+    standIn.enable({ rowCount: kRowCount });
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Count', 'Capacity'], { typed: true });
+    assert.strictEqual(result['0'].Count, 4000000000);
+    assert.strictEqual(result['0'].Capacity, 0);
+    assert.strictEqual(result['2'].Capacity, 2048);
+    // Null values can't be read through a handle and come from the fallback
+    assert.strictEqual(result['1'].Capacity, null);
+    console.log("sameResultsTest() complete");
+}
+
+function reuseHandlesTest() {
+    standIn.enable({ rowCount: kRowCount });
+    wmi.close();
+    let before = standIn.propertyHandleStats();
+
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+    wmi.query('ROOT/CIMV2', 'SELECT * FROM Win32_Processor', kProperties);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor WHERE DeviceID = "CPU0"', kProperties);
+
+    let delta = statsDelta(before);
+    // Handles are resolved once per class and reused by later queries, whatever their filter
+    assert.strictEqual(delta.misses, 1);
+    assert.strictEqual(delta.hits, 2);
+    assert.strictEqual(delta.handleReads, 3 * kRowCount * kHandleProperties);
+    assert.strictEqual(delta.namedReads, 3 * kRowCount * (kProperties.length - kHandleProperties));
+
+    // Another class, property list or select list needs its own handles
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_BIOS', kProperties);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Count']);
+    wmi.query('root/cimv2', 'SELECT Count FROM Win32_Processor', ['Count']);
+    delta = statsDelta(before);
+    assert.strictEqual(delta.misses, 4);
+    assert.strictEqual(delta.cachedSchemas, 4);
+    console.log("reuseHandlesTest() complete");
+}
+
+async function sharedAcrossQueryKindsTest() {
+    standIn.enable({ rowCount: kRowCount });
+    wmi.close();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+    let before = standIn.propertyHandleStats();
+
+    await wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+    for await (let batch of wmi.queryStream('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties, { batchSize: 2 })) {
+        assert.strictEqual(batch.length, 2);
+    }
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.misses, 0);
+    assert.strictEqual(delta.hits, 2);
+    console.log("sharedAcrossQueryKindsTest() complete");
+}
+
+function invalidationTest() {
+    standIn.enable({ rowCount: kRowCount });
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID', kProperties);
+    let before = standIn.propertyHandleStats();
+
+    // The class definitions may have changed while WMI was down, the handles are resolved again
+    standIn.breakConnections();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.invalidations, 1);
+    assert.strictEqual(delta.misses, 1);
+
+    // Other namespaces keep their handles until their own connection is replaced
+    before = standIn.propertyHandleStats();
+    standIn.breakConnections();
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID', kProperties);
+    delta = statsDelta(before);
+    assert.strictEqual(delta.invalidations, 1);
+    assert.strictEqual(delta.misses, 1);
+
+    wmi.close();
+    assert.strictEqual(standIn.propertyHandleStats().cachedSchemas, 0);
+    console.log("invalidationTest() complete");
+}
+
+function perRowCostTest() {
+    const kRows = 20000;
+    const kRuns = 5;
+
+    function measure(propertyHandles) {
+        standIn.enable({ rowCount: kRows, propertyHandles: propertyHandles });
+        wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+        let start = process.hrtime.bigint();
+        for (let i = 0; i < kRuns; ++i) {
+            wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', kProperties);
+        }
+        return Number(process.hrtime.bigint() - start) / (kRuns * kRows);
+    }
+
+    let before = standIn.propertyHandleStats();
+    let handleCost = measure(true);
+    let delta = statsDelta(before);
+    let hitRate = delta.hits / (delta.hits + delta.misses);
+    let namedCost = measure(false);
+
+    // Every query after the first reuses the schema
+    assert.ok(hitRate >= kRuns / (kRuns + 1), `hit rate ${hitRate}`);
+    console.log(`  ${handleCost.toFixed(0)}ns per row with handles (hit rate ${(hitRate * 100).toFixed(0)}%), ` +
+        `${namedCost.toFixed(0)}ns per row by name`);
+
+    standIn.enable();
+    console.log("perRowCostTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        console.log('Property handle tests need the stand-in provider of the unsupported OS build, skipping.');
+        return;
+    }
+
+    sameResultsTest();
+    reuseHandlesTest();
+    await sharedAcrossQueryKindsTest();
+    invalidationTest();
+    perRowCostTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
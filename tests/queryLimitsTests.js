@@ -0,0 +1,192 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in hands out instances through the same enumeration loop as WMI, with scripted delays
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT Caption FROM StandIn_Limited';
+
+// Set for a second run in which errors after connecting are reported like the WMI build does
+let maskRejectedQueries = false;
+
+function enableStandIn(options) {
+    standIn.enable(Object.assign({ maskRejectedQueries: maskRejectedQueries }, options));
+}
+
+function adaptiveBatchSizeTest() {
+    // Fast calls that return everything asked for double the batch size, up to 256
+    enableStandIn({ rowCount: 2000, nextLatencyMs: 1 });
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', kQuery, ['Caption'])).length, 2000);
+    let counts = standIn.lastExecQuery().nextCounts;
+    assert.deepStrictEqual(counts.slice(0, 6), [10, 20, 40, 80, 160, 256]);
+    assert.ok(counts.length < 15);
+
+    // Slow calls get fewer instances
+    enableStandIn({ rowCount: 40, rowLatencyMs: 10 });
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', kQuery, ['Caption'])).length, 40);
+    counts = standIn.lastExecQuery().nextCounts;
+    assert.strictEqual(counts[0], 10);
+    assert.ok(counts[1] < 10);
+    console.log("adaptiveBatchSizeTest() complete");
+}
+
+async function timeoutTest() {
+    // A hung provider returns what it produced until the deadline
+    enableStandIn({ rowCount: 100, hangAfterRows: 15 });
+    let started = Date.now();
+    let result = wmi.query('root/cimv2', kQuery, ['Caption'], { timeoutMs: 200 });
+    let elapsed = Date.now() - started;
+    assert.strictEqual(Object.keys(result).length, 15);
+    assert.strictEqual(result.truncated, 'timeout');
+    assert.ok(!Object.keys(result).includes('truncated'));
+    assert.ok(elapsed >= 190 && elapsed < 2000, `took ${elapsed}ms`);
+
+    result = await wmi.queryAsync('root/cimv2', kQuery, ['Caption'], { timeoutMs: 100, format: 'columnar' });
+    assert.strictEqual(result.rows, 15);
+    assert.strictEqual(result.truncated, 'timeout');
+
+    // Slow instances keep arriving until the deadline
+    enableStandIn({ rowCount: 100, rowLatencyMs: 20 });
+    result = wmi.query('root/cimv2', kQuery, ['Caption'], { timeoutMs: 150 });
+    assert.strictEqual(result.truncated, 'timeout');
+    assert.ok(Object.keys(result).length > 0 && Object.keys(result).length < 10);
+
+    // Queries that finish in time are complete
+    enableStandIn({ rowCount: 4 });
+    result = wmi.query('root/cimv2', kQuery, ['Caption'], { timeoutMs: 1000 });
+    assert.strictEqual(Object.keys(result).length, 4);
+    assert.strictEqual(result.truncated, undefined);
+    console.log("timeoutTest() complete");
+}
+
+async function maxRowsTest() {
+    enableStandIn({ rowCount: 100 });
+    let result = wmi.query('root/cimv2', kQuery, ['Caption'], { maxRows: 25 });
+    assert.strictEqual(Object.keys(result).length, 25);
+    assert.strictEqual(result.truncated, 'maxRows');
+    // Next isn't asked for more than the limit leaves
+    assert.deepStrictEqual(standIn.lastExecQuery().nextCounts, [10, 15]);
+
+    // A limit the query doesn't reach leaves the results complete
+    result = wmi.query('root/cimv2', kQuery, ['Caption'], { maxRows: 1000 });
+    assert.strictEqual(Object.keys(result).length, 100);
+    assert.strictEqual(result.truncated, undefined);
+
+    let [outcome] = await wmi.queryMany([{ namespace: 'root/cimv2', query: kQuery, properties: ['Caption'], options: { maxRows: 3 } }]);
+    assert.strictEqual(outcome.value.truncated, 'maxRows');
+    assert.strictEqual(Object.keys(outcome.value).length, 3);
+
+    // A stream ends at the limit
+    let rows = 0;
+    let stream = wmi.queryStream('root/cimv2', kQuery, ['Caption'], { maxRows: 33, batchSize: 10 });
+    let next;
+    while (!(next = await stream.next()).done) {
+        rows += next.value.length;
+    }
+    assert.strictEqual(rows, 33);
+    assert.strictEqual(next.truncated, 'maxRows');
+    console.log("maxRowsTest() complete");
+}
+
+function maxBytesTest() {
+    enableStandIn({ rowCount: 100 });
+    // Descriptions are over 2048 characters, so a few instances fill 10000 bytes
+    let result = wmi.query('root/cimv2', kQuery, ['Description'], { maxBytes: 10000, timings: true });
+    let rows = Object.keys(result).length;
+    assert.strictEqual(result.truncated, 'maxBytes');
+    assert.ok(rows > 0 && rows < 100);
+    assert.ok(result.timings.bytes >= 10000);
+
+    let single = wmi.query('root/cimv2', kQuery, ['Description'], { maxRows: 1, timings: true });
+    assert.ok(result.timings.bytes < 10000 + single.timings.bytes);
+    console.log("maxBytesTest() complete");
+}
+
+function cacheTest() {
+    enableStandIn({ rowCount: 100 });
+    let queries = standIn.queryCount();
+
+    // Results cut short are never cached
+    wmi.query('root/cimv2', kQuery, ['Caption'], { maxRows: 5, cacheTtlMs: 1000 });
+    let result = wmi.query('root/cimv2', kQuery, ['Caption'], { maxRows: 5, cacheTtlMs: 1000 });
+    assert.strictEqual(result.truncated, 'maxRows');
+    assert.strictEqual(standIn.queryCount() - queries, 2);
+
+    // and complete results aren't served to queries with a limit
+    wmi.query('root/cimv2', kQuery, ['Caption'], { cacheTtlMs: 1000 });
+    result = wmi.query('root/cimv2', kQuery, ['Caption'], { maxRows: 5, cacheTtlMs: 1000 });
+    assert.strictEqual(Object.keys(result).length, 5);
+    assert.strictEqual(standIn.queryCount() - queries, 4);
+    wmi.query('root/cimv2', kQuery, ['Caption'], { cacheTtlMs: 1000 });
+    assert.strictEqual(standIn.queryCount() - queries, 4);
+
+    wmi.invalidateCache();
+    console.log("cacheTest() complete");
+}
+
+function badArgumentsTest_Exceptions() {
+    for (let options of [{ timeoutMs: -1 }, { timeoutMs: '10' }, { timeoutMs: 4294967295 }, { maxRows: -5 }, { maxBytes: true }, { maxRows: 2 ** 54 }]) {
+        assert.throws(() => wmi.query('root/cimv2', kQuery, ['Caption'], options), Error);
+    }
+    console.log("badArgumentsTest_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function windowsLimitsTest() {
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Process', ['Name'], { maxRows: 2 });
+    assert.strictEqual(Object.keys(result).length, 2);
+    assert.strictEqual(result.truncated, 'maxRows');
+
+    result = await wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Process', ['Name'], { timeoutMs: 60000 });
+    assert.ok(Object.keys(result).length > 2);
+    console.log("windowsLimitsTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        await windowsLimitsTest();
+        badArgumentsTest_Exceptions();
+        return;
+    }
+
+    for (let mask of [false, true]) {
+        maskRejectedQueries = mask;
+        adaptiveBatchSizeTest();
+        await timeoutTest();
+        await maxRowsTest();
+        maxBytesTest();
+        cacheTest();
+    }
+    badArgumentsTest_Exceptions();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,144 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+const standIn = wmi.standIn;
+
+const kNamespaces = ['root/cimv2', 'root/wmi', 'root/microsoft/windows/storage'];
+
+function getRequests(count) {
+    let requests = [];
+    for (let i = 0; i < count; ++i) {
+        requests.push({ namespace: kNamespaces[i % kNamespaces.length], query: `SELECT * FROM Class${i}`, properties: ['Name'] });
+    }
+    return requests;
+}
+
+async function sameResultsTest() {
+    let requests = getRequests(6);
+    requests.push({ namespace: 'root/cimv2', query: 'SELECT * FROM Win32_Processor', properties: ['Count'], options: { typed: true } });
+    requests.push({ namespace: 'root/cimv2', query: 'SELECT * FROM Win32_Processor', properties: ['Count'], options: { typed: true, format: 'columnar' } });
+
+    let settled = await wmi.queryMany(requests);
+    assert.strictEqual(settled.length, requests.length);
+
+    // Results come back in request order, exactly as the single query methods return them
+    for (let i = 0; i < requests.length; ++i) {
+        let request = requests[i];
+        assert.strictEqual(settled[i].status, 'fulfilled');
+        assert.deepStrictEqual(settled[i].value, wmi.query(request.namespace, request.query, request.properties, request.options));
+    }
+    assert.strictEqual(settled[0].value['0'].Name, 'Class0.Name.0');
+    assert.strictEqual(settled[7].value.rows, 4);
+
+    assert.deepStrictEqual(await wmi.queryMany([]), []);
+    console.log("sameResultsTest() complete");
+}
+
+async function perRequestErrorsTest() {
+    let requests = [
+        { namespace: 'root/cimv2', query: 'SELECT * FROM Win32_BIOS' },
+        { namespace: 'invalid', query: 'SELECT * FROM Win32_BIOS' },
+        { namespace: 'root/cimv2', query: 42 },
+        { namespace: 'root/cimv2', query: 'SELECT * FROM Win32_BIOS', properties: [1] },
+        { namespace: 'root/cimv2', query: 'SELECT * FROM Win32_BIOS', options: { format: 'table' } },
+        'SELECT * FROM Win32_BIOS',
+        { namespace: 'root/wmi', query: 'SELECT * FROM WmiMonitorID' },
+    ];
+
+    // Bad requests are rejected on their own, the rest of the batch still runs
+    let settled = await wmi.queryMany(requests);
+    assert.deepStrictEqual(settled.map(outcome => outcome.status),
+        ['fulfilled', 'rejected', 'rejected', 'rejected', 'rejected', 'rejected', 'fulfilled']);
+    assert.strictEqual(settled[1].reason.message, 'Unsupported Namespace');
+    assert.ok(settled[2].reason instanceof Error);
+    assert.strictEqual(settled[6].value['0'].Name, 'WmiMonitorID.Name.0');
+
+    await assert.rejects(wmi.queryMany(), Error);
+    await assert.rejects(wmi.queryMany('SELECT * FROM Win32_BIOS'), Error);
+    await assert.rejects(wmi.queryMany([], { concurrency: 0 }), Error);
+    await assert.rejects(wmi.queryMany([], { concurrency: 65 }), Error);
+    console.log("perRequestErrorsTest() complete");
+}
+
+async function concurrencyTest() {
+    const kLatencyMs = 100;
+    const kQueries = 8;
+    standIn.enable({ latencyMs: kLatencyMs });
+    await wmi.queryMany(kNamespaces.map(namespace => ({ namespace: namespace, query: 'SELECT * FROM Warmup' })));
+
+    let start = Date.now();
+    await wmi.queryMany(getRequests(kQueries), { concurrency: 1 });
+    let sequential = Date.now() - start;
+
+    start = Date.now();
+    await wmi.queryMany(getRequests(kQueries), { concurrency: kQueries });
+    let parallel = Date.now() - start;
+
+    assert.ok(sequential >= kQueries * kLatencyMs, `${sequential}ms for ${kQueries} queries one at a time`);
+    assert.ok(parallel < kQueries * kLatencyMs / 2, `${parallel}ms for ${kQueries} queries at once`);
+
+    standIn.enable();
+    console.log("concurrencyTest() complete");
+}
+
+async function sharedConnectionTest() {
+    standIn.enable({ connectLatencyMs: 50 });
+    wmi.close();
+    let before = standIn.connectionStats();
+
+    let settled = await wmi.queryMany(getRequests(12), { concurrency: 12 });
+    assert.ok(settled.every(outcome => outcome.status === 'fulfilled'));
+
+    // One connection per namespace, the first query of each namespace opens it for the others
+    let after = standIn.connectionStats();
+    assert.strictEqual(after.connects - before.connects, kNamespaces.length);
+    assert.strictEqual(after.openConnections, kNamespaces.length);
+
+    standIn.enable();
+    console.log("sharedConnectionTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        console.log('queryMany tests need the stand-in provider of the unsupported OS build, skipping.');
+        return;
+    }
+
+    standIn.enable();
+    await sameResultsTest();
+    await perRequestErrorsTest();
+    await concurrencyTest();
+    await sharedConnectionTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
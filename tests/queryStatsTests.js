@@ -0,0 +1,148 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Row counts and cache hits are only predictable with the stand-in provider of the unsupported OS build
+const standIn = wmi.standIn;
+
+const kStages = ['queue', 'connect', 'exec', 'next', 'read', 'marshal', 'total'];
+
+function findStats(className) {
+    return wmi.getStats().find(entry => entry.className.toLowerCase() === className.toLowerCase());
+}
+
+async function stagesRecordedTest() {
+    wmi.resetStats();
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Name']);
+    await wmi.queryAsync('ROOT/CIMV2', 'select Name from win32_processor');
+    await wmi.queryMany([{ namespace: 'root/cimv2', query: 'SELECT * FROM Win32_Processor', options: { format: 'columnar' } }]);
+
+    // Namespace and class case don't split the statistics
+    let stats = wmi.getStats();
+    assert.strictEqual(stats.length, 1);
+    let entry = stats[0];
+    assert.strictEqual(entry.namespace, 'root/cimv2');
+    assert.strictEqual(entry.className, 'Win32_Processor');
+    assert.strictEqual(entry.queries, 3);
+    assert.strictEqual(entry.failures, 0);
+    assert.deepStrictEqual(entry.errors, {});
+    assert.ok(entry.rows > 0);
+    assert.ok(entry.bytes > 0);
+
+    for (let stage of kStages) {
+        let summary = entry.stages[stage];
+        assert.ok(summary, `${stage} stage missing`);
+        assert.strictEqual(summary.count, 3);
+        assert.ok(summary.p50Ms <= summary.p90Ms && summary.p90Ms <= summary.p99Ms && summary.p99Ms <= summary.maxMs);
+        assert.ok(summary.totalMs >= summary.maxMs);
+    }
+    console.log("stagesRecordedTest() complete");
+}
+
+function timingsOptionTest() {
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Name'], { timings: true });
+    let timings = result.timings;
+    assert.ok(timings);
+    for (let stage of kStages) {
+        assert.strictEqual(typeof timings[`${stage}Ms`], 'number');
+    }
+    assert.ok(timings.totalMs >= timings.readMs);
+    assert.strictEqual(timings.rows, Object.keys(result).length);
+    assert.strictEqual(timings.cached, false);
+
+    // The breakdown doesn't show up as a result
+    assert.ok(!Object.keys(result).includes('timings'));
+    assert.strictEqual(JSON.stringify(result), JSON.stringify(wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Name'])));
+    assert.strictEqual(wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', ['Name']).timings, undefined);
+    console.log("timingsOptionTest() complete");
+}
+
+async function cacheHitsTest() {
+    wmi.resetStats();
+    const options = { cacheTtlMs: 60000, timings: true };
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_BIOS', undefined, options);
+    let cached = await wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_BIOS', undefined, options);
+    assert.strictEqual(cached.timings.cached, true);
+    assert.strictEqual(cached.timings.execMs, 0);
+
+    let entry = findStats('Win32_BIOS');
+    assert.strictEqual(entry.queries, 2);
+    assert.strictEqual(entry.cacheHits, 1);
+    assert.strictEqual(entry.stages.exec.count, 1);
+    assert.strictEqual(entry.stages.total.count, 2);
+    wmi.invalidateCache();
+    console.log("cacheHitsTest() complete");
+}
+
+function configureStatsTest() {
+    wmi.resetStats();
+    assert.deepStrictEqual(wmi.getStats(), []);
+
+    wmi.configureStats({ enabled: false });
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    assert.deepStrictEqual(wmi.getStats(), []);
+
+    // Timings asked for by the caller are still measured, just not recorded
+    let result = wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { timings: true });
+    assert.ok(result.timings.totalMs >= 0);
+    assert.deepStrictEqual(wmi.getStats(), []);
+
+    wmi.configureStats({ enabled: true });
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    assert.strictEqual(findStats('Win32_Processor').queries, 1);
+    console.log("configureStatsTest() complete");
+}
+
+async function badInputStatsTests_Exceptions() {
+    assert.throws(() => wmi.configureStats(), Error);
+    assert.throws(() => wmi.configureStats(true), Error);
+    assert.throws(() => wmi.configureStats({ enabled: 'yes' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { timings: 1 }), Error);
+    await assert.rejects(wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { timings: 'yes' }), Error);
+    console.log("badInputStatsTests_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+    await stagesRecordedTest();
+    timingsOptionTest();
+    if (standIn) {
+        await cacheHitsTest();
+    }
+    configureStatsTest();
+    await badInputStatsTests_Exceptions();
+    wmi.resetStats();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
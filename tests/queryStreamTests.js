@@ -0,0 +1,171 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the queries go to WMI
+const standIn = wmi.standIn;
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function streamMatchesQueryTest() {
+    const properties = ['DeviceID', 'Caption'];
+    const query = `SELECT ${properties.join(',')} FROM Win32_Processor`;
+
+    let expected = Object.values(wmi.query('root/cimv2', query, properties));
+    let rows = [];
+    for await (let batch of wmi.queryStream('root/cimv2', query, properties, { batchSize: 1 })) {
+        assert.ok(Array.isArray(batch));
+        assert.strictEqual(batch.length, 1);
+        rows.push(...batch);
+    }
+    assert.deepStrictEqual(rows, expected);
+    console.log("streamMatchesQueryTest() complete");
+}
+
+async function badInputStreamTests_Exceptions() {
+    let goodnamespace = 'root/cimv2';
+    let goodQuery = 'SELECT * FROM Win32_Processor';
+
+    assert.throws(() => wmi.queryStream(123, goodQuery), Error);
+    assert.throws(() => wmi.queryStream('invalid', goodQuery), Error);
+    assert.throws(() => wmi.queryStream(goodnamespace, goodQuery, [123]), Error);
+    assert.throws(() => wmi.queryStream(goodnamespace, goodQuery, undefined, 123), Error);
+    assert.throws(() => wmi.queryStream(goodnamespace, goodQuery, undefined, { batchSize: 0 }), Error);
+    assert.throws(() => wmi.queryStream(goodnamespace, goodQuery, undefined, { maxBufferedBatches: 'many' }), Error);
+    console.log("badInputStreamTests_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function millionsOfRowsTest() {
+    const kRowCount = 2000000;
+    const kBatchSize = 10000;
+    standIn.enable({ rowCount: kRowCount });
+
+    let rssBefore = process.memoryUsage().rss;
+    let peakRss = rssBefore;
+    let rowCount = 0;
+    let batchCount = 0;
+    let lastName;
+    for await (let batch of wmi.queryStream('root/cimv2', 'SELECT Name FROM StandIn_Large', ['Name'], { batchSize: kBatchSize })) {
+        assert.ok(batch.length <= kBatchSize);
+        rowCount += batch.length;
+        batchCount++;
+        lastName = batch[batch.length - 1].Name;
+        peakRss = Math.max(peakRss, process.memoryUsage().rss);
+    }
+
+    assert.strictEqual(rowCount, kRowCount);
+    assert.strictEqual(batchCount, kRowCount / kBatchSize);
+    assert.strictEqual(lastName, `StandIn_Large.Name.${kRowCount - 1}`);
+    console.log(`millionsOfRowsTest() complete, peak RSS grew by ${Math.round((peakRss - rssBefore) / 1024 / 1024)}MB`);
+}
+
+async function backpressureTest() {
+    const kBatchSize = 100;
+    const kMaxBufferedBatches = 2;
+    standIn.enable({ rowCount: 1000000 });
+
+    let stream = wmi.queryStream('root/cimv2', 'SELECT Name FROM StandIn_Large', ['Name'],
+        { batchSize: kBatchSize, maxBufferedBatches: kMaxBufferedBatches });
+    let generatedBefore = standIn.generatedRows();
+
+    let first = await stream.next();
+    assert.strictEqual(first.done, false);
+    assert.strictEqual(first.value.length, kBatchSize);
+
+    // A consumer that stops pulling pauses the enumeration: at most the buffered batches,
+    // the batch waiting to be buffered and the batch that was consumed have been produced
+    await sleep(200);
+    let generated = standIn.generatedRows() - generatedBefore;
+    assert.ok(generated <= (kMaxBufferedBatches + 2) * kBatchSize, `${generated} rows produced ahead of the consumer`);
+
+    // Resuming continues where the query left off
+    let second = await stream.next();
+    assert.strictEqual(second.value[0].Name, `StandIn_Large.Name.${kBatchSize}`);
+
+    // Closing the iterator stops the query
+    let closed = await stream.return();
+    assert.strictEqual(closed.done, true);
+    await sleep(50);
+    let stoppedAt = standIn.generatedRows();
+    await sleep(100);
+    assert.strictEqual(standIn.generatedRows(), stoppedAt);
+    assert.strictEqual((await stream.next()).done, true);
+    console.log("backpressureTest() complete");
+}
+
+async function breakStopsQueryTest() {
+    standIn.enable({ rowCount: 1000000 });
+
+    let generatedBefore = standIn.generatedRows();
+    let batches = 0;
+    for await (let batch of wmi.queryStream('root/cimv2', 'SELECT Name FROM StandIn_Large', ['Name'], { batchSize: 1000 })) {
+        if (++batches === 3) {
+            break;
+        }
+    }
+    await sleep(100);
+    let generated = standIn.generatedRows() - generatedBefore;
+    assert.ok(generated < 10 * 1000, `${generated} rows produced after break`);
+    console.log("breakStopsQueryTest() complete");
+}
+
+async function concurrentNextTest() {
+    standIn.enable({ rowCount: 10 });
+
+    // next() calls that overlap are settled in order
+    let stream = wmi.queryStream('root/cimv2', 'SELECT Name FROM StandIn_Small', ['Name'], { batchSize: 4 });
+    let results = await Promise.all([stream.next(), stream.next(), stream.next(), stream.next()]);
+    assert.deepStrictEqual(results.map(r => r.done), [false, false, false, true]);
+    assert.deepStrictEqual(results.map(r => r.value ? r.value.length : 0), [4, 4, 2, 0]);
+    assert.strictEqual(results[2].value[1].Name, 'StandIn_Small.Name.9');
+    console.log("concurrentNextTest() complete");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+
+    await streamMatchesQueryTest();
+    await badInputStreamTests_Exceptions();
+
+    if (standIn) {
+        await millionsOfRowsTest();
+        await backpressureTest();
+        await breakStopsQueryTest();
+        await concurrentNextTest();
+    }
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
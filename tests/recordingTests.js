@@ -0,0 +1,230 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Replays don't need the stand-in provider, recordings made with it replay after it was disabled
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT * FROM StandIn_Recorded';
+const kTypedProperties = ['Caption', 'Level', 'Total', 'InstallDate', 'Label', 'Samples'];
+const kTypedOptions = { typed: true, int64: 'bigint' };
+const kRecordingPath = path.join(os.tmpdir(), `wmi-recording-${process.pid}.bin`);
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function collectStream(query, properties, options) {
+    let rows = [];
+    for await (let batch of wmi.queryStream('root/cimv2', query, properties, options)) {
+        rows.push(...batch);
+    }
+    return rows;
+}
+
+async function recordReplayTest() {
+    standIn.enable({ rowCount: 50, propertyCount: 12 });
+    wmi.startRecording();
+    let plain = wmi.query('root/cimv2', kQuery);
+    let typed = await wmi.queryAsync('root/cimv2', kQuery, kTypedProperties, kTypedOptions);
+    let streamed = await collectStream('SELECT Caption FROM StandIn_Streamed', ['Caption'], { batchSize: 8 });
+    let stats = wmi.stopRecording(kRecordingPath);
+    assert.strictEqual(stats.entries, 3);
+    assert.strictEqual(stats.bytes, fs.statSync(kRecordingPath).size);
+
+    // Nothing answers these queries but the recording
+    standIn.disable();
+    assert.throws(() => wmi.query('root/cimv2', kQuery), /not supported/);
+    assert.deepStrictEqual(wmi.startReplay(kRecordingPath), { entries: 3 });
+    assert.deepStrictEqual(wmi.query('root/cimv2', kQuery), plain);
+    assert.deepStrictEqual(wmi.query('ROOT/CIMV2', 'select  *  from standin_recorded'), plain);
+    assert.deepStrictEqual(await wmi.queryAsync('root/cimv2', kQuery, kTypedProperties, kTypedOptions), typed);
+    assert.strictEqual(typed[0].Label, 'Gerät 設定 \u{1F4A1} 0');
+    assert.deepStrictEqual(await collectStream('SELECT Caption FROM StandIn_Streamed', ['Caption'], { batchSize: 7 }), streamed);
+
+    // Results are shaped after the recording was read like any other results
+    let columns = wmi.query('root/cimv2', kQuery, undefined, { format: 'columnar' });
+    assert.strictEqual(columns.Property3[49], plain[49].Property3);
+
+    // Only the queries recorded replay, with the settings they were recorded with
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT * FROM StandIn_Other'), /not in the replayed recording/);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kTypedProperties), /not in the replayed recording/);
+    assert.throws(() => wmi.subscribe('root/cimv2', 'SELECT * FROM __InstanceCreationEvent WITHIN 1', () => { }), Error);
+
+    wmi.stopReplay();
+    assert.throws(() => wmi.query('root/cimv2', kQuery), /not supported/);
+    console.log("recordReplayTest() complete");
+}
+
+async function latencyTest() {
+    wmi.startReplay(kRecordingPath, { latencyMs: 100 });
+    let started = Date.now();
+    await wmi.queryAsync('root/cimv2', kQuery);
+    assert.ok(Date.now() - started >= 90);
+
+    let timings = wmi.query('root/cimv2', kQuery, undefined, { timings: true }).timings;
+    assert.ok(timings.execMs >= 90, `exec took ${timings.execMs}ms`);
+
+    // A timeout shorter than the latency ends the query like a slow WMI query
+    let timedOut = wmi.query('root/cimv2', kQuery, undefined, { timeoutMs: 20 });
+    assert.strictEqual(timedOut.truncated, 'timeout');
+    assert.strictEqual(Object.keys(timedOut).length, 0);
+
+    let controller = new AbortController();
+    let aborted = wmi.queryAsync('root/cimv2', kQuery, undefined, { signal: controller.signal });
+    await sleep(20);
+    controller.abort();
+    await assert.rejects(aborted, { name: 'AbortError' });
+    wmi.stopReplay();
+    console.log("latencyTest() complete");
+}
+
+function fallbackTest() {
+    standIn.enable({ rowCount: 50, propertyCount: 12 });
+    let live = wmi.query('root/cimv2', kQuery);
+    wmi.startReplay(kRecordingPath, { fallback: true });
+
+    let queries = standIn.queryCount();
+    assert.deepStrictEqual(wmi.query('root/cimv2', kQuery), live);
+    assert.strictEqual(standIn.queryCount(), queries);
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', 'SELECT * FROM StandIn_Other')).length, 50);
+    assert.strictEqual(standIn.queryCount(), queries + 1);
+
+    // Recording while replaying keeps both kinds of results
+    wmi.startRecording();
+    wmi.query('root/cimv2', kQuery);
+    wmi.query('root/cimv2', 'SELECT * FROM StandIn_Other');
+    let merged = path.join(os.tmpdir(), `wmi-recording-merged-${process.pid}.bin`);
+    assert.strictEqual(wmi.stopRecording(merged).entries, 2);
+    wmi.stopReplay();
+    fs.unlinkSync(merged);
+    console.log("fallbackTest() complete");
+}
+
+function cacheTest() {
+    // Live results cached before the replay must not answer for the recording
+    standIn.enable({ rowCount: 5, propertyCount: 12 });
+    wmi.query('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000 });
+    wmi.startReplay(kRecordingPath);
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000 })).length, 50);
+    wmi.stopReplay();
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000 })).length, 5);
+    console.log("cacheTest() complete");
+}
+
+async function rejectedQueryTest() {
+    // A query WMI rejects returns no results, the recording keeps the error that rejected it instead
+    standIn.enable({ missingProperties: ['Caption'], maskRejectedQueries: true });
+    wmi.startRecording();
+    assert.deepStrictEqual(wmi.query('root/cimv2', 'SELECT Caption FROM StandIn_Rejected'), {});
+    assert.deepStrictEqual(await collectStream('SELECT Caption FROM StandIn_RejectedStream'), []);
+    let rejected = path.join(os.tmpdir(), `wmi-recording-rejected-${process.pid}.bin`);
+    assert.strictEqual(wmi.stopRecording(rejected).entries, 2);
+
+    standIn.disable();
+    wmi.startReplay(rejected);
+    const kRejectedError = new RegExp(`error code: ${0x80041017 | 0}`);
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT Caption FROM StandIn_Rejected'), kRejectedError);
+    await assert.rejects(collectStream('SELECT Caption FROM StandIn_RejectedStream'), kRejectedError);
+    wmi.stopReplay();
+    fs.unlinkSync(rejected);
+    console.log("rejectedQueryTest() complete");
+}
+
+function badRecordingTests_Exceptions() {
+    let missing = path.join(os.tmpdir(), `wmi-recording-missing-${process.pid}.bin`);
+    assert.throws(() => wmi.startReplay(missing), /Could not open the recording/);
+
+    let corrupt = path.join(os.tmpdir(), `wmi-recording-corrupt-${process.pid}.bin`);
+    fs.writeFileSync(corrupt, 'not a recording');
+    assert.throws(() => wmi.startReplay(corrupt), /Not a valid recording/);
+    let recording = fs.readFileSync(kRecordingPath);
+    fs.writeFileSync(corrupt, recording.subarray(0, recording.length - 10));
+    assert.throws(() => wmi.startReplay(corrupt), /Not a valid recording/);
+    fs.unlinkSync(corrupt);
+    assert.strictEqual(wmi.stopReplay(), undefined);
+    console.log("badRecordingTests_Exceptions() complete");
+}
+
+function badInputTests_Exceptions() {
+    assert.throws(() => wmi.stopRecording(kRecordingPath), /Recording was not started/);
+    assert.throws(() => wmi.startRecording('path'), Error);
+    assert.throws(() => wmi.stopRecording(), Error);
+    assert.throws(() => wmi.stopRecording(123), Error);
+    assert.throws(() => wmi.startReplay(), Error);
+    assert.throws(() => wmi.startReplay(123), Error);
+    assert.throws(() => wmi.startReplay(kRecordingPath, 123), Error);
+    assert.throws(() => wmi.startReplay(kRecordingPath, { latencyMs: -1 }), Error);
+    assert.throws(() => wmi.startReplay(kRecordingPath, { latencyMs: 'slow' }), Error);
+    assert.throws(() => wmi.startReplay(kRecordingPath, { fallback: 'yes' }), Error);
+    assert.throws(() => wmi.stopReplay(true), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+function windowsRecordingTest() {
+    const query = 'SELECT Caption, BuildNumber FROM Win32_OperatingSystem';
+    wmi.startRecording();
+    let live = wmi.query('root/cimv2', query, ['Caption', 'BuildNumber']);
+    assert.strictEqual(wmi.stopRecording(kRecordingPath).entries, 1);
+
+    wmi.startReplay(kRecordingPath);
+    assert.deepStrictEqual(wmi.query('root/cimv2', query, ['Caption', 'BuildNumber']), live);
+    wmi.stopReplay();
+    console.log("windowsRecordingTest() complete");
+}
+
+async function runTests() {
+    badInputTests_Exceptions();
+
+    try {
+        if (!standIn) {
+            windowsRecordingTest();
+            return;
+        }
+
+        await recordReplayTest();
+        await latencyTest();
+        fallbackTest();
+        cacheTest();
+        await rejectedQueryTest();
+        badRecordingTests_Exceptions();
+    } finally {
+        if (fs.existsSync(kRecordingPath)) {
+            fs.unlinkSync(kRecordingPath);
+        }
+    }
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,265 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Executions are counted by the stand-in provider, TTLs run on its clock
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT * FROM Win32_BIOS';
+
+function statsDelta(before) {
+    let after = wmi.cacheStats();
+    let delta = {};
+    for (let key of Object.keys(after)) {
+        delta[key] = after[key] - before[key];
+    }
+    delta.entries = after.entries;
+    delta.bytes = after.bytes;
+    return delta;
+}
+
+function uncachedByDefaultTest() {
+    let queries = standIn.queryCount();
+    wmi.query('root/cimv2', kQuery);
+    wmi.query('root/cimv2', kQuery);
+    assert.strictEqual(standIn.queryCount() - queries, 2);
+    console.log("uncachedByDefaultTest() complete");
+}
+
+function perCallTtlTest() {
+    let before = wmi.cacheStats();
+    let queries = standIn.queryCount();
+
+    let first = wmi.query('root/cimv2', kQuery, ['Name'], { cacheTtlMs: 1000 });
+    // Namespace case and query whitespace don't matter
+    let second = wmi.query('ROOT/CIMV2', 'select *  from\tWin32_BIOS', ['Name'], { cacheTtlMs: 1000 });
+    assert.deepStrictEqual(second, first);
+    assert.strictEqual(standIn.queryCount() - queries, 1);
+
+    // Different properties or value settings are different results
+    wmi.query('root/cimv2', kQuery, ['Version'], { cacheTtlMs: 1000 });
+    wmi.query('root/cimv2', kQuery, ['Name'], { cacheTtlMs: 1000, typed: true });
+    assert.strictEqual(standIn.queryCount() - queries, 3);
+
+    standIn.advanceClock(1000);
+    wmi.query('root/cimv2', kQuery, ['Name'], { cacheTtlMs: 1000 });
+    assert.strictEqual(standIn.queryCount() - queries, 4);
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.hits, 1);
+    assert.strictEqual(delta.misses, 4);
+    assert.strictEqual(delta.expirations, 1);
+
+    // A shorter TTL doesn't accept results cached for longer
+    standIn.advanceClock(500);
+    wmi.query('root/cimv2', kQuery, ['Name'], { cacheTtlMs: 100 });
+    assert.strictEqual(standIn.queryCount() - queries, 5);
+
+    // And 0 always runs the query
+    wmi.query('root/cimv2', kQuery, ['Name'], { cacheTtlMs: 0 });
+    assert.strictEqual(standIn.queryCount() - queries, 6);
+
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, { cacheTtlMs: -1 }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, undefined, { cacheTtlMs: '1000' }), Error);
+    wmi.invalidateCache();
+    console.log("perCallTtlTest() complete");
+}
+
+function classTtlTest() {
+    wmi.configureCache({ classTtlMs: { Win32_Processor: 5000 } });
+    let queries = standIn.queryCount();
+
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    wmi.query('root/cimv2', 'SELECT * FROM win32_processor');
+    wmi.query('root/cimv2', kQuery);
+    wmi.query('root/cimv2', kQuery);
+    assert.strictEqual(standIn.queryCount() - queries, 3);
+
+    // A per call TTL takes precedence over the class TTL
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { cacheTtlMs: 0 });
+    assert.strictEqual(standIn.queryCount() - queries, 4);
+
+    wmi.configureCache({ classTtlMs: { Win32_Processor: 0 } });
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor');
+    assert.strictEqual(standIn.queryCount() - queries, 5);
+
+    assert.throws(() => wmi.configureCache({ classTtlMs: { Win32_Processor: -5 } }), Error);
+    assert.throws(() => wmi.configureCache(), Error);
+    wmi.invalidateCache();
+    console.log("classTtlTest() complete");
+}
+
+function invalidationTest() {
+    const options = { cacheTtlMs: 60000 };
+    wmi.query('root/cimv2', kQuery, undefined, options);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, options);
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID', undefined, options);
+    let before = wmi.cacheStats();
+    let queries = standIn.queryCount();
+
+    wmi.invalidateCache('ROOT/CIMV2', 'win32_bios');
+    assert.strictEqual(statsDelta(before).invalidations, 1);
+    wmi.invalidateCache('root/wmi');
+    assert.strictEqual(statsDelta(before).invalidations, 2);
+
+    wmi.query('root/cimv2', kQuery, undefined, options);
+    wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, options);
+    wmi.query('root/wmi', 'SELECT * FROM WmiMonitorID', undefined, options);
+    assert.strictEqual(standIn.queryCount() - queries, 2);
+
+    wmi.invalidateCache();
+    assert.strictEqual(wmi.cacheStats().entries, 0);
+    assert.strictEqual(wmi.cacheStats().bytes, 0);
+    assert.throws(() => wmi.invalidateCache(42), Error);
+    console.log("invalidationTest() complete");
+}
+
+function byteLimitTest() {
+    const options = { cacheTtlMs: 60000 };
+    wmi.query('root/cimv2', 'SELECT * FROM Class0', undefined, options);
+    let entryBytes = wmi.cacheStats().bytes;
+    wmi.configureCache({ maxBytes: entryBytes * 2 });
+    let before = wmi.cacheStats();
+
+    wmi.query('root/cimv2', 'SELECT * FROM Class1', undefined, options);
+    // Class0 was used more recently than Class1 and survives the eviction
+    wmi.query('root/cimv2', 'SELECT * FROM Class0', undefined, options);
+    wmi.query('root/cimv2', 'SELECT * FROM Class2', undefined, options);
+
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.evictions, 1);
+    assert.strictEqual(delta.entries, 2);
+    assert.ok(delta.bytes <= entryBytes * 2);
+
+    let queries = standIn.queryCount();
+    wmi.query('root/cimv2', 'SELECT * FROM Class0', undefined, options);
+    wmi.query('root/cimv2', 'SELECT * FROM Class1', undefined, options);
+    assert.strictEqual(standIn.queryCount() - queries, 1);
+
+    wmi.configureCache({ maxBytes: 16 * 1024 * 1024 });
+    wmi.invalidateCache();
+    console.log("byteLimitTest() complete");
+}
+
+async function coalesceInFlightTest() {
+    const kLatencyMs = 200;
+    standIn.enable({ latencyMs: kLatencyMs });
+    let before = wmi.cacheStats();
+    let queries = standIn.queryCount();
+
+    let pending = [];
+    for (let i = 0; i < 8; ++i) {
+        pending.push(wmi.queryAsync('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000 }));
+    }
+    let results = await Promise.all(pending);
+
+    // All of them were answered by a single execution
+    assert.strictEqual(standIn.queryCount() - queries, 1);
+    for (let result of results) {
+        assert.deepStrictEqual(result, results[0]);
+    }
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.misses, 1);
+    assert.strictEqual(delta.coalesced + delta.hits, 7);
+
+    standIn.enable();
+    wmi.invalidateCache();
+    console.log("coalesceInFlightTest() complete");
+}
+
+async function coalescedTimeoutTest() {
+    const kLatencyMs = 1000;
+    standIn.enable({ latencyMs: kLatencyMs });
+    let before = wmi.cacheStats();
+
+    // The timeout isn't part of the key, the second query waits for the first one only as long as it may
+    let started = Date.now();
+    let running = wmi.queryAsync('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000 });
+    await new Promise(resolve => setTimeout(resolve, 50));
+    let waiting = await wmi.queryAsync('root/cimv2', kQuery, undefined, { cacheTtlMs: 60000, timeoutMs: 100 });
+    assert.ok(Date.now() - started < kLatencyMs);
+    assert.strictEqual(waiting.truncated, 'timeout');
+    assert.deepStrictEqual(Object.keys(waiting), []);
+    assert.strictEqual(statsDelta(before).coalesced, 1);
+
+    let result = await running;
+    assert.strictEqual(result.truncated, undefined);
+    assert.ok(Object.keys(result).length > 0);
+
+    standIn.enable();
+    wmi.invalidateCache();
+    console.log("coalescedTimeoutTest() complete");
+}
+
+async function rejectedQueryTest() {
+    const kRejectedQuery = 'SELECT SerialNumber FROM Win32_BIOS';
+    standIn.enable({ missingProperties: ['SerialNumber'], maskRejectedQueries: true, latencyMs: 200 });
+    let entries = wmi.cacheStats().entries;
+    let queries = standIn.queryCount();
+
+    // A rejected query has no results to keep, neither for later queries nor for the ones waiting for it
+    let results = await Promise.all([
+        wmi.queryAsync('root/cimv2', kRejectedQuery, undefined, { cacheTtlMs: 60000 }),
+        wmi.queryAsync('root/cimv2', kRejectedQuery, undefined, { cacheTtlMs: 60000 })
+    ]);
+    assert.deepStrictEqual(results, [{}, {}]);
+    assert.strictEqual(standIn.queryCount() - queries, 2);
+    assert.strictEqual(wmi.cacheStats().entries, entries);
+
+    // Once it is accepted its results are cached
+    standIn.enable();
+    assert.ok(Object.keys(wmi.query('root/cimv2', kRejectedQuery, undefined, { cacheTtlMs: 60000 })).length > 0);
+    assert.strictEqual(standIn.queryCount() - queries, 3);
+    assert.strictEqual(wmi.cacheStats().entries, entries + 1);
+
+    wmi.invalidateCache();
+    console.log("rejectedQueryTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        console.log('Result cache tests need the stand-in provider of the unsupported OS build, skipping.');
+        return;
+    }
+
+    standIn.enable();
+    uncachedByDefaultTest();
+    perCallTtlTest();
+    classTtlTest();
+    invalidationTest();
+    byteLimitTest();
+    await coalesceInFlightTest();
+    await coalescedTimeoutTest();
+    await rejectedQueryTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,132 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Builds a ResultSet from the instances passed in and reads it back
+const standIn = wmi.standIn;
+
+function roundTripTest() {
+    const instances = [
+        { Name: 'System Idle Process', ProcessId: 0, Priority: 0, Ratio: 0.5, Enabled: true, Path: null },
+        { Name: '', ProcessId: 4, Priority: -8, Ratio: 1e300, Enabled: false, Path: 'C:\\Windows\\System32\\Système' },
+        { Name: 'svchost.exe', ProcessId: 2147483647, Priority: -2147483648, Ratio: -0.25, Enabled: true, Path: '\u{1F600}' },
+    ];
+    let set = standIn.resultSet(instances);
+    assert.deepStrictEqual(set.rows, instances);
+    assert.deepStrictEqual(set.marshalled, instances);
+    assert.strictEqual(set.schemaCount, 1);
+    assert.deepStrictEqual(set.schemaIndexes, [0, 0, 0]);
+
+    // 64 bit integers beyond the range of a Number keep their value
+    let wide = { Signed: -9007199254740993n, Unsigned: 18446744073709551615n };
+    assert.deepStrictEqual(standIn.resultSet([wide]).rows, [wide]);
+    console.log("roundTripTest() complete");
+}
+
+function arrayValuesTest() {
+    const instances = [
+        { Addresses: ['10.0.0.1', 'fe80::1', ''], Gateways: [], Metrics: [10, 0.5, 20n], Flags: [true, null] },
+        { Addresses: ['192.168.0.1'], Gateways: ['192.168.0.254'], Metrics: [], Flags: [] },
+    ];
+    let set = standIn.resultSet(instances);
+    assert.deepStrictEqual(set.rows, instances);
+    assert.deepStrictEqual(set.marshalled, instances);
+
+    // Numbers of a single width are marshalled into a TypedArray
+    let uniform = standIn.resultSet([{ Samples: [1, -2, 3], Sizes: [1n, 2n] }]);
+    assert.deepStrictEqual(uniform.rows, [{ Samples: Int32Array.from([1, -2, 3]), Sizes: BigInt64Array.from([1n, 2n]) }]);
+    assert.deepStrictEqual(uniform.marshalled, uniform.rows);
+    console.log("arrayValuesTest() complete");
+}
+
+function schemaTest() {
+    // Instances of different schemas can be interleaved, each schema is stored once
+    let set = standIn.resultSet([{ Name: 'a', Size: 1 }, { DeviceID: 'C:' }, { Name: 'b', Size: 2 }, {}, { DeviceID: 'D:' }]);
+    assert.strictEqual(set.schemaCount, 3);
+    assert.deepStrictEqual(set.schemaIndexes, [0, 1, 0, 2, 1]);
+    assert.deepStrictEqual(set.rows[3], {});
+    assert.deepStrictEqual(set.rows, set.marshalled);
+
+    // The order of the names is part of the schema
+    assert.strictEqual(standIn.resultSet([{ Name: 'a', Size: 1 }, { Size: 2, Name: 'b' }]).schemaCount, 2);
+
+    let empty = standIn.resultSet([]);
+    assert.deepStrictEqual(empty.rows, []);
+    assert.strictEqual(empty.schemaCount, 0);
+    console.log("schemaTest() complete");
+}
+
+function bytesTest() {
+    let instance = index => ({ Name: `Instance ${index}`, Caption: 'Caption'.repeat(20), Size: index });
+    let instances = count => Array.from({ length: count }, (unused, index) => instance(index));
+
+    let empty = standIn.resultSet([]);
+    assert.ok(empty.bytes > 0);
+
+    // Strings are counted by their characters, at least 2 bytes each
+    let short = standIn.resultSet([{ Caption: 'x' }]);
+    let long = standIn.resultSet([{ Caption: 'x'.repeat(10001) }]);
+    assert.ok(long.bytes - short.bytes >= 20000);
+
+    // The values grow with the instances, the names and blocks are held once per schema
+    let small = standIn.resultSet(instances(10));
+    let large = standIn.resultSet(instances(1000));
+    assert.ok(large.bytes > small.bytes);
+    assert.ok(large.bytes - small.bytes >= 990 * 140 * 2);
+    assert.strictEqual(large.heapBlocks, small.heapBlocks);
+    assert.ok(large.heapBlocks < 20);
+    console.log("bytesTest() complete");
+}
+
+function badInputTests_Exceptions() {
+    assert.throws(() => standIn.resultSet(), Error);
+    assert.throws(() => standIn.resultSet({}), Error);
+    assert.throws(() => standIn.resultSet([1]), Error);
+    assert.throws(() => standIn.resultSet([['Name']]), Error);
+    assert.throws(() => standIn.resultSet([{ Nested: [[1]] }]), Error);
+    assert.throws(() => standIn.resultSet([{ Object: {} }]), Error);
+    assert.throws(() => standIn.resultSet([{ Huge: 2n ** 64n }]), Error);
+    assert.throws(() => standIn.resultSet([], 1), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+function runTests() {
+    if (!standIn) {
+        console.log('Result set tests need the stand-in provider of the unsupported OS build, skipping.');
+        return;
+    }
+
+    roundTripTest();
+    arrayValuesTest();
+    schemaTest();
+    bytesTest();
+    badInputTests_Exceptions();
+}
+
+runTests();
\ No newline at end of file
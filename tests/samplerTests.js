@@ -0,0 +1,210 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the counters come from WMI
+const standIn = wmi.standIn;
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+// Keeps the JavaScript thread busy while the sampler keeps refreshing
+function block(ms) {
+    const end = Date.now() + ms;
+    while (Date.now() < end) {
+    }
+}
+
+async function sampleProcessorTest() {
+    let sampler = wmi.createSampler('root/cimv2', 'Win32_PerfFormattedData_PerfOS_Processor',
+        ['PercentProcessorTime', 'PercentIdleTime'], 10);
+    assert.strictEqual(sampler.active, true);
+    await sleep(100);
+    let window = sampler.read();
+    sampler.close();
+    assert.strictEqual(sampler.active, false);
+
+    assert.ok(window.rows > 0);
+    assert.deepStrictEqual(window.columns, ['PercentProcessorTime', 'PercentIdleTime']);
+    assert.ok(window.timestamps instanceof Float64Array);
+    assert.ok(window.instances instanceof Uint32Array);
+    assert.ok(window.data.PercentProcessorTime instanceof Float64Array);
+    assert.strictEqual(window.data.PercentIdleTime.length, window.rows);
+    // Every column is a view on the same buffer
+    assert.strictEqual(window.data.PercentProcessorTime.buffer, window.timestamps.buffer);
+    for (let id of window.instances) {
+        assert.strictEqual(typeof window.instanceNames[id], 'string');
+    }
+    console.log(`sampleProcessorTest() complete, ${window.rows} rows`);
+}
+
+async function badInputSamplerTests_Exceptions() {
+    let goodnamespace = 'root/cimv2';
+    let goodClass = 'Win32_PerfFormattedData_PerfOS_Processor';
+    let goodProperties = ['PercentProcessorTime'];
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, goodProperties), Error);
+    assert.throws(() => wmi.createSampler(123, goodClass, goodProperties, 10), Error);
+    assert.throws(() => wmi.createSampler('invalid', goodClass, goodProperties, 10), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, '', goodProperties, 10), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, [], 10), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, [123], 10), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, 'PercentProcessorTime', 10), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, goodProperties, 0), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, goodProperties, '10'), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, goodProperties, 10, 123), Error);
+    assert.throws(() => wmi.createSampler(goodnamespace, goodClass, goodProperties, 10, { capacity: 0 }), Error);
+
+    let sampler = wmi.createSampler(goodnamespace, goodClass, goodProperties, 10);
+    assert.throws(() => sampler.read(-1), Error);
+    assert.throws(() => sampler.read(0, 0), Error);
+    assert.throws(() => sampler.read('0'), Error);
+    sampler.close();
+    console.log("badInputSamplerTests_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function valuesTest() {
+    standIn.enable({ rowCount: 3 });
+    let sampler = wmi.createSampler('root/cimv2', 'StandIn_Counter', ['A', 'B'], 1);
+    await sleep(50);
+    let window = sampler.read(0, 6);
+    sampler.close();
+
+    // One row per instance and refresh, the stand-in counter value is refresh * 100 + row * 10 + property
+    assert.strictEqual(window.rows, 6);
+    assert.strictEqual(window.lost, 0);
+    assert.strictEqual(window.cursor, 6);
+    assert.deepStrictEqual(window.instanceNames,
+        [0, 1, 2].map(row => `StandIn_Counter.Name.${row}`));
+    for (let i = 0; i < 6; i++) {
+        let refresh = Math.floor(i / 3);
+        let row = i % 3;
+        assert.strictEqual(window.instanceNames[window.instances[i]], `StandIn_Counter.Name.${row}`);
+        assert.strictEqual(window.data.A[i], refresh * 100 + row * 10);
+        assert.strictEqual(window.data.B[i], refresh * 100 + row * 10 + 1);
+        assert.strictEqual(window.timestamps[i], window.timestamps[i - row]);
+    }
+    assert.ok(window.timestamps[3] > window.timestamps[0]);
+    console.log("valuesTest() complete");
+}
+
+async function cursorTest() {
+    standIn.enable({ rowCount: 2 });
+    let sampler = wmi.createSampler('root/cimv2', 'StandIn_Counter', ['A'], 1);
+    let cursor = 0;
+    let values = [];
+    while (values.length < 100) {
+        await sleep(5);
+        let window = sampler.read(cursor);
+        assert.strictEqual(window.lost, 0);
+        values.push(...window.data.A);
+        cursor = window.cursor;
+    }
+    sampler.close();
+
+    // Reading from the previous cursor returns every row exactly once
+    for (let i = 0; i < values.length; i++) {
+        assert.strictEqual(values[i], Math.floor(i / 2) * 100 + (i % 2) * 10);
+    }
+    console.log("cursorTest() complete");
+}
+
+async function overwriteTest() {
+    const kCapacity = 8;
+    standIn.enable({ rowCount: 2 });
+    let sampler = wmi.createSampler('root/cimv2', 'StandIn_Counter', ['A'], 1, { capacity: kCapacity });
+    block(50);
+    let window = sampler.read(0);
+    let stats = sampler.stats();
+    sampler.close();
+
+    // Only the newest rows are kept, the ones the reader never got are reported as lost
+    assert.strictEqual(window.rows, kCapacity);
+    assert.strictEqual(window.lost, window.cursor - kCapacity);
+    assert.ok(window.lost > 0);
+    assert.ok(stats.overwrittenRows >= window.lost);
+    assert.strictEqual(window.data.A[0], Math.floor(window.lost / 2) * 100 + (window.lost % 2) * 10);
+    console.log(`overwriteTest() complete, ${window.lost} rows lost while blocked`);
+}
+
+async function missedTicksTest() {
+    standIn.enable({ rowCount: 1, refreshLatencyMs: 20 });
+    let sampler = wmi.createSampler('root/cimv2', 'StandIn_Counter', ['A'], 5);
+    await sleep(200);
+    sampler.close();
+    let stats = sampler.stats();
+
+    // Refreshes that take longer than the interval skip ticks instead of running back to back
+    assert.ok(stats.refreshes > 0);
+    assert.ok(stats.missedTicks >= stats.refreshes);
+    assert.ok(stats.refreshes <= 11);
+    assert.strictEqual(stats.rows, stats.refreshes);
+    assert.strictEqual(stats.failedRefreshes, 0);
+    assert.strictEqual(stats.lastError, null);
+    console.log(`missedTicksTest() complete, ${stats.refreshes} refreshes, ${stats.missedTicks} missed ticks`);
+}
+
+async function brokenConnectionTest() {
+    standIn.enable({ rowCount: 1 });
+    let sampler = wmi.createSampler('root/cimv2', 'StandIn_Counter', ['A'], 5);
+    await sleep(20);
+    standIn.breakConnections();
+    await sleep(50);
+    let stats = sampler.stats();
+    let refreshes = stats.refreshes;
+    await sleep(50);
+
+    // The failed refresh is counted, the following one reconnects and sampling carries on
+    assert.strictEqual(stats.failedRefreshes, 1);
+    assert.strictEqual(stats.lastError, -2147417848);
+    assert.ok(sampler.stats().refreshes > refreshes);
+    assert.strictEqual(sampler.active, true);
+    sampler.close();
+    console.log("brokenConnectionTest() complete");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+    await sampleProcessorTest();
+    await badInputSamplerTests_Exceptions();
+    if (standIn) {
+        await valuesTest();
+        await cursorTest();
+        await overwriteTest();
+        await missedTicksTest();
+        await brokenConnectionTest();
+    }
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// Stand-in rows can be shifted with firstRow and changed with revision between polls
+const standIn = wmi.standIn;
+
+const kQuery = 'SELECT * FROM StandIn_Snapshot';
+
+function sortedPaths(instances) {
+    return instances.map(instance => instance.__PATH).sort();
+}
+
+async function firstPollTest() {
+    standIn.enable({ rowCount: 10 });
+    let watch = wmi.watchSnapshot('root/cimv2', kQuery, undefined, { properties: ['Caption', 'Name'] });
+    assert.deepStrictEqual(watch.keyProperties, ['__PATH']);
+    assert.strictEqual(watch.rows, 0);
+
+    // Everything is new the first time, and the key is read along with the properties
+    let changes = await watch.poll();
+    assert.strictEqual(changes.added.length, 10);
+    assert.deepStrictEqual(Object.keys(changes.added[0]), ['Caption', 'Name', '__PATH']);
+    assert.strictEqual(changes.added[3].__PATH, 'StandIn_Snapshot.__PATH.3');
+    assert.deepStrictEqual(changes.removed, []);
+    assert.deepStrictEqual(changes.changed, []);
+    assert.deepStrictEqual(changes.changeMasks, []);
+    assert.strictEqual(watch.rows, 10);
+
+    // Nothing changed since
+    changes = await watch.poll();
+    assert.deepStrictEqual([changes.added, changes.removed, changes.changed], [[], [], []]);
+    watch.close();
+    console.log("firstPollTest() complete");
+}
+
+async function changesTest() {
+    standIn.enable({ rowCount: 10 });
+    let watch = wmi.watchSnapshot('root/cimv2', kQuery, undefined, { properties: ['Caption', 'Name'] });
+    await watch.poll();
+
+    // Rows 0, 3, 6 and 9 get new values for both properties, their paths stay the same
+    standIn.enable({ rowCount: 10, revision: 1, revisionInterval: 3 });
+    let changes = await watch.poll();
+    assert.deepStrictEqual(sortedPaths(changes.changed), ['StandIn_Snapshot.__PATH.0', 'StandIn_Snapshot.__PATH.3', 'StandIn_Snapshot.__PATH.6', 'StandIn_Snapshot.__PATH.9']);
+    assert.ok(changes.changed.every(instance => instance.Caption.endsWith('.r1')));
+    assert.strictEqual(changes.changeMasks.length, 4);
+    for (let mask of changes.changeMasks) {
+        assert.ok(mask instanceof Uint32Array);
+        assert.deepStrictEqual(Array.from(mask), [0b011]);
+    }
+    assert.deepStrictEqual([changes.added, changes.removed], [[], []]);
+
+    // Rows 0 and 1 go away and rows 10 and 11 show up, the previous version of the removed ones is reported
+    standIn.enable({ rowCount: 10, firstRow: 2, revision: 1, revisionInterval: 3 });
+    changes = await watch.poll();
+    assert.deepStrictEqual(sortedPaths(changes.added), ['StandIn_Snapshot.__PATH.10', 'StandIn_Snapshot.__PATH.11']);
+    assert.deepStrictEqual(sortedPaths(changes.removed), ['StandIn_Snapshot.__PATH.0', 'StandIn_Snapshot.__PATH.1']);
+    assert.ok(changes.removed.some(instance => instance.Caption === 'StandIn_Snapshot.Caption.0.r1'));
+    assert.deepStrictEqual(changes.changed, []);
+    assert.strictEqual(watch.rows, 10);
+    watch.close();
+    console.log("changesTest() complete");
+}
+
+async function keyPropertiesTest() {
+    standIn.enable({ rowCount: 4 });
+    let watch = wmi.watchSnapshot('root/cimv2', 'SELECT Caption FROM StandIn_Snapshot', ['Name']);
+    assert.deepStrictEqual(watch.keyProperties, ['Name']);
+    let changes = await watch.poll();
+    assert.deepStrictEqual(Object.keys(changes.added[0]), ['Caption', 'Name']);
+
+    // An instance whose key changed is a different instance
+    standIn.enable({ rowCount: 4, revision: 2, revisionInterval: 2 });
+    changes = await watch.poll();
+    assert.strictEqual(changes.added.length, 2);
+    assert.strictEqual(changes.removed.length, 2);
+    assert.strictEqual(changes.changed.length, 0);
+    assert.ok(changes.added.every(instance => instance.Name.endsWith('.r2')));
+    watch.close();
+    console.log("keyPropertiesTest() complete");
+}
+
+async function failedPollTest() {
+    standIn.enable({ rowCount: 20 });
+    let watch = wmi.watchSnapshot('root/cimv2', kQuery, undefined, { properties: ['Caption'] });
+    await watch.poll();
+
+    // A snapshot cut short would report the rest as removed, so it fails and the last one is kept
+    await assert.rejects(watch.poll({ maxRows: 5 }), /stopped at a limit/);
+    assert.strictEqual(watch.rows, 20);
+    let changes = await watch.poll();
+    assert.deepStrictEqual([changes.added, changes.removed, changes.changed], [[], [], []]);
+
+    await assert.rejects(watch.poll({ signal: AbortSignal.abort() }), { name: 'AbortError' });
+
+    // Stand-in instances only have __PATH when it is read by name
+    let missingKey = wmi.watchSnapshot('root/cimv2', kQuery);
+    await assert.rejects(missingKey.poll(), /missing a key property/);
+    assert.strictEqual(missingKey.rows, 0);
+    missingKey.close();
+
+    changes = await watch.poll({ timings: true });
+    assert.ok(changes.timings.totalMs >= 0);
+
+    watch.close();
+    assert.strictEqual(watch.closed, true);
+    assert.strictEqual(watch.keyProperties, null);
+    await assert.rejects(watch.poll(), /closed/);
+    console.log("failedPollTest() complete");
+}
+
+async function rejectedPollTest() {
+    standIn.enable({ rowCount: 10 });
+    let watch = wmi.watchSnapshot('root/cimv2', 'SELECT Caption, __PATH FROM StandIn_Snapshot');
+    await watch.poll();
+
+    // A query WMI rejects returns no instances, which isn't a snapshot in which every instance was removed
+    standIn.enable({ rowCount: 10, missingProperties: ['Caption'], maskRejectedQueries: true });
+    let changes = await watch.poll();
+    assert.deepStrictEqual([changes.added, changes.removed, changes.changed, changes.changeMasks], [[], [], [], []]);
+    assert.strictEqual(watch.rows, 10);
+
+    // So they aren't added again once it is accepted
+    standIn.enable({ rowCount: 10 });
+    changes = await watch.poll();
+    assert.deepStrictEqual([changes.added, changes.removed, changes.changed], [[], [], []]);
+    watch.close();
+    console.log("rejectedPollTest() complete");
+}
+
+function badArgumentsTest_Exceptions() {
+    assert.throws(() => wmi.watchSnapshot('root/cimv2'), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', kQuery, 'Name'), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', kQuery, [1]), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', kQuery, undefined, { properties: 'Name' }), Error);
+    assert.throws(() => wmi.watchSnapshot('root/cimv2', 'ASSOCIATORS OF {Win32_Process.Handle="0"}'), /Invalid Query/);
+    assert.throws(() => wmi.watchSnapshot('root/unknown', kQuery), /Unsupported Namespace/);
+    console.log("badArgumentsTest_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function windowsSnapshotTest() {
+    let watch = wmi.watchSnapshot('root/cimv2', 'SELECT * FROM Win32_Process', undefined, { properties: ['Name', 'ProcessId'] });
+    let changes = await watch.poll();
+    assert.ok(changes.added.length > 0);
+    assert.ok(changes.added.every(instance => typeof instance.__PATH === 'string'));
+    changes = await watch.poll();
+    assert.ok(changes.added.length < watch.rows);
+    watch.close();
+    console.log("windowsSnapshotTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        await windowsSnapshotTest();
+        badArgumentsTest_Exceptions();
+        return;
+    }
+
+    await firstPollTest();
+    await changesTest();
+    await keyPropertiesTest();
+    await failedPollTest();
+    await rejectedPollTest();
+    badArgumentsTest_Exceptions();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,234 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the events come from WMI
+const standIn = wmi.standIn;
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+// Keeps the JavaScript thread busy so events pile up in the queue
+function block(ms) {
+    const end = Date.now() + ms;
+    while (Date.now() < end) {
+    }
+}
+
+// Subscribes and resolves with the callback calls once done(calls) returns true, then unsubscribes
+function subscribeUntil(query, options, done) {
+    return new Promise((resolve, reject) => {
+        let calls = [];
+        let subscription = wmi.subscribe('root/cimv2', query, (error, events, info) => {
+            calls.push({ error, events, info });
+            if (error || done(calls)) {
+                subscription.unsubscribe();
+                resolve({ subscription, calls });
+            }
+        }, options);
+        setTimeout(() => {
+            subscription.unsubscribe();
+            reject(new Error(`Subscription timed out after ${calls.length} calls`));
+        }, 5000).unref();
+    });
+}
+
+function eventCount(calls) {
+    return calls.reduce((count, call) => count + (call.events ? call.events.length : 0), 0);
+}
+
+async function subscribeUnsubscribeTest() {
+    let subscription = wmi.subscribe('root/cimv2',
+        "SELECT * FROM __InstanceCreationEvent WITHIN 1 WHERE TargetInstance ISA 'Win32_Process'",
+        () => { }, { properties: ['TargetInstance.Name'] });
+    assert.strictEqual(subscription.active, true);
+    subscription.unsubscribe();
+    assert.strictEqual(subscription.active, false);
+
+    // Unsubscribing twice is harmless
+    subscription.unsubscribe();
+    console.log("subscribeUnsubscribeTest() complete");
+}
+
+async function badInputSubscribeTests_Exceptions() {
+    let goodnamespace = 'root/cimv2';
+    let goodQuery = 'SELECT * FROM __InstanceCreationEvent WITHIN 1';
+    let callback = () => { };
+
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery), Error);
+    assert.throws(() => wmi.subscribe(123, goodQuery, callback), Error);
+    assert.throws(() => wmi.subscribe('invalid', goodQuery, callback), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, 'callback'), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, 123), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { properties: 'Name' }), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { properties: [123] }), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { maxQueuedEvents: 0 }), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { maxBatchSize: 'all' }), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { overflow: 'dropNewest' }), Error);
+    assert.throws(() => wmi.subscribe(goodnamespace, goodQuery, callback, { format: 'columnar' }), Error);
+    console.log("badInputSubscribeTests_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function deliveryTest() {
+    standIn.enable({ rowCount: 4, eventIntervalMs: 1 });
+
+    let { subscription, calls } = await subscribeUntil('SELECT * FROM StandIn_Event', { properties: ['Name', 'Count'], typed: true },
+        calls => eventCount(calls) >= 8);
+    assert.strictEqual(subscription.active, false);
+
+    let events = [].concat(...calls.map(call => call.events));
+    for (let i = 0; i < 8; i++) {
+        assert.deepStrictEqual(events[i], { Name: `StandIn_Event.Name.${i % 4}`, Count: 4000000000 + i % 4 });
+    }
+    for (let call of calls) {
+        assert.strictEqual(call.error, null);
+        assert.deepStrictEqual(call.info, { dropped: 0, coalesced: 0 });
+    }
+    console.log("deliveryTest() complete");
+}
+
+async function dropOldestTest() {
+    const kMaxQueuedEvents = 50;
+    standIn.enable({ rowCount: 1000000, eventIntervalMs: 0, eventBatchSize: 100 });
+
+    let delivery = subscribeUntil('SELECT * FROM StandIn_Event', { properties: ['Name'], maxQueuedEvents: kMaxQueuedEvents },
+        calls => true);
+    block(100);
+    let { calls } = await delivery;
+
+    // Only the newest events were kept, everything produced before them was dropped
+    let call = calls[0];
+    assert.strictEqual(call.events.length, kMaxQueuedEvents);
+    assert.ok(call.info.dropped > 0);
+    assert.strictEqual(call.events[0].Name, `StandIn_Event.Name.${call.info.dropped}`);
+    assert.strictEqual(call.events[kMaxQueuedEvents - 1].Name, `StandIn_Event.Name.${call.info.dropped + kMaxQueuedEvents - 1}`);
+    console.log(`dropOldestTest() complete, ${call.info.dropped} events dropped while blocked`);
+}
+
+async function coalesceTest() {
+    standIn.enable({ rowCount: 4, eventIntervalMs: 0, eventBatchSize: 100 });
+
+    let delivery = subscribeUntil('SELECT * FROM StandIn_Event', { properties: ['Name'], overflow: 'coalesce', maxQueuedEvents: 10 },
+        calls => true);
+    block(100);
+    let { calls } = await delivery;
+
+    // Repeats of an event still waiting to be delivered were merged into it
+    let call = calls[0];
+    assert.deepStrictEqual(call.events.map(event => event.Name).sort(),
+        [0, 1, 2, 3].map(row => `StandIn_Event.Name.${row}`));
+    assert.strictEqual(call.info.dropped, 0);
+    assert.ok(call.info.coalesced > 0);
+    console.log(`coalesceTest() complete, ${call.info.coalesced} events coalesced while blocked`);
+}
+
+async function maxBatchSizeTest() {
+    standIn.enable({ rowCount: 1000000, eventIntervalMs: 0, eventBatchSize: 100 });
+
+    let delivery = subscribeUntil('SELECT * FROM StandIn_Event', { properties: ['Name'], maxQueuedEvents: 1000, maxBatchSize: 100 },
+        calls => calls.length === 3);
+    block(100);
+    let { calls } = await delivery;
+
+    // A full queue is drained in several calls instead of a single large one
+    for (let call of calls) {
+        assert.strictEqual(call.events.length, 100);
+    }
+    // The queue stays full while it is drained, so newer events keep pushing out older ones
+    let expectedIndex = calls[0].info.dropped + 100 + calls[1].info.dropped;
+    assert.strictEqual(calls[1].events[0].Name, `StandIn_Event.Name.${expectedIndex}`);
+    console.log("maxBatchSizeTest() complete");
+}
+
+async function unsubscribeStopsEventsTest() {
+    standIn.enable({ rowCount: 4, eventIntervalMs: 1 });
+
+    let calls = 0;
+    let subscription = wmi.subscribe('root/cimv2', 'SELECT * FROM StandIn_Event', () => calls++, { properties: ['Name'] });
+    await sleep(50);
+    subscription.unsubscribe();
+
+    let callsAtUnsubscribe = calls;
+    let generated = standIn.generatedEvents();
+    await sleep(50);
+    assert.ok(callsAtUnsubscribe > 0);
+    assert.strictEqual(calls, callsAtUnsubscribe);
+    assert.strictEqual(standIn.generatedEvents(), generated);
+    console.log("unsubscribeStopsEventsTest() complete");
+}
+
+async function brokenConnectionTest() {
+    standIn.enable({ rowCount: 4, eventIntervalMs: 1 });
+
+    let delivery = subscribeUntil('SELECT * FROM StandIn_Event', { properties: ['Name'] }, calls => false);
+    await sleep(20);
+    standIn.breakConnections();
+
+    // The subscription ends with the error instead of silently going quiet
+    let { subscription, calls } = await delivery;
+    let last = calls[calls.length - 1];
+    assert.ok(last.error instanceof Error);
+    assert.strictEqual(last.error.message, 'Query failed with error code: -2147417848');
+    assert.strictEqual(subscription.active, false);
+    console.log("brokenConnectionTest() complete");
+}
+
+async function invalidQueryTest() {
+    standIn.enable();
+
+    let { calls } = await subscribeUntil('garbage', undefined, calls => false);
+    assert.strictEqual(calls.length, 1);
+    assert.strictEqual(calls[0].error.message, 'Query failed with error code: -2147217385');
+    console.log("invalidQueryTest() complete");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+
+    await subscribeUnsubscribeTest();
+    await badInputSubscribeTests_Exceptions();
+
+    if (standIn) {
+        await deliveryTest();
+        await dropOldestTest();
+        await coalesceTest();
+        await maxBatchSizeTest();
+        await unsubscribeStopsEventsTest();
+        await brokenConnectionTest();
+        await invalidQueryTest();
+    }
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
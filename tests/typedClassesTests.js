@@ -0,0 +1,206 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The typed classes are read from the stand-in provider's fake instances, which have the properties
+// of the class descriptors with their declared CIM types
+const standIn = wmi.standIn;
+
+const kRowCount = 20;
+
+// Namespace and properties of every typed class, in descriptor order
+const kTypedClasses = {
+    Win32_Processor: ['root/cimv2', ['DeviceID', 'Name', 'Manufacturer', 'ProcessorId', 'Architecture', 'NumberOfCores',
+        'NumberOfLogicalProcessors', 'MaxClockSpeed', 'CurrentClockSpeed', 'LoadPercentage', 'L2CacheSize', 'L3CacheSize']],
+    Win32_LogicalDisk: ['root/cimv2', ['DeviceID', 'DriveType', 'FileSystem', 'FreeSpace', 'Size', 'VolumeName', 'VolumeSerialNumber']],
+    Win32_OperatingSystem: ['root/cimv2', ['Caption', 'Version', 'BuildNumber', 'OSArchitecture', 'SystemDrive', 'NumberOfProcesses',
+        'FreePhysicalMemory', 'TotalVisibleMemorySize', 'FreeVirtualMemory', 'InstallDate', 'LastBootUpTime']],
+    MSFT_PhysicalDisk: ['root/microsoft/windows/storage', ['DeviceId', 'FriendlyName', 'SerialNumber', 'MediaType', 'BusType',
+        'HealthStatus', 'OperationalStatus', 'SpindleSpeed', 'Size']],
+    WmiMonitorID: ['root/wmi', ['InstanceName', 'Active', 'ManufacturerName', 'ProductCodeID', 'SerialNumberID',
+        'UserFriendlyName', 'WeekOfManufacture', 'YearOfManufacture']]
+};
+
+function typedQuery(className, filter) {
+    let query = `SELECT ${kTypedClasses[className][1].join(', ')} FROM ${className}`;
+    return filter ? `${query} WHERE ${filter}` : query;
+}
+
+function statsDelta(before) {
+    let after = standIn.propertyHandleStats();
+    return { handleReads: after.handleReads - before.handleReads, namedReads: after.namedReads - before.namedReads };
+}
+
+async function sameResultsTest() {
+    for (let propertyHandles of [true, false]) {
+        standIn.enable({ rowCount: kRowCount, propertyHandles: propertyHandles });
+        for (let [className, [namespace, properties]] of Object.entries(kTypedClasses)) {
+            let typed = await wmi.queryTyped(className);
+            assert.strictEqual(standIn.lastExecQuery().query, typedQuery(className));
+
+            // The extractors return what the general typed conversion returns for the same query
+            let general = await wmi.queryAsync(namespace, typedQuery(className), properties, { typed: true });
+            assert.deepStrictEqual(typed, general);
+            assert.strictEqual(Object.keys(typed).length, kRowCount);
+            assert.deepStrictEqual(Object.keys(typed[0]), properties);
+        }
+    }
+    console.log("sameResultsTest() complete");
+}
+
+async function valuesTest() {
+    standIn.enable({ rowCount: kRowCount });
+    let disks = await wmi.queryTyped('win32_logicaldisk');
+    assert.strictEqual(disks[0].DeviceID, 'Win32_LogicalDisk.DeviceID.0');
+    assert.strictEqual(disks[1].DriveType, 2147483649);
+    // Null values can't be read through a handle and come from the fallback
+    assert.strictEqual(disks[3].DriveType, null);
+    assert.strictEqual(disks[2].FreeSpace, 9007199254740995n);
+
+    let system = (await wmi.queryTyped('Win32_OperatingSystem'))[5];
+    assert.ok(system.InstallDate instanceof Date);
+    assert.strictEqual(system.InstallDate.toISOString(), '2023-01-02T02:04:05.678Z');
+    assert.strictEqual(system.NumberOfProcesses, 2147483653);
+
+    let monitor = (await wmi.queryTyped('WmiMonitorID'))[1];
+    assert.strictEqual(monitor.Active, false);
+    assert.deepStrictEqual(monitor.ManufacturerName, [66, 49, 0]);
+    assert.strictEqual(monitor.WeekOfManufacture, 1);
+    assert.strictEqual(monitor.YearOfManufacture, 65534);
+
+    let physicalDisk = (await wmi.queryTyped('MSFT_PhysicalDisk'))[0];
+    assert.strictEqual(physicalDisk.MediaType, 65535);
+    assert.deepStrictEqual(physicalDisk.OperationalStatus, [65, 48, 0]);
+    console.log("valuesTest() complete");
+}
+
+async function optionsTest() {
+    standIn.enable({ rowCount: kRowCount });
+    await wmi.queryTyped('Win32_LogicalDisk', 'DriveType = 3');
+    assert.strictEqual(standIn.lastExecQuery().query, typedQuery('Win32_LogicalDisk', 'DriveType = 3'));
+
+    // The conversion settings apply, typed values can't be turned off
+    let disk = (await wmi.queryTyped('Win32_LogicalDisk', undefined, { typed: false, int64: 'number' }))[0];
+    assert.strictEqual(disk.FreeSpace, 9007199254740992);
+    let system = (await wmi.queryTyped('Win32_OperatingSystem', '', { datetime: 'number' }))[0];
+    assert.strictEqual(system.LastBootUpTime, Date.UTC(2023, 0, 2, 2, 4, 0, 678));
+
+    let limited = await wmi.queryTyped('Win32_Processor', undefined, { maxRows: 5 });
+    assert.strictEqual(Object.keys(limited).length, 5);
+    assert.strictEqual(limited.truncated, 'maxRows');
+
+    let lazy = await wmi.queryTyped('Win32_Processor', undefined, { lazy: true });
+    assert.strictEqual(lazy[2].NumberOfCores, 2147483650);
+
+    let controller = new AbortController();
+    controller.abort();
+    await assert.rejects(wmi.queryTyped('Win32_Processor', undefined, { signal: controller.signal }), { name: 'AbortError' });
+    console.log("optionsTest() complete");
+}
+
+async function handleReadsTest() {
+    standIn.enable({ rowCount: kRowCount });
+    let before = standIn.propertyHandleStats();
+    await wmi.queryTyped('Win32_LogicalDisk');
+
+    // DriveType, FreeSpace and Size are read through handles, except the null DriveType of every fourth row
+    let nullRows = kRowCount / 4;
+    let delta = statsDelta(before);
+    assert.strictEqual(delta.handleReads, 3 * kRowCount - nullRows);
+    assert.strictEqual(delta.namedReads, 4 * kRowCount + nullRows);
+    console.log("handleReadsTest() complete");
+}
+
+async function perRowCostTest() {
+    const kRows = 20000;
+    const kRuns = 5;
+    const [namespace, properties] = kTypedClasses.Win32_OperatingSystem;
+
+    async function measure(run) {
+        await run();
+        let start = process.hrtime.bigint();
+        for (let i = 0; i < kRuns; ++i) {
+            await run();
+        }
+        return Number(process.hrtime.bigint() - start) / (kRuns * kRows);
+    }
+
+    standIn.enable({ rowCount: kRows });
+    let typedCost = await measure(() => wmi.queryTyped('Win32_OperatingSystem'));
+    let generalCost = await measure(() => wmi.queryAsync(namespace, typedQuery('Win32_OperatingSystem'), properties, { typed: true }));
+    console.log(`  ${typedCost.toFixed(0)}ns per row with the extractor, ${generalCost.toFixed(0)}ns per row with the general conversion`);
+
+    standIn.enable();
+    console.log("perRowCostTest() complete");
+}
+
+async function badInputTests_Exceptions() {
+    await assert.rejects(wmi.queryTyped(), Error);
+    await assert.rejects(wmi.queryTyped(123), Error);
+    await assert.rejects(wmi.queryTyped('Win32_BIOS'), /Unsupported Class/);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', 3), Error);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', '', 'typed'), Error);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', '', {}, 1), Error);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', '', { format: 'columnar' }), Error);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', '', { aggregate: { values: { n: { op: 'count' } } } }), Error);
+    await assert.rejects(wmi.queryTyped('Win32_LogicalDisk', '', { maxRows: -1 }), Error);
+    console.log("badInputTests_Exceptions() complete");
+}
+
+async function windowsTypedClassesTest() {
+    let disks = await wmi.queryTyped('Win32_LogicalDisk');
+    for (let disk of Object.values(disks)) {
+        assert.strictEqual(typeof disk.DeviceID, 'string');
+        assert.strictEqual(typeof disk.DriveType, 'number');
+    }
+    let system = (await wmi.queryTyped('Win32_OperatingSystem'))[0];
+    assert.ok(system.LastBootUpTime instanceof Date);
+    assert.strictEqual(typeof system.FreePhysicalMemory, 'bigint');
+    console.log("windowsTypedClassesTest() complete");
+}
+
+async function runTests() {
+    await badInputTests_Exceptions();
+
+    if (!standIn) {
+        await windowsTypedClassesTest();
+        return;
+    }
+
+    await sameResultsTest();
+    await valuesTest();
+    await optionsTest();
+    await handleReadsTest();
+    await perRowCostTest();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
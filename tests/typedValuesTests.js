@@ -0,0 +1,176 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider returns a fixed set of typed properties shaped the way WMI hands them out
+const standIn = wmi.standIn;
+
+const kTypedProperties = ['Enabled', 'Level', 'Offset', 'Port', 'Count', 'Delta', 'Total', 'Balance', 'Ratio', 'Load',
+    'InstallDate', 'Uptime', 'Description', 'Status', 'Samples', 'Readings', 'Flags', 'Names', 'Totals', 'Caption'];
+const kQuery = `SELECT ${kTypedProperties.join(',')} FROM StandIn_Typed`;
+
+function typedValuesTest() {
+    let result = wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: true });
+    let row = result[1];
+
+    assert.strictEqual(row.Enabled, false);
+    assert.strictEqual(result[0].Enabled, true);
+    assert.strictEqual(row.Level, 1);
+    assert.strictEqual(row.Offset, -1);
+    assert.strictEqual(row.Port, 65534);
+    // uint32 travels in a signed VARIANT, the CIM type restores the unsigned value
+    assert.strictEqual(row.Count, 4000000001);
+    assert.strictEqual(row.Delta, -1);
+    // 64 bit integers are exact as BigInt even above 2^53
+    assert.strictEqual(row.Total, 9007199254740994n);
+    assert.strictEqual(row.Balance, -1000000000001n);
+    assert.strictEqual(row.Ratio, 1.5);
+    assert.strictEqual(row.Load, 0.25);
+    assert.ok(row.InstallDate instanceof Date);
+    assert.strictEqual(row.InstallDate.getTime(), Date.UTC(2023, 0, 2, 2, 4, 1, 678));
+    assert.strictEqual(row.Uptime, '00000001020304.000000:000');
+    assert.strictEqual(row.Description.length, 2049);
+    assert.strictEqual(row.Status, null);
+    assert.ok(row.Samples instanceof Uint32Array);
+    assert.deepStrictEqual(Array.from(row.Samples), [1, 2, 4294967295]);
+    assert.ok(row.Readings instanceof Float64Array);
+    assert.deepStrictEqual(Array.from(row.Readings), [0.5, 1.5]);
+    assert.deepStrictEqual(row.Flags, [true, false]);
+    assert.deepStrictEqual(row.Names, ['Name.1.0', 'Name.1.1']);
+    assert.ok(row.Totals instanceof BigUint64Array);
+    assert.deepStrictEqual(Array.from(row.Totals), [1n, 18446744073709551615n]);
+    assert.strictEqual(row.Caption, 'StandIn_Typed.Caption.1');
+    console.log("typedValuesTest() complete");
+}
+
+function numberConversionOptionsTest() {
+    let row = wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: true, int64: 'number', datetime: 'number' })[1];
+
+    assert.strictEqual(row.Total, 9007199254740994);
+    assert.strictEqual(row.Balance, -1000000000001);
+    assert.ok(row.Totals instanceof Float64Array);
+    assert.strictEqual(row.InstallDate, Date.UTC(2023, 0, 2, 2, 4, 1, 678));
+    console.log("numberConversionOptionsTest() complete");
+}
+
+function stringValuesTest() {
+    // Without typed every value is still a string, now without the 1024 character limit
+    let row = wmi.query('root/cimv2', kQuery, kTypedProperties)[1];
+
+    for (let property of kTypedProperties) {
+        assert.strictEqual(typeof row[property], 'string', property);
+    }
+    assert.strictEqual(row.Enabled, '0');
+    assert.strictEqual(row.Total, '9007199254740994');
+    assert.strictEqual(row.InstallDate, '20230102030401.678000+060');
+    assert.strictEqual(row.Description.length, 2049);
+    assert.strictEqual(row.Status, '');
+    assert.strictEqual(row.Samples, '1; 2; -1');
+    assert.strictEqual(row.Names, 'Name.1.0; Name.1.1');
+    console.log("stringValuesTest() complete");
+}
+
+async function typedAsyncAndStreamTest() {
+    let expected = wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: true });
+
+    let asyncResult = await wmi.queryAsync('root/cimv2', kQuery, kTypedProperties, { typed: true });
+    assert.deepStrictEqual(asyncResult, expected);
+
+    let rows = [];
+    for await (let batch of wmi.queryStream('root/cimv2', kQuery, kTypedProperties, { typed: true, batchSize: 3 })) {
+        rows.push(...batch);
+    }
+    assert.deepStrictEqual(rows, Object.values(expected));
+    console.log("typedAsyncAndStreamTest() complete");
+}
+
+async function wideStringTest() {
+    // Names and values outside ASCII, including a character that takes a surrogate pair in UTF-16
+    const properties = ['Label', 'Größe'];
+    const query = 'SELECT Label, Größe FROM StandIn_Wide';
+    const label = 'Gerät 設定 \u{1F4A1} 1';
+
+    for (let options of [{ typed: true }, {}]) {
+        let row = wmi.query('root/cimv2', query, properties, options)[1];
+        assert.deepStrictEqual(Object.keys(row), properties);
+        assert.strictEqual(row.Label, label);
+        assert.strictEqual(row['Größe'], 'StandIn_Wide.Größe.1');
+    }
+
+    let asyncRow = (await wmi.queryAsync('root/cimv2', query, properties, { typed: true }))[1];
+    assert.strictEqual(asyncRow.Label, label);
+
+    let columnar = wmi.query('root/cimv2', query, properties, { typed: true, format: 'columnar' });
+    assert.deepStrictEqual(columnar.columns, properties);
+    assert.strictEqual(columnar.data.Label[1], label);
+    assert.strictEqual(columnar.data['Größe'][1], 'StandIn_Wide.Größe.1');
+    console.log("wideStringTest() complete");
+}
+
+function windowsTypedValuesTest() {
+    const properties = ['Name', 'NumberOfCores', 'MaxClockSpeed'];
+    let result = wmi.query('root/cimv2', `SELECT ${properties.join(',')} FROM Win32_Processor`, properties, { typed: true });
+
+    for (let processor of Object.values(result)) {
+        assert.strictEqual(typeof processor.Name, 'string');
+        assert.strictEqual(typeof processor.NumberOfCores, 'number');
+        assert.strictEqual(typeof processor.MaxClockSpeed, 'number');
+    }
+    console.log("windowsTypedValuesTest() complete");
+}
+
+async function badOptionsTest_Exceptions() {
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: 'yes' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: true, int64: 'string' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kTypedProperties, { typed: true, datetime: 1 }), Error);
+    assert.throws(() => wmi.query('root/cimv2', kQuery, kTypedProperties, 'typed'), Error);
+    await assert.rejects(() => wmi.queryAsync('root/cimv2', kQuery, kTypedProperties, { typed: 1 }), Error);
+    console.log("badOptionsTest_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function runTests() {
+    if (!standIn) {
+        windowsTypedValuesTest();
+        await badOptionsTest_Exceptions();
+        return;
+    }
+
+    standIn.enable();
+    typedValuesTest();
+    numberConversionOptionsTest();
+    stringValuesTest();
+    await typedAsyncAndStreamTest();
+    await wideStringTest();
+    await badOptionsTest_Exceptions();
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
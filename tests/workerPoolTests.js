@@ -0,0 +1,188 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the queries go to WMI
+const standIn = wmi.standIn;
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function threadsReusedTest() {
+    wmi.configureWorkers({ threads: 4 });
+    await Promise.all(Array.from({ length: 8 }, () => wmi.queryAsync('root/cimv2', 'SELECT Name FROM Win32_Processor')));
+    let before = wmi.workerStats();
+
+    for (let i = 0; i < 10; i++) {
+        wmi.query('root/cimv2', 'SELECT Name FROM Win32_Processor');
+        await Promise.all(Array.from({ length: 4 }, () => wmi.queryAsync('root/cimv2', 'SELECT Name FROM Win32_Processor')));
+    }
+    let after = wmi.workerStats();
+
+    // Every query ran on a worker thread, and the threads are kept instead of started per query
+    assert.strictEqual(after.startedJobs - before.startedJobs, 50);
+    assert.ok(after.threadStarts - before.threadStarts <= 4 - before.threads);
+    assert.ok(after.threads <= 4);
+    assert.strictEqual(after.maxThreads, 4);
+    assert.strictEqual(after.queuedJobs, 0);
+    console.log(`threadsReusedTest() complete, ${after.threadStarts} threads started`);
+}
+
+async function badInputWorkerTests_Exceptions() {
+    assert.throws(() => wmi.configureWorkers(), Error);
+    assert.throws(() => wmi.configureWorkers(4), Error);
+    assert.throws(() => wmi.configureWorkers({ threads: 0 }), Error);
+    assert.throws(() => wmi.configureWorkers({ threads: 65 }), Error);
+    assert.throws(() => wmi.configureWorkers({ threads: '4' }), Error);
+    assert.throws(() => wmi.query('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { priority: 'urgent' }), Error);
+    await assert.rejects(wmi.queryAsync('root/cimv2', 'SELECT * FROM Win32_Processor', undefined, { priority: 1 }), Error);
+    console.log("badInputWorkerTests_Exceptions() complete, all functions threw exceptions as expected.");
+}
+
+async function threadCountLimitsConcurrencyTest() {
+    const kLatencyMs = 100;
+    standIn.enable({ rowCount: 1, latencyMs: kLatencyMs });
+
+    // queryAsync waits for a worker thread, not for a thread of the libuv pool
+    let runQueries = () => Promise.all(Array.from({ length: 4 }, (_, i) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_${i}`)));
+    wmi.configureWorkers({ threads: 1 });
+    let start = Date.now();
+    await runQueries();
+    let oneThreadMs = Date.now() - start;
+
+    wmi.configureWorkers({ threads: 4 });
+    start = Date.now();
+    await runQueries();
+    let fourThreadsMs = Date.now() - start;
+
+    assert.ok(oneThreadMs >= kLatencyMs * 4, `${oneThreadMs}ms with one thread`);
+    assert.ok(fourThreadsMs < kLatencyMs * 2, `${fourThreadsMs}ms with four threads`);
+    console.log(`threadCountLimitsConcurrencyTest() complete, ${oneThreadMs}ms with one thread, ${fourThreadsMs}ms with four`);
+}
+
+async function priorityTest() {
+    standIn.enable({ rowCount: 1, latencyMs: 60 });
+    wmi.configureWorkers({ threads: 1 });
+
+    let order = [];
+    let run = (name, priority) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_${name}`, undefined, { priority })
+        .then(() => order.push(name));
+
+    // The first query keeps the only thread busy while the others queue up behind it
+    let running = run('Running', 'low');
+    await sleep(20);
+    let queued = [run('Low', 'low'), run('Normal'), run('High', 'high')];
+    await sleep(10);
+    assert.strictEqual(wmi.workerStats().queuedJobs, 3);
+    await Promise.all([running, ...queued]);
+
+    assert.deepStrictEqual(order, ['Running', 'High', 'Normal', 'Low']);
+    assert.ok(wmi.workerStats().maxQueueMs >= 60);
+    console.log("priorityTest() complete");
+}
+
+async function beyondLibuvPoolTest() {
+    const kLatencyMs = 150;
+    standIn.enable({ rowCount: 1, latencyMs: kLatencyMs });
+    wmi.configureWorkers({ threads: 8 });
+
+    // More queries than the 4 threads of the libuv pool run at the same time
+    let start = Date.now();
+    await Promise.all(Array.from({ length: 8 }, (_, i) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_Wide${i}`)));
+    let elapsedMs = Date.now() - start;
+    assert.ok(elapsedMs < kLatencyMs * 2, `${elapsedMs}ms for 8 queries on 8 threads`);
+
+    // and a query queued behind more than 4 others still overtakes them by its priority
+    wmi.configureWorkers({ threads: 1 });
+    standIn.enable({ rowCount: 1, latencyMs: 30 });
+    let order = [];
+    let run = (name, priority) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_${name}`, undefined, { priority })
+        .then(() => order.push(name));
+    let running = run('Running', 'low');
+    await sleep(10);
+    let queued = Array.from({ length: 6 }, (_, i) => run(`Low${i}`, 'low'));
+    queued.push(run('High', 'high'));
+    await sleep(5);
+    assert.strictEqual(wmi.workerStats().queuedJobs, 7);
+    await Promise.all([running, ...queued]);
+    assert.deepStrictEqual(order.slice(0, 2), ['Running', 'High']);
+    console.log(`beyondLibuvPoolTest() complete, ${elapsedMs}ms for 8 queries on 8 threads`);
+}
+
+async function synchronousFirstTest() {
+    const kLatencyMs = 50;
+    standIn.enable({ rowCount: 1, latencyMs: kLatencyMs });
+    wmi.configureWorkers({ threads: 1 });
+
+    // The JavaScript thread only waits for the running query, not for the ones queued behind it
+    let pending = Array.from({ length: 6 }, (_, i) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_Queued${i}`, undefined, { priority: 'high' }));
+    await sleep(10);
+    let start = Date.now();
+    wmi.query('root/cimv2', 'SELECT * FROM StandIn_Blocking', undefined, { priority: 'low' });
+    let blockedMs = Date.now() - start;
+    assert.ok(blockedMs < kLatencyMs * 3, `${blockedMs}ms blocked behind 6 queued queries`);
+    await Promise.all(pending);
+    console.log(`synchronousFirstTest() complete, ${blockedMs}ms blocked`);
+}
+
+async function shrinkTest() {
+    standIn.enable({ rowCount: 1 });
+    wmi.configureWorkers({ threads: 8 });
+    await Promise.all(Array.from({ length: 16 }, (_, i) => wmi.queryAsync('root/cimv2', `SELECT * FROM StandIn_${i}`)));
+
+    // Surplus threads exit once they are done with their jobs
+    wmi.configureWorkers({ threads: 2 });
+    await sleep(50);
+    let stats = wmi.workerStats();
+    assert.ok(stats.threads <= 2, `${stats.threads} threads`);
+    await wmi.queryAsync('root/cimv2', 'SELECT * FROM StandIn_Shrunk');
+    console.log("shrinkTest() complete");
+}
+
+async function runTests() {
+    if (standIn) {
+        standIn.enable();
+    }
+    await threadsReusedTest();
+    await badInputWorkerTests_Exceptions();
+    if (standIn) {
+        await threadCountLimitsConcurrencyTest();
+        await priorityTest();
+        await beyondLibuvPoolTest();
+        await synchronousFirstTest();
+        await shrinkTest();
+    }
+    wmi.configureWorkers({ threads: 8 });
+}
+
+runTests().catch(error => {
+    console.error(error);
+    process.exitCode = 1;
+});
\ No newline at end of file
@@ -0,0 +1,229 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+'use strict';
+
+const assert = require("assert");
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+
+const wmi = require('../build/Release/wmi_native_module');
+
+// The stand-in provider only exists in the unsupported OS build, on Windows the queries go to WMI
+const standIn = wmi.standIn;
+
+const kSharedQuery = 'SELECT * FROM StandIn_Shared';
+const kWorkerCount = 8;
+const kQueriesPerWorker = 20;
+
+function sleep(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+// Runs in every worker: shared cached queries, queries of its own class and a subscription, all
+// answered in this worker's environment
+async function runWorker() {
+    const { id, terminateEarly, closeEngine } = workerData;
+    const ownClass = `StandIn_Worker${id}`;
+    assert.ok(wmi.engineStats().environments >= 2);
+
+    if (closeEngine) {
+        // Gives up this worker's share only, the main thread still holds the engine
+        await wmi.queryAsync('root/cimv2', `SELECT * FROM ${ownClass}`);
+        wmi.close();
+        parentPort.postMessage({ environments: wmi.engineStats().environments });
+        return;
+    }
+
+    if (terminateEarly) {
+        // Leaves queries running for the main thread to terminate the worker under
+        parentPort.postMessage({ started: true });
+        await Promise.all(Array.from({ length: 4 }, () => wmi.queryAsync('root/cimv2', `SELECT * FROM ${ownClass}`)));
+        return;
+    }
+
+    let rows = 0;
+    for (let i = 0; i < kQueriesPerWorker; ++i) {
+        let shared = await wmi.queryAsync('root/cimv2', kSharedQuery, undefined, { cacheTtlMs: 60000 });
+        rows += Object.keys(shared).length;
+    }
+
+    let own = wmi.query('root/cimv2', `SELECT * FROM ${ownClass}`);
+    assert.strictEqual(own[0].Property0, `${ownClass}.Property0.0`);
+    let streamed = [];
+    for await (let batch of wmi.queryStream('root/cimv2', `SELECT * FROM ${ownClass}`, undefined, { batchSize: 3 })) {
+        streamed.push(...batch);
+    }
+    assert.deepStrictEqual(streamed, Object.values(own));
+
+    let events = await new Promise(resolve => {
+        let subscription = wmi.subscribe('root/cimv2', `SELECT * FROM ${ownClass}`, (error, batch) => {
+            assert.ifError(error);
+            subscription.unsubscribe();
+            resolve(batch);
+        });
+    });
+    assert.ok(events.every(event => event.Property0.startsWith(`${ownClass}.`)));
+
+    parentPort.postMessage({ rows });
+}
+
+// Starts workers and resolves with their messages once every one exited
+function runWorkers(count, options = {}) {
+    return Promise.all(Array.from({ length: count }, (_, id) => new Promise((resolve, reject) => {
+        let worker = new Worker(__filename, { workerData: { id, ...options } });
+        let messages = [];
+        worker.on('message', message => {
+            messages.push(message);
+            if (options.terminateEarly) {
+                // Let the queries reach the worker threads before tearing the environment down
+                sleep(20).then(() => worker.terminate());
+            }
+        });
+        worker.on('error', reject);
+        worker.on('exit', code => {
+            if (code !== 0 && !options.terminateEarly) {
+                reject(new Error(`Worker ${id} exited with code ${code}`));
+            }
+            resolve(messages);
+        });
+    })));
+}
+
+async function sharedEngineTest() {
+    standIn.enable({ rowCount: 10, latencyMs: 5, eventIntervalMs: 5 });
+    wmi.configureWorkers({ threads: 4 });
+    wmi.invalidateCache();
+    let connects = standIn.connectionStats().connects;
+    let workerStats = wmi.workerStats();
+    let queries = standIn.queryCount();
+
+    let results = await runWorkers(kWorkerCount);
+    for (let [message] of results) {
+        assert.strictEqual(message.rows, kQueriesPerWorker * 10);
+    }
+
+    // Every worker used the connection, worker threads and cached results of the others
+    assert.strictEqual(standIn.connectionStats().connects, connects === 0 ? 1 : connects);
+    assert.ok(wmi.workerStats().threadStarts - workerStats.threadStarts <= 4);
+    assert.ok(standIn.queryCount() - queries <= 1 + 3 * kWorkerCount);
+    let cache = wmi.cacheStats();
+    assert.strictEqual(cache.misses, 1);
+    assert.strictEqual(cache.hits + cache.coalesced, kWorkerCount * kQueriesPerWorker - 1);
+
+    // The workers are gone, the engine stays for the main thread
+    let engine = wmi.engineStats();
+    assert.strictEqual(engine.environments, 1);
+    assert.strictEqual(engine.attached, 1 + kWorkerCount);
+    assert.strictEqual(engine.releases, 0);
+    assert.strictEqual(Object.keys(wmi.query('root/cimv2', kSharedQuery)).length, 10);
+    console.log(`sharedEngineTest() complete, ${cache.hits} hits and ${cache.coalesced} coalesced across ${kWorkerCount} workers`);
+}
+
+async function terminateTest() {
+    // Workers torn down while their queries are running leave the shared engine usable
+    standIn.enable({ rowCount: 10, latencyMs: 100 });
+    let attached = wmi.engineStats().attached;
+    let connects = standIn.connectionStats().connects;
+    for (let round = 0; round < 3; ++round) {
+        await runWorkers(kWorkerCount, { terminateEarly: true });
+    }
+
+    let engine = wmi.engineStats();
+    assert.strictEqual(engine.environments, 1);
+    assert.strictEqual(engine.attached, attached + 3 * kWorkerCount);
+    assert.strictEqual(engine.releases, 0);
+    assert.strictEqual(standIn.connectionStats().connects, connects);
+    assert.strictEqual(wmi.workerStats().queuedJobs, 0);
+    assert.strictEqual(Object.keys(await wmi.queryAsync('root/cimv2', kSharedQuery)).length, 10);
+    console.log("terminateTest() complete");
+}
+
+async function closeTest() {
+    // A worker that closes the module leaves the connections of the engine to the main thread
+    standIn.enable({ rowCount: 10 });
+    wmi.query('root/cimv2', kSharedQuery);
+    let connections = standIn.connectionStats();
+    let releases = wmi.engineStats().releases;
+
+    let [[message]] = await runWorkers(1, { closeEngine: true });
+    assert.strictEqual(message.environments, 1);
+    assert.strictEqual(standIn.connectionStats().openConnections, connections.openConnections);
+    assert.strictEqual(wmi.engineStats().releases, releases);
+    wmi.query('root/cimv2', kSharedQuery);
+    assert.strictEqual(standIn.connectionStats().connects, connections.connects);
+
+    // Once the main thread closes it as well nothing holds the engine, and every close releases it
+    wmi.close();
+    assert.strictEqual(standIn.connectionStats().openConnections, 0);
+    assert.deepStrictEqual([wmi.engineStats().environments, wmi.engineStats().releases], [0, releases + 1]);
+    wmi.query('root/cimv2', kSharedQuery);
+    wmi.close();
+    assert.strictEqual(standIn.connectionStats().openConnections, 0);
+    assert.strictEqual(wmi.engineStats().releases, releases + 2);
+    console.log("closeTest() complete");
+}
+
+async function windowsWorkerThreadsTest() {
+    const query = 'SELECT Caption FROM Win32_OperatingSystem';
+    let expected = wmi.query('root/cimv2', query, ['Caption']);
+    let results = await Promise.all(Array.from({ length: 4 }, () => new Promise((resolve, reject) => {
+        let worker = new Worker(`
+            const { parentPort } = require('worker_threads');
+            const wmi = require(${JSON.stringify(require.resolve('../build/Release/wmi_native_module'))});
+            wmi.queryAsync('root/cimv2', ${JSON.stringify(query)}, ['Caption']).then(result => parentPort.postMessage(result));
+        `, { eval: true });
+        let result;
+        worker.on('message', message => result = message);
+        worker.on('error', reject);
+        worker.on('exit', () => resolve(result));
+    })));
+    for (let result of results) {
+        assert.deepStrictEqual(result, expected);
+    }
+    assert.strictEqual(wmi.engineStats().environments, 1);
+    console.log("windowsWorkerThreadsTest() complete");
+}
+
+async function runTests() {
+    if (!standIn) {
+        await windowsWorkerThreadsTest();
+        return;
+    }
+
+    await sharedEngineTest();
+    await terminateTest();
+    await closeTest();
+}
+
+if (isMainThread) {
+    runTests().catch(error => {
+        console.error(error);
+        process.exitCode = 1;
+    });
+} else {
+    runWorker().catch(error => {
+        console.error(error);
+        process.exitCode = 1;
+    });
+}
\ No newline at end of file
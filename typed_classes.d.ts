@@ -0,0 +1,102 @@
+/*
+ * **************************************************************************
+ * Copyright 2023 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the “Software”),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ * **************************************************************************
+ */
+
+// Instances returned by queryTyped, one interface per class descriptor of src/class_descriptors.h.
+// 64 bit integers are bigint and datetimes Date unless int64: 'number' or datetime: 'number' is passed,
+// any property may be null.
+
+type Int64 = bigint | number;
+type DateTime = Date | number;
+
+export interface Win32_Processor {
+    DeviceID: string | null;
+    Name: string | null;
+    Manufacturer: string | null;
+    ProcessorId: string | null;
+    Architecture: number | null;
+    NumberOfCores: number | null;
+    NumberOfLogicalProcessors: number | null;
+    MaxClockSpeed: number | null;
+    CurrentClockSpeed: number | null;
+    LoadPercentage: number | null;
+    L2CacheSize: number | null;
+    L3CacheSize: number | null;
+}
+
+export interface Win32_LogicalDisk {
+    DeviceID: string | null;
+    DriveType: number | null;
+    FileSystem: string | null;
+    FreeSpace: Int64 | null;
+    Size: Int64 | null;
+    VolumeName: string | null;
+    VolumeSerialNumber: string | null;
+}
+
+export interface Win32_OperatingSystem {
+    Caption: string | null;
+    Version: string | null;
+    BuildNumber: string | null;
+    OSArchitecture: string | null;
+    SystemDrive: string | null;
+    NumberOfProcesses: number | null;
+    FreePhysicalMemory: Int64 | null;
+    TotalVisibleMemorySize: Int64 | null;
+    FreeVirtualMemory: Int64 | null;
+    InstallDate: DateTime | null;
+    LastBootUpTime: DateTime | null;
+}
+
+/** Namespace root/microsoft/windows/storage */
+export interface MSFT_PhysicalDisk {
+    DeviceId: string | null;
+    FriendlyName: string | null;
+    SerialNumber: string | null;
+    MediaType: number | null;
+    BusType: number | null;
+    HealthStatus: number | null;
+    OperationalStatus: number[] | null;
+    SpindleSpeed: number | null;
+    Size: Int64 | null;
+}
+
+/** Namespace root/wmi, the names are arrays of character codes padded with zeros */
+export interface WmiMonitorID {
+    InstanceName: string | null;
+    Active: boolean | null;
+    ManufacturerName: number[] | null;
+    ProductCodeID: number[] | null;
+    SerialNumberID: number[] | null;
+    UserFriendlyName: number[] | null;
+    WeekOfManufacture: number | null;
+    YearOfManufacture: number | null;
+}
+
+export interface TypedClasses {
+    Win32_Processor: Win32_Processor;
+    Win32_LogicalDisk: Win32_LogicalDisk;
+    Win32_OperatingSystem: Win32_OperatingSystem;
+    MSFT_PhysicalDisk: MSFT_PhysicalDisk;
+    WmiMonitorID: WmiMonitorID;
+}
\ No newline at end of file
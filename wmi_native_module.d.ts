@@ -22,4 +22,293 @@
  * **************************************************************************
  */
 
-export function query(namespace: string, query: string, properties?: string[]): object;
\ No newline at end of file
+import { TypedClasses } from './typed_classes';
+export * from './typed_classes';
+
+/** An AbortSignal, or any object that behaves like one */
+export interface AbortSignalLike {
+    readonly aborted: boolean;
+    readonly reason?: any;
+    addEventListener(type: 'abort', listener: () => void, options?: { once?: boolean }): void;
+    removeEventListener(type: 'abort', listener: () => void): void;
+}
+
+/** An instance is aggregated when it meets every condition */
+export interface AggregateCondition {
+    property: string;
+    op: '=' | '!=' | '<>' | '<' | '<=' | '>' | '>=';
+    value: number | bigint | string | boolean | Date | null;
+}
+
+/** count without property counts the instances */
+export type AggregateValue =
+    | { op: 'count'; property?: string }
+    | { op: 'sum' | 'avg' | 'min' | 'max'; property: string };
+
+/** Without groupBy a query returns one object of values, with it an array of one object per group */
+export interface AggregateOptions {
+    where?: AggregateCondition[];
+    groupBy?: string | string[];
+    values: { [name: string]: AggregateValue };
+}
+
+export interface QueryOptions {
+    typed?: boolean;
+    int64?: 'bigint' | 'number';
+    datetime?: 'date' | 'number';
+    format?: 'rows' | 'columnar';
+    cacheTtlMs?: number;
+    priority?: 'high' | 'normal' | 'low';
+    timings?: boolean;
+    partialInstances?: boolean;
+    timeoutMs?: number;
+    maxRows?: number;
+    maxBytes?: number;
+    signal?: AbortSignalLike;
+    aggregate?: AggregateOptions;
+    lazy?: boolean;
+}
+
+/** An instance of results queried with lazy: true, its values are converted when first read */
+export interface LazyInstance {
+    [property: string]: any;
+    toJSON(): object;
+    dispose(): void;
+}
+
+/** The non-enumerable timings property of results queried with timings: true */
+export interface QueryTimings {
+    queueMs: number;
+    connectMs: number;
+    execMs: number;
+    nextMs: number;
+    readMs: number;
+    marshalMs: number;
+    totalMs: number;
+    rows: number;
+    bytes: number;
+    cached: boolean;
+}
+
+export interface ColumnarResult {
+    columns: string[];
+    rows: number;
+    data: { [property: string]: any[] | Float64Array | BigInt64Array | BigUint64Array };
+}
+
+export function query(namespace: string, query: string, properties?: string[], options?: QueryOptions): object | ColumnarResult;
+export function queryAsync(namespace: string, query: string, properties?: string[], options?: QueryOptions): Promise<object | ColumnarResult>;
+
+/** Values are always typed, the class implies the namespace and the properties */
+export type TypedQueryOptions = Omit<QueryOptions, 'typed' | 'format' | 'aggregate'>;
+export function queryTyped<K extends keyof TypedClasses>(className: K, filter?: string, options?: TypedQueryOptions): Promise<{ [index: string]: TypedClasses[K] }>;
+
+export interface PreparedQuery {
+    readonly namespace: string | null;
+    readonly query: string | null;
+    readonly className: string | null;
+    readonly properties: string[] | null;
+    readonly closed: boolean;
+    run(options?: QueryOptions): object | ColumnarResult;
+    runAsync(options?: QueryOptions): Promise<object | ColumnarResult>;
+    close(): void;
+}
+
+export function prepare(namespace: string, query: string, properties?: string[], options?: QueryOptions): PreparedQuery;
+
+export interface QueryRequest {
+    namespace: string;
+    query: string;
+    properties?: string[];
+    options?: QueryOptions;
+}
+
+export interface QueryManyOptions {
+    concurrency?: number;
+    signal?: AbortSignalLike;
+}
+
+export type QueryOutcome =
+    | { status: 'fulfilled'; value: object | ColumnarResult }
+    | { status: 'rejected'; reason: Error };
+
+export function queryMany(requests: QueryRequest[], options?: QueryManyOptions): Promise<QueryOutcome[]>;
+
+export interface QueryStreamOptions extends Omit<QueryOptions, 'timings' | 'aggregate' | 'lazy'> {
+    batchSize?: number;
+    maxBufferedBatches?: number;
+}
+
+export function queryStream(namespace: string, query: string, properties?: string[], options?: QueryStreamOptions): AsyncIterableIterator<object[] | ColumnarResult>;
+
+export interface SnapshotWatchOptions extends Omit<QueryOptions, 'format' | 'aggregate' | 'lazy' | 'cacheTtlMs' | 'signal'> {
+    properties?: string[];
+}
+
+export interface SnapshotChanges {
+    added: object[];
+    removed: object[];
+    changed: object[];
+    /** One mask per changed instance, bit j is set when its j-th property changed */
+    changeMasks: Uint32Array[];
+}
+
+export interface SnapshotWatch {
+    readonly keyProperties: string[] | null;
+    readonly rows: number;
+    readonly closed: boolean;
+    poll(options?: Omit<QueryOptions, 'format' | 'cacheTtlMs'>): Promise<SnapshotChanges>;
+    close(): void;
+}
+
+export function watchSnapshot(namespace: string, query: string, keyProperties?: string[], options?: SnapshotWatchOptions): SnapshotWatch;
+
+export interface SubscribeOptions extends Omit<QueryOptions, 'format' | 'aggregate' | 'lazy' | 'cacheTtlMs' | 'priority' | 'timings' | 'partialInstances' | 'timeoutMs' | 'maxRows' | 'maxBytes' | 'signal'> {
+    properties?: string[];
+    maxQueuedEvents?: number;
+    overflow?: 'dropOldest' | 'coalesce';
+    maxBatchSize?: number;
+}
+
+export interface EventDeliveryInfo {
+    dropped: number;
+    coalesced: number;
+}
+
+export type SubscriptionCallback = (error: Error | null, events?: object[], info?: EventDeliveryInfo) => void;
+
+export interface Subscription {
+    readonly active: boolean;
+    unsubscribe(): void;
+}
+
+export function subscribe(namespace: string, eventQuery: string, callback: SubscriptionCallback, options?: SubscribeOptions): Subscription;
+
+export interface SamplerOptions {
+    capacity?: number;
+}
+
+export interface SampleWindow {
+    cursor: number;
+    lost: number;
+    rows: number;
+    timestamps: Float64Array;
+    instances: Uint32Array;
+    instanceNames: string[];
+    columns: string[];
+    data: { [property: string]: Float64Array };
+}
+
+export interface SamplerStats {
+    refreshes: number;
+    failedRefreshes: number;
+    missedTicks: number;
+    rows: number;
+    overwrittenRows: number;
+    meanLatenessMs: number;
+    maxLatenessMs: number;
+    lastError: number | null;
+}
+
+export interface Sampler {
+    readonly active: boolean;
+    read(since?: number, maxRows?: number): SampleWindow;
+    stats(): SamplerStats;
+    close(): void;
+}
+
+export function createSampler(namespace: string, className: string, properties: string[], intervalMs: number, options?: SamplerOptions): Sampler;
+
+export function close(): void;
+
+export interface WorkerOptions {
+    threads?: number;
+}
+
+export interface WorkerStats {
+    threads: number;
+    maxThreads: number;
+    idleThreads: number;
+    queuedJobs: number;
+    startedJobs: number;
+    threadStarts: number;
+    totalQueueMs: number;
+    maxQueueMs: number;
+}
+
+export function configureWorkers(options: WorkerOptions): void;
+export function workerStats(): WorkerStats;
+
+export interface EngineStats {
+    environments: number;
+    attached: number;
+    releases: number;
+}
+
+export function engineStats(): EngineStats;
+
+export interface CacheOptions {
+    maxBytes?: number;
+    classTtlMs?: { [className: string]: number };
+}
+
+export interface CacheStats {
+    hits: number;
+    misses: number;
+    coalesced: number;
+    expirations: number;
+    evictions: number;
+    invalidations: number;
+    entries: number;
+    bytes: number;
+}
+
+export function configureCache(options: CacheOptions): void;
+export function invalidateCache(namespace?: string, className?: string): void;
+export function cacheStats(): CacheStats;
+
+export interface LatencySummary {
+    count: number;
+    totalMs: number;
+    maxMs: number;
+    p50Ms: number;
+    p90Ms: number;
+    p99Ms: number;
+}
+
+export type QueryStage = 'queue' | 'connect' | 'exec' | 'next' | 'read' | 'marshal' | 'total';
+
+export interface ClassStats {
+    namespace: string;
+    className: string;
+    queries: number;
+    failures: number;
+    cacheHits: number;
+    rows: number;
+    bytes: number;
+    errors: { [errorCode: string]: number };
+    stages: { [stage in QueryStage]?: LatencySummary };
+}
+
+export interface StatsOptions {
+    enabled?: boolean;
+}
+
+export function getStats(): ClassStats[];
+export function resetStats(): void;
+export function configureStats(options: StatsOptions): void;
+
+export interface RecordingStats {
+    entries: number;
+    bytes: number;
+}
+
+export interface ReplayOptions {
+    latencyMs?: number;
+    fallback?: boolean;
+}
+
+export function startRecording(): void;
+export function stopRecording(path: string): RecordingStats;
+export function startReplay(path: string, options?: ReplayOptions): { entries: number };
+export function stopReplay(): void;
\ No newline at end of file